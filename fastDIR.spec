@@ -104,6 +104,8 @@ mkdir -p /opt/fastcfs/fdir
 
 %files -n %{FastDIRServer}
 /usr/bin/fdir_serverd
+/usr/bin/fdir_binlog_convert
+/usr/bin/fdir_binlog_compact
 %config(noreplace) /usr/lib/systemd/system/fastdir.service
 
 %post -n %{FastDIRClient}
@@ -122,6 +124,7 @@ mkdir -p /opt/fastcfs/fdir
 /usr/bin/fdir_service_stat
 /usr/bin/fdir_stat
 /usr/bin/fdir_list_servers
+/usr/bin/fdir_benchmark
 
 %files -n %{FastDIRDevel}
 %defattr(-,root,root,-)
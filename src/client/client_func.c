@@ -18,6 +18,7 @@
 #include <limits.h>
 #include "fastcommon/ini_file_reader.h"
 #include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
 #include "fastcommon/logger.h"
 #include "sf/sf_cluster_cfg.h"
 #include "fastcfs/auth/fcfs_auth_client.h"
@@ -76,6 +77,21 @@ static int fdir_client_do_init_ex(FDIRClientContext *client_ctx,
     }
 
     sf_load_read_rule_config(&client_ctx->common_cfg.read_rule, ini_ctx);
+    client_ctx->consistency.read_your_writes = iniGetBoolValue(
+            ini_ctx->section_name, "read_your_writes",
+            ini_ctx->context, false);
+    client_ctx->consistency.wait_timeout_ms = iniGetIntValueEx(
+            ini_ctx->section_name, "read_wait_version_timeout_ms",
+            ini_ctx->context, FDIR_CLIENT_DEFAULT_READ_WAIT_VERSION_TIMEOUT_MS,
+            true);
+    if (client_ctx->consistency.wait_timeout_ms < 0) {
+        client_ctx->consistency.wait_timeout_ms = 0;
+    }
+    if ((result=init_pthread_lock(&client_ctx->
+                    consistency.servers.lock)) != 0)
+    {
+        return result;
+    }
 
     if ((result=sf_load_cluster_config_ex(&client_ctx->cluster, ini_ctx,
                     FDIR_SERVER_DEFAULT_CLUSTER_PORT, full_cluster_filename,
@@ -117,7 +133,8 @@ void fdir_client_log_config_ex(FDIRClientContext *client_ctx,
     logInfo("FastDIR v%d.%d.%d, %s"
             "connect_timeout=%d, "
             "network_timeout=%d, "
-            "read_rule: %s, %s, "
+            "read_rule: %s, read_your_writes: %d, "
+            "read_wait_version_timeout_ms: %d, %s, "
             "dir_server_count=%d%s%s",
             g_fdir_global_vars.version.major,
             g_fdir_global_vars.version.minor,
@@ -126,6 +143,8 @@ void fdir_client_log_config_ex(FDIRClientContext *client_ctx,
             client_ctx->common_cfg.connect_timeout,
             client_ctx->common_cfg.network_timeout,
             sf_get_read_rule_caption(client_ctx->common_cfg.read_rule),
+            client_ctx->consistency.read_your_writes,
+            client_ctx->consistency.wait_timeout_ms,
             net_retry_output, FC_SID_SERVER_COUNT(client_ctx->cluster.server_cfg),
             extra_config != NULL ? ", " : "",
             extra_config != NULL ? extra_config : "");
@@ -257,5 +276,6 @@ void fdir_client_destroy_ex(FDIRClientContext *client_ctx)
     } else if (client_ctx->conn_manager_type == conn_manager_type_pooled) {
         fdir_pooled_connection_manager_destroy(&client_ctx->cm);
     }
+    pthread_mutex_destroy(&client_ctx->consistency.servers.lock);
     memset(client_ctx, 0, sizeof(FDIRClientContext));
 }
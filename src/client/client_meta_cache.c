@@ -0,0 +1,886 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef OS_LINUX
+#include <sys/prctl.h>
+#endif
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/hash.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/connection_pool.h"
+#include "fdir_client.h"
+#include "client_meta_cache.h"
+
+#define META_CACHE_THREAD_STACK_SIZE  (256 * 1024)
+#define META_CACHE_RECONNECT_INTERVAL_MS  1000
+
+typedef struct fdir_meta_cache_inode_entry {
+    FDIRMetaCacheEntry common;  //must be the first
+    FDIRDEntryInfo dentry;
+} FDIRMetaCacheInodeEntry;
+
+typedef struct fdir_meta_cache_pname_entry {
+    FDIRMetaCacheEntry common;  //must be the first
+    int64_t parent_inode;
+    int64_t inode;       //the inode of the dentry self, 0 for unknown
+    int64_t stat_inode;  //the inode of the hard link followed, 0 for unknown
+    unsigned int name_hash_code;
+    string_t ns;
+    string_t name;
+    char buff[0];  //for ns and name
+} FDIRMetaCachePNameEntry;
+
+#define META_CACHE_USABLE(cache) \
+    ((cache)->cfg.enabled && __sync_add_and_fetch(&(cache)->subscribed, 0))
+
+#define META_CACHE_GENERATION(cache) \
+    __sync_add_and_fetch(&(cache)->generation, 0)
+
+#define META_CACHE_INODE_HASH_CODE(inode) \
+    ((unsigned int)((inode) ^ ((inode) >> 32)))
+
+#define META_CACHE_PNAME_HASH_CODE(parent_inode, name_hash_code) \
+    (META_CACHE_INODE_HASH_CODE(parent_inode) * 31 + (name_hash_code))
+
+static inline FDIRMetaCacheShard *meta_cache_get_shard(
+        FDIRMetaCacheTable *table, const unsigned int hash_code)
+{
+    return table->shards + hash_code % table->shard_count;
+}
+
+static inline FDIRMetaCacheEntry **meta_cache_get_bucket(
+        FDIRMetaCacheTable *table, FDIRMetaCacheShard *shard,
+        const unsigned int hash_code)
+{
+    return shard->buckets + (hash_code / table->shard_count) %
+        shard->bucket_count;
+}
+
+static int meta_cache_table_init(FDIRMetaCacheTable *table,
+        const int capacity)
+{
+    FDIRMetaCacheShard *shard;
+    FDIRMetaCacheShard *end;
+    int bytes;
+    int result;
+
+    table->shard_count = FDIR_CLIENT_META_CACHE_SHARD_COUNT;
+    bytes = sizeof(FDIRMetaCacheShard) * table->shard_count;
+    table->shards = (FDIRMetaCacheShard *)fc_malloc(bytes);
+    if (table->shards == NULL) {
+        return ENOMEM;
+    }
+
+    end = table->shards + table->shard_count;
+    for (shard=table->shards; shard<end; shard++) {
+        shard->count = 0;
+        shard->capacity = capacity / table->shard_count + 1;
+        shard->bucket_count = shard->capacity;
+        bytes = sizeof(FDIRMetaCacheEntry *) * shard->bucket_count;
+        shard->buckets = (FDIRMetaCacheEntry **)fc_calloc(bytes);
+        if (shard->buckets == NULL) {
+            return ENOMEM;
+        }
+        FC_INIT_LIST_HEAD(&shard->fifo);
+        if ((result=init_pthread_lock(&shard->lock)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static void meta_cache_shard_remove(FDIRMetaCacheTable *table,
+        FDIRMetaCacheShard *shard, FDIRMetaCacheEntry *entry)
+{
+    FDIRMetaCacheEntry **bucket;
+    FDIRMetaCacheEntry *previous;
+
+    bucket = meta_cache_get_bucket(table, shard, entry->hash_code);
+    if (*bucket == entry) {
+        *bucket = entry->next;
+    } else {
+        previous = *bucket;
+        while (previous->next != entry) {
+            previous = previous->next;
+        }
+        previous->next = entry->next;
+    }
+
+    fc_list_del_init(&entry->dlink);
+    shard->count--;
+    free(entry);
+}
+
+static void meta_cache_shard_clear(FDIRMetaCacheShard *shard)
+{
+    FDIRMetaCacheEntry *entry;
+    FDIRMetaCacheEntry *tmp;
+
+    fc_list_for_each_entry_safe(entry, tmp, &shard->fifo, dlink) {
+        free(entry);
+    }
+    FC_INIT_LIST_HEAD(&shard->fifo);
+    memset(shard->buckets, 0, sizeof(FDIRMetaCacheEntry *) *
+            shard->bucket_count);
+    shard->count = 0;
+}
+
+static void meta_cache_table_clear(FDIRMetaCacheTable *table)
+{
+    FDIRMetaCacheShard *shard;
+    FDIRMetaCacheShard *end;
+
+    end = table->shards + table->shard_count;
+    for (shard=table->shards; shard<end; shard++) {
+        PTHREAD_MUTEX_LOCK(&shard->lock);
+        meta_cache_shard_clear(shard);
+        PTHREAD_MUTEX_UNLOCK(&shard->lock);
+    }
+}
+
+static void meta_cache_table_destroy(FDIRMetaCacheTable *table)
+{
+    FDIRMetaCacheShard *shard;
+    FDIRMetaCacheShard *end;
+
+    if (table->shards == NULL) {
+        return;
+    }
+
+    end = table->shards + table->shard_count;
+    for (shard=table->shards; shard<end; shard++) {
+        if (shard->buckets != NULL) {
+            meta_cache_shard_clear(shard);
+            free(shard->buckets);
+            pthread_mutex_destroy(&shard->lock);
+        }
+    }
+    free(table->shards);
+    table->shards = NULL;
+}
+
+//the caller MUST hold the shard lock
+static void meta_cache_shard_insert(FDIRMetaCacheTable *table,
+        FDIRMetaCacheShard *shard, FDIRMetaCacheEntry *entry)
+{
+    FDIRMetaCacheEntry **bucket;
+
+    if (shard->count >= shard->capacity) {
+        meta_cache_shard_remove(table, shard, fc_list_first_entry(
+                    &shard->fifo, FDIRMetaCacheEntry, dlink));
+    }
+
+    bucket = meta_cache_get_bucket(table, shard, entry->hash_code);
+    entry->next = *bucket;
+    *bucket = entry;
+    fc_list_add_tail(&entry->dlink, &shard->fifo);
+    shard->count++;
+}
+
+static inline bool pname_entry_match(const FDIRMetaCachePNameEntry *entry,
+        const string_t *ns, const FDIRDEntryPName *pname)
+{
+    return entry->parent_inode == pname->parent_inode &&
+        fc_string_equal(&entry->name, &pname->name) &&
+        fc_string_equal(&entry->ns, ns);
+}
+
+static int meta_cache_get_inode(FDIRClientMetaCache *cache,
+        const int64_t inode, FDIRDEntryInfo *dentry)
+{
+    FDIRMetaCacheShard *shard;
+    FDIRMetaCacheEntry *entry;
+    unsigned int hash_code;
+    int result;
+
+    hash_code = META_CACHE_INODE_HASH_CODE(inode);
+    shard = meta_cache_get_shard(&cache->inodes, hash_code);
+    result = ENOENT;
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    entry = *meta_cache_get_bucket(&cache->inodes, shard, hash_code);
+    while (entry != NULL) {
+        if (((FDIRMetaCacheInodeEntry *)entry)->dentry.inode == inode) {
+            if (entry->expires_ms > get_current_time_ms()) {
+                *dentry = ((FDIRMetaCacheInodeEntry *)entry)->dentry;
+                result = 0;
+            } else {
+                meta_cache_shard_remove(&cache->inodes, shard, entry);
+            }
+            break;
+        }
+        entry = entry->next;
+    }
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
+
+    return result;
+}
+
+#define PNAME_ENTRY_INODE(entry, follow) \
+    (follow ? (entry)->stat_inode : (entry)->inode)
+
+static int meta_cache_get_pname(FDIRClientMetaCache *cache,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        const bool follow, int64_t *inode)
+{
+    FDIRMetaCachePNameEntry *pentry;
+    FDIRMetaCacheShard *shard;
+    FDIRMetaCacheEntry *entry;
+    unsigned int hash_code;
+    int result;
+
+    hash_code = META_CACHE_PNAME_HASH_CODE(pname->parent_inode,
+            simple_hash(pname->name.str, pname->name.len));
+    shard = meta_cache_get_shard(&cache->pnames, hash_code);
+    result = ENOENT;
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    entry = *meta_cache_get_bucket(&cache->pnames, shard, hash_code);
+    while (entry != NULL) {
+        pentry = (FDIRMetaCachePNameEntry *)entry;
+        if (entry->hash_code == hash_code &&
+                pname_entry_match(pentry, ns, pname))
+        {
+            if (entry->expires_ms > get_current_time_ms()) {
+                if ((*inode=PNAME_ENTRY_INODE(pentry, follow)) != 0) {
+                    result = 0;
+                }
+            } else {
+                meta_cache_shard_remove(&cache->pnames, shard, entry);
+            }
+            break;
+        }
+        entry = entry->next;
+    }
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
+
+    return result;
+}
+
+/* the entry is NOT cached when the generation changed during the query
+ * because the invalidate event of the entry maybe applied before */
+static void meta_cache_put_inode(FDIRClientMetaCache *cache,
+        const int64_t generation, const FDIRDEntryInfo *dentry)
+{
+    FDIRMetaCacheShard *shard;
+    FDIRMetaCacheEntry *entry;
+    FDIRMetaCacheInodeEntry *ientry;
+    unsigned int hash_code;
+
+    hash_code = META_CACHE_INODE_HASH_CODE(dentry->inode);
+    shard = meta_cache_get_shard(&cache->inodes, hash_code);
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    do {
+        if (META_CACHE_GENERATION(cache) != generation) {
+            break;
+        }
+
+        entry = *meta_cache_get_bucket(&cache->inodes, shard, hash_code);
+        while (entry != NULL) {
+            if (((FDIRMetaCacheInodeEntry *)entry)->dentry.inode ==
+                    dentry->inode)
+            {
+                break;
+            }
+            entry = entry->next;
+        }
+
+        if (entry != NULL) {
+            ientry = (FDIRMetaCacheInodeEntry *)entry;
+        } else {
+            ientry = (FDIRMetaCacheInodeEntry *)fc_malloc(
+                    sizeof(FDIRMetaCacheInodeEntry));
+            if (ientry == NULL) {
+                break;
+            }
+            ientry->common.hash_code = hash_code;
+            meta_cache_shard_insert(&cache->inodes, shard, &ientry->common);
+        }
+
+        ientry->dentry = *dentry;
+        ientry->common.expires_ms = get_current_time_ms() +
+            cache->cfg.lease_ms;
+    } while (0);
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
+}
+
+static void meta_cache_put_pname(FDIRClientMetaCache *cache,
+        const int64_t generation, const string_t *ns,
+        const FDIRDEntryPName *pname, const bool follow,
+        const int64_t inode)
+{
+    FDIRMetaCacheShard *shard;
+    FDIRMetaCacheEntry *entry;
+    FDIRMetaCachePNameEntry *pentry;
+    unsigned int name_hash_code;
+    unsigned int hash_code;
+
+    name_hash_code = simple_hash(pname->name.str, pname->name.len);
+    hash_code = META_CACHE_PNAME_HASH_CODE(pname->parent_inode,
+            name_hash_code);
+    shard = meta_cache_get_shard(&cache->pnames, hash_code);
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    do {
+        if (META_CACHE_GENERATION(cache) != generation) {
+            break;
+        }
+
+        entry = *meta_cache_get_bucket(&cache->pnames, shard, hash_code);
+        while (entry != NULL) {
+            if (entry->hash_code == hash_code && pname_entry_match(
+                        (FDIRMetaCachePNameEntry *)entry, ns, pname))
+            {
+                break;
+            }
+            entry = entry->next;
+        }
+
+        if (entry != NULL) {
+            pentry = (FDIRMetaCachePNameEntry *)entry;
+        } else {
+            pentry = (FDIRMetaCachePNameEntry *)fc_malloc(
+                    sizeof(FDIRMetaCachePNameEntry) +
+                    ns->len + pname->name.len);
+            if (pentry == NULL) {
+                break;
+            }
+
+            pentry->common.hash_code = hash_code;
+            pentry->parent_inode = pname->parent_inode;
+            pentry->inode = pentry->stat_inode = 0;
+            pentry->name_hash_code = name_hash_code;
+            pentry->ns.str = pentry->buff;
+            pentry->ns.len = ns->len;
+            memcpy(pentry->ns.str, ns->str, ns->len);
+            pentry->name.str = pentry->buff + ns->len;
+            pentry->name.len = pname->name.len;
+            memcpy(pentry->name.str, pname->name.str, pname->name.len);
+            meta_cache_shard_insert(&cache->pnames, shard, &pentry->common);
+        }
+
+        if (follow) {
+            pentry->stat_inode = inode;
+        } else {
+            pentry->inode = inode;
+        }
+        pentry->common.expires_ms = get_current_time_ms() +
+            cache->cfg.lease_ms;
+    } while (0);
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
+}
+
+static void meta_cache_drop_inode(FDIRClientMetaCache *cache,
+        const int64_t inode)
+{
+    FDIRMetaCacheShard *shard;
+    FDIRMetaCacheEntry *entry;
+    unsigned int hash_code;
+
+    hash_code = META_CACHE_INODE_HASH_CODE(inode);
+    shard = meta_cache_get_shard(&cache->inodes, hash_code);
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    entry = *meta_cache_get_bucket(&cache->inodes, shard, hash_code);
+    while (entry != NULL) {
+        if (((FDIRMetaCacheInodeEntry *)entry)->dentry.inode == inode) {
+            meta_cache_shard_remove(&cache->inodes, shard, entry);
+            break;
+        }
+        entry = entry->next;
+    }
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
+}
+
+/* drop the entries of all namespaces with the same parent inode and
+ * name hash code, the collision only causes an extra miss */
+static void meta_cache_drop_pname(FDIRClientMetaCache *cache,
+        const int64_t parent_inode, const unsigned int name_hash_code)
+{
+    FDIRMetaCacheShard *shard;
+    FDIRMetaCacheEntry *entry;
+    FDIRMetaCacheEntry *current;
+    FDIRMetaCachePNameEntry *pentry;
+    unsigned int hash_code;
+
+    hash_code = META_CACHE_PNAME_HASH_CODE(parent_inode, name_hash_code);
+    shard = meta_cache_get_shard(&cache->pnames, hash_code);
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    entry = *meta_cache_get_bucket(&cache->pnames, shard, hash_code);
+    while (entry != NULL) {
+        current = entry;
+        entry = entry->next;
+
+        pentry = (FDIRMetaCachePNameEntry *)current;
+        if (pentry->parent_inode == parent_inode &&
+                pentry->name_hash_code == name_hash_code)
+        {
+            meta_cache_shard_remove(&cache->pnames, shard, current);
+        }
+    }
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
+}
+
+static void meta_cache_apply_events(FDIRClientMetaCache *cache,
+        const FDIRClientInvalidateArray *array)
+{
+    const FDIRClientInvalidateEvent *event;
+    const FDIRClientInvalidateEvent *end;
+
+    if (array->overflow) {
+        fdir_client_meta_cache_clear(cache);
+    }
+    if (array->count == 0) {
+        return;
+    }
+
+    __sync_add_and_fetch(&cache->generation, 1);
+    end = array->events + array->count;
+    for (event=array->events; event<end; event++) {
+        if ((event->flags & FDIR_INVALIDATE_FLAGS_PNAME) != 0) {
+            meta_cache_drop_pname(cache, event->parent_inode,
+                    event->name_hash_code);
+        }
+        if ((event->flags & FDIR_INVALIDATE_FLAGS_INODE) != 0) {
+            meta_cache_drop_inode(cache, event->inode);
+        }
+    }
+}
+
+static int meta_cache_subscribe(FDIRClientMetaCache *cache)
+{
+    FDIRClientServerEntry master;
+    int result;
+
+    if ((result=fdir_client_get_master(cache->client_ctx, &master)) != 0) {
+        return result;
+    }
+
+    conn_pool_set_server_info(&cache->conn, master.conn.ip_addr,
+            master.conn.port);
+    if ((result=conn_pool_connect_server(&cache->conn, cache->
+                    client_ctx->common_cfg.connect_timeout)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=fdir_client_proto_join_server(cache->client_ctx,
+                    &cache->conn, NULL)) != 0 ||
+            (result=fdir_client_proto_invalidate_subscribe(
+                    cache->client_ctx, &cache->conn)) != 0)
+    {
+        conn_pool_disconnect_server(&cache->conn);
+        return result;
+    }
+
+    //the events before the subscription are lost
+    fdir_client_meta_cache_clear(cache);
+    __sync_bool_compare_and_swap(&cache->subscribed, 0, 1);
+    return 0;
+}
+
+static void meta_cache_unsubscribe(FDIRClientMetaCache *cache)
+{
+    __sync_bool_compare_and_swap(&cache->subscribed, 1, 0);
+    conn_pool_disconnect_server(&cache->conn);
+    fdir_client_meta_cache_clear(cache);
+}
+
+static int meta_cache_fetch(FDIRClientMetaCache *cache)
+{
+    bool is_last;
+    int result;
+
+    do {
+        if ((result=fdir_client_proto_invalidate_fetch(cache->client_ctx,
+                        &cache->conn, &cache->array, &is_last)) != 0)
+        {
+            return result;
+        }
+        meta_cache_apply_events(cache, &cache->array);
+    } while (!is_last && cache->running);
+
+    return 0;
+}
+
+static void *meta_cache_thread_func(void *arg)
+{
+    FDIRClientMetaCache *cache;
+
+    cache = (FDIRClientMetaCache *)arg;
+#ifdef OS_LINUX
+    prctl(PR_SET_NAME, "fdir-meta-cache");
+#endif
+
+    while (cache->running) {
+        if (cache->conn.sock < 0) {
+            if (meta_cache_subscribe(cache) != 0) {
+                fc_sleep_ms(META_CACHE_RECONNECT_INTERVAL_MS);
+                continue;
+            }
+        }
+
+        if (meta_cache_fetch(cache) != 0) {
+            meta_cache_unsubscribe(cache);
+            continue;
+        }
+        fc_sleep_ms(cache->cfg.fetch_interval_ms);
+    }
+
+    if (cache->conn.sock >= 0) {
+        meta_cache_unsubscribe(cache);
+    }
+    cache->thread_running = false;
+    return NULL;
+}
+
+void fdir_client_meta_cache_load_config(IniFullContext *ini_ctx,
+        FDIRClientMetaCacheConfig *cfg)
+{
+    cfg->enabled = iniGetBoolValue(ini_ctx->section_name,
+            "meta_cache_enabled", ini_ctx->context, false);
+    cfg->lease_ms = iniGetIntValue(ini_ctx->section_name,
+            "meta_cache_lease_ms", ini_ctx->context,
+            FDIR_CLIENT_META_CACHE_DEFAULT_LEASE_MS);
+    if (cfg->lease_ms <= 0) {
+        cfg->lease_ms = FDIR_CLIENT_META_CACHE_DEFAULT_LEASE_MS;
+    }
+    cfg->capacity = iniGetIntValue(ini_ctx->section_name,
+            "meta_cache_capacity", ini_ctx->context,
+            FDIR_CLIENT_META_CACHE_DEFAULT_CAPACITY);
+    if (cfg->capacity <= 0) {
+        cfg->capacity = FDIR_CLIENT_META_CACHE_DEFAULT_CAPACITY;
+    }
+    cfg->fetch_interval_ms = iniGetIntValue(ini_ctx->section_name,
+            "meta_cache_fetch_interval_ms", ini_ctx->context,
+            FDIR_CLIENT_META_CACHE_DEFAULT_FETCH_INTERVAL_MS);
+    if (cfg->fetch_interval_ms <= 0) {
+        cfg->fetch_interval_ms =
+            FDIR_CLIENT_META_CACHE_DEFAULT_FETCH_INTERVAL_MS;
+    }
+}
+
+int fdir_client_meta_cache_init(FDIRClientMetaCache *cache,
+        FDIRClientContext *client_ctx,
+        const FDIRClientMetaCacheConfig *cfg)
+{
+    pthread_t tid;
+    int result;
+
+    memset(cache, 0, sizeof(*cache));
+    cache->client_ctx = client_ctx;
+    cache->cfg = *cfg;
+    cache->conn.sock = -1;
+    if (!cfg->enabled) {
+        return 0;
+    }
+
+    if ((result=meta_cache_table_init(&cache->inodes,
+                    cfg->capacity)) != 0)
+    {
+        return result;
+    }
+    if ((result=meta_cache_table_init(&cache->pnames,
+                    cfg->capacity)) != 0)
+    {
+        return result;
+    }
+    if ((result=fdir_client_invalidate_array_init(&cache->array)) != 0) {
+        return result;
+    }
+
+    cache->running = true;
+    cache->thread_running = true;
+    if ((result=fc_create_thread(&tid, meta_cache_thread_func,
+                    cache, META_CACHE_THREAD_STACK_SIZE)) != 0)
+    {
+        cache->running = false;
+        cache->thread_running = false;
+    }
+    return result;
+}
+
+void fdir_client_meta_cache_destroy(FDIRClientMetaCache *cache)
+{
+    if (!cache->cfg.enabled) {
+        return;
+    }
+
+    cache->running = false;
+    while (cache->thread_running) {
+        fc_sleep_ms(10);
+    }
+
+    meta_cache_table_destroy(&cache->inodes);
+    meta_cache_table_destroy(&cache->pnames);
+    fdir_client_invalidate_array_free(&cache->array);
+    cache->cfg.enabled = false;
+}
+
+void fdir_client_meta_cache_clear(FDIRClientMetaCache *cache)
+{
+    if (!cache->cfg.enabled) {
+        return;
+    }
+
+    __sync_add_and_fetch(&cache->generation, 1);
+    meta_cache_table_clear(&cache->inodes);
+    meta_cache_table_clear(&cache->pnames);
+}
+
+void fdir_client_meta_cache_invalidate_inode(FDIRClientMetaCache *cache,
+        const int64_t inode)
+{
+    if (!cache->cfg.enabled) {
+        return;
+    }
+
+    __sync_add_and_fetch(&cache->generation, 1);
+    meta_cache_drop_inode(cache, inode);
+}
+
+void fdir_client_meta_cache_invalidate_pname(FDIRClientMetaCache *cache,
+        const FDIRDEntryPName *pname)
+{
+    if (!cache->cfg.enabled) {
+        return;
+    }
+
+    __sync_add_and_fetch(&cache->generation, 1);
+    meta_cache_drop_pname(cache, pname->parent_inode,
+            simple_hash(pname->name.str, pname->name.len));
+}
+
+int fdir_client_cached_stat_dentry_by_inode(FDIRClientMetaCache *cache,
+        const string_t *ns, const int64_t inode, FDIRDEntryInfo *dentry)
+{
+    int64_t generation;
+    int result;
+
+    if (!META_CACHE_USABLE(cache)) {
+        return fdir_client_stat_dentry_by_inode(cache->client_ctx,
+                ns, inode, dentry);
+    }
+
+    if (meta_cache_get_inode(cache, inode, dentry) == 0) {
+        return 0;
+    }
+
+    generation = META_CACHE_GENERATION(cache);
+    if ((result=fdir_client_master_stat_dentry_by_inode(cache->client_ctx,
+                    ns, inode, dentry)) == 0)
+    {
+        meta_cache_put_inode(cache, generation, dentry);
+    }
+    return result;
+}
+
+int fdir_client_cached_stat_dentry_by_pname_ex(FDIRClientMetaCache *cache,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        const int enoent_log_level, FDIRDEntryInfo *dentry)
+{
+    int64_t generation;
+    int64_t inode;
+    int result;
+
+    if (!META_CACHE_USABLE(cache)) {
+        return fdir_client_stat_dentry_by_pname_ex(cache->client_ctx,
+                ns, pname, enoent_log_level, dentry);
+    }
+
+    if (meta_cache_get_pname(cache, ns, pname, true, &inode) == 0 &&
+            meta_cache_get_inode(cache, inode, dentry) == 0)
+    {
+        return 0;
+    }
+
+    generation = META_CACHE_GENERATION(cache);
+    if ((result=fdir_client_master_stat_dentry_by_pname_ex(
+                    cache->client_ctx, ns, pname,
+                    enoent_log_level, dentry)) == 0)
+    {
+        meta_cache_put_pname(cache, generation, ns,
+                pname, true, dentry->inode);
+        meta_cache_put_inode(cache, generation, dentry);
+    }
+    return result;
+}
+
+int fdir_client_cached_lookup_inode_by_pname_ex(FDIRClientMetaCache *cache,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        const int enoent_log_level, int64_t *inode)
+{
+    int64_t generation;
+    int result;
+
+    if (!META_CACHE_USABLE(cache)) {
+        return fdir_client_lookup_inode_by_pname_ex(cache->client_ctx,
+                ns, pname, enoent_log_level, inode);
+    }
+
+    if (meta_cache_get_pname(cache, ns, pname, false, inode) == 0) {
+        return 0;
+    }
+
+    generation = META_CACHE_GENERATION(cache);
+    if ((result=fdir_client_master_lookup_inode_by_pname_ex(
+                    cache->client_ctx, ns, pname,
+                    enoent_log_level, inode)) == 0)
+    {
+        meta_cache_put_pname(cache, generation, ns, pname, false, *inode);
+    }
+    return result;
+}
+
+static int meta_cache_stat_root(FDIRClientMetaCache *cache,
+        const string_t *ns, const int enoent_log_level,
+        FDIRDEntryInfo *dentry)
+{
+    FDIRDEntryPName pname;
+    FDIRDEntryFullName fullname;
+    int64_t generation;
+    int64_t inode;
+    int result;
+
+    //the root is cached with parent inode 0 and empty name
+    pname.parent_inode = 0;
+    FC_SET_STRING_EX(pname.name, "", 0);
+    if (meta_cache_get_pname(cache, ns, &pname, true, &inode) == 0 &&
+            meta_cache_get_inode(cache, inode, dentry) == 0)
+    {
+        return 0;
+    }
+
+    generation = META_CACHE_GENERATION(cache);
+    fullname.ns = *ns;
+    FC_SET_STRING_EX(fullname.path, "/", 1);
+    if ((result=fdir_client_master_stat_dentry_by_path_ex(
+                    cache->client_ctx, &fullname,
+                    enoent_log_level, dentry)) == 0)
+    {
+        meta_cache_put_pname(cache, generation, ns,
+                &pname, true, dentry->inode);
+        meta_cache_put_inode(cache, generation, dentry);
+    }
+    return result;
+}
+
+/* walk the path by (parent inode, name) so that the rename of any
+ * ancestor invalidates the walk, output the pname of the last component,
+ * pname->name.len is 0 for the root (dentry is the root in this case).
+ * return EAGAIN for . and .. */
+static int meta_cache_resolve_pname(FDIRClientMetaCache *cache,
+        const FDIRDEntryFullName *fullname, const int enoent_log_level,
+        FDIRDEntryPName *pname, FDIRDEntryInfo *dentry)
+{
+    char *p;
+    char *end;
+    char *start;
+    int result;
+
+    if ((result=meta_cache_stat_root(cache, &fullname->ns,
+                    enoent_log_level, dentry)) != 0)
+    {
+        return result;
+    }
+
+    pname->parent_inode = 0;
+    FC_SET_STRING_EX(pname->name, "", 0);
+    p = fullname->path.str;
+    end = fullname->path.str + fullname->path.len;
+    while (p < end) {
+        while (p < end && *p == '/') {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+
+        start = p;
+        while (p < end && *p != '/') {
+            p++;
+        }
+        if (*start == '.' && ((p - start == 1) ||
+                    (p - start == 2 && *(start + 1) == '.')))
+        {
+            return EAGAIN;
+        }
+
+        if (pname->name.len > 0) {  //the parent of this component
+            if ((result=fdir_client_cached_stat_dentry_by_pname_ex(cache,
+                            &fullname->ns, pname, enoent_log_level,
+                            dentry)) != 0)
+            {
+                return result;
+            }
+        }
+        pname->parent_inode = dentry->inode;
+        FC_SET_STRING_EX(pname->name, start, p - start);
+    }
+
+    return 0;
+}
+
+int fdir_client_cached_stat_dentry_by_path_ex(FDIRClientMetaCache *cache,
+        const FDIRDEntryFullName *fullname, const int enoent_log_level,
+        FDIRDEntryInfo *dentry)
+{
+    FDIRDEntryPName pname;
+    int result;
+
+    if (META_CACHE_USABLE(cache)) {
+        result = meta_cache_resolve_pname(cache, fullname,
+                enoent_log_level, &pname, dentry);
+        if (result == 0 && pname.name.len > 0) {
+            result = fdir_client_cached_stat_dentry_by_pname_ex(cache,
+                    &fullname->ns, &pname, enoent_log_level, dentry);
+        }
+        if (result != EAGAIN) {
+            return result;
+        }
+    }
+
+    return fdir_client_stat_dentry_by_path_ex(cache->client_ctx,
+            fullname, enoent_log_level, dentry);
+}
+
+int fdir_client_cached_lookup_inode_by_path_ex(FDIRClientMetaCache *cache,
+        const FDIRDEntryFullName *fullname, const int enoent_log_level,
+        int64_t *inode)
+{
+    FDIRDEntryPName pname;
+    FDIRDEntryInfo dentry;
+    int result;
+
+    if (META_CACHE_USABLE(cache)) {
+        result = meta_cache_resolve_pname(cache, fullname,
+                enoent_log_level, &pname, &dentry);
+        if (result == 0) {
+            if (pname.name.len > 0) {
+                result = fdir_client_cached_lookup_inode_by_pname_ex(cache,
+                        &fullname->ns, &pname, enoent_log_level, inode);
+            } else {
+                *inode = dentry.inode;
+            }
+        }
+        if (result != EAGAIN) {
+            return result;
+        }
+    }
+
+    return fdir_client_lookup_inode_by_path_ex(cache->client_ctx,
+            fullname, enoent_log_level, inode);
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FDIR_CLIENT_META_CACHE_H
+#define _FDIR_CLIENT_META_CACHE_H
+
+#include <pthread.h>
+#include "fastcommon/fc_list.h"
+#include "fdir_proto.h"
+#include "client_types.h"
+#include "client_proto.h"
+
+#define FDIR_CLIENT_META_CACHE_DEFAULT_LEASE_MS           3000
+#define FDIR_CLIENT_META_CACHE_DEFAULT_CAPACITY          65536
+#define FDIR_CLIENT_META_CACHE_DEFAULT_FETCH_INTERVAL_MS   100
+#define FDIR_CLIENT_META_CACHE_SHARD_COUNT                  61
+
+typedef struct fdir_client_meta_cache_config {
+    bool enabled;
+    int lease_ms;           //the max time to trust a cached entry
+    int capacity;           //the max entry count of each table
+    int fetch_interval_ms;  //the interval to fetch the invalidate events
+} FDIRClientMetaCacheConfig;
+
+typedef struct fdir_meta_cache_entry {
+    unsigned int hash_code;
+    int64_t expires_ms;
+    struct fdir_meta_cache_entry *next;  //for hash chain
+    struct fc_list_head dlink;           //for FIFO eviction
+} FDIRMetaCacheEntry;
+
+typedef struct fdir_meta_cache_shard {
+    pthread_mutex_t lock;
+    int count;
+    int capacity;
+    int bucket_count;
+    FDIRMetaCacheEntry **buckets;
+    struct fc_list_head fifo;
+} FDIRMetaCacheShard;
+
+typedef struct fdir_meta_cache_table {
+    int shard_count;
+    FDIRMetaCacheShard *shards;
+} FDIRMetaCacheTable;
+
+/* the optional dentry cache of the client with lease, the entries are
+ * keyed by inode (the attributes) and by (ns, parent inode, name) (the
+ * inode of the name). the cached entries are dropped by the invalidate
+ * events pushed by the master through a subscribed connection, the cache
+ * is bypassed when the subscription is broken. the missed entries are
+ * read from the master too, because a lagging slave may return the stale
+ * entry whose invalidate event has been fetched already.
+ *
+ * the cache is thread safe. the updates of this process are NOT seen by
+ * the cache until the events are fetched, call the invalidate functions
+ * after the update for read-your-writes */
+typedef struct fdir_client_meta_cache {
+    FDIRClientContext *client_ctx;
+    FDIRClientMetaCacheConfig cfg;
+    FDIRMetaCacheTable inodes;
+    FDIRMetaCacheTable pnames;
+    volatile int64_t generation;  //changed when entries are invalidated
+    volatile int subscribed;      //the cache is usable
+    volatile bool running;
+    volatile bool thread_running;
+    ConnectionInfo conn;          //for the invalidate events
+    FDIRClientInvalidateArray array;
+} FDIRClientMetaCache;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* load the items prefixed with meta_cache_ from the section */
+void fdir_client_meta_cache_load_config(IniFullContext *ini_ctx,
+        FDIRClientMetaCacheConfig *cfg);
+
+/* start the fetch thread when cfg->enabled */
+int fdir_client_meta_cache_init(FDIRClientMetaCache *cache,
+        FDIRClientContext *client_ctx,
+        const FDIRClientMetaCacheConfig *cfg);
+
+void fdir_client_meta_cache_destroy(FDIRClientMetaCache *cache);
+
+void fdir_client_meta_cache_clear(FDIRClientMetaCache *cache);
+
+void fdir_client_meta_cache_invalidate_inode(FDIRClientMetaCache *cache,
+        const int64_t inode);
+
+void fdir_client_meta_cache_invalidate_pname(FDIRClientMetaCache *cache,
+        const FDIRDEntryPName *pname);
+
+#define fdir_client_cached_lookup_inode_by_path(cache, fullname, inode) \
+    fdir_client_cached_lookup_inode_by_path_ex(cache, \
+            fullname, LOG_ERR, inode)
+
+#define fdir_client_cached_lookup_inode_by_pname(cache, ns, pname, inode) \
+    fdir_client_cached_lookup_inode_by_pname_ex(cache, \
+            ns, pname, LOG_ERR, inode)
+
+#define fdir_client_cached_stat_dentry_by_path(cache, fullname, dentry) \
+    fdir_client_cached_stat_dentry_by_path_ex(cache, \
+            fullname, LOG_ERR, dentry)
+
+#define fdir_client_cached_stat_dentry_by_pname(cache, ns, pname, dentry) \
+    fdir_client_cached_stat_dentry_by_pname_ex(cache, \
+            ns, pname, LOG_ERR, dentry)
+
+int fdir_client_cached_lookup_inode_by_path_ex(FDIRClientMetaCache *cache,
+        const FDIRDEntryFullName *fullname, const int enoent_log_level,
+        int64_t *inode);
+
+int fdir_client_cached_lookup_inode_by_pname_ex(FDIRClientMetaCache *cache,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        const int enoent_log_level, int64_t *inode);
+
+int fdir_client_cached_stat_dentry_by_path_ex(FDIRClientMetaCache *cache,
+        const FDIRDEntryFullName *fullname, const int enoent_log_level,
+        FDIRDEntryInfo *dentry);
+
+int fdir_client_cached_stat_dentry_by_pname_ex(FDIRClientMetaCache *cache,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        const int enoent_log_level, FDIRDEntryInfo *dentry);
+
+int fdir_client_cached_stat_dentry_by_inode(FDIRClientMetaCache *cache,
+        const string_t *ns, const int64_t inode, FDIRDEntryInfo *dentry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,636 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/sockopt.h"
+#include "fastcommon/connection_pool.h"
+#include "fdir_proto.h"
+#include "client_proto.h"
+#include "client_pipeline.h"
+
+#define PIPELINE_NETWORK_TIMEOUT(pipeline) \
+    (pipeline)->client_ctx->common_cfg.network_timeout
+
+static inline void pipeline_queue_push(FDIRClientPipelineQueue *queue,
+        FDIRClientPipelineRequest *request)
+{
+    request->next = NULL;
+    if (queue->tail == NULL) {
+        queue->head = request;
+    } else {
+        queue->tail->next = request;
+    }
+    queue->tail = request;
+    queue->count++;
+}
+
+static inline FDIRClientPipelineRequest *pipeline_queue_pop(
+        FDIRClientPipelineQueue *queue)
+{
+    FDIRClientPipelineRequest *request;
+
+    if ((request=queue->head) == NULL) {
+        return NULL;
+    }
+
+    queue->head = request->next;
+    if (queue->head == NULL) {
+        queue->tail = NULL;
+    }
+    queue->count--;
+    return request;
+}
+
+static inline void pipeline_queue_init(FDIRClientPipelineQueue *queue)
+{
+    queue->count = 0;
+    queue->head = queue->tail = NULL;
+}
+
+int fdir_client_pipeline_init(FDIRClientPipeline *pipeline,
+        FDIRClientContext *client_ctx, const int window_size,
+        const bool readonly)
+{
+    pipeline->send_buffer.alloc = FDIR_CLIENT_PIPELINE_SEND_BUFFER_SIZE;
+    pipeline->send_buffer.buff = (char *)fc_malloc(
+            pipeline->send_buffer.alloc);
+    if (pipeline->send_buffer.buff == NULL) {
+        return ENOMEM;
+    }
+    pipeline->send_buffer.length = 0;
+
+    if (window_size <= 0) {
+        pipeline->window_size = FDIR_CLIENT_PIPELINE_DEFAULT_WINDOW_SIZE;
+    } else if (window_size > FDIR_CLIENT_PIPELINE_MAX_WINDOW_SIZE) {
+        pipeline->window_size = FDIR_CLIENT_PIPELINE_MAX_WINDOW_SIZE;
+    } else {
+        pipeline->window_size = window_size;
+    }
+
+    pipeline->client_ctx = client_ctx;
+    pipeline->readonly = readonly;
+    pipeline->current_req_id = 0;
+    pipeline_queue_init(&pipeline->pending);
+    pipeline_queue_init(&pipeline->inflight);
+    pipeline_queue_init(&pipeline->completed);
+    memset(&pipeline->conn, 0, sizeof(pipeline->conn));
+    pipeline->conn.sock = -1;
+    return 0;
+}
+
+static int pipeline_connect(FDIRClientPipeline *pipeline)
+{
+    FDIRClientServerEntry server;
+    int result;
+
+    if (pipeline->readonly) {
+        result = fdir_client_get_readable_server(
+                pipeline->client_ctx, &server);
+    } else {
+        result = fdir_client_get_master(pipeline->client_ctx, &server);
+    }
+    if (result != 0) {
+        return result;
+    }
+
+    conn_pool_set_server_info(&pipeline->conn,
+            server.conn.ip_addr, server.conn.port);
+    if ((result=conn_pool_connect_server(&pipeline->conn, pipeline->
+                    client_ctx->common_cfg.connect_timeout)) != 0)
+    {
+        return result;
+    }
+
+    //without idempotency channel because the requests are not retried
+    if ((result=fdir_client_proto_join_server(pipeline->client_ctx,
+                    &pipeline->conn, NULL)) != 0)
+    {
+        conn_pool_disconnect_server(&pipeline->conn);
+    }
+    return result;
+}
+
+static void pipeline_complete(FDIRClientPipeline *pipeline,
+        FDIRClientPipelineRequest *request)
+{
+    if (request->callback != NULL) {
+        request->callback(request);
+    } else {
+        pipeline_queue_push(&pipeline->completed, request);
+    }
+}
+
+static void pipeline_complete_all(FDIRClientPipeline *pipeline,
+        FDIRClientPipelineQueue *queue, const int result)
+{
+    FDIRClientPipelineQueue detached;
+    FDIRClientPipelineRequest *request;
+
+    detached = *queue;
+    pipeline_queue_init(queue);
+    while ((request=pipeline_queue_pop(&detached)) != NULL) {
+        request->result = result;
+        pipeline_complete(pipeline, request);
+    }
+}
+
+//the requests after the broken one can't be matched any more
+static void pipeline_fail_all(FDIRClientPipeline *pipeline, const int result)
+{
+    conn_pool_disconnect_server(&pipeline->conn);
+    pipeline->send_buffer.length = 0;
+    pipeline_complete_all(pipeline, &pipeline->inflight, result);
+    pipeline_complete_all(pipeline, &pipeline->pending, result);
+}
+
+void fdir_client_pipeline_destroy(FDIRClientPipeline *pipeline)
+{
+    if (pipeline->send_buffer.buff == NULL) {
+        return;
+    }
+
+    pipeline_fail_all(pipeline, ECANCELED);
+    free(pipeline->send_buffer.buff);
+    pipeline->send_buffer.buff = NULL;
+}
+
+int fdir_client_pipeline_flush(FDIRClientPipeline *pipeline)
+{
+    int result;
+
+    if (pipeline->pending.count == 0) {
+        return 0;
+    }
+
+    if ((result=tcpsenddata_nb(pipeline->conn.sock, pipeline->
+                    send_buffer.buff, pipeline->send_buffer.length,
+                    PIPELINE_NETWORK_TIMEOUT(pipeline))) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "send %d requests to server %s:%u fail, "
+                "errno: %d, error info: %s", __LINE__,
+                pipeline->pending.count, pipeline->conn.ip_addr,
+                pipeline->conn.port, result, STRERROR(result));
+        pipeline_fail_all(pipeline, result);
+        return result;
+    }
+
+    if (pipeline->inflight.tail == NULL) {
+        pipeline->inflight.head = pipeline->pending.head;
+    } else {
+        pipeline->inflight.tail->next = pipeline->pending.head;
+    }
+    pipeline->inflight.tail = pipeline->pending.tail;
+    pipeline->inflight.count += pipeline->pending.count;
+    pipeline_queue_init(&pipeline->pending);
+    pipeline->send_buffer.length = 0;
+    return 0;
+}
+
+static int pipeline_recv_body(FDIRClientPipeline *pipeline,
+        SFResponseInfo *response, FDIRClientPipelineRequest *request)
+{
+    union {
+        FDIRProtoUpdateDEntryResp stat;
+        FDIRProtoLookupInodeResp lookup;
+    } body;
+    int expect_len;
+    int result;
+
+    if (request->output_type == FDIR_CLIENT_PIPELINE_OUTPUT_INODE) {
+        expect_len = sizeof(FDIRProtoLookupInodeResp);
+    } else if (response->header.body_len ==
+            sizeof(FDIRProtoUpdateDEntryResp))
+    {
+        expect_len = sizeof(FDIRProtoUpdateDEntryResp);
+    } else {
+        expect_len = sizeof(FDIRProtoStatDEntryResp);
+    }
+
+    if (response->header.cmd != request->resp_cmd) {
+        response->error.length = sprintf(response->error.message,
+                "response cmd: %d != expect: %d", response->header.cmd,
+                request->resp_cmd);
+        return EINVAL;
+    }
+    if (response->header.body_len != expect_len) {
+        response->error.length = sprintf(response->error.message,
+                "response body length: %d != expect: %d",
+                response->header.body_len, expect_len);
+        return EINVAL;
+    }
+
+    if ((result=tcprecvdata_nb(pipeline->conn.sock, &body, expect_len,
+                    PIPELINE_NETWORK_TIMEOUT(pipeline))) != 0)
+    {
+        response->error.length = sprintf(response->error.message,
+                "recv response body fail");
+        return result;
+    }
+
+    if (request->output_type == FDIR_CLIENT_PIPELINE_OUTPUT_INODE) {
+        request->output.inode = buff2long(body.lookup.inode);
+    } else {
+        request->output.dentry.inode = buff2long(body.stat.stat.inode);
+        fdir_proto_unpack_dentry_stat(&body.stat.stat.stat,
+                &request->output.dentry.stat);
+        if (expect_len == sizeof(FDIRProtoUpdateDEntryResp)) {
+            fdir_client_set_write_version(pipeline->client_ctx,
+                    buff2long(body.stat.trailer.data_version));
+        }
+    }
+    return 0;
+}
+
+static int pipeline_recv_error(FDIRClientPipeline *pipeline,
+        SFResponseInfo *response)
+{
+    int result;
+
+    if (response->header.body_len >= sizeof(response->error.message)) {
+        response->error.length = sprintf(response->error.message,
+                "error message length: %d is too long",
+                response->header.body_len);
+        return EINVAL;
+    }
+
+    response->error.length = response->header.body_len;
+    if (response->error.length > 0) {
+        if ((result=tcprecvdata_nb(pipeline->conn.sock, response->
+                        error.message, response->error.length,
+                        PIPELINE_NETWORK_TIMEOUT(pipeline))) != 0)
+        {
+            response->error.length = sprintf(response->error.message,
+                    "recv error message fail");
+            return result;
+        }
+    }
+    response->error.message[response->error.length] = '\0';
+    return 0;
+}
+
+//return the network error, the result of the operation is in request
+static int pipeline_recv_one(FDIRClientPipeline *pipeline)
+{
+    FDIRClientPipelineRequest *request;
+    SFResponseInfo response;
+    int result;
+    int log_level;
+
+    response.error.length = 0;
+    if ((result=sf_recv_response_header(&pipeline->conn, &response,
+                    PIPELINE_NETWORK_TIMEOUT(pipeline))) == 0)
+    {
+        request = pipeline->inflight.head;
+        if (response.header.status == 0) {
+            result = pipeline_recv_body(pipeline, &response, request);
+        } else {
+            result = pipeline_recv_error(pipeline, &response);
+        }
+    }
+
+    if (result != 0) {
+        sf_log_network_error(&response, &pipeline->conn, result);
+        pipeline_fail_all(pipeline, result);
+        return result;
+    }
+
+    request = pipeline_queue_pop(&pipeline->inflight);
+    request->result = response.header.status;
+    if (request->result != 0) {
+        log_level = (request->result == ENOENT || request->result ==
+                EEXIST) ? LOG_DEBUG : LOG_ERR;
+        sf_log_network_error_ex(&response, &pipeline->conn,
+                request->result, log_level);
+    }
+    pipeline_complete(pipeline, request);
+    return 0;
+}
+
+int fdir_client_pipeline_poll(FDIRClientPipeline *pipeline,
+        FDIRClientPipelineRequest **request)
+{
+    int result;
+
+    while ((*request=pipeline_queue_pop(&pipeline->completed)) == NULL) {
+        if ((result=fdir_client_pipeline_flush(pipeline)) != 0) {
+            continue;  //the failed requests are in the completed queue
+        }
+
+        if (pipeline->inflight.count == 0) {
+            return ENOENT;
+        }
+        pipeline_recv_one(pipeline);
+    }
+
+    return 0;
+}
+
+int fdir_client_pipeline_wait_all(FDIRClientPipeline *pipeline)
+{
+    int result;
+
+    if ((result=fdir_client_pipeline_flush(pipeline)) != 0) {
+        return result;
+    }
+
+    while (pipeline->inflight.count > 0) {
+        if ((result=pipeline_recv_one(pipeline)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static char *pipeline_prepare(FDIRClientPipeline *pipeline, int *err_no)
+{
+    if (pipeline->conn.sock < 0) {
+        if ((*err_no=pipeline_connect(pipeline)) != 0) {
+            return NULL;
+        }
+    }
+
+    while (fdir_client_pipeline_outstanding_count(pipeline) >=
+            pipeline->window_size)
+    {
+        if ((*err_no=fdir_client_pipeline_flush(pipeline)) != 0) {
+            return NULL;
+        }
+        if ((*err_no=pipeline_recv_one(pipeline)) != 0) {
+            return NULL;
+        }
+    }
+
+    if (pipeline->send_buffer.length + FDIR_CLIENT_PIPELINE_MAX_REQ_SIZE >
+            pipeline->send_buffer.alloc)
+    {
+        if ((*err_no=fdir_client_pipeline_flush(pipeline)) != 0) {
+            return NULL;
+        }
+    }
+
+    *err_no = 0;
+    return pipeline->send_buffer.buff + pipeline->send_buffer.length;
+}
+
+static inline int pipeline_commit(FDIRClientPipeline *pipeline,
+        FDIRClientPipelineRequest *request, const int out_bytes,
+        const int resp_cmd, const int output_type)
+{
+    request->req_id = ++(pipeline->current_req_id);
+    request->result = EINPROGRESS;
+    request->resp_cmd = resp_cmd;
+    request->output_type = output_type;
+    pipeline->send_buffer.length += out_bytes;
+    pipeline_queue_push(&pipeline->pending, request);
+    return 0;
+}
+
+#define PIPELINE_PREPARE(pipeline, out_buff, result) \
+    if ((out_buff=pipeline_prepare(pipeline, &result)) == NULL) { \
+        return result; \
+    }
+
+int fdir_client_pipeline_stat_dentry_by_path(FDIRClientPipeline *pipeline,
+        const FDIRDEntryFullName *fullname,
+        FDIRClientPipelineRequest *request)
+{
+    char *out_buff;
+    int out_bytes;
+    int result;
+
+    PIPELINE_PREPARE(pipeline, out_buff, result);
+    if ((result=fdir_client_proto_pack_query_by_path(pipeline->client_ctx,
+                    fullname, FDIR_SERVICE_PROTO_STAT_BY_PATH_REQ,
+                    out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
+
+    return pipeline_commit(pipeline, request, out_bytes,
+            FDIR_SERVICE_PROTO_STAT_BY_PATH_RESP,
+            FDIR_CLIENT_PIPELINE_OUTPUT_DENTRY);
+}
+
+int fdir_client_pipeline_stat_dentry_by_pname(FDIRClientPipeline *pipeline,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        FDIRClientPipelineRequest *request)
+{
+    char *out_buff;
+    int out_bytes;
+    int result;
+
+    PIPELINE_PREPARE(pipeline, out_buff, result);
+    if ((result=fdir_client_proto_pack_query_by_pname(pipeline->client_ctx,
+                    ns, pname, FDIR_SERVICE_PROTO_STAT_BY_PNAME_REQ,
+                    out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
+
+    return pipeline_commit(pipeline, request, out_bytes,
+            FDIR_SERVICE_PROTO_STAT_BY_PNAME_RESP,
+            FDIR_CLIENT_PIPELINE_OUTPUT_DENTRY);
+}
+
+int fdir_client_pipeline_stat_dentry_by_inode(FDIRClientPipeline *pipeline,
+        const string_t *ns, const int64_t inode,
+        FDIRClientPipelineRequest *request)
+{
+    char *out_buff;
+    int out_bytes;
+    int result;
+
+    PIPELINE_PREPARE(pipeline, out_buff, result);
+    if ((result=fdir_client_proto_pack_query_by_inode(pipeline->client_ctx,
+                    ns, inode, FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ,
+                    out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
+
+    return pipeline_commit(pipeline, request, out_bytes,
+            FDIR_SERVICE_PROTO_STAT_BY_INODE_RESP,
+            FDIR_CLIENT_PIPELINE_OUTPUT_DENTRY);
+}
+
+int fdir_client_pipeline_lookup_inode_by_path(FDIRClientPipeline *pipeline,
+        const FDIRDEntryFullName *fullname,
+        FDIRClientPipelineRequest *request)
+{
+    char *out_buff;
+    int out_bytes;
+    int result;
+
+    PIPELINE_PREPARE(pipeline, out_buff, result);
+    if ((result=fdir_client_proto_pack_query_by_path(pipeline->client_ctx,
+                    fullname, FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PATH_REQ,
+                    out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
+
+    return pipeline_commit(pipeline, request, out_bytes,
+            FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PATH_RESP,
+            FDIR_CLIENT_PIPELINE_OUTPUT_INODE);
+}
+
+int fdir_client_pipeline_lookup_inode_by_pname(FDIRClientPipeline *pipeline,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        FDIRClientPipelineRequest *request)
+{
+    char *out_buff;
+    int out_bytes;
+    int result;
+
+    PIPELINE_PREPARE(pipeline, out_buff, result);
+    if ((result=fdir_client_proto_pack_query_by_pname(pipeline->client_ctx,
+                    ns, pname, FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PNAME_REQ,
+                    out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
+
+    return pipeline_commit(pipeline, request, out_bytes,
+            FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PNAME_RESP,
+            FDIR_CLIENT_PIPELINE_OUTPUT_INODE);
+}
+
+int fdir_client_pipeline_create_dentry(FDIRClientPipeline *pipeline,
+        const FDIRDEntryFullName *fullname,
+        const FDIRClientOwnerModePair *omp,
+        FDIRClientPipelineRequest *request)
+{
+    char *out_buff;
+    int out_bytes;
+    int result;
+
+    PIPELINE_PREPARE(pipeline, out_buff, result);
+    if ((result=fdir_client_proto_pack_create_dentry(pipeline->client_ctx,
+                    0, fullname, omp, out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
+
+    return pipeline_commit(pipeline, request, out_bytes,
+            FDIR_SERVICE_PROTO_CREATE_DENTRY_RESP,
+            FDIR_CLIENT_PIPELINE_OUTPUT_DENTRY);
+}
+
+int fdir_client_pipeline_create_dentry_by_pname(FDIRClientPipeline *pipeline,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        const FDIRClientOwnerModePair *omp,
+        FDIRClientPipelineRequest *request)
+{
+    char *out_buff;
+    int out_bytes;
+    int result;
+
+    PIPELINE_PREPARE(pipeline, out_buff, result);
+    if ((result=fdir_client_proto_pack_create_dentry_by_pname(pipeline->
+                    client_ctx, 0, ns, pname, omp, out_buff,
+                    &out_bytes)) != 0)
+    {
+        return result;
+    }
+
+    return pipeline_commit(pipeline, request, out_bytes,
+            FDIR_SERVICE_PROTO_CREATE_BY_PNAME_RESP,
+            FDIR_CLIENT_PIPELINE_OUTPUT_DENTRY);
+}
+
+int fdir_client_pipeline_remove_dentry(FDIRClientPipeline *pipeline,
+        const FDIRDEntryFullName *fullname,
+        FDIRClientPipelineRequest *request)
+{
+    char *out_buff;
+    int out_bytes;
+    int result;
+
+    PIPELINE_PREPARE(pipeline, out_buff, result);
+    if ((result=fdir_client_proto_pack_remove_dentry(pipeline->client_ctx,
+                    0, fullname, out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
+
+    return pipeline_commit(pipeline, request, out_bytes,
+            FDIR_SERVICE_PROTO_REMOVE_DENTRY_RESP,
+            FDIR_CLIENT_PIPELINE_OUTPUT_DENTRY);
+}
+
+int fdir_client_pipeline_remove_dentry_by_pname(FDIRClientPipeline *pipeline,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        FDIRClientPipelineRequest *request)
+{
+    char *out_buff;
+    int out_bytes;
+    int result;
+
+    PIPELINE_PREPARE(pipeline, out_buff, result);
+    if ((result=fdir_client_proto_pack_remove_dentry_by_pname(pipeline->
+                    client_ctx, 0, ns, pname, out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
+
+    return pipeline_commit(pipeline, request, out_bytes,
+            FDIR_SERVICE_PROTO_REMOVE_BY_PNAME_RESP,
+            FDIR_CLIENT_PIPELINE_OUTPUT_DENTRY);
+}
+
+int fdir_client_pipeline_set_dentry_size(FDIRClientPipeline *pipeline,
+        const string_t *ns, const FDIRSetDEntrySizeInfo *dsize,
+        FDIRClientPipelineRequest *request)
+{
+    char *out_buff;
+    int out_bytes;
+    int result;
+
+    PIPELINE_PREPARE(pipeline, out_buff, result);
+    if ((result=fdir_client_proto_pack_set_dentry_size(pipeline->client_ctx,
+                    0, ns, dsize, out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
+
+    return pipeline_commit(pipeline, request, out_bytes,
+            FDIR_SERVICE_PROTO_SET_DENTRY_SIZE_RESP,
+            FDIR_CLIENT_PIPELINE_OUTPUT_DENTRY);
+}
+
+int fdir_client_pipeline_modify_dentry_stat(FDIRClientPipeline *pipeline,
+        const string_t *ns, const int64_t inode, const int64_t flags,
+        const FDIRDEntryStat *stat, FDIRClientPipelineRequest *request)
+{
+    char *out_buff;
+    int out_bytes;
+    int result;
+
+    PIPELINE_PREPARE(pipeline, out_buff, result);
+    if ((result=fdir_client_proto_pack_modify_dentry_stat(pipeline->
+                    client_ctx, 0, ns, inode, flags, stat, out_buff,
+                    &out_bytes)) != 0)
+    {
+        return result;
+    }
+
+    return pipeline_commit(pipeline, request, out_bytes,
+            FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_RESP,
+            FDIR_CLIENT_PIPELINE_OUTPUT_DENTRY);
+}
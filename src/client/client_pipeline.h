@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _FDIR_CLIENT_PIPELINE_H
+#define _FDIR_CLIENT_PIPELINE_H
+
+#include "fdir_proto.h"
+#include "client_types.h"
+#include "client_proto.h"
+
+#define FDIR_CLIENT_PIPELINE_DEFAULT_WINDOW_SIZE   64
+#define FDIR_CLIENT_PIPELINE_MAX_WINDOW_SIZE     1024
+#define FDIR_CLIENT_PIPELINE_SEND_BUFFER_SIZE    (64 * 1024)
+
+#define FDIR_CLIENT_PIPELINE_MAX_REQ_SIZE  (sizeof(FDIRProtoHeader) + \
+        SF_PROTO_UPDATE_EXTRA_BODY_SIZE + sizeof(FDIRProtoCreateDEntryReq) + \
+        sizeof(FDIRProtoModifyDentryStatReq) + 2 * NAME_MAX + PATH_MAX)
+
+#define FDIR_CLIENT_PIPELINE_OUTPUT_DENTRY  1
+#define FDIR_CLIENT_PIPELINE_OUTPUT_INODE   2
+
+struct fdir_client_pipeline_request;
+
+typedef void (*fdir_client_pipeline_callback)(
+        struct fdir_client_pipeline_request *request);
+
+/* the request object is owned by the caller and must be kept until
+ * completed, set callback and args before submit */
+typedef struct fdir_client_pipeline_request {
+    fdir_client_pipeline_callback callback; //NULL for polling
+    void *args;            //the user data
+
+    uint64_t req_id;       //assigned when submit
+    int result;            //the errno of the operation, 0 for success
+    unsigned char resp_cmd;
+    unsigned char output_type;
+    union {
+        FDIRDEntryInfo dentry;  //for stat, create, remove and update
+        int64_t inode;          //for lookup
+    } output;
+    struct fdir_client_pipeline_request *next;
+} FDIRClientPipelineRequest;
+
+typedef struct fdir_client_pipeline_queue {
+    int count;
+    FDIRClientPipelineRequest *head;
+    FDIRClientPipelineRequest *tail;
+} FDIRClientPipelineQueue;
+
+/* many requests in flight on one dedicated connection. the server deals
+ * the requests of a connection one by one, so the responses are returned
+ * in the order of the requests and matched with the in-flight queue.
+ *
+ * the pipeline is NOT thread safe, use one pipeline per thread.
+ * the update requests are not idempotent and are NOT retried, they
+ * complete with the error when the connection is broken */
+typedef struct fdir_client_pipeline {
+    FDIRClientContext *client_ctx;
+    ConnectionInfo conn;
+    bool readonly;    //connect to the readable server instead of the master
+    int window_size;  //the max count of the requests in flight
+    uint64_t current_req_id;
+    FDIRClientPipelineQueue pending;    //packed but not sent yet
+    FDIRClientPipelineQueue inflight;   //sent and wait for the response
+    FDIRClientPipelineQueue completed;  //without callback, for polling
+    struct {
+        int length;
+        int alloc;
+        char *buff;
+    } send_buffer;
+} FDIRClientPipeline;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* window_size: 0 for the default */
+int fdir_client_pipeline_init(FDIRClientPipeline *pipeline,
+        FDIRClientContext *client_ctx, const int window_size,
+        const bool readonly);
+
+/* the outstanding requests complete with ECANCELED */
+void fdir_client_pipeline_destroy(FDIRClientPipeline *pipeline);
+
+/* send the pending requests */
+int fdir_client_pipeline_flush(FDIRClientPipeline *pipeline);
+
+/* flush and get one completed request, block until a response arrives,
+ * the callback is called for the completed request with callback
+ * return ENOENT when no request is outstanding */
+int fdir_client_pipeline_poll(FDIRClientPipeline *pipeline,
+        FDIRClientPipelineRequest **request);
+
+/* flush and wait all the in-flight requests completed */
+int fdir_client_pipeline_wait_all(FDIRClientPipeline *pipeline);
+
+static inline int fdir_client_pipeline_outstanding_count(
+        FDIRClientPipeline *pipeline)
+{
+    return pipeline->pending.count + pipeline->inflight.count;
+}
+
+/* the submit functions return the error when pack or send fail,
+ * and the request is NOT queued in this case */
+int fdir_client_pipeline_stat_dentry_by_path(FDIRClientPipeline *pipeline,
+        const FDIRDEntryFullName *fullname,
+        FDIRClientPipelineRequest *request);
+
+int fdir_client_pipeline_stat_dentry_by_pname(FDIRClientPipeline *pipeline,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        FDIRClientPipelineRequest *request);
+
+int fdir_client_pipeline_stat_dentry_by_inode(FDIRClientPipeline *pipeline,
+        const string_t *ns, const int64_t inode,
+        FDIRClientPipelineRequest *request);
+
+int fdir_client_pipeline_lookup_inode_by_path(FDIRClientPipeline *pipeline,
+        const FDIRDEntryFullName *fullname,
+        FDIRClientPipelineRequest *request);
+
+int fdir_client_pipeline_lookup_inode_by_pname(FDIRClientPipeline *pipeline,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        FDIRClientPipelineRequest *request);
+
+int fdir_client_pipeline_create_dentry(FDIRClientPipeline *pipeline,
+        const FDIRDEntryFullName *fullname,
+        const FDIRClientOwnerModePair *omp,
+        FDIRClientPipelineRequest *request);
+
+int fdir_client_pipeline_create_dentry_by_pname(FDIRClientPipeline *pipeline,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        const FDIRClientOwnerModePair *omp,
+        FDIRClientPipelineRequest *request);
+
+int fdir_client_pipeline_remove_dentry(FDIRClientPipeline *pipeline,
+        const FDIRDEntryFullName *fullname,
+        FDIRClientPipelineRequest *request);
+
+int fdir_client_pipeline_remove_dentry_by_pname(FDIRClientPipeline *pipeline,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        FDIRClientPipelineRequest *request);
+
+int fdir_client_pipeline_set_dentry_size(FDIRClientPipeline *pipeline,
+        const string_t *ns, const FDIRSetDEntrySizeInfo *dsize,
+        FDIRClientPipelineRequest *request);
+
+int fdir_client_pipeline_modify_dentry_stat(FDIRClientPipeline *pipeline,
+        const string_t *ns, const int64_t inode, const int64_t flags,
+        const FDIRDEntryStat *stat, FDIRClientPipelineRequest *request);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -96,6 +96,31 @@ void fdir_client_namespace_stat_array_free(FDIRClientNamespaceStatArray *array)
     sf_free_recv_buffer(&array->buffer);
 }
 
+int fdir_client_invalidate_array_init(FDIRClientInvalidateArray *array)
+{
+    int result;
+
+    if ((result=sf_init_recv_buffer(&array->buffer, 0)) != 0) {
+        return result;
+    }
+
+    array->alloc = array->count = 0;
+    array->overflow = false;
+    array->events = NULL;
+    return 0;
+}
+
+void fdir_client_invalidate_array_free(FDIRClientInvalidateArray *array)
+{
+    if (array->events != NULL) {
+        free(array->events);
+        array->events = NULL;
+        array->alloc = array->count = 0;
+    }
+
+    sf_free_recv_buffer(&array->buffer);
+}
+
 static int client_check_set_proto_dentry(const FDIRDEntryFullName *fullname,
         FDIRProtoDEntryInfo *entry_proto)
 {
@@ -191,7 +216,7 @@ int fdir_client_proto_join_server(FDIRClientContext *client_ctx,
     proto_header = (FDIRProtoHeader *)out_buff;
     req = (FDIRProtoClientJoinReq *)(proto_header + 1);
 
-    if (client_ctx->idempotency_enabled) {
+    if (client_ctx->idempotency_enabled && conn_params != NULL) {
         flags = FDIR_CLIENT_JOIN_FLAGS_IDEMPOTENCY_REQUEST;
 
         int2buff(__sync_add_and_fetch(&conn_params->channel->id, 0),
@@ -201,6 +226,10 @@ int fdir_client_proto_join_server(FDIRClientContext *client_ctx,
     } else {
         flags = 0;
     }
+    if (client_ctx->consistency.read_your_writes) {
+        flags |= FDIR_CLIENT_JOIN_FLAGS_DATA_VERSION;
+    }
+    flags |= FDIR_CLIENT_JOIN_FLAGS_NSS_INODES;
     int2buff(flags, req->flags);
     req->auth_enabled = (client_ctx->auth.enabled ? 1 : 0);
     memcpy(&req->config_sign, &client_ctx->cluster.md5_digest,
@@ -214,7 +243,9 @@ int fdir_client_proto_join_server(FDIRClientContext *client_ctx,
                     FDIR_SERVICE_PROTO_CLIENT_JOIN_RESP, (char *)&join_resp,
                     sizeof(FDIRProtoClientJoinResp))) == 0)
     {
-        conn_params->buffer_size = buff2int(join_resp.buffer_size);
+        if (conn_params != NULL) {
+            conn_params->buffer_size = buff2int(join_resp.buffer_size);
+        }
     } else {
         sf_log_network_error(&response, conn, result);
     }
@@ -222,6 +253,33 @@ int fdir_client_proto_join_server(FDIRClientContext *client_ctx,
     return result;
 }
 
+/* the update response without body, the server appends the committed
+ * data version when the client joined with the data version flag */
+static int send_and_recv_update_response(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, char *out_buff, const int out_bytes,
+        SFResponseInfo *response, const int expect_cmd)
+{
+    FDIRProtoUpdateRespTrailer trailer;
+    int expect_body_lens[2];
+    int body_len;
+    int result;
+
+    expect_body_lens[0] = 0;
+    expect_body_lens[1] = sizeof(trailer);
+    if ((result=sf_send_and_recv_response_ex(conn, out_buff, out_bytes,
+                    response, client_ctx->common_cfg.network_timeout,
+                    expect_cmd, (char *)&trailer, expect_body_lens,
+                    2, &body_len)) == 0)
+    {
+        if (body_len == (int)sizeof(trailer)) {
+            fdir_client_set_write_version(client_ctx,
+                    buff2long(trailer.data_version));
+        }
+    }
+
+    return result;
+}
+
 static inline void proto_unpack_dentry(FDIRProtoStatDEntryResp *proto_stat,
         FDIRDEntryInfo *dentry)
 {
@@ -234,16 +292,24 @@ static inline int do_update_dentry(FDIRClientContext *client_ctx,
         const int expect_cmd, FDIRDEntryInfo *dentry)
 {
     SFResponseInfo response;
-    FDIRProtoStatDEntryResp proto_stat;
+    FDIRProtoUpdateDEntryResp resp;
+    int expect_body_lens[2];
+    int body_len;
     int result;
 
+    expect_body_lens[0] = sizeof(resp.stat);
+    expect_body_lens[1] = sizeof(resp);
     response.error.length = 0;
-    if ((result=sf_send_and_recv_response(conn, out_buff, out_bytes,
+    if ((result=sf_send_and_recv_response_ex(conn, out_buff, out_bytes,
                     &response, client_ctx->common_cfg.network_timeout,
-                    expect_cmd, (char *)&proto_stat,
-                    sizeof(proto_stat))) == 0)
+                    expect_cmd, (char *)&resp, expect_body_lens,
+                    2, &body_len)) == 0)
     {
-        proto_unpack_dentry(&proto_stat, dentry);
+        proto_unpack_dentry(&resp.stat, dentry);
+        if (body_len == (int)sizeof(resp)) {
+            fdir_client_set_write_version(client_ctx,
+                    buff2long(resp.trailer.data_version));
+        }
     } else {
         sf_log_network_error_for_update(&response, conn, result);
     }
@@ -258,31 +324,46 @@ static inline int do_update_dentry(FDIRClientContext *client_ctx,
         int2buff(omp->mode, proto_front.mode); \
     } while (0)
 
+int fdir_client_proto_pack_create_dentry(FDIRClientContext *client_ctx,
+        const uint64_t req_id, const FDIRDEntryFullName *fullname,
+        const FDIRClientOwnerModePair *omp, char *out_buff, int *out_bytes)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoCreateDEntryReq *req;
+    int result;
+
+    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff,
+            header, req, req_id, *out_bytes);
+    if ((result=client_check_set_proto_dentry(fullname,
+                    &req->dentry)) != 0)
+    {
+        return result;
+    }
+
+    CLIENT_PROTO_SET_OMP(omp, req->front);
+    *out_bytes += fullname->ns.len + fullname->path.len;
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_CREATE_DENTRY_REQ,
+            *out_bytes - sizeof(FDIRProtoHeader));
+    return 0;
+}
+
 int fdir_client_proto_create_dentry(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const uint64_t req_id,
         const FDIRDEntryFullName *fullname,
         const FDIRClientOwnerModePair *omp,
         FDIRDEntryInfo *dentry)
 {
-    FDIRProtoHeader *header;
-    FDIRProtoCreateDEntryReq *req;
     char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_UPDATE_EXTRA_BODY_SIZE +
         sizeof(FDIRProtoCreateDEntryReq) + NAME_MAX + PATH_MAX];
     int out_bytes;
     int result;
 
-    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff, header, req, req_id, out_bytes);
-    if ((result=client_check_set_proto_dentry(fullname,
-                    &req->dentry)) != 0)
+    if ((result=fdir_client_proto_pack_create_dentry(client_ctx, req_id,
+                    fullname, omp, out_buff, &out_bytes)) != 0)
     {
         return result;
     }
 
-    CLIENT_PROTO_SET_OMP(omp, req->front);
-    out_bytes += fullname->ns.len + fullname->path.len;
-    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_CREATE_DENTRY_REQ,
-            out_bytes - sizeof(FDIRProtoHeader));
-
     return do_update_dentry(client_ctx, conn, out_buff, out_bytes,
             FDIR_SERVICE_PROTO_CREATE_DENTRY_RESP, dentry);
 }
@@ -324,27 +405,42 @@ int fdir_client_proto_symlink_dentry(FDIRClientContext *client_ctx,
             FDIR_SERVICE_PROTO_SYMLINK_DENTRY_RESP, dentry);
 }
 
-int fdir_client_proto_remove_dentry_ex(FDIRClientContext *client_ctx,
-        ConnectionInfo *conn, const uint64_t req_id,
-        const FDIRDEntryFullName *fullname, FDIRDEntryInfo *dentry)
+int fdir_client_proto_pack_remove_dentry(FDIRClientContext *client_ctx,
+        const uint64_t req_id, const FDIRDEntryFullName *fullname,
+        char *out_buff, int *out_bytes)
 {
     FDIRProtoHeader *header;
     FDIRProtoRemoveDEntry *req;
-    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_UPDATE_EXTRA_BODY_SIZE +
-        sizeof(FDIRProtoRemoveDEntry) + NAME_MAX + PATH_MAX];
-    int out_bytes;
     int result;
 
-    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff, header, req, req_id, out_bytes);
+    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff,
+            header, req, req_id, *out_bytes);
     if ((result=client_check_set_proto_dentry(fullname,
                     &req->dentry)) != 0)
     {
         return result;
     }
 
-    out_bytes += fullname->ns.len + fullname->path.len;
+    *out_bytes += fullname->ns.len + fullname->path.len;
     SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_REMOVE_DENTRY_REQ,
-            out_bytes - sizeof(FDIRProtoHeader));
+            *out_bytes - sizeof(FDIRProtoHeader));
+    return 0;
+}
+
+int fdir_client_proto_remove_dentry_ex(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id,
+        const FDIRDEntryFullName *fullname, FDIRDEntryInfo *dentry)
+{
+    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_UPDATE_EXTRA_BODY_SIZE +
+        sizeof(FDIRProtoRemoveDEntry) + NAME_MAX + PATH_MAX];
+    int out_bytes;
+    int result;
+
+    if ((result=fdir_client_proto_pack_remove_dentry(client_ctx, req_id,
+                    fullname, out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
 
     return do_update_dentry(client_ctx, conn, out_buff, out_bytes,
             FDIR_SERVICE_PROTO_REMOVE_DENTRY_RESP, dentry);
@@ -417,23 +513,36 @@ static int do_rename_dentry(FDIRClientContext *client_ctx,
         const int expect_cmd, FDIRDEntryInfo **dentry)
 {
     SFResponseInfo response;
-    FDIRProtoStatDEntryResp proto_stat;
-    int expect_body_lens[2];
+    FDIRProtoUpdateDEntryResp resp;
+    FDIRProtoUpdateRespTrailer *trailer;
+    int expect_body_lens[4];
     int body_len;
     int result;
 
+    /* the stat of the overwritten dentry and the data version
+     * are both optional */
     expect_body_lens[0] = 0;
-    expect_body_lens[1] = sizeof(proto_stat);
+    expect_body_lens[1] = sizeof(resp.trailer);
+    expect_body_lens[2] = sizeof(resp.stat);
+    expect_body_lens[3] = sizeof(resp);
     response.error.length = 0;
     if ((result=sf_send_and_recv_response_ex(conn, out_buff, out_bytes,
                     &response, client_ctx->common_cfg.network_timeout,
-                    expect_cmd, (char *)&proto_stat, expect_body_lens,
-                    2, &body_len)) == 0)
+                    expect_cmd, (char *)&resp, expect_body_lens,
+                    4, &body_len)) == 0)
     {
-        if (body_len == (int)sizeof(proto_stat)) {
-            proto_unpack_dentry(&proto_stat, *dentry);
+        if (body_len >= (int)sizeof(resp.stat)) {
+            proto_unpack_dentry(&resp.stat, *dentry);
+            trailer = &resp.trailer;
         } else {
             *dentry = NULL;
+            trailer = (FDIRProtoUpdateRespTrailer *)&resp;
+        }
+        if (body_len == (int)sizeof(resp.trailer) ||
+                body_len == (int)sizeof(resp))
+        {
+            fdir_client_set_write_version(client_ctx,
+                    buff2long(trailer->data_version));
         }
     } else {
         sf_log_network_error_for_update(&response, conn, result);
@@ -515,7 +624,7 @@ int fdir_client_proto_rename_dentry_by_pname_ex(FDIRClientContext *client_ctx,
             FDIR_SERVICE_PROTO_RENAME_BY_PNAME_RESP, dentry);
 }
 
-static int setup_req_by_dentry_fullname(FDIRClientContext *client_ctx,
+int fdir_client_proto_pack_query_by_path(FDIRClientContext *client_ctx,
         const FDIRDEntryFullName *fullname, const int req_cmd,
         char *out_buff, int *out_bytes)
 {
@@ -533,7 +642,7 @@ static int setup_req_by_dentry_fullname(FDIRClientContext *client_ctx,
     return 0;
 }
 
-static int setup_req_by_dentry_pname(FDIRClientContext *client_ctx,
+int fdir_client_proto_pack_query_by_pname(FDIRClientContext *client_ctx,
         const string_t *ns, const FDIRDEntryPName *pname,
         const int req_cmd, char *out_buff, int *out_bytes)
 {
@@ -552,7 +661,7 @@ static int setup_req_by_dentry_pname(FDIRClientContext *client_ctx,
     return 0;
 }
 
-static inline int setup_req_by_dentry_inode(FDIRClientContext *client_ctx,
+int fdir_client_proto_pack_query_by_inode(FDIRClientContext *client_ctx,
         const string_t *ns, const int64_t inode, const int req_cmd,
         char *out_buff, int *out_bytes)
 {
@@ -588,7 +697,7 @@ static int query_by_dentry_fullname(FDIRClientContext *client_ctx,
     int result;
     int log_level;
 
-    if ((result=setup_req_by_dentry_fullname(client_ctx, fullname,
+    if ((result=fdir_client_proto_pack_query_by_path(client_ctx, fullname,
                     req_cmd, out_buff, &out_bytes)) != 0)
     {
         return result;
@@ -639,7 +748,7 @@ int fdir_client_proto_lookup_inode_by_pname(FDIRClientContext *client_ctx,
     FDIRProtoLookupInodeResp proto_resp;
     int log_level;
 
-    if ((result=setup_req_by_dentry_pname(client_ctx, ns, pname,
+    if ((result=fdir_client_proto_pack_query_by_pname(client_ctx, ns, pname,
                     FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PNAME_REQ,
                     out_buff, &out_bytes)) != 0)
     {
@@ -725,7 +834,7 @@ int fdir_client_proto_readlink_by_path(FDIRClientContext *client_ctx,
     int out_bytes;
     int result;
 
-    if ((result=setup_req_by_dentry_fullname(client_ctx, fullname,
+    if ((result=fdir_client_proto_pack_query_by_path(client_ctx, fullname,
                     FDIR_SERVICE_PROTO_READLINK_BY_PATH_REQ,
                     out_buff, &out_bytes)) != 0)
     {
@@ -745,7 +854,7 @@ int fdir_client_proto_readlink_by_pname(FDIRClientContext *client_ctx,
     int out_bytes;
     int result;
 
-    if ((result=setup_req_by_dentry_pname(client_ctx, ns, pname,
+    if ((result=fdir_client_proto_pack_query_by_pname(client_ctx, ns, pname,
                     FDIR_SERVICE_PROTO_READLINK_BY_PNAME_REQ,
                     out_buff, &out_bytes)) != 0)
     {
@@ -765,7 +874,7 @@ int fdir_client_proto_readlink_by_inode(FDIRClientContext *client_ctx,
     int out_bytes;
     int result;
 
-    if ((result=setup_req_by_dentry_inode(client_ctx, ns, inode,
+    if ((result=fdir_client_proto_pack_query_by_inode(client_ctx, ns, inode,
                     FDIR_SERVICE_PROTO_READLINK_BY_INODE_REQ,
                     out_buff, &out_bytes)) != 0)
     {
@@ -808,7 +917,7 @@ int fdir_client_proto_stat_dentry_by_inode(FDIRClientContext *client_ctx,
     int out_bytes;
     int result;
 
-    if ((result=setup_req_by_dentry_inode(client_ctx, ns, inode,
+    if ((result=fdir_client_proto_pack_query_by_inode(client_ctx, ns, inode,
                     FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ,
                     out_buff, &out_bytes)) != 0)
     {
@@ -827,7 +936,7 @@ int fdir_client_proto_stat_dentry_by_pname(FDIRClientContext *client_ctx,
     int out_bytes;
     int result;
 
-    if ((result=setup_req_by_dentry_pname(client_ctx, ns, pname,
+    if ((result=fdir_client_proto_pack_query_by_pname(client_ctx, ns, pname,
                     FDIR_SERVICE_PROTO_STAT_BY_PNAME_REQ,
                     out_buff, &out_bytes)) != 0)
     {
@@ -838,27 +947,43 @@ int fdir_client_proto_stat_dentry_by_pname(FDIRClientContext *client_ctx,
             FDIR_SERVICE_PROTO_STAT_BY_PNAME_RESP, dentry, enoent_log_level);
 }
 
-int fdir_client_proto_create_dentry_by_pname(FDIRClientContext *client_ctx,
-        ConnectionInfo *conn, const uint64_t req_id,
+int fdir_client_proto_pack_create_dentry_by_pname(
+        FDIRClientContext *client_ctx, const uint64_t req_id,
         const string_t *ns, const FDIRDEntryPName *pname,
-        const FDIRClientOwnerModePair *omp, FDIRDEntryInfo *dentry)
+        const FDIRClientOwnerModePair *omp, char *out_buff, int *out_bytes)
 {
     FDIRProtoHeader *header;
     FDIRProtoCreateDEntryByPNameReq *req;
-    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_UPDATE_EXTRA_BODY_SIZE +
-        sizeof(FDIRProtoCreateDEntryByPNameReq) + 2 * NAME_MAX];
-    int out_bytes;
     int result;
 
-    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff, header, req, req_id, out_bytes);
+    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff,
+            header, req, req_id, *out_bytes);
     if ((result=client_check_set_proto_pname(ns, pname, &req->pname)) != 0) {
         return result;
     }
 
     CLIENT_PROTO_SET_OMP(omp, req->front);
-    out_bytes += ns->len + pname->name.len;
+    *out_bytes += ns->len + pname->name.len;
     SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_CREATE_BY_PNAME_REQ,
-            out_bytes - sizeof(FDIRProtoHeader));
+            *out_bytes - sizeof(FDIRProtoHeader));
+    return 0;
+}
+
+int fdir_client_proto_create_dentry_by_pname(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        const FDIRClientOwnerModePair *omp, FDIRDEntryInfo *dentry)
+{
+    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_UPDATE_EXTRA_BODY_SIZE +
+        sizeof(FDIRProtoCreateDEntryByPNameReq) + 2 * NAME_MAX];
+    int out_bytes;
+    int result;
+
+    if ((result=fdir_client_proto_pack_create_dentry_by_pname(client_ctx,
+                    req_id, ns, pname, omp, out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
 
     return do_update_dentry(client_ctx, conn, out_buff, out_bytes,
             FDIR_SERVICE_PROTO_CREATE_BY_PNAME_RESP, dentry);
@@ -903,25 +1028,41 @@ int fdir_client_proto_symlink_dentry_by_pname(FDIRClientContext *client_ctx,
             FDIR_SERVICE_PROTO_SYMLINK_BY_PNAME_RESP, dentry);
 }
 
+int fdir_client_proto_pack_remove_dentry_by_pname(
+        FDIRClientContext *client_ctx, const uint64_t req_id,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        char *out_buff, int *out_bytes)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoRemoveDEntryByPName *req;
+    int result;
+
+    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff,
+            header, req, req_id, *out_bytes);
+    if ((result=client_check_set_proto_pname(ns, pname, &req->pname)) != 0) {
+        return result;
+    }
+    *out_bytes += ns->len + pname->name.len;
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_REMOVE_BY_PNAME_REQ,
+            *out_bytes - sizeof(FDIRProtoHeader));
+    return 0;
+}
+
 int fdir_client_proto_remove_dentry_by_pname_ex(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const uint64_t req_id,
         const string_t *ns, const FDIRDEntryPName *pname,
         FDIRDEntryInfo *dentry)
 {
-    FDIRProtoHeader *header;
-    FDIRProtoRemoveDEntryByPName *req;
     char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_UPDATE_EXTRA_BODY_SIZE +
         sizeof(FDIRProtoRemoveDEntryByPName) + 2 * NAME_MAX];
     int out_bytes;
     int result;
 
-    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff, header, req, req_id, out_bytes);
-    if ((result=client_check_set_proto_pname(ns, pname, &req->pname)) != 0) {
+    if ((result=fdir_client_proto_pack_remove_dentry_by_pname(client_ctx,
+                    req_id, ns, pname, out_buff, &out_bytes)) != 0)
+    {
         return result;
     }
-    out_bytes += ns->len + pname->name.len;
-    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_REMOVE_BY_PNAME_REQ,
-            out_bytes - sizeof(FDIRProtoHeader));
 
     return do_update_dentry(client_ctx, conn, out_buff, out_bytes,
             FDIR_SERVICE_PROTO_REMOVE_BY_PNAME_RESP, dentry);
@@ -938,16 +1079,12 @@ int fdir_client_proto_remove_dentry_by_pname_ex(FDIRClientContext *client_ctx,
         int2buff(dsize->flags, req->flags); \
     }
 
-int fdir_client_proto_set_dentry_size(FDIRClientContext *client_ctx,
-        ConnectionInfo *conn, const uint64_t req_id,
-        const string_t *ns, const FDIRSetDEntrySizeInfo *dsize,
-        FDIRDEntryInfo *dentry)
+int fdir_client_proto_pack_set_dentry_size(FDIRClientContext *client_ctx,
+        const uint64_t req_id, const string_t *ns,
+        const FDIRSetDEntrySizeInfo *dsize, char *out_buff, int *out_bytes)
 {
     FDIRProtoHeader *header;
     FDIRProtoSetDentrySizeReq *req;
-    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_UPDATE_EXTRA_BODY_SIZE +
-        sizeof(FDIRProtoSetDentrySizeReq) + NAME_MAX];
-    int out_bytes;
 
     if (ns->len <= 0 || ns->len > NAME_MAX) {
         logError("file: "__FILE__", line: %d, "
@@ -956,13 +1093,32 @@ int fdir_client_proto_set_dentry_size(FDIRClientContext *client_ctx,
         return EINVAL;
     }
 
-    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff, header, req, req_id, out_bytes);
+    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff,
+            header, req, req_id, *out_bytes);
     FDIR_CLIENT_PROTO_PACK_DENTRY_SIZE(dsize, req);
     req->ns_len = ns->len;
     memcpy(req + 1, ns->str, ns->len);
-    out_bytes += ns->len;
+    *out_bytes += ns->len;
     SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_SET_DENTRY_SIZE_REQ,
-            out_bytes - sizeof(FDIRProtoHeader));
+            *out_bytes - sizeof(FDIRProtoHeader));
+    return 0;
+}
+
+int fdir_client_proto_set_dentry_size(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id,
+        const string_t *ns, const FDIRSetDEntrySizeInfo *dsize,
+        FDIRDEntryInfo *dentry)
+{
+    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_UPDATE_EXTRA_BODY_SIZE +
+        sizeof(FDIRProtoSetDentrySizeReq) + NAME_MAX];
+    int out_bytes;
+    int result;
+
+    if ((result=fdir_client_proto_pack_set_dentry_size(client_ctx, req_id,
+                    ns, dsize, out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
 
     return do_update_dentry(client_ctx, conn, out_buff, out_bytes,
             FDIR_SERVICE_PROTO_SET_DENTRY_SIZE_RESP, dentry);
@@ -1013,26 +1169,249 @@ int fdir_client_proto_batch_set_dentry_size(FDIRClientContext *client_ctx,
     SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_REQ,
             out_bytes - sizeof(FDIRProtoHeader));
     response.error.length = 0;
-    if ((result=sf_send_and_recv_none_body_response(conn, out_buff, out_bytes,
+    if ((result=send_and_recv_update_response(client_ctx, conn, out_buff,
+                    out_bytes, &response, FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_RESP)) != 0)
+    {
+        sf_log_network_error_for_update(&response, conn, result);
+    }
+
+    return result;
+}
+
+static int client_batch_add_op(FDIRClientBatch *batch, const int op,
+        const string_t *path, const string_t *name, const string_t *value,
+        const int flags, const FDIRClientOwnerModePair *omp)
+{
+    FDIRProtoBatchOpHeader *oph;
+    int name_len;
+    int value_len;
+    int op_bytes;
+
+    if (path->len <= 0 || path->len > PATH_MAX) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid path length: %d, which <= 0 or > %d",
+                __LINE__, path->len, PATH_MAX);
+        return EINVAL;
+    }
+
+    name_len = (name != NULL ? name->len : 0);
+    value_len = (value != NULL ? value->len : 0);
+    if (name_len > NAME_MAX || value_len > PATH_MAX) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid name length: %d or value length: %d",
+                __LINE__, name_len, value_len);
+        return EINVAL;
+    }
+
+    op_bytes = sizeof(FDIRProtoBatchOpHeader) +
+        path->len + name_len + value_len;
+    if (batch->count >= FDIR_BATCH_UPDATE_MAX_OP_COUNT ||
+            sizeof(FDIRProtoBatchReqHeader) + batch->ns.len +
+            batch->ops.length + op_bytes > FDIR_BATCH_UPDATE_MAX_BODY_SIZE)
+    {
+        return ENOSPC;
+    }
+
+    oph = (FDIRProtoBatchOpHeader *)(batch->ops.buff + batch->ops.length);
+    oph->op = op;
+    oph->name_len = name_len;
+    short2buff(path->len, oph->path_len);
+    short2buff(value_len, oph->value_len);
+    short2buff(flags, oph->flags);
+    if (omp != NULL) {
+        CLIENT_PROTO_SET_OMP(omp, oph->front);
+    } else {
+        memset(&oph->front, 0, sizeof(oph->front));
+    }
+
+    memcpy(oph->path_str, path->str, path->len);
+    if (name_len > 0) {
+        memcpy(oph->path_str + path->len, name->str, name_len);
+    }
+    if (value_len > 0) {
+        memcpy(oph->path_str + path->len + name_len,
+                value->str, value_len);
+    }
+
+    batch->ops.length += op_bytes;
+    batch->count++;
+    return 0;
+}
+
+int fdir_client_batch_add_create(FDIRClientBatch *batch,
+        const string_t *path, const FDIRClientOwnerModePair *omp)
+{
+    return client_batch_add_op(batch, FDIR_BATCH_OP_CREATE_DENTRY,
+            path, NULL, NULL, 0, omp);
+}
+
+int fdir_client_batch_add_symlink(FDIRClientBatch *batch,
+        const string_t *link, const string_t *path,
+        const FDIRClientOwnerModePair *omp)
+{
+    if (link->len <= 0 || link->len >= PATH_MAX) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid link length: %d, which <= 0 or >= %d",
+                __LINE__, link->len, PATH_MAX);
+        return EINVAL;
+    }
+
+    return client_batch_add_op(batch, FDIR_BATCH_OP_SYMLINK_DENTRY,
+            path, NULL, link, 0, omp);
+}
+
+int fdir_client_batch_add_remove(FDIRClientBatch *batch,
+        const string_t *path)
+{
+    return client_batch_add_op(batch, FDIR_BATCH_OP_REMOVE_DENTRY,
+            path, NULL, NULL, 0, NULL);
+}
+
+int fdir_client_batch_add_set_xattr(FDIRClientBatch *batch,
+        const string_t *path, const key_value_pair_t *xattr,
+        const int flags)
+{
+    if (xattr->key.len <= 0 || xattr->value.len >
+            FDIR_XATTR_MAX_VALUE_SIZE)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "invalid xattr name length: %d or value length: %d",
+                __LINE__, xattr->key.len, xattr->value.len);
+        return EINVAL;
+    }
+
+    return client_batch_add_op(batch, FDIR_BATCH_OP_SET_XATTR,
+            path, &xattr->key, &xattr->value, flags, NULL);
+}
+
+int fdir_client_batch_add_remove_xattr(FDIRClientBatch *batch,
+        const string_t *path, const string_t *name)
+{
+    if (name->len <= 0) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid xattr name length: %d <= 0",
+                __LINE__, name->len);
+        return EINVAL;
+    }
+
+    return client_batch_add_op(batch, FDIR_BATCH_OP_REMOVE_XATTR,
+            path, name, NULL, 0, NULL);
+}
+
+static int client_batch_parse_results(FDIRClientContext *client_ctx,
+        FDIRClientBatch *batch, ConnectionInfo *conn,
+        const char *in_buff, int body_len)
+{
+    FDIRProtoBatchRespHeader *rheader;
+    FDIRProtoBatchRespBodyPart *rbody;
+    FDIRClientBatchResult *result;
+    FDIRClientBatchResult *end;
+    int expect_len;
+
+    end = batch->results + batch->count;
+    if (body_len == 0) {
+        /* the response of the idempotency request which finished by
+         * the previous try, the results of the operations are lost */
+        for (result=batch->results; result<end; result++) {
+            result->inode = 0;
+            result->status = EALREADY;
+        }
+        batch->success = 0;
+        logWarning("file: "__FILE__", line: %d, "
+                "server %s:%u, the batch of %d operations is done by "
+                "the previous try, the results are unknown", __LINE__,
+                conn->ip_addr, conn->port, batch->count);
+        return EALREADY;
+    }
+
+    expect_len = sizeof(FDIRProtoBatchRespHeader) + batch->count *
+        sizeof(FDIRProtoBatchRespBodyPart);
+    rheader = (FDIRProtoBatchRespHeader *)in_buff;
+    if (body_len == expect_len + (int)sizeof(FDIRProtoUpdateRespTrailer)) {
+        fdir_client_set_write_version(client_ctx, buff2long(
+                    ((FDIRProtoUpdateRespTrailer *)(in_buff +
+                        expect_len))->data_version));
+        body_len = expect_len;
+    }
+    if (body_len != expect_len || buff2int(rheader->count) != batch->count) {
+        logError("file: "__FILE__", line: %d, "
+                "server %s:%u, response body length: %d != expect: %d, "
+                "or response count: %d != request count: %d", __LINE__,
+                conn->ip_addr, conn->port, body_len, expect_len,
+                buff2int(rheader->count), batch->count);
+        return EINVAL;
+    }
+
+    batch->success = buff2int(rheader->success);
+    rbody = (FDIRProtoBatchRespBodyPart *)(rheader + 1);
+    for (result=batch->results; result<end; result++, rbody++) {
+        result->inode = buff2long(rbody->inode);
+        result->status = buff2short(rbody->status);
+    }
+
+    return 0;
+}
+
+int fdir_client_proto_batch_update(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id,
+        FDIRClientBatch *batch)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoBatchReqHeader *rheader;
+    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_UPDATE_EXTRA_BODY_SIZE +
+        FDIR_BATCH_UPDATE_MAX_BODY_SIZE];
+    char in_buff[sizeof(FDIRProtoBatchRespHeader) +
+        FDIR_BATCH_UPDATE_MAX_OP_COUNT * sizeof(FDIRProtoBatchRespBodyPart) +
+        sizeof(FDIRProtoUpdateRespTrailer)];
+    SFResponseInfo response;
+    int out_bytes;
+    int body_len;
+    int result;
+
+    if (batch->ns.len <= 0 || batch->ns.len > NAME_MAX) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid namespace length: %d, which <= 0 or > %d",
+                __LINE__, batch->ns.len, NAME_MAX);
+        return EINVAL;
+    }
+    if (batch->count <= 0) {
+        logError("file: "__FILE__", line: %d, "
+                "empty batch, operation count: %d",
+                __LINE__, batch->count);
+        return EINVAL;
+    }
+
+    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff, header, rheader, req_id, out_bytes);
+    int2buff(batch->count, rheader->count);
+    rheader->ns_len = batch->ns.len;
+    memcpy(rheader->ns_str, batch->ns.str, batch->ns.len);
+    memcpy(rheader->ns_str + batch->ns.len, batch->ops.buff,
+            batch->ops.length);
+    out_bytes += batch->ns.len + batch->ops.length;
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_BATCH_REQ,
+            out_bytes - sizeof(FDIRProtoHeader));
+
+    response.error.length = 0;
+    if ((result=sf_send_and_recv_response_ex1(conn, out_buff, out_bytes,
                     &response, client_ctx->common_cfg.network_timeout,
-                    FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_RESP)) != 0)
+                    FDIR_SERVICE_PROTO_BATCH_RESP, in_buff,
+                    sizeof(in_buff), &body_len)) != 0)
     {
         sf_log_network_error_for_update(&response, conn, result);
+        return result;
     }
 
-    return result;
+    return client_batch_parse_results(client_ctx, batch,
+            conn, in_buff, body_len);
 }
 
-int fdir_client_proto_modify_dentry_stat(FDIRClientContext *client_ctx,
-        ConnectionInfo *conn, const uint64_t req_id,
-        const string_t *ns, const int64_t inode, const int64_t flags,
-        const FDIRDEntryStat *stat, FDIRDEntryInfo *dentry)
+int fdir_client_proto_pack_modify_dentry_stat(FDIRClientContext *client_ctx,
+        const uint64_t req_id, const string_t *ns, const int64_t inode,
+        const int64_t flags, const FDIRDEntryStat *stat,
+        char *out_buff, int *out_bytes)
 {
     FDIRProtoHeader *header;
     FDIRProtoModifyDentryStatReq *req;
-    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_UPDATE_EXTRA_BODY_SIZE +
-        sizeof(FDIRProtoModifyDentryStatReq) + NAME_MAX];
-    int out_bytes;
 
     if (ns->len <= 0 || ns->len > NAME_MAX) {
         logError("file: "__FILE__", line: %d, "
@@ -1041,15 +1420,35 @@ int fdir_client_proto_modify_dentry_stat(FDIRClientContext *client_ctx,
         return EINVAL;
     }
 
-    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff, header, req, req_id, out_bytes);
+    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff,
+            header, req, req_id, *out_bytes);
     long2buff(inode, req->inode);
     long2buff(flags, req->mflags);
     req->ns_len = ns->len;
     memcpy(req->ns_str, ns->str, ns->len);
     fdir_proto_pack_dentry_stat(stat, &req->stat);
-    out_bytes += ns->len;
+    *out_bytes += ns->len;
     SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_REQ,
-            out_bytes - sizeof(FDIRProtoHeader));
+            *out_bytes - sizeof(FDIRProtoHeader));
+    return 0;
+}
+
+int fdir_client_proto_modify_dentry_stat(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id,
+        const string_t *ns, const int64_t inode, const int64_t flags,
+        const FDIRDEntryStat *stat, FDIRDEntryInfo *dentry)
+{
+    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_UPDATE_EXTRA_BODY_SIZE +
+        sizeof(FDIRProtoModifyDentryStatReq) + NAME_MAX];
+    int out_bytes;
+    int result;
+
+    if ((result=fdir_client_proto_pack_modify_dentry_stat(client_ctx,
+                    req_id, ns, inode, flags, stat, out_buff,
+                    &out_bytes)) != 0)
+    {
+        return result;
+    }
 
     return do_update_dentry(client_ctx, conn, out_buff, out_bytes,
             FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_RESP, dentry);
@@ -1267,9 +1666,9 @@ int fdir_client_dentry_sys_unlock_ex(FDIRClientSession *session,
             out_bytes - sizeof(FDIRProtoHeader));
 
     response.error.length = 0;
-    if ((result=sf_send_and_recv_response(session->mconn, out_buff, out_bytes,
-                    &response, session->ctx->common_cfg.network_timeout,
-                    FDIR_SERVICE_PROTO_SYS_UNLOCK_DENTRY_RESP, NULL, 0)) != 0)
+    if ((result=send_and_recv_update_response(session->ctx, session->mconn,
+                    out_buff, out_bytes, &response,
+                    FDIR_SERVICE_PROTO_SYS_UNLOCK_DENTRY_RESP)) != 0)
     {
         sf_log_network_error(&response, session->mconn, result);
     }
@@ -1323,9 +1722,8 @@ int fdir_client_proto_set_xattr_by_path(FDIRClientContext *client_ctx,
             out_bytes - sizeof(FDIRProtoHeader));
 
     response.error.length = 0;
-    if ((result=sf_send_and_recv_none_body_response(conn, out_buff, out_bytes,
-                    &response, client_ctx->common_cfg.network_timeout,
-                    FDIR_SERVICE_PROTO_SET_XATTR_BY_PATH_RESP)) != 0)
+    if ((result=send_and_recv_update_response(client_ctx, conn, out_buff,
+                    out_bytes, &response, FDIR_SERVICE_PROTO_SET_XATTR_BY_PATH_RESP)) != 0)
     {
         sf_log_network_error_for_update(&response, conn, result);
     }
@@ -1367,9 +1765,8 @@ int fdir_client_proto_set_xattr_by_inode(FDIRClientContext *client_ctx,
             out_bytes - sizeof(FDIRProtoHeader));
 
     response.error.length = 0;
-    if ((result=sf_send_and_recv_none_body_response(conn, out_buff, out_bytes,
-                    &response, client_ctx->common_cfg.network_timeout,
-                    FDIR_SERVICE_PROTO_SET_XATTR_BY_INODE_RESP)) != 0)
+    if ((result=send_and_recv_update_response(client_ctx, conn, out_buff,
+                    out_bytes, &response, FDIR_SERVICE_PROTO_SET_XATTR_BY_INODE_RESP)) != 0)
     {
         sf_log_network_error_for_update(&response, conn, result);
     }
@@ -1408,9 +1805,8 @@ int fdir_client_proto_remove_xattr_by_path(FDIRClientContext *client_ctx,
             out_bytes - sizeof(FDIRProtoHeader));
 
     response.error.length = 0;
-    if ((result=sf_send_and_recv_none_body_response(conn, out_buff, out_bytes,
-                    &response, client_ctx->common_cfg.network_timeout,
-                    FDIR_SERVICE_PROTO_REMOVE_XATTR_BY_PATH_RESP)) != 0)
+    if ((result=send_and_recv_update_response(client_ctx, conn, out_buff,
+                    out_bytes, &response, FDIR_SERVICE_PROTO_REMOVE_XATTR_BY_PATH_RESP)) != 0)
     {
         sf_log_network_error_for_delete(&response,
                 conn, result, enoattr_log_level);
@@ -1449,9 +1845,8 @@ int fdir_client_proto_remove_xattr_by_inode(FDIRClientContext *client_ctx,
             out_bytes - sizeof(FDIRProtoHeader));
 
     response.error.length = 0;
-    if ((result=sf_send_and_recv_none_body_response(conn, out_buff, out_bytes,
-                    &response, client_ctx->common_cfg.network_timeout,
-                    FDIR_SERVICE_PROTO_REMOVE_XATTR_BY_INODE_RESP)) != 0)
+    if ((result=send_and_recv_update_response(client_ctx, conn, out_buff,
+                    out_bytes, &response, FDIR_SERVICE_PROTO_REMOVE_XATTR_BY_INODE_RESP)) != 0)
     {
         sf_log_network_error_for_delete(&response,
                 conn, result, enoattr_log_level);
@@ -1928,6 +2323,99 @@ int fdir_client_proto_list_dentry_by_inode(FDIRClientContext *client_ctx,
     return list_dentry(client_ctx, conn, out_buff, out_bytes, array);
 }
 
+static int service_detail_stat(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, FDIRClientServiceStat *stat)
+{
+    FDIRProtoHeader *header;
+    SFProtoEmptyBodyReq *req;
+    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_QUERY_EXTRA_BODY_SIZE];
+    char skip_buff[1024];
+    SFResponseInfo response;
+    FDIRProtoServiceDetailStatResp stat_resp;
+    int out_bytes;
+    int recv_bytes;
+    int remain;
+    int result;
+    int i;
+
+    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff, header, req, 0, out_bytes);
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_SERVICE_DETAIL_STAT_REQ,
+            out_bytes - sizeof(FDIRProtoHeader));
+    response.error.length = 0;
+    if ((result=sf_send_and_check_response_header(conn, out_buff,
+                    out_bytes, &response, client_ctx->common_cfg.
+                    network_timeout, FDIR_SERVICE_PROTO_SERVICE_DETAIL_STAT_RESP)) != 0)
+    {
+        if (response.error.length > 0 && result == EINVAL) {
+            stat->detail = false;  //the old server without this command
+            return 0;
+        }
+        sf_log_network_error(&response, conn, result);
+        return result;
+    }
+
+    //the fields absent from the older servers are zero
+    memset(&stat_resp, 0, sizeof(stat_resp));
+    recv_bytes = FC_MIN(response.header.body_len, (int)sizeof(stat_resp));
+    if ((result=tcprecvdata_nb(conn->sock, &stat_resp, recv_bytes,
+                    client_ctx->common_cfg.network_timeout)) != 0)
+    {
+        return result;
+    }
+
+    //skip the fields appended by the newer servers
+    remain = response.header.body_len - recv_bytes;
+    while (remain > 0) {
+        recv_bytes = FC_MIN(remain, (int)sizeof(skip_buff));
+        if ((result=tcprecvdata_nb(conn->sock, skip_buff, recv_bytes,
+                        client_ctx->common_cfg.network_timeout)) != 0)
+        {
+            return result;
+        }
+        remain -= recv_bytes;
+    }
+
+    stat->detail = true;
+    stat->dentry.lru.evict_count = buff2long(
+            stat_resp.dentry_lru.evict_count);
+    stat->dentry.lru.reload_count = buff2long(
+            stat_resp.dentry_lru.reload_count);
+
+    stat->inode_hashtable.capacity = buff2long(
+            stat_resp.inode_hashtable.capacity);
+    stat->inode_hashtable.count = buff2long(stat_resp.inode_hashtable.count);
+    stat->inode_hashtable.rehash_capacity = buff2long(
+            stat_resp.inode_hashtable.rehash_capacity);
+    stat->inode_hashtable.resize_count = buff2int(
+            stat_resp.inode_hashtable.resize_count);
+    stat->inode_hashtable.max_chain_length = buff2int(
+            stat_resp.inode_hashtable.max_chain_length);
+    for (i=0; i<FDIR_INODE_HT_CHAIN_HISTOGRAM_SIZE; i++) {
+        stat->inode_hashtable.chain_histogram[i] = buff2long(
+                stat_resp.inode_hashtable.chain_histogram[i]);
+    }
+
+    stat->data_load.record_count = buff2long(
+            stat_resp.data_load.record_count);
+    stat->data_load.skip_count = buff2long(stat_resp.data_load.skip_count);
+    stat->data_load.barrier_count = buff2long(
+            stat_resp.data_load.barrier_count);
+    stat->data_load.time_used_ms = buff2long(
+            stat_resp.data_load.time_used_ms);
+    stat->data_load.parallel = stat_resp.data_load.parallel;
+
+    stat->dentry.memory.dentry_size = buff2int(
+            stat_resp.dentry_memory.dentry_size);
+    stat->dentry.memory.count = buff2long(stat_resp.dentry_memory.count);
+    stat->dentry.memory.extra_count = buff2long(
+            stat_resp.dentry_memory.extra_count);
+    stat->dentry.memory.name_bytes = buff2long(
+            stat_resp.dentry_memory.name_bytes);
+    stat->dentry.memory.total_bytes = buff2long(
+            stat_resp.dentry_memory.total_bytes);
+    return 0;
+}
+
 int fdir_client_service_stat(FDIRClientContext *client_ctx,
         const ConnectionInfo *spec_conn, FDIRClientServiceStat *stat)
 {
@@ -1956,6 +2444,8 @@ int fdir_client_service_stat(FDIRClientContext *client_ctx,
                     (char *)&stat_resp, sizeof(FDIRProtoServiceStatResp))) != 0)
     {
         sf_log_network_error(&response, conn, result);
+    } else {
+        result = service_detail_stat(client_ctx, conn, stat);
     }
 
     SF_CLIENT_RELEASE_CONNECTION(&client_ctx->cm, conn, result);
@@ -2088,6 +2578,117 @@ int fdir_client_cluster_stat(FDIRClientContext *client_ctx,
     return result;
 }
 
+static void latency_stat_unpack_stage(FDIRClientLatencyStage *stage,
+        const FDIRProtoLatencyStatStage *proto)
+{
+    stage->count = buff2long(proto->count);
+    stage->avg = buff2long(proto->avg);
+    stage->p50 = buff2long(proto->p50);
+    stage->p90 = buff2long(proto->p90);
+    stage->p99 = buff2long(proto->p99);
+    stage->p999 = buff2long(proto->p999);
+    stage->max = buff2long(proto->max);
+}
+
+int fdir_client_latency_stat(FDIRClientContext *client_ctx,
+        const ConnectionInfo *spec_conn, FDIRClientLatencyStatEntry *stats,
+        const int size, int *count)
+{
+    FDIRProtoHeader *header;
+    SFProtoEmptyBodyReq *req;
+    FDIRProtoLatencyStatRespBodyHeader *body_header;
+    FDIRProtoLatencyStatRespBodyPart *body_part;
+    FDIRProtoLatencyStatRespBodyPart *body_end;
+    FDIRClientLatencyStatEntry *stat;
+    ConnectionInfo *conn;
+    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_QUERY_EXTRA_BODY_SIZE];
+    char *in_buff;
+    SFResponseInfo response;
+    int out_bytes;
+    int result;
+    int calc_size;
+    int i;
+
+    if ((conn=client_ctx->cm.ops.get_spec_connection(
+                    &client_ctx->cm, spec_conn, &result)) == NULL)
+    {
+        return result;
+    }
+
+    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff, header, req, 0, out_bytes);
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_LATENCY_STAT_REQ,
+            out_bytes - sizeof(FDIRProtoHeader));
+
+    response.error.length = 0;
+    in_buff = NULL;
+    if ((result=sf_send_and_check_response_header(conn, out_buff,
+                    out_bytes, &response, client_ctx->common_cfg.
+                    network_timeout, FDIR_SERVICE_PROTO_LATENCY_STAT_RESP))
+            == 0)
+    {
+        if (response.header.body_len < (int)sizeof(
+                    FDIRProtoLatencyStatRespBodyHeader))
+        {
+            response.error.length = sprintf(response.error.message,
+                    "response body length: %d is too small",
+                    response.header.body_len);
+            result = EINVAL;
+        } else if ((in_buff=(char *)fc_malloc(response.
+                        header.body_len)) == NULL)
+        {
+            response.error.length = sprintf(response.error.message,
+                    "malloc %d bytes fail", response.header.body_len);
+            result = ENOMEM;
+        } else {
+            result = tcprecvdata_nb(conn->sock, in_buff,
+                    response.header.body_len, client_ctx->
+                    common_cfg.network_timeout);
+        }
+    }
+
+    if (result == 0) {
+        body_header = (FDIRProtoLatencyStatRespBodyHeader *)in_buff;
+        *count = buff2int(body_header->count);
+        calc_size = sizeof(FDIRProtoLatencyStatRespBodyHeader) +
+            (*count) * sizeof(FDIRProtoLatencyStatRespBodyPart);
+        if (calc_size != response.header.body_len) {
+            response.error.length = sprintf(response.error.message,
+                    "response body length: %d != calculate size: %d, "
+                    "command count: %d", response.header.body_len,
+                    calc_size, *count);
+            *count = 0;
+            result = EINVAL;
+        } else if (size < *count) {
+            response.error.length = sprintf(response.error.message,
+                    "entry size %d too small < %d", size, *count);
+            *count = 0;
+            result = ENOSPC;
+        }
+    } else {
+        *count = 0;
+    }
+
+    if (result != 0) {
+        sf_log_network_error(&response, conn, result);
+    } else {
+        body_part = (FDIRProtoLatencyStatRespBodyPart *)(body_header + 1);
+        body_end = body_part + (*count);
+        for (stat=stats; body_part<body_end; body_part++, stat++) {
+            stat->cmd = body_part->cmd;
+            for (i=0; i<FDIR_LATENCY_STAGE_COUNT; i++) {
+                latency_stat_unpack_stage(stat->stages + i,
+                        body_part->stages + i);
+            }
+        }
+    }
+
+    SF_CLIENT_RELEASE_CONNECTION(&client_ctx->cm, conn, result);
+    if (in_buff != NULL) {
+        free(in_buff);
+    }
+    return result;
+}
+
 int fdir_client_get_master(FDIRClientContext *client_ctx,
         FDIRClientServerEntry *master)
 {
@@ -2368,11 +2969,13 @@ static int parse_nss_fetch_response_body(ConnectionInfo *conn,
 {
     FDIRProtoNSSFetchRespBodyHeader *body_header;
     FDIRProtoNSSFetchRespBodyPart *part;
+    FDIRProtoNSSFetchRespInodesPart *inodes_part;
     FDIRClientNamespaceStatEntry *current;
     FDIRClientNamespaceStatEntry *end;
     char *p;
     int result;
     int entry_len;
+    int inodes_bytes;
     int count;
 
     body_header = (FDIRProtoNSSFetchRespBodyHeader *)array->buffer.buff;
@@ -2398,12 +3001,26 @@ static int parse_nss_fetch_response_body(ConnectionInfo *conn,
         }
 
         current->used_bytes = buff2long(part->used_bytes);
+        current->used_inodes = 0;
         FC_SET_STRING_EX(current->ns_name, part->ns_name.str,
                 part->ns_name.len);
 
         p += entry_len;
     }
 
+    //the used inodes section is absent from the old servers
+    inodes_bytes = response->header.body_len - (p - array->buffer.buff);
+    if (inodes_bytes == count * (int)sizeof(
+                FDIRProtoNSSFetchRespInodesPart) && count > 0)
+    {
+        inodes_part = (FDIRProtoNSSFetchRespInodesPart *)p;
+        for (current=array->entries; current<end; current++) {
+            current->used_inodes = buff2long(inodes_part->used_inodes);
+            inodes_part++;
+        }
+        p = (char *)inodes_part;
+    }
+
     if ((int)(p - array->buffer.buff) != response->header.body_len) {
         response->error.length = snprintf(response->error.message,
                 sizeof(response->error.message),
@@ -2441,3 +3058,172 @@ int fdir_client_proto_nss_fetch(FDIRClientContext *client_ctx,
 
     return parse_nss_fetch_response_body(conn, &response, array, is_last);
 }
+
+int fdir_client_proto_invalidate_subscribe(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn)
+{
+    FDIRProtoHeader *header;
+    SFProtoEmptyBodyReq *req;
+    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_QUERY_EXTRA_BODY_SIZE +
+        sizeof(SFProtoEmptyBodyReq)];
+    SFResponseInfo response;
+    int out_bytes;
+    int result;
+
+    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff, header, req, 0, out_bytes);
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_INVALIDATE_SUBSCRIBE_REQ,
+            out_bytes - sizeof(FDIRProtoHeader));
+
+    response.error.length = 0;
+    if ((result=sf_send_and_recv_none_body_response(conn,
+                    out_buff, out_bytes, &response,
+                    client_ctx->common_cfg.network_timeout,
+                    FDIR_SERVICE_PROTO_INVALIDATE_SUBSCRIBE_RESP)) != 0)
+    {
+        sf_log_network_error(&response, conn, result);
+    }
+
+    return result;
+}
+
+int fdir_client_proto_wait_data_version(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const int64_t data_version,
+        const int timeout_ms, int64_t *current_version)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoWaitDataVersionReq *req;
+    FDIRProtoWaitDataVersionResp resp;
+    char out_buff[sizeof(FDIRProtoHeader) + SF_PROTO_QUERY_EXTRA_BODY_SIZE +
+        sizeof(FDIRProtoWaitDataVersionReq)];
+    SFResponseInfo response;
+    int out_bytes;
+    int result;
+
+    SF_PROTO_CLIENT_SET_REQ(client_ctx, out_buff, header, req, 0, out_bytes);
+    long2buff(data_version, req->data_version);
+    int2buff(timeout_ms, req->timeout_ms);
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_WAIT_DATA_VERSION_REQ,
+            out_bytes - sizeof(FDIRProtoHeader));
+
+    response.error.length = 0;
+    if ((result=sf_send_and_recv_response(conn, out_buff, out_bytes,
+                    &response, client_ctx->common_cfg.network_timeout,
+                    FDIR_SERVICE_PROTO_WAIT_DATA_VERSION_RESP, (char *)&resp,
+                    sizeof(FDIRProtoWaitDataVersionResp))) == 0)
+    {
+        *current_version = buff2long(resp.data_version);
+    } else if (result != EAGAIN) {  //EAGAIN for timeout
+        sf_log_network_error(&response, conn, result);
+    }
+
+    return result;
+}
+
+static int check_realloc_invalidate_array(SFResponseInfo *response,
+        FDIRClientInvalidateArray *array, const int target_count)
+{
+    FDIRClientInvalidateEvent *new_events;
+    int new_alloc;
+    int bytes;
+
+    if (target_count <= array->alloc) {
+        return 0;
+    }
+
+    new_alloc = (array->alloc == 0) ? 1024 : 2 * array->alloc;
+    while (new_alloc < target_count) {
+        new_alloc *= 2;
+    }
+
+    bytes = sizeof(FDIRClientInvalidateEvent) * new_alloc;
+    new_events = (FDIRClientInvalidateEvent *)fc_malloc(bytes);
+    if (new_events == NULL) {
+        response->error.length = sprintf(response->error.message,
+                "malloc %d bytes fail", bytes);
+        return ENOMEM;
+    }
+
+    if (array->events != NULL) {
+        free(array->events);
+    }
+    array->events = new_events;
+    array->alloc = new_alloc;
+    return 0;
+}
+
+static int parse_invalidate_fetch_response_body(ConnectionInfo *conn,
+        SFResponseInfo *response, FDIRClientInvalidateArray *array,
+        bool *is_last)
+{
+    FDIRProtoInvalidateFetchRespBodyHeader *body_header;
+    FDIRProtoInvalidateEvent *proto;
+    FDIRClientInvalidateEvent *event;
+    FDIRClientInvalidateEvent *end;
+    int result;
+    int count;
+    int expect_len;
+
+    body_header = (FDIRProtoInvalidateFetchRespBodyHeader *)
+        array->buffer.buff;
+    count = buff2int(body_header->count);
+    expect_len = sizeof(FDIRProtoInvalidateFetchRespBodyHeader) +
+        sizeof(FDIRProtoInvalidateEvent) * count;
+    if (expect_len != response->header.body_len) {
+        response->error.length = snprintf(response->error.message,
+                sizeof(response->error.message),
+                "server %s:%u response body length: %d != expect: %d",
+                conn->ip_addr, conn->port, response->header.body_len,
+                expect_len);
+        return EINVAL;
+    }
+
+    if ((result=check_realloc_invalidate_array(
+                    response, array, count)) != 0)
+    {
+        return result;
+    }
+
+    proto = (FDIRProtoInvalidateEvent *)(body_header + 1);
+    end = array->events + count;
+    for (event=array->events; event<end; event++, proto++) {
+        event->inode = buff2long(proto->inode);
+        event->parent_inode = buff2long(proto->parent_inode);
+        event->name_hash_code = buff2int(proto->name_hash_code);
+        event->flags = proto->flags;
+    }
+
+    *is_last = body_header->is_last;
+    array->overflow = body_header->overflow;
+    array->count = count;
+    return 0;
+}
+
+int fdir_client_proto_invalidate_fetch(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, FDIRClientInvalidateArray *array,
+        bool *is_last)
+{
+    FDIRProtoHeader *header;
+    char out_buff[sizeof(FDIRProtoHeader)];
+    SFResponseInfo response;
+    int result;
+
+    header = (FDIRProtoHeader *)out_buff;
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_INVALIDATE_FETCH_REQ, 0);
+    response.error.length = 0;
+    if ((result=sf_send_and_recv_vary_response(conn,
+                    out_buff, sizeof(out_buff), &response,
+                    client_ctx->common_cfg.network_timeout,
+                    FDIR_SERVICE_PROTO_INVALIDATE_FETCH_RESP, &array->buffer,
+                    sizeof(FDIRProtoInvalidateFetchRespBodyHeader))) != 0)
+    {
+        sf_log_network_error(&response, conn, result);
+        return result;
+    }
+
+    if ((result=parse_invalidate_fetch_response_body(conn,
+                    &response, array, is_last)) != 0)
+    {
+        sf_log_network_error(&response, conn, result);
+    }
+    return result;
+}
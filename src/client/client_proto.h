@@ -59,6 +59,7 @@ typedef struct fdir_client_service_stat {
     int server_id;
     bool is_master;
     char status;
+    bool detail;  //false for the old server without the detail stat
 
     struct {
         int current_count;
@@ -77,7 +78,37 @@ typedef struct fdir_client_service_stat {
             int64_t dir;
             int64_t file;
         } counters;
+
+        struct {
+            int64_t evict_count;
+            int64_t reload_count;
+        } lru;  //the detail stat, the same below
+
+        struct {
+            int dentry_size;
+            int64_t count;
+            int64_t extra_count;
+            int64_t name_bytes;
+            int64_t total_bytes;
+        } memory;
     } dentry;
+
+    struct {
+        int64_t capacity;
+        int64_t count;
+        int64_t rehash_capacity;  //0 for not rehashing
+        int resize_count;
+        int max_chain_length;
+        int64_t chain_histogram[FDIR_INODE_HT_CHAIN_HISTOGRAM_SIZE];
+    } inode_hashtable;
+
+    struct {
+        int64_t record_count;
+        int64_t skip_count;
+        int64_t barrier_count;
+        int64_t time_used_ms;
+        bool parallel;
+    } data_load;
 } FDIRClientServiceStat;
 
 typedef struct fdir_client_namespace_stat {
@@ -95,9 +126,25 @@ typedef struct fdir_client_cluster_stat_entry {
     uint16_t port;
 } FDIRClientClusterStatEntry;
 
+typedef struct fdir_client_latency_stage {
+    int64_t count;
+    int64_t avg;  //in microseconds, the same below
+    int64_t p50;
+    int64_t p90;
+    int64_t p99;
+    int64_t p999;
+    int64_t max;
+} FDIRClientLatencyStage;
+
+typedef struct fdir_client_latency_stat_entry {
+    int cmd;
+    FDIRClientLatencyStage stages[FDIR_LATENCY_STAGE_COUNT];
+} FDIRClientLatencyStatEntry;
+
 typedef struct fdir_client_namespace_stat_entry {
     string_t ns_name;
     int64_t used_bytes;
+    int64_t used_inodes;  //0 when the server does not return it
 } FDIRClientNamespaceStatEntry;
 
 typedef struct fdir_client_namespace_stat_array {
@@ -107,19 +154,113 @@ typedef struct fdir_client_namespace_stat_array {
     SFProtoRecvBuffer buffer;
 } FDIRClientNamespaceStatArray;
 
+typedef struct fdir_client_invalidate_event {
+    int64_t inode;
+    int64_t parent_inode;
+    unsigned int name_hash_code;
+    int flags;  //FDIR_INVALIDATE_FLAGS_INODE and/or PNAME
+} FDIRClientInvalidateEvent;
+
+typedef struct fdir_client_invalidate_array {
+    int alloc;
+    int count;
+    bool overflow;  //the events are lost, MUST drop all cached entries
+    FDIRClientInvalidateEvent *events;
+    SFProtoRecvBuffer buffer;
+} FDIRClientInvalidateArray;
+
+typedef struct fdir_client_batch_result {
+    int64_t inode;
+    int status;  //the errno of the operation, 0 for success
+} FDIRClientBatchResult;
+
+/* multi update operations of the same namespace sent in one request,
+ * the operations are executed in order by the server */
+typedef struct fdir_client_batch {
+    string_t ns;
+    int count;
+    int success;
+    struct {
+        int length;
+        char buff[FDIR_BATCH_UPDATE_MAX_BODY_SIZE];
+    } ops;  //the packed operations
+    FDIRClientBatchResult results[FDIR_BATCH_UPDATE_MAX_OP_COUNT];
+} FDIRClientBatch;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+//record the max data version of the updates for read your writes
+static inline void fdir_client_set_write_version(
+        FDIRClientContext *client_ctx, const int64_t data_version)
+{
+    int64_t old_version;
+
+    old_version = __sync_add_and_fetch(&client_ctx->
+            consistency.write_version, 0);
+    while (data_version > old_version) {
+        if (__sync_bool_compare_and_swap(&client_ctx->consistency.
+                    write_version, old_version, data_version))
+        {
+            break;
+        }
+        old_version = __sync_add_and_fetch(&client_ctx->
+                consistency.write_version, 0);
+    }
+}
+
 int fdir_client_init_session(FDIRClientContext *client_ctx,
     FDIRClientSession *session);
 
 void fdir_client_close_session(FDIRClientSession *session,
         const bool force_close);
 
+/* conn_params can be NULL for the connection without idempotency */
 int fdir_client_proto_join_server(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, SFConnectionParameters *conn_params);
 
+/* pack the request into out_buff without sending, for the pipeline,
+ * the idempotency header is NOT packed when req_id is 0 */
+int fdir_client_proto_pack_query_by_path(FDIRClientContext *client_ctx,
+        const FDIRDEntryFullName *fullname, const int req_cmd,
+        char *out_buff, int *out_bytes);
+
+int fdir_client_proto_pack_query_by_pname(FDIRClientContext *client_ctx,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        const int req_cmd, char *out_buff, int *out_bytes);
+
+int fdir_client_proto_pack_query_by_inode(FDIRClientContext *client_ctx,
+        const string_t *ns, const int64_t inode, const int req_cmd,
+        char *out_buff, int *out_bytes);
+
+int fdir_client_proto_pack_create_dentry(FDIRClientContext *client_ctx,
+        const uint64_t req_id, const FDIRDEntryFullName *fullname,
+        const FDIRClientOwnerModePair *omp, char *out_buff, int *out_bytes);
+
+int fdir_client_proto_pack_create_dentry_by_pname(
+        FDIRClientContext *client_ctx, const uint64_t req_id,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        const FDIRClientOwnerModePair *omp, char *out_buff, int *out_bytes);
+
+int fdir_client_proto_pack_remove_dentry(FDIRClientContext *client_ctx,
+        const uint64_t req_id, const FDIRDEntryFullName *fullname,
+        char *out_buff, int *out_bytes);
+
+int fdir_client_proto_pack_remove_dentry_by_pname(
+        FDIRClientContext *client_ctx, const uint64_t req_id,
+        const string_t *ns, const FDIRDEntryPName *pname,
+        char *out_buff, int *out_bytes);
+
+int fdir_client_proto_pack_set_dentry_size(FDIRClientContext *client_ctx,
+        const uint64_t req_id, const string_t *ns,
+        const FDIRSetDEntrySizeInfo *dsize, char *out_buff, int *out_bytes);
+
+int fdir_client_proto_pack_modify_dentry_stat(FDIRClientContext *client_ctx,
+        const uint64_t req_id, const string_t *ns, const int64_t inode,
+        const int64_t flags, const FDIRDEntryStat *stat,
+        char *out_buff, int *out_bytes);
+
 int fdir_client_proto_create_dentry(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const uint64_t req_id,
         const FDIRDEntryFullName *fullname,
@@ -213,6 +354,39 @@ int fdir_client_proto_batch_set_dentry_size(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const uint64_t req_id, const string_t *ns,
         const FDIRSetDEntrySizeInfo *dsizes, const int count);
 
+static inline void fdir_client_batch_init(FDIRClientBatch *batch,
+        const string_t *ns)
+{
+    batch->ns = *ns;
+    batch->count = batch->success = 0;
+    batch->ops.length = 0;
+}
+
+#define fdir_client_batch_reset(batch) \
+    fdir_client_batch_init(batch, &(batch)->ns)
+
+/* the add functions return ENOSPC when the batch is full */
+int fdir_client_batch_add_create(FDIRClientBatch *batch,
+        const string_t *path, const FDIRClientOwnerModePair *omp);
+
+int fdir_client_batch_add_symlink(FDIRClientBatch *batch,
+        const string_t *link, const string_t *path,
+        const FDIRClientOwnerModePair *omp);
+
+int fdir_client_batch_add_remove(FDIRClientBatch *batch,
+        const string_t *path);
+
+int fdir_client_batch_add_set_xattr(FDIRClientBatch *batch,
+        const string_t *path, const key_value_pair_t *xattr,
+        const int flags);
+
+int fdir_client_batch_add_remove_xattr(FDIRClientBatch *batch,
+        const string_t *path, const string_t *name);
+
+int fdir_client_proto_batch_update(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id,
+        FDIRClientBatch *batch);
+
 int fdir_client_proto_modify_dentry_stat(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const uint64_t req_id,
         const string_t *ns, const int64_t inode, const int64_t flags,
@@ -325,12 +499,34 @@ int fdir_client_proto_nss_fetch(FDIRClientContext *client_ctx,
 int fdir_client_namespace_stat_array_init(FDIRClientNamespaceStatArray *array);
 void fdir_client_namespace_stat_array_free(FDIRClientNamespaceStatArray *array);
 
+int fdir_client_proto_invalidate_subscribe(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn);
+
+int fdir_client_proto_invalidate_fetch(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, FDIRClientInvalidateArray *array,
+        bool *is_last);
+
+int fdir_client_invalidate_array_init(FDIRClientInvalidateArray *array);
+void fdir_client_invalidate_array_free(FDIRClientInvalidateArray *array);
+
+/* wait until the server applied the data version,
+ * return EAGAIN when timeout */
+int fdir_client_proto_wait_data_version(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const int64_t data_version,
+        const int timeout_ms, int64_t *current_version);
+
 int fdir_client_service_stat(FDIRClientContext *client_ctx,
         const ConnectionInfo *spec_conn, FDIRClientServiceStat *stat);
 
 int fdir_client_cluster_stat(FDIRClientContext *client_ctx,
         FDIRClientClusterStatEntry *stats, const int size, int *count);
 
+/* the latency histograms of the requests by command,
+ * stats: the entries at least FDIR_LATENCY_STAT_MAX_CMD_COUNT */
+int fdir_client_latency_stat(FDIRClientContext *client_ctx,
+        const ConnectionInfo *spec_conn, FDIRClientLatencyStatEntry *stats,
+        const int size, int *count);
+
 int fdir_client_proto_namespace_stat(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const string_t *ns,
         FDIRClientNamespaceStat *stat);
@@ -26,6 +26,9 @@
 
 #define FDIR_CLIENT_DEFAULT_CONFIG_FILENAME "/etc/fastcfs/fdir/client.conf"
 
+#define FDIR_CLIENT_DEFAULT_READ_WAIT_VERSION_TIMEOUT_MS  100
+#define FDIR_CLIENT_MAX_TRACKED_SERVERS                    16
+
 struct fdir_client_context;
 
 typedef struct fdir_client_server_entry {
@@ -45,6 +48,24 @@ typedef struct fdir_client_session {
     ConnectionInfo *mconn;  //master connection
 } FDIRClientSession;
 
+//the applied data version of the server known by the client
+typedef struct fdir_client_server_version {
+    char ip_addr[IP_ADDRESS_SIZE];
+    int port;
+    volatile int64_t data_version;
+} FDIRClientServerVersion;
+
+typedef struct fdir_client_read_consistency {
+    bool read_your_writes;
+    int wait_timeout_ms;
+    volatile int64_t write_version;  //the max data version of my updates
+    struct {
+        volatile int count;  //published after the entry filled
+        pthread_mutex_t lock;  //for adding the entry
+        FDIRClientServerVersion entries[FDIR_CLIENT_MAX_TRACKED_SERVERS];
+    } servers;
+} FDIRClientReadConsistency;
+
 typedef enum {
     conn_manager_type_simple = 1,
     conn_manager_type_pooled,
@@ -58,6 +79,7 @@ typedef struct fdir_client_context {
     bool cloned;
     bool idempotency_enabled;
     SFClientCommonConfig common_cfg;
+    FDIRClientReadConsistency consistency;
     FCFSAuthClientFullContext auth;
 } FDIRClientContext;
 
@@ -13,6 +13,7 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "fastcommon/pthread_func.h"
 #include "sf/idempotency/client/client_channel.h"
 #include "sf/idempotency/client/rpc_wrapper.h"
 #include "client_global.h"
@@ -21,8 +22,135 @@
 #define GET_MASTER_CONNECTION(cm, arg1, result)   \
     (cm)->ops.get_master_connection(cm, arg1, result)
 
+/* the variable client_ctx MUST be in the scope of the caller */
 #define GET_READABLE_CONNECTION(cm, arg1, result) \
-    (cm)->ops.get_readable_connection(cm, arg1, result)
+    get_readable_connection(client_ctx, cm, arg1, result)
+
+static inline volatile int64_t *find_server_version_ptr(
+        FDIRClientContext *client_ctx, const ConnectionInfo *conn,
+        const int count)
+{
+    FDIRClientServerVersion *entry;
+    FDIRClientServerVersion *end;
+
+    end = client_ctx->consistency.servers.entries + count;
+    for (entry=client_ctx->consistency.servers.entries;
+            entry<end; entry++)
+    {
+        if (entry->port == conn->port &&
+                strcmp(entry->ip_addr, conn->ip_addr) == 0)
+        {
+            return &entry->data_version;
+        }
+    }
+
+    return NULL;
+}
+
+static volatile int64_t *get_server_version_ptr(
+        FDIRClientContext *client_ctx, const ConnectionInfo *conn)
+{
+    FDIRClientServerVersion *entry;
+    volatile int64_t *server_version;
+    int count;
+
+    count = __sync_add_and_fetch(&client_ctx->consistency.servers.count, 0);
+    if ((server_version=find_server_version_ptr(client_ctx,
+                    conn, count)) != NULL)
+    {
+        return server_version;
+    }
+
+    PTHREAD_MUTEX_LOCK(&client_ctx->consistency.servers.lock);
+    count = client_ctx->consistency.servers.count;
+    if ((server_version=find_server_version_ptr(client_ctx,
+                    conn, count)) == NULL &&
+            count < FDIR_CLIENT_MAX_TRACKED_SERVERS)
+    {
+        entry = client_ctx->consistency.servers.entries + count;
+        strcpy(entry->ip_addr, conn->ip_addr);
+        entry->port = conn->port;
+        entry->data_version = 0;
+        server_version = &entry->data_version;
+
+        //publish the entry to the lockless readers
+        __sync_add_and_fetch(&client_ctx->consistency.servers.count, 1);
+    }
+    PTHREAD_MUTEX_UNLOCK(&client_ctx->consistency.servers.lock);
+
+    return server_version;
+}
+
+static inline void set_server_version(volatile int64_t *server_version,
+        const int64_t data_version)
+{
+    int64_t old_version;
+
+    old_version = __sync_add_and_fetch(server_version, 0);
+    while (data_version > old_version) {
+        if (__sync_bool_compare_and_swap(server_version,
+                    old_version, data_version))
+        {
+            break;
+        }
+        old_version = __sync_add_and_fetch(server_version, 0);
+    }
+}
+
+/* read your writes: the readable server MUST applied the data version
+ * of my updates, otherwise wait for it or read from the master */
+static ConnectionInfo *get_readable_connection(FDIRClientContext *client_ctx,
+        SFConnectionManager *cm, const int group_index, int *err_no)
+{
+    ConnectionInfo *conn;
+    volatile int64_t *server_version;
+    int64_t write_version;
+    int64_t current_version;
+
+    if ((conn=cm->ops.get_readable_connection(cm,
+                    group_index, err_no)) == NULL)
+    {
+        return NULL;
+    }
+
+    if (!client_ctx->consistency.read_your_writes ||
+            cm->common_cfg->read_rule == sf_data_read_rule_master_only)
+    {
+        return conn;
+    }
+
+    write_version = __sync_add_and_fetch(&client_ctx->
+            consistency.write_version, 0);
+    if (write_version == 0) {
+        return conn;
+    }
+
+    server_version = get_server_version_ptr(client_ctx, conn);
+    if (server_version != NULL && __sync_add_and_fetch(
+                server_version, 0) >= write_version)
+    {
+        return conn;
+    }
+
+    if ((*err_no=fdir_client_proto_wait_data_version(client_ctx, conn,
+                    write_version, client_ctx->consistency.
+                    wait_timeout_ms, &current_version)) == 0)
+    {
+        if (server_version != NULL) {
+            set_server_version(server_version, current_version);
+        }
+        return conn;
+    }
+
+    if (*err_no == EAGAIN) {
+        if (cm->ops.release_connection != NULL) {
+            cm->ops.release_connection(cm, conn);
+        }
+    } else {
+        cm->ops.close_connection(cm, conn);
+    }
+    return cm->ops.get_master_connection(cm, group_index, err_no);
+}
 
 int fdir_client_create_dentry(FDIRClientContext *client_ctx,
         const FDIRDEntryFullName *fullname,
@@ -159,6 +287,16 @@ int fdir_client_batch_set_dentry_size(FDIRClientContext *client_ctx,
             ns, dsizes, count);
 }
 
+int fdir_client_batch_commit(FDIRClientContext *client_ctx,
+        FDIRClientBatch *batch)
+{
+    const SFConnectionParameters *connection_params;
+
+    SF_CLIENT_IDEMPOTENCY_UPDATE_WRAPPER(client_ctx, &client_ctx->cm,
+            GET_MASTER_CONNECTION, 0, fdir_client_proto_batch_update,
+            batch);
+}
+
 int fdir_client_modify_dentry_stat(FDIRClientContext *client_ctx,
         const string_t *ns, const int64_t inode, const int64_t flags,
         const FDIRDEntryStat *stat, FDIRDEntryInfo *dentry)
@@ -267,6 +405,43 @@ int fdir_client_stat_dentry_by_pname_ex(FDIRClientContext *client_ctx,
             ns, pname, enoent_log_level, dentry);
 }
 
+int fdir_client_master_lookup_inode_by_pname_ex(
+        FDIRClientContext *client_ctx, const string_t *ns,
+        const FDIRDEntryPName *pname, const int enoent_log_level,
+        int64_t *inode)
+{
+    SF_CLIENT_IDEMPOTENCY_QUERY_WRAPPER(client_ctx, &client_ctx->cm,
+            GET_MASTER_CONNECTION, 0, fdir_client_proto_lookup_inode_by_pname,
+            ns, pname, enoent_log_level, inode);
+}
+
+int fdir_client_master_stat_dentry_by_path_ex(FDIRClientContext *client_ctx,
+        const FDIRDEntryFullName *fullname, const int enoent_log_level,
+        FDIRDEntryInfo *dentry)
+{
+    SF_CLIENT_IDEMPOTENCY_QUERY_WRAPPER(client_ctx, &client_ctx->cm,
+            GET_MASTER_CONNECTION, 0, fdir_client_proto_stat_dentry_by_path,
+            fullname, enoent_log_level, dentry);
+}
+
+int fdir_client_master_stat_dentry_by_inode(FDIRClientContext *client_ctx,
+        const string_t *ns, const int64_t inode, FDIRDEntryInfo *dentry)
+{
+    SF_CLIENT_IDEMPOTENCY_QUERY_WRAPPER(client_ctx, &client_ctx->cm,
+            GET_MASTER_CONNECTION, 0, fdir_client_proto_stat_dentry_by_inode,
+            ns, inode, dentry);
+}
+
+int fdir_client_master_stat_dentry_by_pname_ex(
+        FDIRClientContext *client_ctx, const string_t *ns,
+        const FDIRDEntryPName *pname, const int enoent_log_level,
+        FDIRDEntryInfo *dentry)
+{
+    SF_CLIENT_IDEMPOTENCY_QUERY_WRAPPER(client_ctx, &client_ctx->cm,
+            GET_MASTER_CONNECTION, 0, fdir_client_proto_stat_dentry_by_pname,
+            ns, pname, enoent_log_level, dentry);
+}
+
 int fdir_client_readlink_by_path(FDIRClientContext *client_ctx,
         const FDIRDEntryFullName *fullname, string_t *link, const int size)
 {
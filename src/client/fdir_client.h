@@ -22,6 +22,8 @@
 #include "client_func.h"
 #include "client_global.h"
 #include "client_proto.h"
+#include "client_pipeline.h"
+#include "client_meta_cache.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -117,6 +119,13 @@ int fdir_client_batch_set_dentry_size(FDIRClientContext *client_ctx,
         const string_t *ns, const FDIRSetDEntrySizeInfo *dsizes,
         const int count);
 
+/* send the operations of the batch in one request,
+ * the status of each operation is stored in batch->results
+ * return EALREADY when the batch was done by the retried request and
+ *   the results are lost, the caller should stat the dentries instead */
+int fdir_client_batch_commit(FDIRClientContext *client_ctx,
+        FDIRClientBatch *batch);
+
 int fdir_client_modify_dentry_stat(FDIRClientContext *client_ctx,
         const string_t *ns, const int64_t inode, const int64_t flags,
         const FDIRDEntryStat *stat, FDIRDEntryInfo *dentry);
@@ -202,6 +211,25 @@ int fdir_client_stat_dentry_by_pname_ex(FDIRClientContext *client_ctx,
 int fdir_client_stat_dentry_by_inode(FDIRClientContext *client_ctx,
         const string_t *ns, const int64_t inode, FDIRDEntryInfo *dentry);
 
+/* read from the master regardless of the read rule, for the meta cache
+ * whose invalidate events are subscribed from the master */
+int fdir_client_master_lookup_inode_by_pname_ex(
+        FDIRClientContext *client_ctx, const string_t *ns,
+        const FDIRDEntryPName *pname, const int enoent_log_level,
+        int64_t *inode);
+
+int fdir_client_master_stat_dentry_by_path_ex(FDIRClientContext *client_ctx,
+        const FDIRDEntryFullName *fullname, const int enoent_log_level,
+        FDIRDEntryInfo *dentry);
+
+int fdir_client_master_stat_dentry_by_inode(FDIRClientContext *client_ctx,
+        const string_t *ns, const int64_t inode, FDIRDEntryInfo *dentry);
+
+int fdir_client_master_stat_dentry_by_pname_ex(
+        FDIRClientContext *client_ctx, const string_t *ns,
+        const FDIRDEntryPName *pname, const int enoent_log_level,
+        FDIRDEntryInfo *dentry);
+
 int fdir_client_readlink_by_path(FDIRClientContext *client_ctx,
         const FDIRDEntryFullName *fullname, string_t *link, const int size);
 
@@ -0,0 +1,936 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastdir/client/fdir_client.h"
+#include "fastdir/client/fdir_histogram.h"
+
+#define BENCH_MAX_NAMESPACE_COUNT   64
+#define BENCH_MAX_TREE_DEPTH       128
+#define BENCH_MAX_TREE_WIDTH     10000
+#define BENCH_MAX_ERROR_LOGS        10
+
+typedef enum {
+    BENCH_OP_CREATE = 0,
+    BENCH_OP_STAT,
+    BENCH_OP_LOOKUP,
+    BENCH_OP_LIST,
+    BENCH_OP_SETXATTR,
+    BENCH_OP_SET_DSIZE,
+    BENCH_OP_FLOCK,
+    BENCH_OP_RENAME,
+    BENCH_OP_REMOVE,
+    BENCH_OP_COUNT
+} BenchOpType;
+
+typedef enum {
+    BENCH_SHAPE_WIDE = 0,
+    BENCH_SHAPE_DEEP,
+    BENCH_SHAPE_HOT
+} BenchTreeShape;
+
+typedef struct {
+    int64_t errors;
+    FDIRHistogram histogram;  //in microseconds
+} BenchLatencyStat;
+
+typedef struct {
+    string_t path;
+    int64_t inode;
+} BenchDirEntry;
+
+typedef struct {
+    int index;
+    string_t *ns;
+    FDIRClientContext client_ctx;
+    FCFSAuthClientContext auth_ctx;
+    FDIRClientSession session;
+    FDIRClientDentryArray array;
+    struct {
+        BenchDirEntry *entries;
+        int count;
+    } dirs;
+    int64_t *inodes;
+    BenchOpType op;          //current phase
+    BenchLatencyStat *stat;  //current phase
+    int result;
+} BenchThreadContext;
+
+static const char *op_names[BENCH_OP_COUNT] = {
+    "create", "stat", "lookup", "list", "setxattr",
+    "set_dsize", "flock", "rename", "remove"
+};
+
+static const char *shape_names[] = {"wide", "deep", "hot"};
+
+static char *config_filename = FDIR_CLIENT_DEFAULT_CONFIG_FILENAME;
+static char *ns_prefix = "bench";
+static char *base_path = "/benchmark";
+static int ns_count = 1;
+static int threads = 8;
+static int items = 1000;
+static int tree_width = 16;
+static int tree_depth = 8;
+static BenchTreeShape tree_shape = BENCH_SHAPE_WIDE;
+static bool json_output = false;
+static bool keep_tree = false;
+static char name_prefix = 'f';
+
+static string_t namespaces[BENCH_MAX_NAMESPACE_COUNT];
+static BenchOpType phases[BENCH_OP_COUNT];
+static int phase_count = 0;
+static BenchLatencyStat phase_stats[BENCH_OP_COUNT];
+static int64_t phase_time_used[BENCH_OP_COUNT];  //in microseconds
+static BenchThreadContext *contexts;
+static volatile int error_logs = 0;
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-c config_filename=%s]\n"
+            "\t[-n namespace prefix=bench] [-N namespace count=1]\n"
+            "\t[-b base path=/benchmark] [-t thread count=8]\n"
+            "\t[-i items per thread=1000]\n"
+            "\t[-s tree shape: wide | deep | hot, default: wide]\n"
+            "\t[-w directory width for wide shape=16]\n"
+            "\t[-d directory depth for deep shape=8]\n"
+            "\t[-m comma separated operations, default: "
+            "create,stat,lookup,list,setxattr,set_dsize,flock,"
+            "rename,remove]\n"
+            "\t[-j for JSON output] [-k for keeping the directories]\n",
+            argv[0], FDIR_CLIENT_DEFAULT_CONFIG_FILENAME);
+}
+
+static inline void latency_stat_add(BenchLatencyStat *stat,
+        const int64_t start_time, const int result)
+{
+    int64_t time_used;
+
+    if (result != 0) {
+        stat->errors++;
+        return;
+    }
+
+    time_used = get_current_time_us() - start_time;
+    fdir_histogram_add(&stat->histogram, time_used);
+}
+
+static inline void latency_stat_merge(BenchLatencyStat *dest,
+        const BenchLatencyStat *src)
+{
+    dest->errors += src->errors;
+    fdir_histogram_merge(&dest->histogram, &src->histogram);
+}
+
+static inline void log_op_error(BenchThreadContext *thread_ctx,
+        const BenchOpType op, const int result)
+{
+    if (__sync_add_and_fetch(&error_logs, 1) <= BENCH_MAX_ERROR_LOGS) {
+        logError("file: "__FILE__", line: %d, "
+                "thread #%d, operation: %s fail, namespace: %.*s, "
+                "errno: %d, error info: %s", __LINE__, thread_ctx->index,
+                op_names[op], thread_ctx->ns->len, thread_ctx->ns->str,
+                result, STRERROR(result));
+    }
+}
+
+static inline BenchDirEntry *get_item_dir(BenchThreadContext *thread_ctx,
+        const int item_index)
+{
+    return thread_ctx->dirs.entries + item_index % thread_ctx->dirs.count;
+}
+
+static inline int format_item_name(BenchThreadContext *thread_ctx,
+        const char prefix, const int item_index, char *name)
+{
+    return sprintf(name, "%c.%d.%d", prefix,
+            thread_ctx->index, item_index);
+}
+
+static inline int format_item_path(BenchThreadContext *thread_ctx,
+        const char prefix, const int item_index, char *path)
+{
+    BenchDirEntry *dir;
+    int len;
+
+    dir = get_item_dir(thread_ctx, item_index);
+    memcpy(path, dir->path.str, dir->path.len);
+    len = dir->path.len;
+    *(path + len++) = '/';
+    return len + format_item_name(thread_ctx, prefix,
+            item_index, path + len);
+}
+
+static int create_dir(FDIRClientContext *client_ctx, const string_t *ns,
+        const char *path, const int len, int64_t *inode)
+{
+    FDIRDEntryFullName fullname;
+    FDIRClientOwnerModePair omp;
+    FDIRDEntryInfo dentry;
+    int result;
+
+    fullname.ns = *ns;
+    FC_SET_STRING_EX(fullname.path, (char *)path, len);
+    omp.mode = 0755 | S_IFDIR;
+    omp.uid = geteuid();
+    omp.gid = getegid();
+    if ((result=fdir_client_create_dentry(client_ctx,
+                    &fullname, &omp, &dentry)) == 0)
+    {
+        *inode = dentry.inode;
+        return 0;
+    }
+
+    if (result != EEXIST) {
+        logError("file: "__FILE__", line: %d, "
+                "create directory %.*s fail, namespace: %.*s, "
+                "errno: %d, error info: %s", __LINE__, len, path,
+                ns->len, ns->str, result, STRERROR(result));
+        return result;
+    }
+
+    return fdir_client_lookup_inode_by_path(client_ctx, &fullname, inode);
+}
+
+static int create_base_path(FDIRClientContext *client_ctx,
+        const string_t *ns)
+{
+    char path[PATH_MAX];
+    char *p;
+    int64_t inode;
+    int result;
+
+    if ((result=create_dir(client_ctx, ns, "/", 1, &inode)) != 0) {
+        return result;
+    }
+
+    snprintf(path, sizeof(path), "%s", base_path);
+    p = path;
+    while (*p != '\0') {
+        p = strchr(p + 1, '/');
+        if (p == NULL) {
+            p = path + strlen(path);
+        }
+        if (p - path > 1 && *(p - 1) != '/') {
+            if ((result=create_dir(client_ctx, ns, path,
+                            p - path, &inode)) != 0)
+            {
+                return result;
+            }
+        }
+    }
+
+    if (tree_shape == BENCH_SHAPE_HOT) {
+        snprintf(path, sizeof(path), "%s/hot", base_path);
+        if ((result=create_dir(client_ctx, ns, path,
+                        strlen(path), &inode)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int add_thread_dir(BenchThreadContext *thread_ctx,
+        const char *path, const int len)
+{
+    BenchDirEntry *dir;
+    int result;
+
+    dir = thread_ctx->dirs.entries + thread_ctx->dirs.count;
+    if ((result=create_dir(&thread_ctx->client_ctx, thread_ctx->ns,
+                    path, len, &dir->inode)) != 0)
+    {
+        return result;
+    }
+
+    if ((dir->path.str=fc_malloc(len + 1)) == NULL) {
+        return ENOMEM;
+    }
+    memcpy(dir->path.str, path, len + 1);
+    dir->path.len = len;
+    thread_ctx->dirs.count++;
+    return 0;
+}
+
+/* the leaf directories of the thread:
+ *   wide: <base>/t<index>/d<0 .. width-1>
+ *   deep: <base>/t<index>/l0/l1/.../l<depth-1>, items of every level
+ *   hot:  <base>/hot shared by all threads
+ */
+static int create_thread_tree(BenchThreadContext *thread_ctx)
+{
+    char path[PATH_MAX];
+    int64_t inode;
+    int alloc_count;
+    int base_len;
+    int len;
+    int result;
+    int i;
+
+    switch (tree_shape) {
+        case BENCH_SHAPE_WIDE:
+            alloc_count = tree_width;
+            break;
+        case BENCH_SHAPE_DEEP:
+            alloc_count = tree_depth;
+            break;
+        default:
+            alloc_count = 1;
+            break;
+    }
+    thread_ctx->dirs.entries = fc_malloc(sizeof(BenchDirEntry) * alloc_count);
+    if (thread_ctx->dirs.entries == NULL) {
+        return ENOMEM;
+    }
+    thread_ctx->dirs.count = 0;
+
+    if (tree_shape == BENCH_SHAPE_HOT) {
+        len = snprintf(path, sizeof(path), "%s/hot", base_path);
+        return add_thread_dir(thread_ctx, path, len);
+    }
+
+    base_len = snprintf(path, sizeof(path), "%s/t%d",
+            base_path, thread_ctx->index);
+    if ((result=create_dir(&thread_ctx->client_ctx, thread_ctx->ns,
+                    path, base_len, &inode)) != 0)
+    {
+        return result;
+    }
+
+    len = base_len;
+    for (i=0; i<alloc_count; i++) {
+        if (tree_shape == BENCH_SHAPE_WIDE) {
+            len = base_len + sprintf(path + base_len, "/d%d", i);
+        } else {
+            len += sprintf(path + len, "/l%d", i);
+        }
+        if ((result=add_thread_dir(thread_ctx, path, len)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static void remove_thread_tree(BenchThreadContext *thread_ctx)
+{
+    FDIRDEntryFullName fullname;
+    char path[PATH_MAX];
+    int i;
+
+    //the hot directory is shared and removed by the main thread
+    if (tree_shape == BENCH_SHAPE_HOT) {
+        return;
+    }
+
+    fullname.ns = *thread_ctx->ns;
+    for (i=thread_ctx->dirs.count-1; i>=0; i--) {
+        fullname.path = thread_ctx->dirs.entries[i].path;
+        fdir_client_remove_dentry(&thread_ctx->client_ctx, &fullname);
+    }
+
+    fullname.path.str = path;
+    fullname.path.len = snprintf(path, sizeof(path), "%s/t%d",
+            base_path, thread_ctx->index);
+    fdir_client_remove_dentry(&thread_ctx->client_ctx, &fullname);
+}
+
+static void remove_hot_dirs()
+{
+    FDIRDEntryFullName fullname;
+    char path[PATH_MAX];
+    int i;
+
+    fullname.path.str = path;
+    fullname.path.len = snprintf(path, sizeof(path), "%s/hot", base_path);
+    for (i=0; i<ns_count; i++) {
+        fullname.ns = namespaces[i];
+        fdir_client_remove_dentry(&g_fdir_client_vars.client_ctx, &fullname);
+    }
+}
+
+static int do_create(BenchThreadContext *thread_ctx, const int item_index)
+{
+    FDIRDEntryFullName fullname;
+    FDIRClientOwnerModePair omp;
+    FDIRDEntryInfo dentry;
+    char path[PATH_MAX];
+    int result;
+
+    fullname.ns = *thread_ctx->ns;
+    fullname.path.str = path;
+    fullname.path.len = format_item_path(thread_ctx,
+            name_prefix, item_index, path);
+    omp.mode = 0644 | S_IFREG;
+    omp.uid = geteuid();
+    omp.gid = getegid();
+    if ((result=fdir_client_create_dentry(&thread_ctx->client_ctx,
+                    &fullname, &omp, &dentry)) == 0)
+    {
+        thread_ctx->inodes[item_index] = dentry.inode;
+    }
+    return result;
+}
+
+static int do_stat(BenchThreadContext *thread_ctx, const int item_index)
+{
+    FDIRDEntryFullName fullname;
+    FDIRDEntryInfo dentry;
+    char path[PATH_MAX];
+
+    fullname.ns = *thread_ctx->ns;
+    fullname.path.str = path;
+    fullname.path.len = format_item_path(thread_ctx,
+            name_prefix, item_index, path);
+    return fdir_client_stat_dentry_by_path(&thread_ctx->client_ctx,
+            &fullname, &dentry);
+}
+
+static int do_lookup(BenchThreadContext *thread_ctx, const int item_index)
+{
+    FDIRDEntryPName pname;
+    char name[NAME_MAX];
+    int64_t inode;
+
+    pname.parent_inode = get_item_dir(thread_ctx, item_index)->inode;
+    pname.name.str = name;
+    pname.name.len = format_item_name(thread_ctx,
+            name_prefix, item_index, name);
+    return fdir_client_lookup_inode_by_pname(&thread_ctx->client_ctx,
+            thread_ctx->ns, &pname, &inode);
+}
+
+static int do_list(BenchThreadContext *thread_ctx, const int dir_index)
+{
+    FDIRDEntryFullName fullname;
+
+    fullname.ns = *thread_ctx->ns;
+    fullname.path = thread_ctx->dirs.entries[dir_index].path;
+    return fdir_client_list_dentry_by_path(&thread_ctx->client_ctx,
+            &fullname, &thread_ctx->array);
+}
+
+static int do_setxattr(BenchThreadContext *thread_ctx, const int item_index)
+{
+    const int flags = 0;
+    key_value_pair_t xattr;
+    char value[32];
+
+    FC_SET_STRING(xattr.key, "user.benchmark");
+    xattr.value.str = value;
+    xattr.value.len = sprintf(value, "%d", item_index);
+    return fdir_client_set_xattr_by_inode(&thread_ctx->client_ctx,
+            thread_ctx->ns, thread_ctx->inodes[item_index], &xattr, flags);
+}
+
+static int do_set_dsize(BenchThreadContext *thread_ctx, const int item_index)
+{
+    FDIRSetDEntrySizeInfo dsize;
+    FDIRDEntryInfo dentry;
+
+    dsize.inode = thread_ctx->inodes[item_index];
+    dsize.file_size = (int64_t)(item_index + 1) * 4096;
+    dsize.inc_alloc = 0;
+    dsize.force = false;
+    dsize.flags = FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE;
+    return fdir_client_set_dentry_size(&thread_ctx->client_ctx,
+            thread_ctx->ns, &dsize, &dentry);
+}
+
+static int do_flock(BenchThreadContext *thread_ctx, const int item_index)
+{
+    int result;
+
+    if ((result=fdir_client_flock_dentry(&thread_ctx->session,
+                    thread_ctx->ns, thread_ctx->inodes[item_index],
+                    LOCK_EX | LOCK_NB)) != 0)
+    {
+        return result;
+    }
+    return fdir_client_flock_dentry(&thread_ctx->session, thread_ctx->ns,
+            thread_ctx->inodes[item_index], LOCK_UN);
+}
+
+static int do_rename(BenchThreadContext *thread_ctx, const int item_index)
+{
+    const int flags = 0;
+    FDIRDEntryFullName src;
+    FDIRDEntryFullName dest;
+    char src_path[PATH_MAX];
+    char dest_path[PATH_MAX];
+
+    src.ns = dest.ns = *thread_ctx->ns;
+    src.path.str = src_path;
+    src.path.len = format_item_path(thread_ctx,
+            name_prefix, item_index, src_path);
+    dest.path.str = dest_path;
+    dest.path.len = format_item_path(thread_ctx,
+            name_prefix == 'f' ? 'r' : 'f', item_index, dest_path);
+    return fdir_client_rename_dentry(&thread_ctx->client_ctx,
+            &src, &dest, flags);
+}
+
+static int do_remove(BenchThreadContext *thread_ctx, const int item_index)
+{
+    FDIRDEntryFullName fullname;
+    char path[PATH_MAX];
+
+    fullname.ns = *thread_ctx->ns;
+    fullname.path.str = path;
+    fullname.path.len = format_item_path(thread_ctx,
+            name_prefix, item_index, path);
+    return fdir_client_remove_dentry(&thread_ctx->client_ctx, &fullname);
+}
+
+static void *phase_thread_func(void *arg)
+{
+    BenchThreadContext *thread_ctx;
+    BenchOpType op;
+    int64_t start_time;
+    int count;
+    int result;
+    int i;
+
+    thread_ctx = (BenchThreadContext *)arg;
+    op = thread_ctx->op;
+    thread_ctx->result = 0;
+    count = (op == BENCH_OP_LIST) ? thread_ctx->dirs.count : items;
+    for (i=0; i<count; i++) {
+        start_time = get_current_time_us();
+        switch (op) {
+            case BENCH_OP_CREATE:
+                result = do_create(thread_ctx, i);
+                break;
+            case BENCH_OP_STAT:
+                result = do_stat(thread_ctx, i);
+                break;
+            case BENCH_OP_LOOKUP:
+                result = do_lookup(thread_ctx, i);
+                break;
+            case BENCH_OP_LIST:
+                result = do_list(thread_ctx, i);
+                break;
+            case BENCH_OP_SETXATTR:
+                result = do_setxattr(thread_ctx, i);
+                break;
+            case BENCH_OP_SET_DSIZE:
+                result = do_set_dsize(thread_ctx, i);
+                break;
+            case BENCH_OP_FLOCK:
+                result = do_flock(thread_ctx, i);
+                break;
+            case BENCH_OP_RENAME:
+                result = do_rename(thread_ctx, i);
+                break;
+            case BENCH_OP_REMOVE:
+                result = do_remove(thread_ctx, i);
+                break;
+            default:
+                result = EINVAL;
+                break;
+        }
+
+        latency_stat_add(thread_ctx->stat, start_time, result);
+        if (result != 0) {
+            log_op_error(thread_ctx, op, result);
+            thread_ctx->result = result;
+        }
+    }
+
+    return NULL;
+}
+
+static int run_phase(const BenchOpType op)
+{
+    BenchLatencyStat *stats;
+    pthread_t *tids;
+    int64_t start_time;
+    int result;
+    int i;
+
+    stats = fc_calloc(sizeof(BenchLatencyStat) * threads);
+    tids = fc_malloc(sizeof(pthread_t) * threads);
+    if (stats == NULL || tids == NULL) {
+        return ENOMEM;
+    }
+
+    result = 0;
+    start_time = get_current_time_us();
+    for (i=0; i<threads; i++) {
+        contexts[i].op = op;
+        contexts[i].stat = stats + i;
+        if ((result=pthread_create(tids + i, NULL,
+                        phase_thread_func, contexts + i)) != 0)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "create thread fail, errno: %d, error info: %s",
+                    __LINE__, result, STRERROR(result));
+            break;
+        }
+    }
+
+    while (--i >= 0) {
+        pthread_join(tids[i], NULL);
+        latency_stat_merge(phase_stats + op, stats + i);
+    }
+    phase_time_used[op] = get_current_time_us() - start_time;
+
+    free(tids);
+    free(stats);
+    return result;
+}
+
+static int init_thread_context(BenchThreadContext *thread_ctx,
+        const int index)
+{
+    const bool publish = false;
+    int result;
+
+    thread_ctx->index = index;
+    thread_ctx->ns = namespaces + index % ns_count;
+    if ((result=fdir_client_pooled_init_ex(&thread_ctx->client_ctx,
+                    &thread_ctx->auth_ctx, config_filename, NULL,
+                    0, 4 * 3600, false)) != 0)
+    {
+        return result;
+    }
+    if ((result=fdir_client_auth_session_create1_ex(&thread_ctx->
+                    client_ctx, thread_ctx->ns, publish)) != 0)
+    {
+        return result;
+    }
+    if ((result=fdir_client_init_session(&thread_ctx->client_ctx,
+                    &thread_ctx->session)) != 0)
+    {
+        return result;
+    }
+    if ((result=fdir_client_dentry_array_init(&thread_ctx->array)) != 0) {
+        return result;
+    }
+
+    if ((thread_ctx->inodes=fc_calloc(sizeof(int64_t) * items)) == NULL) {
+        return ENOMEM;
+    }
+    return create_thread_tree(thread_ctx);
+}
+
+static void destroy_thread_context(BenchThreadContext *thread_ctx,
+        const bool remove_tree)
+{
+    int i;
+
+    if (remove_tree) {
+        remove_thread_tree(thread_ctx);
+    }
+    for (i=0; i<thread_ctx->dirs.count; i++) {
+        free(thread_ctx->dirs.entries[i].path.str);
+    }
+    free(thread_ctx->dirs.entries);
+    free(thread_ctx->inodes);
+    fdir_client_dentry_array_free(&thread_ctx->array);
+    fdir_client_close_session(&thread_ctx->session, false);
+    fdir_client_destroy_ex(&thread_ctx->client_ctx);
+}
+
+static int parse_operations(const char *str)
+{
+    string_t src;
+    string_t parts[BENCH_OP_COUNT + 1];
+    int count;
+    int i;
+    int j;
+    int k;
+
+    FC_SET_STRING(src, (char *)str);
+    count = split_string_ex(&src, ',', parts, BENCH_OP_COUNT + 1, true);
+    if (count > BENCH_OP_COUNT) {
+        fprintf(stderr, "too many operations: %s\n", str);
+        return EINVAL;
+    }
+
+    phase_count = 0;
+    for (i=0; i<count; i++) {
+        for (k=0; k<BENCH_OP_COUNT; k++) {
+            if (parts[i].len == (int)strlen(op_names[k]) && memcmp(
+                        parts[i].str, op_names[k], parts[i].len) == 0)
+            {
+                break;
+            }
+        }
+        if (k == BENCH_OP_COUNT) {
+            fprintf(stderr, "unknown operation: %.*s\n",
+                    parts[i].len, parts[i].str);
+            return EINVAL;
+        }
+        for (j=0; j<phase_count; j++) {
+            if (phases[j] == k) {
+                fprintf(stderr, "duplicate operation: %s\n", op_names[k]);
+                return EINVAL;
+            }
+        }
+        phases[phase_count++] = k;
+    }
+
+    return 0;
+}
+
+static int parse_shape(const char *str)
+{
+    int i;
+
+    for (i=0; i<(int)(sizeof(shape_names) / sizeof(shape_names[0])); i++) {
+        if (strcmp(str, shape_names[i]) == 0) {
+            tree_shape = i;
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "unknown tree shape: %s\n", str);
+    return EINVAL;
+}
+
+static inline double calc_ops(const BenchOpType op)
+{
+    if (phase_time_used[op] <= 0) {
+        return 0.00;
+    }
+    return (double)phase_stats[op].histogram.count * 1000000.00 /
+        phase_time_used[op];
+}
+
+static inline double calc_avg(const FDIRHistogram *histogram)
+{
+    return histogram->count > 0 ? (double)histogram->sum /
+        histogram->count : 0.00;
+}
+
+static void output_text()
+{
+    BenchLatencyStat *stat;
+    FDIRHistogram *histogram;
+    BenchOpType op;
+    int i;
+
+    printf("threads: %d, namespaces: %d, items per thread: %d, "
+            "tree shape: %s\n", threads, ns_count, items,
+            shape_names[tree_shape]);
+    printf("%-10s %10s %8s %10s %12s %9s %8s %8s %8s %8s %8s %8s\n",
+            "operation", "count", "errors", "time(ms)", "ops/s",
+            "avg(us)", "min", "p50", "p90", "p99", "p999", "max");
+    for (i=0; i<phase_count; i++) {
+        op = phases[i];
+        stat = phase_stats + op;
+        histogram = &stat->histogram;
+        printf("%-10s %10"PRId64" %8"PRId64" %10"PRId64" %12.2f %9.1f "
+                "%8"PRId64" %8"PRId64" %8"PRId64" %8"PRId64" %8"PRId64
+                " %8"PRId64"\n", op_names[op], histogram->count, stat->errors,
+                phase_time_used[op] / 1000, calc_ops(op),
+                calc_avg(histogram), histogram->min,
+                fdir_histogram_percentile(histogram, 50.00),
+                fdir_histogram_percentile(histogram, 90.00),
+                fdir_histogram_percentile(histogram, 99.00),
+                fdir_histogram_percentile(histogram, 99.90),
+                histogram->max);
+    }
+}
+
+static void output_json()
+{
+    BenchLatencyStat *stat;
+    FDIRHistogram *histogram;
+    BenchOpType op;
+    int i;
+
+    printf("{\"threads\": %d, \"namespaces\": %d, \"items_per_thread\": %d, "
+            "\"tree_shape\": \"%s\", \"tree_width\": %d, \"tree_depth\": %d, "
+            "\"operations\": [", threads, ns_count, items,
+            shape_names[tree_shape], tree_width, tree_depth);
+    for (i=0; i<phase_count; i++) {
+        op = phases[i];
+        stat = phase_stats + op;
+        histogram = &stat->histogram;
+        printf("%s\n  {\"op\": \"%s\", \"count\": %"PRId64", "
+                "\"errors\": %"PRId64", \"time_used_us\": %"PRId64", "
+                "\"ops_per_second\": %.2f, \"latency_us\": {"
+                "\"avg\": %.1f, \"min\": %"PRId64", \"p50\": %"PRId64", "
+                "\"p90\": %"PRId64", \"p99\": %"PRId64", "
+                "\"p999\": %"PRId64", \"max\": %"PRId64"}}",
+                (i > 0 ? "," : ""), op_names[op], histogram->count,
+                stat->errors, phase_time_used[op], calc_ops(op),
+                calc_avg(histogram), histogram->min,
+                fdir_histogram_percentile(histogram, 50.00),
+                fdir_histogram_percentile(histogram, 90.00),
+                fdir_histogram_percentile(histogram, 99.00),
+                fdir_histogram_percentile(histogram, 99.90),
+                histogram->max);
+    }
+    printf("\n]}\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const bool publish = false;
+    char ns_buff[BENCH_MAX_NAMESPACE_COUNT][NAME_MAX];
+    bool remove_tree;
+	int ch;
+	int result;
+    int i;
+
+    if ((result=parse_operations("create,stat,lookup,list,setxattr,"
+                    "set_dsize,flock,rename,remove")) != 0)
+    {
+        return result;
+    }
+
+    while ((ch=getopt(argc, argv, "hc:n:N:b:t:i:s:w:d:m:jk")) != -1) {
+        switch (ch) {
+            case 'h':
+                usage(argv);
+                return 0;
+            case 'c':
+                config_filename = optarg;
+                break;
+            case 'n':
+                ns_prefix = optarg;
+                break;
+            case 'N':
+                ns_count = strtol(optarg, NULL, 10);
+                break;
+            case 'b':
+                base_path = optarg;
+                break;
+            case 't':
+                threads = strtol(optarg, NULL, 10);
+                break;
+            case 'i':
+                items = strtol(optarg, NULL, 10);
+                break;
+            case 's':
+                if (parse_shape(optarg) != 0) {
+                    return EINVAL;
+                }
+                break;
+            case 'w':
+                tree_width = strtol(optarg, NULL, 10);
+                break;
+            case 'd':
+                tree_depth = strtol(optarg, NULL, 10);
+                break;
+            case 'm':
+                if (parse_operations(optarg) != 0) {
+                    return EINVAL;
+                }
+                break;
+            case 'j':
+                json_output = true;
+                break;
+            case 'k':
+                keep_tree = true;
+                break;
+            default:
+                usage(argv);
+                return 1;
+        }
+    }
+
+    if (ns_count <= 0 || ns_count > BENCH_MAX_NAMESPACE_COUNT ||
+            threads <= 0 || items <= 0 || *base_path != '/' ||
+            tree_width <= 0 || tree_width > BENCH_MAX_TREE_WIDTH ||
+            tree_depth <= 0 || tree_depth > BENCH_MAX_TREE_DEPTH)
+    {
+        usage(argv);
+        return EINVAL;
+    }
+
+    log_init();
+    //g_log_context.log_level = LOG_DEBUG;
+
+    for (i=0; i<ns_count; i++) {
+        if (ns_count == 1) {
+            snprintf(ns_buff[i], sizeof(ns_buff[i]), "%s", ns_prefix);
+        } else {
+            snprintf(ns_buff[i], sizeof(ns_buff[i]), "%s%d", ns_prefix, i);
+        }
+        FC_SET_STRING(namespaces[i], ns_buff[i]);
+    }
+
+    if ((result=fdir_client_simple_init_with_auth_ex(
+                    config_filename, namespaces + 0, publish)) != 0)
+    {
+        return result;
+    }
+    for (i=0; i<ns_count; i++) {
+        if ((result=create_base_path(&g_fdir_client_vars.
+                        client_ctx, namespaces + i)) != 0)
+        {
+            return result;
+        }
+    }
+
+    contexts = fc_calloc(sizeof(BenchThreadContext) * threads);
+    if (contexts == NULL) {
+        return ENOMEM;
+    }
+    for (i=0; i<threads; i++) {
+        if ((result=init_thread_context(contexts + i, i)) != 0) {
+            return result;
+        }
+    }
+
+    remove_tree = !keep_tree;
+    for (i=0; i<phase_count; i++) {
+        if ((result=run_phase(phases[i])) != 0) {
+            remove_tree = false;
+            break;
+        }
+        if (phase_stats[phases[i]].errors > 0) {
+            result = EIO;
+        }
+        if (phases[i] == BENCH_OP_CREATE) {
+            remove_tree = false;
+        } else if (phases[i] == BENCH_OP_REMOVE) {
+            remove_tree = !keep_tree;
+        } else if (phases[i] == BENCH_OP_RENAME) {
+            name_prefix = (name_prefix == 'f') ? 'r' : 'f';
+        }
+    }
+
+    if (json_output) {
+        output_json();
+    } else {
+        output_text();
+    }
+
+    for (i=0; i<threads; i++) {
+        destroy_thread_context(contexts + i, remove_tree);
+    }
+    if (remove_tree && tree_shape == BENCH_SHAPE_HOT) {
+        remove_hot_dirs();
+    }
+    free(contexts);
+    return result;
+}
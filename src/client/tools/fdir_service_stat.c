@@ -27,9 +27,42 @@
 static void usage(char *argv[])
 {
     fprintf(stderr, "Usage: %s [-c config_filename=%s] "
+            "[-l for the latency stat of the requests] "
             "host[:port]\n", argv[0], FDIR_CLIENT_DEFAULT_CONFIG_FILENAME);
 }
 
+static void output_latency(FDIRClientLatencyStatEntry *stats,
+        const int count)
+{
+    FDIRClientLatencyStatEntry *stat;
+    FDIRClientLatencyStatEntry *end;
+    FDIRClientLatencyStage *stage;
+    int i;
+
+    printf("latency in microseconds, recv: network receive, "
+            "queue: wait in the data thread queue,\n"
+            "exec: deal by the data thread, binlog: produce the binlog, "
+            "replica: wait for the slaves\n\n");
+    end = stats + count;
+    for (stat=stats; stat<end; stat++) {
+        printf("%s (%d)\n", fdir_get_cmd_caption(stat->cmd), stat->cmd);
+        printf("\t%-8s %12s %8s %8s %8s %8s %8s %8s\n", "stage",
+                "count", "avg", "p50", "p90", "p99", "p999", "max");
+        for (i=0; i<FDIR_LATENCY_STAGE_COUNT; i++) {
+            stage = stat->stages + i;
+            if (stage->count == 0) {
+                continue;
+            }
+            printf("\t%-8s %12"PRId64" %8"PRId64" %8"PRId64" %8"PRId64
+                    " %8"PRId64" %8"PRId64" %8"PRId64"\n",
+                    fdir_get_latency_stage_caption(i), stage->count,
+                    stage->avg, stage->p50, stage->p90, stage->p99,
+                    stage->p999, stage->max);
+        }
+        printf("\n");
+    }
+}
+
 static void output(FDIRClientServiceStat *stat)
 {
     printf( "\tserver_id: %d\n"
@@ -58,11 +91,67 @@ static void output(FDIRClientServiceStat *stat)
             "\tdentry : {current_inode_sn: %"PRId64", "
             "ns_count: %"PRId64", "
             "dir_count: %"PRId64", "
-            "file_count: %"PRId64"}\n\n",
+            "file_count: %"PRId64"}\n",
             stat->dentry.current_inode_sn,
             stat->dentry.counters.ns,
             stat->dentry.counters.dir,
             stat->dentry.counters.file);
+
+    if (!stat->detail) {
+        printf("\n");
+        return;
+    }
+
+    printf( "\tdentry_lru : {evict_count: %"PRId64", "
+            "reload_count: %"PRId64"}\n",
+            stat->dentry.lru.evict_count,
+            stat->dentry.lru.reload_count);
+    printf( "\tdentry_memory : {dentry_size: %d, "
+            "count: %"PRId64", extra_count: %"PRId64", "
+            "name_bytes: %"PRId64", total_bytes: %"PRId64", "
+            "bytes_per_dentry: %"PRId64"}\n",
+            stat->dentry.memory.dentry_size,
+            stat->dentry.memory.count,
+            stat->dentry.memory.extra_count,
+            stat->dentry.memory.name_bytes,
+            stat->dentry.memory.total_bytes,
+            stat->dentry.memory.total_bytes /
+            (stat->dentry.memory.count > 0 ?
+             stat->dentry.memory.count : 1));
+
+    printf( "\tinode_hashtable : {capacity: %"PRId64", "
+            "count: %"PRId64", load_factor: %.2f, "
+            "rehash_capacity: %"PRId64", resize_count: %d, "
+            "max_chain_length: %d, chain_histogram: {"
+            "0: %"PRId64", 1: %"PRId64", 2: %"PRId64", 3: %"PRId64", "
+            "4~7: %"PRId64", 8~15: %"PRId64", 16+: %"PRId64"}}\n",
+            stat->inode_hashtable.capacity,
+            stat->inode_hashtable.count,
+            stat->inode_hashtable.capacity > 0 ?
+            (double)stat->inode_hashtable.count /
+            (double)stat->inode_hashtable.capacity : 0.00,
+            stat->inode_hashtable.rehash_capacity,
+            stat->inode_hashtable.resize_count,
+            stat->inode_hashtable.max_chain_length,
+            stat->inode_hashtable.chain_histogram[0],
+            stat->inode_hashtable.chain_histogram[1],
+            stat->inode_hashtable.chain_histogram[2],
+            stat->inode_hashtable.chain_histogram[3],
+            stat->inode_hashtable.chain_histogram[4],
+            stat->inode_hashtable.chain_histogram[5],
+            stat->inode_hashtable.chain_histogram[6]);
+    printf( "\tdata_load : {record_count: %"PRId64", "
+            "skip_count: %"PRId64", parallel: %s, "
+            "barrier_count: %"PRId64", time_used: %"PRId64" ms, "
+            "speed: %"PRId64" records/s}\n\n",
+            stat->data_load.record_count,
+            stat->data_load.skip_count,
+            stat->data_load.parallel ? "true" : "false",
+            stat->data_load.barrier_count,
+            stat->data_load.time_used_ms,
+            stat->data_load.record_count * 1000 /
+            (stat->data_load.time_used_ms > 0 ?
+             stat->data_load.time_used_ms : 1));
 }
 
 int main(int argc, char *argv[])
@@ -71,8 +160,12 @@ int main(int argc, char *argv[])
     const char *config_filename = FDIR_CLIENT_DEFAULT_CONFIG_FILENAME;
 	int ch;
     char *host;
+    bool latency_stat;
     ConnectionInfo conn;
     FDIRClientServiceStat stat;
+    FDIRClientLatencyStatEntry latency_stats[
+        FDIR_LATENCY_STAT_MAX_CMD_COUNT];
+    int count;
 	int result;
 
     if (argc < 2) {
@@ -80,7 +173,8 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    while ((ch=getopt(argc, argv, "hc:")) != -1) {
+    latency_stat = false;
+    while ((ch=getopt(argc, argv, "hc:l")) != -1) {
         switch (ch) {
             case 'h':
                 usage(argv);
@@ -88,6 +182,9 @@ int main(int argc, char *argv[])
             case 'c':
                 config_filename = optarg;
                 break;
+            case 'l':
+                latency_stat = true;
+                break;
             default:
                 usage(argv);
                 return 1;
@@ -116,6 +213,18 @@ int main(int argc, char *argv[])
         return result;
     }
 
+    if (latency_stat) {
+        if ((result=fdir_client_latency_stat(&g_fdir_client_vars.
+                        client_ctx, &conn, latency_stats,
+                        FDIR_LATENCY_STAT_MAX_CMD_COUNT, &count)) != 0)
+        {
+            return result;
+        }
+
+        output_latency(latency_stats, count);
+        return 0;
+    }
+
     if ((result=fdir_client_service_stat(&g_fdir_client_vars.
                     client_ctx, &conn, &stat)) != 0)
     {
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fastcommon/shared_func.h"
+#include "fdir_histogram.h"
+
+void fdir_histogram_merge(FDIRHistogram *dest, const FDIRHistogram *src)
+{
+    int i;
+
+    if (src->count > 0) {
+        if (dest->count == 0 || src->min < dest->min) {
+            dest->min = src->min;
+        }
+        if (src->max > dest->max) {
+            dest->max = src->max;
+        }
+    }
+    dest->count += src->count;
+    dest->sum += src->sum;
+    for (i=0; i<FDIR_HISTOGRAM_BUCKET_COUNT; i++) {
+        dest->buckets[i] += src->buckets[i];
+    }
+}
+
+int64_t fdir_histogram_percentile(const FDIRHistogram *histogram,
+        const double percentile)
+{
+    int64_t target;
+    int64_t total;
+    int i;
+
+    if (histogram->count == 0) {
+        return 0;
+    }
+
+    target = (int64_t)(histogram->count * percentile / 100.00 + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+
+    total = 0;
+    for (i=0; i<FDIR_HISTOGRAM_BUCKET_COUNT; i++) {
+        total += histogram->buckets[i];
+        if (total >= target) {
+            return FC_MIN(FC_MAX(fdir_histogram_bucket_value(i),
+                        histogram->min), histogram->max);
+        }
+    }
+
+    return histogram->max;
+}
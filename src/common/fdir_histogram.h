@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//fdir_histogram.h
+
+#ifndef _FDIR_HISTOGRAM_H
+#define _FDIR_HISTOGRAM_H
+
+#include "fastcommon/common_define.h"
+
+/* the log-linear latency histogram in microseconds: linear below 16us,
+ * then 8 sub buckets for each power of two,
+ * the relative error is less than 1/8 */
+#define FDIR_HISTOGRAM_LINEAR_COUNT     16
+#define FDIR_HISTOGRAM_SUB_BITS          3
+#define FDIR_HISTOGRAM_SUB_COUNT       (1 << FDIR_HISTOGRAM_SUB_BITS)
+#define FDIR_HISTOGRAM_MAX_MSB          36
+#define FDIR_HISTOGRAM_BUCKET_COUNT    (FDIR_HISTOGRAM_LINEAR_COUNT + \
+        (FDIR_HISTOGRAM_MAX_MSB - FDIR_HISTOGRAM_SUB_BITS) * \
+        FDIR_HISTOGRAM_SUB_COUNT)
+
+typedef struct fdir_histogram {
+    int64_t count;
+    int64_t sum;
+    int64_t min;
+    int64_t max;
+    int64_t buckets[FDIR_HISTOGRAM_BUCKET_COUNT];
+} FDIRHistogram;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline int fdir_histogram_bucket_index(const int64_t value)
+{
+    int shift;
+    int index;
+
+    if (value < FDIR_HISTOGRAM_LINEAR_COUNT) {
+        return value < 0 ? 0 : value;
+    }
+
+    shift = 63 - __builtin_clzll(value) - FDIR_HISTOGRAM_SUB_BITS;
+    index = FDIR_HISTOGRAM_LINEAR_COUNT + (shift - 1) *
+        FDIR_HISTOGRAM_SUB_COUNT + ((value >> shift) &
+                (FDIR_HISTOGRAM_SUB_COUNT - 1));
+    return index < FDIR_HISTOGRAM_BUCKET_COUNT ? index :
+        FDIR_HISTOGRAM_BUCKET_COUNT - 1;
+}
+
+//the lower bound of the bucket
+static inline int64_t fdir_histogram_bucket_value(const int index)
+{
+    int msb;
+    int sub;
+
+    if (index < FDIR_HISTOGRAM_LINEAR_COUNT) {
+        return index;
+    }
+
+    msb = (index - FDIR_HISTOGRAM_LINEAR_COUNT) / FDIR_HISTOGRAM_SUB_COUNT +
+        FDIR_HISTOGRAM_SUB_BITS + 1;
+    sub = (index - FDIR_HISTOGRAM_LINEAR_COUNT) % FDIR_HISTOGRAM_SUB_COUNT;
+    return (int64_t)(FDIR_HISTOGRAM_SUB_COUNT | sub) <<
+        (msb - FDIR_HISTOGRAM_SUB_BITS);
+}
+
+static inline void fdir_histogram_add(FDIRHistogram *histogram,
+        const int64_t value)
+{
+    if (histogram->count == 0 || value < histogram->min) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+    histogram->count++;
+    histogram->sum += value;
+    histogram->buckets[fdir_histogram_bucket_index(value)]++;
+}
+
+void fdir_histogram_merge(FDIRHistogram *dest, const FDIRHistogram *src);
+
+/* the lower bound of the bucket which the percentile falls in,
+ * limited to [min, max], return 0 when empty */
+int64_t fdir_histogram_percentile(const FDIRHistogram *histogram,
+        const double percentile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
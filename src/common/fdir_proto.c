@@ -217,6 +217,10 @@ const char *fdir_get_cmd_caption(const int cmd)
             return "LIST_XATTR_BY_INODE_REQ";
         case FDIR_SERVICE_PROTO_LIST_XATTR_BY_INODE_RESP:
             return "LIST_XATTR_BY_INODE_RESP";
+        case FDIR_SERVICE_PROTO_BATCH_REQ:
+            return "BATCH_REQ";
+        case FDIR_SERVICE_PROTO_BATCH_RESP:
+            return "BATCH_RESP";
 
         case FDIR_SERVICE_PROTO_NSS_SUBSCRIBE_REQ:
             return "NSS_SUBSCRIBE_REQ";
@@ -226,6 +230,26 @@ const char *fdir_get_cmd_caption(const int cmd)
             return "NSS_FETCH_REQ";
         case FDIR_SERVICE_PROTO_NSS_FETCH_RESP:
             return "NSS_FETCH_RESP";
+        case FDIR_SERVICE_PROTO_INVALIDATE_SUBSCRIBE_REQ:
+            return "INVALIDATE_SUBSCRIBE_REQ";
+        case FDIR_SERVICE_PROTO_INVALIDATE_SUBSCRIBE_RESP:
+            return "INVALIDATE_SUBSCRIBE_RESP";
+        case FDIR_SERVICE_PROTO_INVALIDATE_FETCH_REQ:
+            return "INVALIDATE_FETCH_REQ";
+        case FDIR_SERVICE_PROTO_INVALIDATE_FETCH_RESP:
+            return "INVALIDATE_FETCH_RESP";
+        case FDIR_SERVICE_PROTO_WAIT_DATA_VERSION_REQ:
+            return "WAIT_DATA_VERSION_REQ";
+        case FDIR_SERVICE_PROTO_WAIT_DATA_VERSION_RESP:
+            return "WAIT_DATA_VERSION_RESP";
+        case FDIR_SERVICE_PROTO_LATENCY_STAT_REQ:
+            return "LATENCY_STAT_REQ";
+        case FDIR_SERVICE_PROTO_LATENCY_STAT_RESP:
+            return "LATENCY_STAT_RESP";
+        case FDIR_SERVICE_PROTO_SERVICE_DETAIL_STAT_REQ:
+            return "SERVICE_DETAIL_STAT_REQ";
+        case FDIR_SERVICE_PROTO_SERVICE_DETAIL_STAT_RESP:
+            return "SERVICE_DETAIL_STAT_RESP";
 
         case FDIR_CLUSTER_PROTO_GET_SERVER_STATUS_REQ:
             return "GET_SERVER_STATUS_REQ";
@@ -256,3 +280,23 @@ const char *fdir_get_cmd_caption(const int cmd)
             return sf_get_cmd_caption(cmd);
     }
 }
+
+const char *fdir_get_latency_stage_caption(const int stage)
+{
+    switch (stage) {
+        case FDIR_LATENCY_STAGE_RECV:
+            return "recv";
+        case FDIR_LATENCY_STAGE_QUEUE:
+            return "queue";
+        case FDIR_LATENCY_STAGE_EXEC:
+            return "exec";
+        case FDIR_LATENCY_STAGE_BINLOG:
+            return "binlog";
+        case FDIR_LATENCY_STAGE_REPLICA:
+            return "replica";
+        case FDIR_LATENCY_STAGE_TOTAL:
+            return "total";
+        default:
+            return "unknown";
+    }
+}
@@ -120,12 +120,45 @@
 #define FDIR_SERVICE_PROTO_LIST_XATTR_BY_INODE_REQ  91
 #define FDIR_SERVICE_PROTO_LIST_XATTR_BY_INODE_RESP 92
 
+//multi update operations of the same namespace in one request
+#define FDIR_SERVICE_PROTO_BATCH_REQ                93
+#define FDIR_SERVICE_PROTO_BATCH_RESP               94
+
 //for namespace stat sync
 #define FDIR_SERVICE_PROTO_NSS_SUBSCRIBE_REQ        101
 #define FDIR_SERVICE_PROTO_NSS_SUBSCRIBE_RESP       102
 #define FDIR_SERVICE_PROTO_NSS_FETCH_REQ            103
 #define FDIR_SERVICE_PROTO_NSS_FETCH_RESP           104
 
+//for client metadata cache invalidation
+#define FDIR_SERVICE_PROTO_INVALIDATE_SUBSCRIBE_REQ  105
+#define FDIR_SERVICE_PROTO_INVALIDATE_SUBSCRIBE_RESP 106
+#define FDIR_SERVICE_PROTO_INVALIDATE_FETCH_REQ      107
+#define FDIR_SERVICE_PROTO_INVALIDATE_FETCH_RESP     108
+
+//for read-your-writes from the slaves
+#define FDIR_SERVICE_PROTO_WAIT_DATA_VERSION_REQ     109
+#define FDIR_SERVICE_PROTO_WAIT_DATA_VERSION_RESP    110
+
+//the latency histograms of the requests by command
+#define FDIR_SERVICE_PROTO_LATENCY_STAT_REQ          111
+#define FDIR_SERVICE_PROTO_LATENCY_STAT_RESP         112
+
+//the detail stat of the server besides SERVICE_STAT
+#define FDIR_SERVICE_PROTO_SERVICE_DETAIL_STAT_REQ   113
+#define FDIR_SERVICE_PROTO_SERVICE_DETAIL_STAT_RESP  114
+
+//the flags of the invalidate event
+#define FDIR_INVALIDATE_FLAGS_INODE   1  //drop the attributes of the inode
+#define FDIR_INVALIDATE_FLAGS_PNAME   2  //drop the (parent inode, name) entry
+
+//the sub operations of the batch request
+#define FDIR_BATCH_OP_CREATE_DENTRY   1
+#define FDIR_BATCH_OP_SYMLINK_DENTRY  2
+#define FDIR_BATCH_OP_REMOVE_DENTRY   3
+#define FDIR_BATCH_OP_SET_XATTR       4
+#define FDIR_BATCH_OP_REMOVE_XATTR    5
+
 //cluster commands
 #define FDIR_CLUSTER_PROTO_GET_SERVER_STATUS_REQ    201
 #define FDIR_CLUSTER_PROTO_GET_SERVER_STATUS_RESP   202
@@ -282,6 +315,36 @@ typedef struct fdir_proto_batch_set_dentry_size_req_body {
     char flags[4];
 } FDIRProtoBatchSetDentrySizeReqBody;
 
+typedef struct fdir_proto_batch_req_header {
+    char count[4];        //operation count
+    unsigned char ns_len; //namespace length
+    char padding[3];
+    char ns_str[0];       //the namespace of all operations
+} FDIRProtoBatchReqHeader;
+
+typedef struct fdir_proto_batch_op_header {
+    unsigned char op;        //FDIR_BATCH_OP_xxx
+    unsigned char name_len;  //xattr name length
+    char path_len[2];
+    char value_len[2];       //xattr value or symlink length
+    char flags[2];           //xattr set flags
+    FDIRProtoCreateDEntryFront front;  //for create and symlink
+    char path_str[0];
+    //char name_str[0];  //name_str = path_str + path_len
+    //char value_str[0]; //value_str = name_str + name_len
+} FDIRProtoBatchOpHeader;
+
+typedef struct fdir_proto_batch_resp_header {
+    char count[4];
+    char success[4];
+} FDIRProtoBatchRespHeader;
+
+typedef struct fdir_proto_batch_resp_body_part {
+    char inode[8];
+    char status[2];    //the errno of this operation
+    char padding[6];
+} FDIRProtoBatchRespBodyPart;
+
 typedef struct fdir_proto_dentry_stat {
     char mode[4];
     char uid[4];
@@ -313,6 +376,27 @@ typedef struct fdir_proto_stat_dentry_resp {
     FDIRProtoDEntryStat stat;
 } FDIRProtoStatDEntryResp;
 
+/* appended to the response of the update which changed the data when
+ * the client joined with FDIR_CLIENT_JOIN_FLAGS_DATA_VERSION */
+typedef struct fdir_proto_update_resp_trailer {
+    char data_version[8];  //the committed data version of the update
+} FDIRProtoUpdateRespTrailer;
+
+typedef struct fdir_proto_update_dentry_resp {
+    FDIRProtoStatDEntryResp stat;
+    FDIRProtoUpdateRespTrailer trailer;  //optional
+} FDIRProtoUpdateDEntryResp;
+
+typedef struct fdir_proto_wait_data_version_req {
+    char data_version[8];  //the min data version to read
+    char timeout_ms[4];
+    char padding[4];
+} FDIRProtoWaitDataVersionReq;
+
+typedef struct fdir_proto_wait_data_version_resp {
+    char data_version[8];  //the applied data version of the server
+} FDIRProtoWaitDataVersionResp;
+
 typedef struct fdir_proto_flock_dentry_req {
     char offset[8];  /* lock region offset */
     char length[8];  /* lock region  length, 0 for until end of file */
@@ -460,6 +544,42 @@ typedef struct fdir_proto_service_stat_resp {
     } dentry;
 } FDIRProtoServiceStatResp;
 
+/* the fields are only appended, the client skips the unknown tail
+ * of the newer servers and zeros the absent fields of the older ones */
+typedef struct fdir_proto_service_detail_stat_resp {
+    struct {
+        char evict_count[8];
+        char reload_count[8];
+    } dentry_lru;  //for storage engine
+
+    struct {
+        char capacity[8];
+        char count[8];
+        char rehash_capacity[8];
+        char resize_count[4];
+        char max_chain_length[4];
+        char chain_histogram[FDIR_INODE_HT_CHAIN_HISTOGRAM_SIZE][8];
+    } inode_hashtable;
+
+    struct {
+        char record_count[8];
+        char skip_count[8];
+        char barrier_count[8];
+        char time_used_ms[8];
+        char parallel;
+        char padding[7];
+    } data_load;  //the stat of the startup data loading
+
+    struct {
+        char dentry_size[4];
+        char padding[4];
+        char count[8];
+        char extra_count[8];
+        char name_bytes[8];
+        char total_bytes[8];
+    } dentry_memory;
+} FDIRProtoServiceDetailStatResp;
+
 typedef struct fdir_proto_cluster_stat_resp_body_header {
     char count[4];
 } FDIRProtoClusterStatRespBodyHeader;
@@ -472,6 +592,27 @@ typedef struct fdir_proto_cluster_stat_resp_body_part {
     char port[2];
 } FDIRProtoClusterStatRespBodyPart;
 
+typedef struct fdir_proto_latency_stat_resp_body_header {
+    char count[4];   //the command count
+    char padding[4];
+} FDIRProtoLatencyStatRespBodyHeader;
+
+typedef struct fdir_proto_latency_stat_stage {
+    char count[8];
+    char avg[8];     //in microseconds, the same below
+    char p50[8];
+    char p90[8];
+    char p99[8];
+    char p999[8];
+    char max[8];
+} FDIRProtoLatencyStatStage;
+
+typedef struct fdir_proto_latency_stat_resp_body_part {
+    unsigned char cmd;
+    char padding[7];
+    FDIRProtoLatencyStatStage stages[FDIR_LATENCY_STAGE_COUNT];
+} FDIRProtoLatencyStatRespBodyPart;
+
 typedef struct fdir_proto_namespace_stat_req {
     unsigned char ns_len; //namespace length
     char ns_str[0];       //namespace string
@@ -533,6 +674,12 @@ typedef struct fdir_proto_join_slave_req {
     char key[FDIR_REPLICA_KEY_SIZE];  //the slave key passed / set by JOIN_MASTER
 } FDIRProtoJoinSlaveReq;
 
+//optional, appended to FDIRProtoJoinSlaveReq, the old slave rejects it
+typedef struct fdir_proto_join_slave_req_extra {
+    char flags[4];   //FDIR_REPLICA_JOIN_FLAGS_xxx
+    char padding[4];
+} FDIRProtoJoinSlaveReqExtra;
+
 typedef struct fdir_proto_join_slave_resp {
     //last N rows for consistency check
     char binlog_count[4];
@@ -574,6 +721,12 @@ typedef struct fdir_proto_push_binlog_resp_body_header {
     char count[4];
 } FDIRProtoPushBinlogRespBodyHeader;
 
+//the body header when FDIR_REPLICA_JOIN_FLAGS_CREDITS negotiated
+typedef struct fdir_proto_push_binlog_resp_credit_header {
+    FDIRProtoPushBinlogRespBodyHeader common;
+    char credits[4];  //the push packets granted by the slave
+} FDIRProtoPushBinlogRespCreditHeader;
+
 typedef struct fdir_proto_push_binlog_resp_body_part {
     char data_version[8];
     char err_no[2];
@@ -590,6 +743,27 @@ typedef struct fdir_proto_nss_fetch_resp_body_part {
     FDIRProtoNameInfo ns_name;
 } FDIRProtoNSSFetchRespBodyPart;
 
+/* appended after all body parts in the same order when the client
+ * joined with FDIR_CLIENT_JOIN_FLAGS_NSS_INODES */
+typedef struct fdir_proto_nss_fetch_resp_inodes_part {
+    char used_inodes[8];
+} FDIRProtoNSSFetchRespInodesPart;
+
+typedef struct fdir_proto_invalidate_fetch_resp_body_header {
+    char count[4];
+    char is_last;
+    char overflow;  //events lost, the client should drop all
+    char padding[2];
+} FDIRProtoInvalidateFetchRespBodyHeader;
+
+typedef struct fdir_proto_invalidate_event {
+    char inode[8];
+    char parent_inode[8];
+    char name_hash_code[4];  //simple_hash of the name
+    char flags;
+    char padding[3];
+} FDIRProtoInvalidateEvent;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -639,6 +813,8 @@ const char *fdir_get_server_status_caption(const int status);
 
 const char *fdir_get_cmd_caption(const int cmd);
 
+const char *fdir_get_latency_stage_caption(const int stage);
+
 #ifdef __cplusplus
 }
 #endif
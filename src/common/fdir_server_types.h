@@ -42,6 +42,10 @@ typedef struct fdir_db_update_field_info {
     int merge_count;
     int field_index;
     FastBuffer *buffer;
+    struct {
+        int64_t parent_inode;
+        string_t name;  //point to the buffer
+    } pname;  //for the name index of the storage engine, basic field only
     void *args;   //dentry
     struct fdir_db_update_field_info *next;  //for queue
 } FDIRDBUpdateFieldInfo;
@@ -23,13 +23,32 @@
 #define FDIR_REPLICA_KEY_SIZE    8
 
 #define FDIR_DEFAULT_BINLOG_BUFFER_SIZE (256 * 1024)
+#define FDIR_DEFAULT_BINLOG_GROUP_COMMIT_BYTES  (16 * 1024)
+#define FDIR_MAX_BINLOG_GROUP_COMMIT_BYTES      (64 * 1024)
 
 #define FDIR_SERVER_DEFAULT_CLUSTER_PORT  11011
 #define FDIR_SERVER_DEFAULT_SERVICE_PORT  11012
 
 #define FDIR_MAX_PATH_COUNT             128
+
+//chain length: 0, 1, 2, 3, 4~7, 8~15, >= 16
+#define FDIR_INODE_HT_CHAIN_HISTOGRAM_SIZE  7
 #define FDIR_BATCH_SET_MAX_DENTRY_COUNT 256
 
+//the stages of the request latency stat
+#define FDIR_LATENCY_STAGE_RECV     0  //network receive of the request body
+#define FDIR_LATENCY_STAGE_QUEUE    1  //wait in the data thread queue
+#define FDIR_LATENCY_STAGE_EXEC     2  //deal by the data thread
+#define FDIR_LATENCY_STAGE_BINLOG   3  //produce and dispatch the binlog
+#define FDIR_LATENCY_STAGE_REPLICA  4  //wait for the acks of the slaves
+#define FDIR_LATENCY_STAGE_TOTAL    5  //from receive to response
+#define FDIR_LATENCY_STAGE_COUNT    6
+#define FDIR_LATENCY_STAT_MAX_CMD_COUNT  256  //the command is one byte
+
+//for batch update request
+#define FDIR_BATCH_UPDATE_MAX_OP_COUNT  128
+#define FDIR_BATCH_UPDATE_MAX_BODY_SIZE (16 * 1024)
+
 #define FDIR_XATTR_KVARRAY_ALLOCATOR_COUNT  6
 #define FDIR_XATTR_KVARRAY_MAX_ELEMENTS (1 << FDIR_XATTR_KVARRAY_ALLOCATOR_COUNT)
 #define FDIR_XATTR_MAX_VALUE_SIZE       256
@@ -41,6 +60,10 @@
 #define FDIR_SERVER_STATUS_ACTIVE    23
 
 #define FDIR_CLIENT_JOIN_FLAGS_IDEMPOTENCY_REQUEST  1
+#define FDIR_CLIENT_JOIN_FLAGS_DATA_VERSION         2  //for read your writes
+#define FDIR_CLIENT_JOIN_FLAGS_NSS_INODES           4  //used inodes of NSS_FETCH
+
+#define FDIR_REPLICA_JOIN_FLAGS_CREDITS  1  //credit based flow control
 
 #define FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE   1  //file size
 #define FDIR_DENTRY_FIELD_MODIFIED_FLAG_INC_ALLOC   2  //increase alloc space
@@ -0,0 +1,1041 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/fast_buffer.h"
+#include "fastcommon/fc_atomic.h"
+#include "sf/sf_global.h"
+#include "../server_global.h"
+#include "binlog_pack.h"
+#include "binlog_reader.h"
+#include "binlog_write.h"
+#include "binlog_index.h"
+#include "binlog_compact.h"
+
+#define COMPACT_INPUT_BUFFER_SIZE   (1024 * 1024)
+#define COMPACT_OUTPUT_FLUSH_SIZE   (256 * 1024)
+#define COMPACT_HTABLE_INIT_CAPACITY  (64 * 1024)
+
+#define BINLOG_COMPACT_MARK_FILENAME  ".compact.mark"
+
+#define COMPACT_INODE_CREATED  1
+#define COMPACT_INODE_REMOVED  2
+#define COMPACT_INODE_KEEP     4   //some kept record refers to it
+
+#define COMPACT_INODE_DROPPABLE(flags) \
+    (((flags) & (COMPACT_INODE_CREATED | COMPACT_INODE_REMOVED | \
+                 COMPACT_INODE_KEEP)) == \
+     (COMPACT_INODE_CREATED | COMPACT_INODE_REMOVED))
+
+typedef struct binlog_compact_hash_entry {
+    int64_t key;    //0 for empty
+    int64_t value;
+} BinlogCompactHashEntry;
+
+typedef struct binlog_compact_htable {
+    BinlogCompactHashEntry *entries;
+    int64_t capacity;  //power of 2
+    int64_t count;
+} BinlogCompactHTable;
+
+typedef struct binlog_compact_file_info {
+    int64_t first_version;
+    int64_t last_version;
+} BinlogCompactFileInfo;
+
+//the merged fields of the updates before the last one
+typedef struct binlog_compact_pending {
+    FDIRStatModifyFlags options;
+    FDIRDEntryStat stat;
+} BinlogCompactPending;
+
+struct binlog_compact_context;
+typedef int (*binlog_compact_record_func)(struct binlog_compact_context *ctx,
+        FDIRBinlogRecord *record, const char *rec_start,
+        const int rec_len, const bool boundary);
+
+typedef struct binlog_compact_context {
+    int start_index;
+    int last_index;
+    BinlogCompactFileInfo *files;  //indexed by index - start_index
+    BinlogCompactHTable inodes;    //inode => flags
+    BinlogCompactHTable exchanges; //the dest locations of exchange renames
+    BinlogCompactHTable runs;      //inode => the last update of the run
+    BinlogCompactHTable terminals; //the versions of the last updates
+    BinlogCompactHTable pendings;  //inode => BinlogCompactPending *
+    bool evicted;     //some inode changed to keep in this pass
+    int out_fd;
+    char *in_buff;
+    FastBuffer out_buffer;
+    BinlogCompactStat *stat;
+} BinlogCompactContext;
+
+static inline uint64_t htable_hash(const int64_t key)
+{
+    uint64_t h;
+
+    h = (uint64_t)key * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 32);
+}
+
+//the key of the dentry location: parent inode + name
+static int64_t location_key(const int64_t parent_inode, const string_t *name)
+{
+    uint64_t h;
+    const unsigned char *p;
+    const unsigned char *end;
+
+    h = htable_hash(parent_inode);
+    end = (const unsigned char *)name->str + name->len;
+    for (p=(const unsigned char *)name->str; p<end; p++) {
+        h = (h ^ *p) * 0x100000001B3ULL;
+    }
+    return (h != 0 ? (int64_t)h : 1);
+}
+
+static int htable_init(BinlogCompactHTable *ht, const int64_t capacity)
+{
+    ht->entries = (BinlogCompactHashEntry *)fc_calloc(
+            sizeof(BinlogCompactHashEntry) * capacity);
+    if (ht->entries == NULL) {
+        return ENOMEM;
+    }
+    ht->capacity = capacity;
+    ht->count = 0;
+    return 0;
+}
+
+static inline void htable_clear(BinlogCompactHTable *ht)
+{
+    memset(ht->entries, 0, sizeof(BinlogCompactHashEntry) * ht->capacity);
+    ht->count = 0;
+}
+
+static inline void htable_destroy(BinlogCompactHTable *ht)
+{
+    if (ht->entries != NULL) {
+        free(ht->entries);
+        ht->entries = NULL;
+    }
+}
+
+static inline BinlogCompactHashEntry *htable_locate(
+        BinlogCompactHashEntry *entries, const int64_t capacity,
+        const int64_t key)
+{
+    BinlogCompactHashEntry *entry;
+    int64_t index;
+
+    index = htable_hash(key) & (capacity - 1);
+    while (1) {
+        entry = entries + index;
+        if (entry->key == key || entry->key == 0) {
+            return entry;
+        }
+        index = (index + 1) & (capacity - 1);
+    }
+}
+
+static int htable_expand(BinlogCompactHTable *ht)
+{
+    BinlogCompactHashEntry *entries;
+    BinlogCompactHashEntry *entry;
+    BinlogCompactHashEntry *end;
+    int64_t capacity;
+
+    capacity = ht->capacity * 2;
+    entries = (BinlogCompactHashEntry *)fc_calloc(
+            sizeof(BinlogCompactHashEntry) * capacity);
+    if (entries == NULL) {
+        return ENOMEM;
+    }
+
+    end = ht->entries + ht->capacity;
+    for (entry=ht->entries; entry<end; entry++) {
+        if (entry->key != 0) {
+            *htable_locate(entries, capacity, entry->key) = *entry;
+        }
+    }
+
+    free(ht->entries);
+    ht->entries = entries;
+    ht->capacity = capacity;
+    return 0;
+}
+
+static inline BinlogCompactHashEntry *htable_find(
+        BinlogCompactHTable *ht, const int64_t key)
+{
+    BinlogCompactHashEntry *entry;
+
+    entry = htable_locate(ht->entries, ht->capacity, key);
+    return (entry->key != 0 ? entry : NULL);
+}
+
+//return the existing or new entry, NULL for out of memory
+static BinlogCompactHashEntry *htable_insert(
+        BinlogCompactHTable *ht, const int64_t key)
+{
+    BinlogCompactHashEntry *entry;
+
+    entry = htable_locate(ht->entries, ht->capacity, key);
+    if (entry->key != 0) {
+        return entry;
+    }
+
+    if (2 * (ht->count + 1) > ht->capacity) {
+        if (htable_expand(ht) != 0) {
+            return NULL;
+        }
+        entry = htable_locate(ht->entries, ht->capacity, key);
+    }
+
+    entry->key = key;
+    entry->value = 0;
+    ht->count++;
+    return entry;
+}
+
+static inline int set_inode_flags(BinlogCompactContext *ctx,
+        const int64_t inode, const int flags)
+{
+    BinlogCompactHashEntry *entry;
+
+    if ((entry=htable_insert(&ctx->inodes, inode)) == NULL) {
+        return ENOMEM;
+    }
+    entry->value |= flags;
+    return 0;
+}
+
+static inline bool inode_droppable(BinlogCompactContext *ctx,
+        const int64_t inode)
+{
+    BinlogCompactHashEntry *entry;
+
+    if ((entry=htable_find(&ctx->inodes, inode)) == NULL) {
+        return false;
+    }
+    return COMPACT_INODE_DROPPABLE(entry->value);
+}
+
+static inline void keep_inode(BinlogCompactContext *ctx, const int64_t inode)
+{
+    BinlogCompactHashEntry *entry;
+
+    if ((entry=htable_find(&ctx->inodes, inode)) != NULL &&
+            COMPACT_INODE_DROPPABLE(entry->value))
+    {
+        entry->value |= COMPACT_INODE_KEEP;
+        ctx->evicted = true;
+    }
+}
+
+static int get_record_inodes(const FDIRBinlogRecord *record,
+        int64_t *inodes)
+{
+    int count;
+
+    count = 0;
+    if (record->inode > 0) {
+        inodes[count++] = record->inode;
+    }
+    if (record->options.path_info.flags != 0 &&
+            record->me.pname.parent_inode > 0)
+    {
+        inodes[count++] = record->me.pname.parent_inode;
+    }
+    if (record->operation == BINLOG_OP_RENAME_DENTRY_INT &&
+            record->rename.src.pname.parent_inode > 0)
+    {
+        inodes[count++] = record->rename.src.pname.parent_inode;
+    }
+    if (record->operation == BINLOG_OP_CREATE_DENTRY_INT &&
+            record->options.src_inode && record->hdlink.src.inode > 0)
+    {
+        inodes[count++] = record->hdlink.src.inode;
+    }
+    return count;
+}
+
+/* the records of the inode which created and removed in the range are
+ * dropped, except the rename which maybe overwrite or exchange others */
+static inline bool record_droppable(BinlogCompactContext *ctx,
+        const FDIRBinlogRecord *record, const bool boundary)
+{
+    if (boundary || record->operation == BINLOG_OP_RENAME_DENTRY_INT) {
+        return false;
+    }
+    return inode_droppable(ctx, record->inode);
+}
+
+static int scan_file(BinlogCompactContext *ctx, const int index,
+        binlog_compact_record_func func)
+{
+    char filename[PATH_MAX];
+    FDIRBinlogRecord record;
+    BinlogCompactFileInfo *file;
+    const char *p;
+    const char *end;
+    const char *rec_end;
+    char error_info[SF_ERROR_INFO_SIZE];
+    int64_t offset;
+    int read_bytes;
+    int remain;
+    int fd;
+    int result;
+
+    sf_binlog_writer_get_filename(DATA_PATH_STR, FDIR_BINLOG_SUBDIR_NAME,
+            index, filename, sizeof(filename));
+    if ((fd=open(filename, O_RDONLY)) < 0) {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "open file %s fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        return result;
+    }
+
+    file = ctx->files + (index - ctx->start_index);
+    offset = 0;
+    remain = 0;
+    result = 0;
+    while ((read_bytes=read(fd, ctx->in_buff + remain,
+                    COMPACT_INPUT_BUFFER_SIZE - remain)) > 0)
+    {
+        p = ctx->in_buff;
+        end = ctx->in_buff + remain + read_bytes;
+        while (p < end) {
+            result = binlog_unpack_record(p, end - p, &record,
+                    &rec_end, error_info, sizeof(error_info));
+            if (result == EAGAIN || result == EOVERFLOW) {
+                result = 0;  //partial record, read more
+                break;
+            } else if (result != 0) {
+                logError("file: "__FILE__", line: %d, "
+                        "binlog file: %s, offset: %"PRId64", "
+                        "unpack record fail, %s", __LINE__,
+                        filename, offset, error_info);
+                close(fd);
+                return result;
+            }
+
+            if ((result=func(ctx, &record, p, rec_end - p,
+                            record.data_version == file->first_version ||
+                            record.data_version == file->last_version)) != 0)
+            {
+                close(fd);
+                return result;
+            }
+
+            offset += rec_end - p;
+            p = rec_end;
+        }
+
+        remain = end - p;
+        if (remain > 0 && p != ctx->in_buff) {
+            memmove(ctx->in_buff, p, remain);
+        }
+    }
+
+    if (read_bytes < 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "read from file %s fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+    } else if (remain > 0) {
+        logError("file: "__FILE__", line: %d, "
+                "binlog file: %s, offset: %"PRId64", the last "
+                "record is incomplete, length: %d", __LINE__,
+                filename, offset, remain);
+        result = EINVAL;
+    }
+
+    close(fd);
+    return result;
+}
+
+static int scan_files(BinlogCompactContext *ctx,
+        binlog_compact_record_func func)
+{
+    int index;
+    int result;
+
+    ctx->stat->pass_count++;
+    for (index=ctx->start_index; index<=ctx->last_index; index++) {
+        if (!SF_G_CONTINUE_FLAG) {
+            return EINTR;
+        }
+        if ((result=scan_file(ctx, index, func)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int collect_inode_record(BinlogCompactContext *ctx,
+        FDIRBinlogRecord *record, const char *rec_start,
+        const int rec_len, const bool boundary)
+{
+    int result;
+
+    ctx->stat->record_count++;
+    switch (record->operation) {
+        case BINLOG_OP_CREATE_DENTRY_INT:
+            if ((result=set_inode_flags(ctx, record->inode,
+                            COMPACT_INODE_CREATED)) != 0)
+            {
+                return result;
+            }
+
+            //the removed source is kept by the hard links
+            if (record->options.src_inode) {
+                return set_inode_flags(ctx, record->hdlink.src.inode,
+                        COMPACT_INODE_KEEP);
+            }
+            return 0;
+        case BINLOG_OP_REMOVE_DENTRY_INT:
+            return set_inode_flags(ctx, record->inode,
+                    COMPACT_INODE_REMOVED);
+        case BINLOG_OP_RENAME_DENTRY_INT:
+            /* the inode of the exchange peer is not in the record,
+             * so the dest location is recorded to keep the peer */
+            if ((record->flags & RENAME_EXCHANGE) != 0) {
+                if (htable_insert(&ctx->exchanges, location_key(
+                                record->rename.dest.pname.parent_inode,
+                                &record->rename.dest.pname.name)) == NULL)
+                {
+                    return ENOMEM;
+                }
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static inline int end_update_run(BinlogCompactContext *ctx,
+        const int64_t inode)
+{
+    BinlogCompactHashEntry *entry;
+
+    if ((entry=htable_find(&ctx->runs, inode)) == NULL ||
+            entry->value == 0)
+    {
+        return 0;
+    }
+
+    if (htable_insert(&ctx->terminals, entry->value) == NULL) {
+        return ENOMEM;
+    }
+    entry->value = 0;
+    return 0;
+}
+
+/* the inodes referred by the kept records can't be dropped,
+ * and the last update of the consecutive updates is the terminal */
+static int check_kept_record(BinlogCompactContext *ctx,
+        FDIRBinlogRecord *record, const char *rec_start,
+        const int rec_len, const bool boundary)
+{
+    BinlogCompactHashEntry *entry;
+    int64_t inodes[4];
+    int count;
+    int i;
+    int result;
+
+    /* the dentry created at the dest location of an exchange rename
+     * maybe the exchange peer, the kept rename needs its creation */
+    if (record->operation == BINLOG_OP_CREATE_DENTRY_INT &&
+            ctx->exchanges.count > 0 && htable_find(&ctx->exchanges,
+                location_key(record->me.pname.parent_inode,
+                    &record->me.pname.name)) != NULL)
+    {
+        keep_inode(ctx, record->inode);
+    }
+
+    if (record_droppable(ctx, record, boundary)) {
+        return 0;
+    }
+
+    count = get_record_inodes(record, inodes);
+    for (i=0; i<count; i++) {
+        keep_inode(ctx, inodes[i]);
+    }
+
+    if (record->operation == BINLOG_OP_UPDATE_DENTRY_INT && !boundary) {
+        if ((entry=htable_insert(&ctx->runs, record->inode)) == NULL) {
+            return ENOMEM;
+        }
+        entry->value = record->data_version;
+        return 0;
+    }
+
+    //the boundary update is kept as it is
+    if ((result=end_update_run(ctx, record->inode)) != 0) {
+        return result;
+    }
+    if (record->operation == BINLOG_OP_UPDATE_DENTRY_INT) {
+        if (htable_insert(&ctx->terminals, record->data_version) == NULL) {
+            return ENOMEM;
+        }
+    }
+    return 0;
+}
+
+static int end_all_update_runs(BinlogCompactContext *ctx)
+{
+    BinlogCompactHashEntry *entry;
+    BinlogCompactHashEntry *end;
+
+    end = ctx->runs.entries + ctx->runs.capacity;
+    for (entry=ctx->runs.entries; entry<end; entry++) {
+        if (entry->key != 0 && entry->value != 0) {
+            if (htable_insert(&ctx->terminals, entry->value) == NULL) {
+                return ENOMEM;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void merge_to_pending(BinlogCompactPending *pending,
+        const FDIRBinlogRecord *record)
+{
+#define COMPACT_MERGE_FIELD(field) \
+    if (record->options.field) { \
+        pending->options.field = 1; \
+        pending->stat.field = record->stat.field; \
+    }
+
+    COMPACT_MERGE_FIELD(mode);
+    COMPACT_MERGE_FIELD(atime);
+    COMPACT_MERGE_FIELD(btime);
+    COMPACT_MERGE_FIELD(ctime);
+    COMPACT_MERGE_FIELD(mtime);
+    COMPACT_MERGE_FIELD(uid);
+    COMPACT_MERGE_FIELD(gid);
+    COMPACT_MERGE_FIELD(size);
+    COMPACT_MERGE_FIELD(space_end);
+
+    if (record->options.inc_alloc) {  //increment
+        pending->options.inc_alloc = 1;
+        pending->stat.alloc += record->stat.alloc;
+    }
+}
+
+//the fields of the later record take precedence
+static void merge_from_pending(FDIRBinlogRecord *record,
+        const BinlogCompactPending *pending)
+{
+#define COMPACT_FILL_FIELD(field) \
+    if (pending->options.field && !record->options.field) { \
+        record->options.field = 1; \
+        record->stat.field = pending->stat.field; \
+    }
+
+    COMPACT_FILL_FIELD(mode);
+    COMPACT_FILL_FIELD(atime);
+    COMPACT_FILL_FIELD(btime);
+    COMPACT_FILL_FIELD(ctime);
+    COMPACT_FILL_FIELD(mtime);
+    COMPACT_FILL_FIELD(uid);
+    COMPACT_FILL_FIELD(gid);
+    COMPACT_FILL_FIELD(size);
+    COMPACT_FILL_FIELD(space_end);
+
+    if (pending->options.inc_alloc) {
+        if (record->options.inc_alloc) {
+            record->stat.alloc += pending->stat.alloc;
+        } else {
+            record->options.inc_alloc = 1;
+            record->stat.alloc = pending->stat.alloc;
+        }
+    }
+}
+
+static int write_update_record(BinlogCompactContext *ctx,
+        FDIRBinlogRecord *record, const char *rec_start,
+        const int rec_len)
+{
+    BinlogCompactHashEntry *entry;
+    BinlogCompactPending *pending;
+
+    if ((entry=htable_find(&ctx->pendings, record->inode)) != NULL &&
+            entry->value != 0)
+    {
+        pending = (BinlogCompactPending *)entry->value;
+        entry->value = 0;
+        if (htable_find(&ctx->terminals, record->data_version) != NULL) {
+            merge_from_pending(record, pending);
+            free(pending);
+            return binlog_pack_record(record, &ctx->out_buffer);
+        }
+    } else if (htable_find(&ctx->terminals,
+                record->data_version) != NULL)
+    {
+        return fast_buffer_append_buff(&ctx->out_buffer,
+                rec_start, rec_len);
+    } else {
+        if ((entry=htable_insert(&ctx->pendings, record->inode)) == NULL) {
+            return ENOMEM;
+        }
+        pending = (BinlogCompactPending *)fc_calloc(
+                sizeof(BinlogCompactPending));
+        if (pending == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    //merge into the later update of the run
+    merge_to_pending(pending, record);
+    entry->value = (int64_t)pending;
+    ctx->stat->merge_count++;
+    return 0;
+}
+
+static int write_kept_record(BinlogCompactContext *ctx,
+        FDIRBinlogRecord *record, const char *rec_start,
+        const int rec_len, const bool boundary)
+{
+    int result;
+
+    if (record_droppable(ctx, record, boundary)) {
+        ctx->stat->drop_count++;
+        return 0;
+    }
+
+    if (record->operation == BINLOG_OP_UPDATE_DENTRY_INT && !boundary) {
+        result = write_update_record(ctx, record, rec_start, rec_len);
+    } else {
+        result = fast_buffer_append_buff(&ctx->out_buffer,
+                rec_start, rec_len);
+    }
+    if (result != 0) {
+        return result;
+    }
+
+    if (ctx->out_buffer.length >= COMPACT_OUTPUT_FLUSH_SIZE) {
+        if (fc_safe_write(ctx->out_fd, ctx->out_buffer.data,
+                    ctx->out_buffer.length) != ctx->out_buffer.length)
+        {
+            return errno != 0 ? errno : EIO;
+        }
+        ctx->out_buffer.length = 0;
+    }
+    return 0;
+}
+
+static int rewrite_file(BinlogCompactContext *ctx, const int index)
+{
+    char filename[PATH_MAX];
+    char tmp_filename[PATH_MAX];
+    struct stat stbuf;
+    int64_t file_size;
+    int result;
+
+    sf_binlog_writer_get_filename(DATA_PATH_STR, FDIR_BINLOG_SUBDIR_NAME,
+            index, filename, sizeof(filename));
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.compact", filename);
+    if ((ctx->out_fd=open(tmp_filename, O_WRONLY | O_CREAT | O_TRUNC,
+                    0644)) < 0)
+    {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "open file %s fail, errno: %d, error info: %s",
+                __LINE__, tmp_filename, result, STRERROR(result));
+        return result;
+    }
+
+    ctx->out_buffer.length = 0;
+    if ((result=scan_file(ctx, index, write_kept_record)) == 0) {
+        if (fc_safe_write(ctx->out_fd, ctx->out_buffer.data,
+                    ctx->out_buffer.length) != ctx->out_buffer.length ||
+                fsync(ctx->out_fd) != 0)
+        {
+            result = errno != 0 ? errno : EIO;
+            logError("file: "__FILE__", line: %d, "
+                    "write to file %s fail, errno: %d, error info: %s",
+                    __LINE__, tmp_filename, result, STRERROR(result));
+        }
+    }
+    close(ctx->out_fd);
+    ctx->out_fd = -1;
+
+    if (result == 0) {
+        if (stat(filename, &stbuf) == 0) {
+            file_size = stbuf.st_size;
+        } else {
+            file_size = 0;
+        }
+        if (stat(tmp_filename, &stbuf) != 0) {
+            result = errno != 0 ? errno : ENOENT;
+        }
+    }
+    if (result != 0) {
+        unlink(tmp_filename);
+        return result;
+    }
+
+    ctx->stat->bytes_before += file_size;
+    ctx->stat->bytes_after += stbuf.st_size;
+    if (stbuf.st_size == file_size) {  //nothing dropped
+        unlink(tmp_filename);
+        return 0;
+    }
+
+    if ((result=binlog_index_replace_binlog(index, tmp_filename)) != 0) {
+        unlink(tmp_filename);
+        return result;
+    }
+
+    ctx->stat->file_count++;
+    return 0;
+}
+
+static int init_compact_context(BinlogCompactContext *ctx,
+        const int start_index, const int last_index)
+{
+    BinlogCompactFileInfo *file;
+    int result;
+    int index;
+
+    ctx->start_index = start_index;
+    ctx->last_index = last_index;
+    ctx->out_fd = -1;
+
+    ctx->files = (BinlogCompactFileInfo *)fc_malloc(
+            sizeof(BinlogCompactFileInfo) * (last_index - start_index + 1));
+    if (ctx->files == NULL) {
+        return ENOMEM;
+    }
+    for (index=start_index; index<=last_index; index++) {
+        file = ctx->files + (index - start_index);
+        if ((result=binlog_get_first_record_version(index,
+                        &file->first_version)) != 0)
+        {
+            return result;
+        }
+        if ((result=binlog_get_last_record_version(index,
+                        &file->last_version)) != 0)
+        {
+            return result;
+        }
+    }
+
+    if ((ctx->in_buff=(char *)fc_malloc(COMPACT_INPUT_BUFFER_SIZE)) == NULL) {
+        return ENOMEM;
+    }
+    if ((result=fast_buffer_init_ex(&ctx->out_buffer,
+                    COMPACT_OUTPUT_FLUSH_SIZE +
+                    2 * BINLOG_RECORD_MAX_SIZE)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=htable_init(&ctx->inodes,
+                    COMPACT_HTABLE_INIT_CAPACITY)) != 0)
+    {
+        return result;
+    }
+    if ((result=htable_init(&ctx->runs,
+                    COMPACT_HTABLE_INIT_CAPACITY)) != 0)
+    {
+        return result;
+    }
+    if ((result=htable_init(&ctx->terminals,
+                    COMPACT_HTABLE_INIT_CAPACITY)) != 0)
+    {
+        return result;
+    }
+    if ((result=htable_init(&ctx->exchanges,
+                    COMPACT_HTABLE_INIT_CAPACITY)) != 0)
+    {
+        return result;
+    }
+    return htable_init(&ctx->pendings, COMPACT_HTABLE_INIT_CAPACITY);
+}
+
+static void destroy_compact_context(BinlogCompactContext *ctx)
+{
+    BinlogCompactHashEntry *entry;
+    BinlogCompactHashEntry *end;
+
+    if (ctx->pendings.entries != NULL) {
+        end = ctx->pendings.entries + ctx->pendings.capacity;
+        for (entry=ctx->pendings.entries; entry<end; entry++) {
+            if (entry->key != 0 && entry->value != 0) {
+                free((BinlogCompactPending *)entry->value);
+            }
+        }
+    }
+
+    htable_destroy(&ctx->inodes);
+    htable_destroy(&ctx->runs);
+    htable_destroy(&ctx->terminals);
+    htable_destroy(&ctx->exchanges);
+    htable_destroy(&ctx->pendings);
+    if (ctx->files != NULL) {
+        free(ctx->files);
+    }
+    if (ctx->in_buff != NULL) {
+        free(ctx->in_buff);
+    }
+    fast_buffer_destroy(&ctx->out_buffer);
+}
+
+static int do_compact(BinlogCompactContext *ctx)
+{
+    int index;
+    int result;
+
+    if ((result=scan_files(ctx, collect_inode_record)) != 0) {
+        return result;
+    }
+
+    /* keep the inodes referred by the kept records until stable,
+       the parent of the kept record maybe droppable before */
+    do {
+        ctx->evicted = false;
+        htable_clear(&ctx->runs);
+        htable_clear(&ctx->terminals);
+        if ((result=scan_files(ctx, check_kept_record)) != 0) {
+            return result;
+        }
+    } while (ctx->evicted);
+
+    if ((result=end_all_update_runs(ctx)) != 0) {
+        return result;
+    }
+
+    for (index=ctx->start_index; index<=ctx->last_index; index++) {
+        if (!SF_G_CONTINUE_FLAG) {
+            return EINTR;
+        }
+        if ((result=rewrite_file(ctx, index)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static inline void get_mark_filename(char *filename, const int size)
+{
+    snprintf(filename, size, "%s/%s/%s", DATA_PATH_STR,
+            FDIR_BINLOG_SUBDIR_NAME, BINLOG_COMPACT_MARK_FILENAME);
+}
+
+//the mark file stores the first binlog index which not compacted yet
+static int load_compact_mark(int *start_index)
+{
+    char filename[PATH_MAX];
+    char content[32];
+    char *endptr;
+    int64_t file_size;
+    int result;
+
+    get_mark_filename(filename, sizeof(filename));
+    if (access(filename, F_OK) != 0) {
+        *start_index = 0;
+        return 0;
+    }
+
+    file_size = sizeof(content);
+    if ((result=getFileContentEx(filename, content, 0, &file_size)) != 0) {
+        return result;
+    }
+    endptr = NULL;
+    *start_index = strtol(content, &endptr, 10);
+    if (!(endptr == NULL || *endptr == '\0') || *start_index < 0) {
+        logError("file: "__FILE__", line: %d, "
+                "compact mark filename: %s, invalid content: %s",
+                __LINE__, filename, content);
+        return EINVAL;
+    }
+    return 0;
+}
+
+static int save_compact_mark(const int start_index)
+{
+    char filename[PATH_MAX];
+    char buff[32];
+    int len;
+
+    get_mark_filename(filename, sizeof(filename));
+    len = sprintf(buff, "%d", start_index);
+    return safeWriteToFile(filename, buff, len);
+}
+
+int binlog_compact_files(const int last_index, BinlogCompactStat *stat)
+{
+    BinlogCompactContext ctx;
+    int start_index;
+    int result;
+
+    memset(stat, 0, sizeof(*stat));
+    if ((result=load_compact_mark(&start_index)) != 0) {
+        return result;
+    }
+    stat->start_index = start_index;
+    if (last_index < start_index) {
+        return 0;
+    }
+
+    /* the records of the files compacted before are not scanned again,
+     * the inodes created before the start file are not droppable */
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.stat = stat;
+    if ((result=init_compact_context(&ctx, start_index, last_index)) == 0) {
+        result = do_compact(&ctx);
+    }
+    destroy_compact_context(&ctx);
+    if (result != 0) {
+        return result;
+    }
+
+    return save_compact_mark(last_index + 1);
+}
+
+//the slaves joined with the data versions after the compacted files
+static int64_t get_slaves_min_data_version()
+{
+    FDIRClusterServerInfo *cs;
+    FDIRClusterServerInfo *end;
+    int64_t min_version;
+    int64_t version;
+
+    min_version = FC_ATOMIC_GET(DATA_CURRENT_VERSION);
+    end = CLUSTER_SERVER_ARRAY.servers + CLUSTER_SERVER_ARRAY.count;
+    for (cs=CLUSTER_SERVER_ARRAY.servers; cs<end; cs++) {
+        if (cs == CLUSTER_MYSELF_PTR) {
+            continue;
+        }
+
+        version = FC_ATOMIC_GET(cs->last_data_version);
+        if (version < min_version) {
+            min_version = version;
+        }
+    }
+
+    return min_version;
+}
+
+static int get_compact_last_index()
+{
+    int64_t min_version;
+    int64_t last_version;
+    int index;
+
+    min_version = get_slaves_min_data_version();
+    if (min_version <= 0) {
+        return -1;
+    }
+
+    index = binlog_get_current_write_index() - BINLOG_COMPACT_KEEP_FILES;
+    while (index >= 0) {
+        if (binlog_get_last_record_version(index, &last_version) == 0 &&
+                last_version <= min_version)
+        {
+            break;
+        }
+        index--;
+    }
+
+    return index;
+}
+
+static void compact_binlog()
+{
+    BinlogCompactStat stat;
+    int64_t start_time_ms;
+    int last_index;
+    int result;
+
+    if ((last_index=get_compact_last_index()) < 0) {
+        return;
+    }
+
+    start_time_ms = get_current_time_ms();
+    if ((result=binlog_compact_files(last_index, &stat)) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "compact binlog files [%d, %d] fail, "
+                "errno: %d, error info: %s", __LINE__, stat.start_index,
+                last_index, result, STRERROR(result));
+        return;
+    }
+    if (stat.start_index > last_index) {  //already compacted
+        return;
+    }
+
+    logInfo("file: "__FILE__", line: %d, "
+            "compact binlog files [%d, %d] done, rewritten file count: %d, "
+            "record count: %"PRId64", drop count: %"PRId64", merge count: "
+            "%"PRId64", bytes: %"PRId64" => %"PRId64", pass count: %d, "
+            "time used: %"PRId64" ms", __LINE__, stat.start_index, last_index,
+            stat.file_count, stat.record_count, stat.drop_count,
+            stat.merge_count, stat.bytes_before, stat.bytes_after,
+            stat.pass_count, get_current_time_ms() - start_time_ms);
+}
+
+static void *binlog_compact_thread_func(void *arg)
+{
+    time_t last_time;
+
+#ifdef OS_LINUX
+    prctl(PR_SET_NAME, "binlog-compact");
+#endif
+
+    last_time = g_current_time;
+    while (SF_G_CONTINUE_FLAG) {
+        sleep(1);
+        if (g_current_time - last_time < BINLOG_COMPACT_INTERVAL) {
+            continue;
+        }
+        last_time = g_current_time;
+
+        //the slave binlog is compared with the master's when joining
+        if (MYSELF_IS_MASTER) {
+            compact_binlog();
+        }
+    }
+
+    return NULL;
+}
+
+int binlog_compact_init()
+{
+    pthread_t tid;
+
+    if (BINLOG_COMPACT_INTERVAL <= 0) {
+        return 0;
+    }
+
+    return fc_create_thread(&tid, binlog_compact_thread_func,
+            NULL, SF_G_THREAD_STACK_SIZE);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//binlog_compact.h
+
+#ifndef _BINLOG_COMPACT_H_
+#define _BINLOG_COMPACT_H_
+
+#include "binlog_types.h"
+
+typedef struct binlog_compact_stat {
+    int start_index;      //the first file which not compacted before
+    int file_count;       //the rewritten files
+    int pass_count;       //the scan passes of the binlog files
+    int64_t record_count;
+    int64_t drop_count;   //the records of the created and removed inodes
+    int64_t merge_count;  //the updates merged into the later one
+    int64_t bytes_before;
+    int64_t bytes_after;
+} BinlogCompactStat;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//start the compact thread when binlog_compact_interval > 0
+int binlog_compact_init();
+
+/* rewrite the binlog files [start_index, last_index] keeping the net
+ * effect, the start_index is loaded from the compact mark file which
+ * saved as last_index + 1 after success, so the compacted files are
+ * not scanned again. the first and last records of each file are kept
+ * for the version search, and the other kept records are byte-identical,
+ * these files MUST NOT be written during the compaction */
+int binlog_compact_files(const int last_index, BinlogCompactStat *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,440 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "sf/sf_global.h"
+#include "../server_global.h"
+#include "binlog_pack.h"
+#include "binlog_reader.h"
+#include "binlog_index.h"
+
+#define BINLOG_INDEX_FILENAME_EXT     ".idx"
+#define BINLOG_INDEX_MAGIC_STR        "FDIRBIDX"
+#define BINLOG_INDEX_MAGIC_LEN        (sizeof(BINLOG_INDEX_MAGIC_STR) - 1)
+#define BINLOG_INDEX_FORMAT_VERSION   1
+#define BINLOG_INDEX_READ_BUFFER_SIZE (1024 * 1024)
+
+/* the index file: the header and the entries of the records
+ * which the offset is ascending */
+typedef struct binlog_index_header {
+    char magic[8];
+    char format_version[4];
+    char padding[4];
+    char indexed_size[8];  //the binlog bytes scanned
+    char entry_count[8];
+} BinlogIndexHeader;
+
+typedef struct binlog_index_entry_pack {
+    char data_version[8];
+    char offset[8];
+} BinlogIndexEntryPack;
+
+typedef struct binlog_index_entry {
+    int64_t data_version;
+    int64_t offset;
+} BinlogIndexEntry;
+
+typedef struct binlog_index_array {
+    BinlogIndexEntry *entries;
+    int64_t indexed_size;
+    int count;
+    int alloc;
+} BinlogIndexArray;
+
+//serialize the building of the index files
+static pthread_mutex_t index_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline void get_index_filename(const int file_index,
+        char *filename, const int size)
+{
+    int len;
+
+    sf_binlog_writer_get_filename(DATA_PATH_STR, FDIR_BINLOG_SUBDIR_NAME,
+            file_index, filename, size);
+    len = strlen(filename);
+    snprintf(filename + len, size - len, "%s", BINLOG_INDEX_FILENAME_EXT);
+}
+
+static int index_array_add(BinlogIndexArray *array,
+        const int64_t data_version, const int64_t offset)
+{
+    BinlogIndexEntry *entries;
+    int alloc;
+
+    if (array->count == array->alloc) {
+        alloc = (array->alloc == 0) ? 256 : array->alloc * 2;
+        entries = (BinlogIndexEntry *)fc_malloc(
+                sizeof(BinlogIndexEntry) * alloc);
+        if (entries == NULL) {
+            return ENOMEM;
+        }
+
+        if (array->count > 0) {
+            memcpy(entries, array->entries,
+                    sizeof(BinlogIndexEntry) * array->count);
+        }
+        if (array->entries != NULL) {
+            free(array->entries);
+        }
+        array->entries = entries;
+        array->alloc = alloc;
+    }
+
+    array->entries[array->count].data_version = data_version;
+    array->entries[array->count].offset = offset;
+    array->count++;
+    return 0;
+}
+
+static inline void index_array_reset(BinlogIndexArray *array)
+{
+    array->count = 0;
+    array->indexed_size = 0;
+}
+
+static int load_index(const char *filename, BinlogIndexArray *array)
+{
+    char *content;
+    BinlogIndexHeader *header;
+    BinlogIndexEntryPack *pack;
+    BinlogIndexEntryPack *end;
+    int64_t file_size;
+    int64_t entry_count;
+    int result;
+
+    if (access(filename, F_OK) != 0) {
+        return errno != 0 ? errno : ENOENT;
+    }
+    if ((result=getFileContent(filename, &content, &file_size)) != 0) {
+        return result;
+    }
+
+    header = (BinlogIndexHeader *)content;
+    if (file_size < sizeof(BinlogIndexHeader) || memcmp(header->magic,
+                BINLOG_INDEX_MAGIC_STR, BINLOG_INDEX_MAGIC_LEN) != 0 ||
+            buff2int(header->format_version) != BINLOG_INDEX_FORMAT_VERSION)
+    {
+        free(content);
+        return EINVAL;
+    }
+
+    entry_count = buff2long(header->entry_count);
+    if (sizeof(BinlogIndexHeader) + entry_count *
+            sizeof(BinlogIndexEntryPack) != file_size)
+    {
+        free(content);
+        return EINVAL;
+    }
+
+    result = 0;
+    pack = (BinlogIndexEntryPack *)(header + 1);
+    end = pack + entry_count;
+    for (; pack<end; pack++) {
+        if ((result=index_array_add(array, buff2long(pack->data_version),
+                        buff2long(pack->offset))) != 0)
+        {
+            break;
+        }
+    }
+    array->indexed_size = buff2long(header->indexed_size);
+
+    free(content);
+    return result;
+}
+
+static int save_index(const char *filename, const BinlogIndexArray *array)
+{
+    char tmp_filename[PATH_MAX];
+    BinlogIndexHeader header;
+    BinlogIndexEntryPack pack;
+    const BinlogIndexEntry *entry;
+    const BinlogIndexEntry *end;
+    FILE *fp;
+    int result;
+
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp", filename);
+    if ((fp=fopen(tmp_filename, "wb")) == NULL) {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "open file %s fail, errno: %d, error info: %s",
+                __LINE__, tmp_filename, result, STRERROR(result));
+        return result;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINLOG_INDEX_MAGIC_STR, BINLOG_INDEX_MAGIC_LEN);
+    int2buff(BINLOG_INDEX_FORMAT_VERSION, header.format_version);
+    long2buff(array->indexed_size, header.indexed_size);
+    long2buff(array->count, header.entry_count);
+
+    result = 0;
+    if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+        result = errno != 0 ? errno : EIO;
+    }
+    end = array->entries + array->count;
+    for (entry=array->entries; entry<end && result==0; entry++) {
+        long2buff(entry->data_version, pack.data_version);
+        long2buff(entry->offset, pack.offset);
+        if (fwrite(&pack, sizeof(pack), 1, fp) != 1) {
+            result = errno != 0 ? errno : EIO;
+        }
+    }
+    if (fclose(fp) != 0 && result == 0) {
+        result = errno != 0 ? errno : EIO;
+    }
+
+    if (result == 0 && rename(tmp_filename, filename) != 0) {
+        result = errno != 0 ? errno : EPERM;
+    }
+    if (result != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "write index file %s fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        unlink(tmp_filename);
+    }
+    return result;
+}
+
+//index the records from the indexed size to the last complete record
+static int scan_binlog(const char *filename, BinlogIndexArray *array,
+        bool *changed)
+{
+    char *buff;
+    const char *p;
+    const char *end;
+    const char *rec_end;
+    char error_info[SF_ERROR_INFO_SIZE];
+    int64_t data_version;
+    int64_t offset;
+    int read_bytes;
+    int remain;
+    int fd;
+    int result;
+
+    if ((fd=open(filename, O_RDONLY)) < 0) {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "open file %s fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        return result;
+    }
+    if (array->indexed_size > 0 && lseek(fd, array->indexed_size,
+                SEEK_SET) < 0)
+    {
+        result = errno != 0 ? errno : EIO;
+        close(fd);
+        return result;
+    }
+
+    if ((buff=(char *)fc_malloc(BINLOG_INDEX_READ_BUFFER_SIZE)) == NULL) {
+        close(fd);
+        return ENOMEM;
+    }
+
+    offset = array->indexed_size;
+    remain = 0;
+    result = 0;
+    while ((read_bytes=read(fd, buff + remain,
+                    BINLOG_INDEX_READ_BUFFER_SIZE - remain)) > 0)
+    {
+        p = buff;
+        end = buff + remain + read_bytes;
+        while (p < end) {
+            *error_info = '\0';
+            result = binlog_detect_record(p, end - p, &data_version,
+                    &rec_end, error_info, sizeof(error_info));
+            if (result != 0) {
+                break;
+            }
+
+            if (array->count == 0 || offset - array->entries[array->
+                    count - 1].offset >= FDIR_BINLOG_INDEX_INTERVAL_BYTES)
+            {
+                if ((result=index_array_add(array,
+                                data_version, offset)) != 0)
+                {
+                    break;
+                }
+                *changed = true;
+            }
+
+            offset += rec_end - p;
+            p = rec_end;
+        }
+
+        if (result == EAGAIN || result == EOVERFLOW) {
+            result = 0;  //partial record
+        } else if (result != 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "binlog file: %s, offset: %"PRId64", detect record "
+                    "fail, errno: %d, error info: %s", __LINE__, filename,
+                    offset, result, (*error_info != '\0') ?
+                    error_info : STRERROR(result));
+            break;
+        }
+
+        remain = end - p;
+        if (remain > 0 && p != buff) {
+            memmove(buff, p, remain);
+        }
+    }
+
+    if (read_bytes < 0 && result == 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "read from file %s fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+    }
+    if (result == 0) {
+        array->indexed_size = offset;
+    }
+
+    free(buff);
+    close(fd);
+    return result;
+}
+
+static int check_index(const int file_index, const char *binlog_filename,
+        const char *index_filename, BinlogIndexArray *array)
+{
+    int64_t file_size;
+    int64_t first_version;
+    bool changed;
+    int result;
+
+    if ((result=getFileSize(binlog_filename, &file_size)) != 0) {
+        return result;
+    }
+
+    changed = false;
+    if ((result=load_index(index_filename, array)) != 0) {
+        if (result != ENOENT) {
+            logWarning("file: "__FILE__", line: %d, "
+                    "index file %s is invalid, rebuild it",
+                    __LINE__, index_filename);
+        }
+        index_array_reset(array);
+        changed = true;
+    } else if (array->indexed_size > file_size) {  //binlog rewritten
+        index_array_reset(array);
+        changed = true;
+    } else if (array->count > 0) {
+        if (binlog_get_first_record_version(file_index,
+                    &first_version) != 0 || first_version !=
+                array->entries[0].data_version)
+        {
+            index_array_reset(array);
+            changed = true;
+        }
+    }
+
+    if (array->indexed_size < file_size) {
+        if ((result=scan_binlog(binlog_filename, array, &changed)) != 0) {
+            return result;
+        }
+    }
+
+    if (changed) {
+        save_index(index_filename, array);  //rebuild next time when fail
+    }
+    return 0;
+}
+
+int binlog_index_find_offset(const int file_index,
+        const int64_t data_version, int64_t *offset)
+{
+    char binlog_filename[PATH_MAX];
+    char index_filename[PATH_MAX];
+    BinlogIndexArray array;
+    int low;
+    int high;
+    int mid;
+    int result;
+
+    *offset = 0;
+    sf_binlog_writer_get_filename(DATA_PATH_STR, FDIR_BINLOG_SUBDIR_NAME,
+            file_index, binlog_filename, sizeof(binlog_filename));
+    get_index_filename(file_index, index_filename, sizeof(index_filename));
+
+    memset(&array, 0, sizeof(array));
+    PTHREAD_MUTEX_LOCK(&index_lock);
+    result = check_index(file_index, binlog_filename,
+            index_filename, &array);
+    PTHREAD_MUTEX_UNLOCK(&index_lock);
+
+    if (result == 0) {
+        low = 0;
+        high = array.count - 1;
+        while (low <= high) {
+            mid = (low + high) / 2;
+            if (array.entries[mid].data_version <= data_version) {
+                *offset = array.entries[mid].offset;
+                low = mid + 1;
+            } else {
+                high = mid - 1;
+            }
+        }
+    }
+
+    if (array.entries != NULL) {
+        free(array.entries);
+    }
+    return result;
+}
+
+int binlog_index_replace_binlog(const int file_index,
+        const char *new_filename)
+{
+    char binlog_filename[PATH_MAX];
+    char index_filename[PATH_MAX];
+    int result;
+
+    sf_binlog_writer_get_filename(DATA_PATH_STR, FDIR_BINLOG_SUBDIR_NAME,
+            file_index, binlog_filename, sizeof(binlog_filename));
+    get_index_filename(file_index, index_filename, sizeof(index_filename));
+
+    /* the stale index MUST be removed before the rename, otherwise it
+     * maybe loaded against the new binlog file by the concurrent finder */
+    PTHREAD_MUTEX_LOCK(&index_lock);
+    if (unlink(index_filename) != 0 && errno != ENOENT) {
+        result = errno != 0 ? errno : EPERM;
+        logError("file: "__FILE__", line: %d, "
+                "unlink file %s fail, errno: %d, error info: %s",
+                __LINE__, index_filename, result, STRERROR(result));
+    } else if (rename(new_filename, binlog_filename) != 0) {
+        result = errno != 0 ? errno : EPERM;
+        logError("file: "__FILE__", line: %d, "
+                "rename file %s to %s fail, errno: %d, error info: %s",
+                __LINE__, new_filename, binlog_filename,
+                result, STRERROR(result));
+    } else {
+        result = 0;
+    }
+    PTHREAD_MUTEX_UNLOCK(&index_lock);
+
+    return result;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//binlog_index.h
+
+#ifndef _BINLOG_INDEX_H_
+#define _BINLOG_INDEX_H_
+
+#include "binlog_types.h"
+
+//one index entry per the binlog bytes
+#define FDIR_BINLOG_INDEX_INTERVAL_BYTES  (64 * 1024)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* find the start offset to search the data version in the binlog file
+ * by the sparse index file "<binlog filename>.idx", which is built or
+ * extended to the file end when necessary
+ * offset: return the offset of the last indexed record whose data version
+ *         <= the data_version, 0 for not found
+ * return error no, the caller should search from offset 0 when fail
+ */
+int binlog_index_find_offset(const int file_index,
+        const int64_t data_version, int64_t *offset);
+
+/* replace the binlog file with the rewritten one, the index file is
+ * removed before the rename under the index lock
+ * return error no */
+int binlog_index_replace_binlog(const int file_index,
+        const char *new_filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
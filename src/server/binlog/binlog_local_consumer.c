@@ -32,6 +32,7 @@
 #include "fastcommon/ioevent_loop.h"
 #include "sf/sf_global.h"
 #include "../server_global.h"
+#include "../latency_stat.h"
 #include "binlog_write.h"
 #include "binlog_replication.h"
 #include "binlog_producer.h"
@@ -175,14 +176,29 @@ int binlog_local_consumer_push_to_queues(ServerBinlogRecordBuffer *rbuffer)
 {
     FDIRSlaveReplication *replication;
     FDIRSlaveReplication *end;
+    ServerBinlogRecordBuffer *member;
     struct fast_task_info *task;
+    int64_t dispatch_time;
 
     __sync_add_and_fetch(&rbuffer->reffer_count,
             slave_replication_array.count);
 
-    task = (struct fast_task_info *)rbuffer->args;
-    __sync_add_and_fetch(&((FDIRServerTaskArg *)task->arg)->context.
-            service.waiting_rpc_count, slave_replication_array.count);
+    dispatch_time = latency_stat_now();
+    if (rbuffer->members == NULL) {
+        task = (struct fast_task_info *)rbuffer->args;
+        ((FDIRServerTaskArg *)task->arg)->context.
+            latency.dispatch_time = dispatch_time;
+        __sync_add_and_fetch(&((FDIRServerTaskArg *)task->arg)->context.
+                service.waiting_rpc_count, slave_replication_array.count);
+    } else {
+        for (member=rbuffer->members; member!=NULL; member=member->next) {
+            task = (struct fast_task_info *)member->args;
+            ((FDIRServerTaskArg *)task->arg)->context.
+                latency.dispatch_time = dispatch_time;
+            __sync_add_and_fetch(&((FDIRServerTaskArg *)task->arg)->context.
+                    service.waiting_rpc_count, slave_replication_array.count);
+        }
+    }
 
     end = slave_replication_array.replications + slave_replication_array.count;
     for (replication=slave_replication_array.replications; replication<end;
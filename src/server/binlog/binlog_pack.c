@@ -43,6 +43,19 @@
 #define BINLOG_RECORD_END_TAG_STR   "/rec>\n"
 #define BINLOG_RECORD_END_TAG_LEN   (sizeof(BINLOG_RECORD_END_TAG_STR) - 1)
 
+/* the binary record: %04d<brc + format version (1 byte) + fields
+ * + field id 0 + padding + /rec>\n
+ * the field: field id (1 byte) + varint value
+ * the integer value is zigzag encoded and the string value is
+ * the length followed by the escaped bytes as the text format,
+ * so the start and end tags never occur inside a record
+ */
+#define BINLOG_BINARY_START_TAG_STR  "<brc"
+#define BINLOG_BINARY_FORMAT_VERSION  1
+
+//the reserved bytes for the varint length of the escaped string
+#define BINLOG_BINARY_STRING_LENGTH_BYTES  3
+
 #define BINLOG_RECORD_FIELD_NAME_LENGTH         2
 
 #define BINLOG_RECORD_FIELD_NAME_INODE         "id"
@@ -100,9 +113,75 @@
 #define BINLOG_RECORD_FIELD_INDEX_XATTR_NAME    ('x' * 256 + 'n')
 #define BINLOG_RECORD_FIELD_INDEX_XATTR_VALUE   ('x' * 256 + 'v')
 
+#define BINLOG_BINARY_FIELD_ID_END             0
+#define BINLOG_BINARY_FIELD_ID_DATA_VERSION    1
+#define BINLOG_BINARY_FIELD_ID_INODE           2
+#define BINLOG_BINARY_FIELD_ID_OPERATION       3
+#define BINLOG_BINARY_FIELD_ID_TIMESTAMP       4
+#define BINLOG_BINARY_FIELD_ID_NAMESPACE       5
+#define BINLOG_BINARY_FIELD_ID_PARENT          6
+#define BINLOG_BINARY_FIELD_ID_SUBNAME         7
+#define BINLOG_BINARY_FIELD_ID_HASH_CODE       8
+#define BINLOG_BINARY_FIELD_ID_LINK            9
+#define BINLOG_BINARY_FIELD_ID_MODE           10
+#define BINLOG_BINARY_FIELD_ID_BTIME          11
+#define BINLOG_BINARY_FIELD_ID_ATIME          12
+#define BINLOG_BINARY_FIELD_ID_CTIME          13
+#define BINLOG_BINARY_FIELD_ID_MTIME          14
+#define BINLOG_BINARY_FIELD_ID_UID            15
+#define BINLOG_BINARY_FIELD_ID_GID            16
+#define BINLOG_BINARY_FIELD_ID_FILE_SIZE      17
+#define BINLOG_BINARY_FIELD_ID_SPACE_END      18
+#define BINLOG_BINARY_FIELD_ID_INC_ALLOC      19
+#define BINLOG_BINARY_FIELD_ID_SRC_INODE      20
+#define BINLOG_BINARY_FIELD_ID_SRC_PARENT     21
+#define BINLOG_BINARY_FIELD_ID_SRC_SUBNAME    22
+#define BINLOG_BINARY_FIELD_ID_FLAGS          23
+#define BINLOG_BINARY_FIELD_ID_XATTR_NAME     24
+#define BINLOG_BINARY_FIELD_ID_XATTR_VALUE    25
+#define BINLOG_BINARY_FIELD_COUNT             26
+
 #define BINLOG_FIELD_TYPE_INTEGER   'i'
 #define BINLOG_FIELD_TYPE_STRING    's'
 
+typedef struct {
+    const char *name;
+    int type;
+} BinlogBinaryField;
+
+#define BINLOG_BINARY_FIELD(id, type) \
+    [BINLOG_BINARY_FIELD_ID_##id] = {BINLOG_RECORD_FIELD_NAME_##id, \
+        BINLOG_FIELD_TYPE_##type}
+
+//map to the text field name for sharing the field setter
+static const BinlogBinaryField binary_fields[BINLOG_BINARY_FIELD_COUNT] = {
+    BINLOG_BINARY_FIELD(DATA_VERSION, INTEGER),
+    BINLOG_BINARY_FIELD(INODE, INTEGER),
+    BINLOG_BINARY_FIELD(OPERATION, INTEGER),
+    BINLOG_BINARY_FIELD(TIMESTAMP, INTEGER),
+    BINLOG_BINARY_FIELD(NAMESPACE, STRING),
+    BINLOG_BINARY_FIELD(PARENT, INTEGER),
+    BINLOG_BINARY_FIELD(SUBNAME, STRING),
+    BINLOG_BINARY_FIELD(HASH_CODE, INTEGER),
+    BINLOG_BINARY_FIELD(LINK, STRING),
+    BINLOG_BINARY_FIELD(MODE, INTEGER),
+    BINLOG_BINARY_FIELD(BTIME, INTEGER),
+    BINLOG_BINARY_FIELD(ATIME, INTEGER),
+    BINLOG_BINARY_FIELD(CTIME, INTEGER),
+    BINLOG_BINARY_FIELD(MTIME, INTEGER),
+    BINLOG_BINARY_FIELD(UID, INTEGER),
+    BINLOG_BINARY_FIELD(GID, INTEGER),
+    BINLOG_BINARY_FIELD(FILE_SIZE, INTEGER),
+    BINLOG_BINARY_FIELD(SPACE_END, INTEGER),
+    BINLOG_BINARY_FIELD(INC_ALLOC, INTEGER),
+    BINLOG_BINARY_FIELD(SRC_INODE, INTEGER),
+    BINLOG_BINARY_FIELD(SRC_PARENT, INTEGER),
+    BINLOG_BINARY_FIELD(SRC_SUBNAME, STRING),
+    BINLOG_BINARY_FIELD(FLAGS, INTEGER),
+    BINLOG_BINARY_FIELD(XATTR_NAME, STRING),
+    BINLOG_BINARY_FIELD(XATTR_VALUE, STRING)
+};
+
 typedef struct {
     const char *name;
     int type;
@@ -117,6 +196,7 @@ typedef struct {
     const char *p;
     const char *rec_end;
     BinlogFieldValue fv;
+    bool binary;
     char *error_info;
     int error_size;
 } FieldParserContext;
@@ -228,7 +308,8 @@ static void binlog_pack_stringl(FastBuffer *buffer, const char *name,
     binlog_pack_stringl(buffer, name, value.str, value.len, true)
 
 
-int binlog_pack_record(const FDIRBinlogRecord *record, FastBuffer *buffer)
+static int binlog_pack_record_text(const FDIRBinlogRecord *record,
+        FastBuffer *buffer)
 {
     string_t op_caption;
     int old_len;
@@ -398,6 +479,257 @@ int binlog_pack_record(const FDIRBinlogRecord *record, FastBuffer *buffer)
     return 0;
 }
 
+static inline void binlog_pack_varint(FastBuffer *buffer, uint64_t n)
+{
+    unsigned char *p;
+
+    p = (unsigned char *)buffer->data + buffer->length;
+    while (n >= 0x80) {
+        *p++ = (n & 0x7F) | 0x80;
+        n >>= 7;
+    }
+    *p++ = n;
+    buffer->length = (char *)p - buffer->data;
+}
+
+static inline void binlog_pack_binary_int(FastBuffer *buffer,
+        const int id, const int64_t n)
+{
+    buffer->data[buffer->length++] = id;
+    binlog_pack_varint(buffer, ((uint64_t)n << 1) ^ (uint64_t)(n >> 63));
+}
+
+static inline void binlog_pack_binary_string(FastBuffer *buffer,
+        const int id, const string_t *s)
+{
+    char *escaped;
+    int escape_len;
+
+    buffer->data[buffer->length++] = id;
+    if (s->len == 0) {
+        binlog_pack_varint(buffer, 0);
+        return;
+    }
+
+    /* the escaped length is unknown before escaping, escape after the
+     * reserved length bytes then move to the end of the length */
+    escaped = buffer->data + buffer->length +
+        BINLOG_BINARY_STRING_LENGTH_BYTES;
+    fast_char_escape(&char_converter, s->str, s->len, escaped,
+            &escape_len, buffer->alloc_size - (escaped - buffer->data));
+    binlog_pack_varint(buffer, escape_len);
+    memmove(buffer->data + buffer->length, escaped, escape_len);
+    buffer->length += escape_len;
+}
+
+static int binlog_pack_record_binary(const FDIRBinlogRecord *record,
+        FastBuffer *buffer)
+{
+    int old_len;
+    int expect_len;
+    int record_len;
+    int pad_len;
+    int result;
+
+    //the string is doubled by escaping in the worst case
+    expect_len = 512;
+    if (record->options.path_info.flags != 0) {
+        expect_len += 2 * (record->ns.len + record->me.pname.name.len);
+    }
+    if (record->options.link) {
+        expect_len += 2 * record->link.len;
+    }
+    switch (record->operation) {
+        case BINLOG_OP_RENAME_DENTRY_INT:
+            expect_len += 2 * record->rename.src.pname.name.len;
+            break;
+        case BINLOG_OP_SET_XATTR_INT:
+            expect_len += 2 * (record->xattr.key.len +
+                    record->xattr.value.len);
+            break;
+        case BINLOG_OP_REMOVE_XATTR_INT:
+            expect_len += 2 * record->xattr.key.len;
+            break;
+        default:
+            break;
+    }
+    if ((result=fast_buffer_check_capacity(buffer, expect_len)) != 0) {
+        return result;
+    }
+
+    //reserve record size spaces
+    old_len = buffer->length;
+    buffer->length += BINLOG_RECORD_SIZE_STRLEN;
+
+    fast_buffer_append_buff(buffer, BINLOG_BINARY_START_TAG_STR,
+            BINLOG_RECORD_START_TAG_LEN);
+    buffer->data[buffer->length++] = BINLOG_BINARY_FORMAT_VERSION;
+
+    binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_DATA_VERSION,
+            record->data_version);
+    binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_INODE,
+            record->inode);
+    binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_OPERATION,
+            record->operation);
+    binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_TIMESTAMP,
+            record->timestamp);
+
+    if (record->options.path_info.flags != 0) {
+        if (record->me.pname.parent_inode == 0 &&
+                record->me.pname.name.len > 0)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "subname: %.*s, expect parent inode", __LINE__,
+                    record->me.pname.name.len, record->me.pname.name.str);
+            return EINVAL;
+        }
+
+        binlog_pack_binary_string(buffer, BINLOG_BINARY_FIELD_ID_NAMESPACE,
+                &record->ns);
+        binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_PARENT,
+                record->me.pname.parent_inode);
+        binlog_pack_binary_string(buffer, BINLOG_BINARY_FIELD_ID_SUBNAME,
+                &record->me.pname.name);
+    }
+
+    binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_HASH_CODE,
+            record->hash_code);
+
+    if (record->options.link) {
+        binlog_pack_binary_string(buffer, BINLOG_BINARY_FIELD_ID_LINK,
+                &record->link);
+    }
+    if (record->options.mode) {
+        binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_MODE,
+                record->stat.mode);
+    }
+    if (record->options.btime) {
+        binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_BTIME,
+                record->stat.btime);
+    }
+    if (record->options.atime) {
+        binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_ATIME,
+                record->stat.atime);
+    }
+    if (record->options.ctime) {
+        binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_CTIME,
+                record->stat.ctime);
+    }
+    if (record->options.mtime) {
+        binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_MTIME,
+                record->stat.mtime);
+    }
+    if (record->options.uid) {
+        binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_UID,
+                record->stat.uid);
+    }
+    if (record->options.gid) {
+        binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_GID,
+                record->stat.gid);
+    }
+    if (record->options.size) {
+        binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_FILE_SIZE,
+                record->stat.size);
+    }
+    if (record->options.space_end) {
+        binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_SPACE_END,
+                record->stat.space_end);
+    }
+    if (record->options.inc_alloc) {
+        binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_INC_ALLOC,
+                record->stat.alloc);
+    }
+    if (record->options.src_inode) {
+        binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_SRC_INODE,
+                record->hdlink.src.inode);
+    }
+
+    switch (record->operation) {
+        case BINLOG_OP_RENAME_DENTRY_INT:
+            binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_SRC_PARENT,
+                    record->rename.src.pname.parent_inode);
+            binlog_pack_binary_string(buffer,
+                    BINLOG_BINARY_FIELD_ID_SRC_SUBNAME,
+                    &record->rename.src.pname.name);
+            binlog_pack_binary_int(buffer, BINLOG_BINARY_FIELD_ID_FLAGS,
+                    record->flags);
+            break;
+        case BINLOG_OP_SET_XATTR_INT:
+            binlog_pack_binary_string(buffer,
+                    BINLOG_BINARY_FIELD_ID_XATTR_NAME, &record->xattr.key);
+            binlog_pack_binary_string(buffer,
+                    BINLOG_BINARY_FIELD_ID_XATTR_VALUE, &record->xattr.value);
+            break;
+        case BINLOG_OP_REMOVE_XATTR_INT:
+            binlog_pack_binary_string(buffer,
+                    BINLOG_BINARY_FIELD_ID_XATTR_NAME, &record->xattr.key);
+            break;
+        default:
+            break;
+    }
+
+    buffer->data[buffer->length++] = BINLOG_BINARY_FIELD_ID_END;
+
+    //pad to the min record size for the binlog reader
+    pad_len = BINLOG_RECORD_MIN_SIZE - (buffer->length - old_len +
+            BINLOG_RECORD_END_TAG_LEN);
+    if (pad_len > 0) {
+        memset(buffer->data + buffer->length, 0, pad_len);
+        buffer->length += pad_len;
+    }
+
+    fast_buffer_append_buff(buffer, BINLOG_RECORD_END_TAG_STR,
+            BINLOG_RECORD_END_TAG_LEN);
+
+    record_len = buffer->length - old_len - BINLOG_RECORD_SIZE_STRLEN;
+    if (record_len > BINLOG_RECORD_MAX_SIZE) {
+        logError("file: "__FILE__", line: %d, "
+                "record length: %d is too large, exceeds %d",
+                __LINE__, record_len, BINLOG_RECORD_MAX_SIZE);
+        return EOVERFLOW;
+    }
+
+    sprintf(buffer->data + old_len, BINLOG_RECORD_SIZE_PRINTF_FMT, record_len);
+    *(buffer->data + old_len + BINLOG_RECORD_SIZE_STRLEN) =
+        BINLOG_RECORD_START_TAG_CHAR;  //restore the start char
+    return 0;
+}
+
+int binlog_pack_record_ex(const FDIRBinlogRecord *record,
+        FastBuffer *buffer, const int format)
+{
+    if (format == FDIR_BINLOG_FORMAT_BINARY) {
+        return binlog_pack_record_binary(record, buffer);
+    } else {
+        return binlog_pack_record_text(record, buffer);
+    }
+}
+
+static int binlog_unescape_string_value(FieldParserContext *pcontext)
+{
+    if (memchr(pcontext->fv.value.s.str, '\\',
+                pcontext->fv.value.s.len) != NULL)
+    {
+        if (pcontext->mpool != NULL) {
+            char *unescaped;
+
+            if ((unescaped=fast_mpool_memdup(pcontext->mpool,
+                            pcontext->fv.value.s.str,
+                            pcontext->fv.value.s.len)) == NULL)
+            {
+                sprintf(pcontext->error_info, "alloc %d bytes fail",
+                        pcontext->fv.value.s.len);
+                return ENOMEM;
+            }
+            pcontext->fv.value.s.str = unescaped;
+        }
+        fast_char_unescape(&char_converter, pcontext->fv.value.s.str,
+                &pcontext->fv.value.s.len);
+    }
+
+    return 0;
+}
+
 static int binlog_get_next_field_value(FieldParserContext *pcontext)
 {
     int remain;
@@ -405,6 +737,7 @@ static int binlog_get_next_field_value(FieldParserContext *pcontext)
     const char *value;
     char *endptr;
     int64_t n;
+    int result;
 
     remain = pcontext->rec_end - pcontext->p;
     if (*pcontext->p == '/') {
@@ -454,24 +787,8 @@ static int binlog_get_next_field_value(FieldParserContext *pcontext)
             return EINVAL;
         }
 
-        if (memchr(pcontext->fv.value.s.str, '\\',
-                    pcontext->fv.value.s.len) != NULL)
-        {
-            if (pcontext->mpool != NULL) {
-                char *unescaped;
-
-                if ((unescaped=fast_mpool_memdup(pcontext->mpool,
-                                pcontext->fv.value.s.str,
-                                pcontext->fv.value.s.len)) == NULL)
-                {
-                    sprintf(pcontext->error_info, "alloc %d bytes fail",
-                            pcontext->fv.value.s.len);
-                    return ENOMEM;
-                }
-                pcontext->fv.value.s.str = unescaped;
-            }
-            fast_char_unescape(&char_converter, pcontext->fv.value.s.str,
-                    &pcontext->fv.value.s.len);
+        if ((result=binlog_unescape_string_value(pcontext)) != 0) {
+            return result;
         }
     } else if ((*endptr == ' ') || (*endptr == '/' && pcontext->rec_end -
                 endptr == BINLOG_RECORD_END_TAG_LEN))
@@ -490,6 +807,93 @@ static int binlog_get_next_field_value(FieldParserContext *pcontext)
     return 0;
 }
 
+static inline int binlog_unpack_varint(FieldParserContext *pcontext,
+        const char *end, uint64_t *n)
+{
+    unsigned char ch;
+    int shift;
+
+    *n = 0;
+    shift = 0;
+    while (pcontext->p < end && shift < 64) {
+        ch = *pcontext->p++;
+        *n |= (uint64_t)(ch & 0x7F) << shift;
+        if ((ch & 0x80) == 0) {
+            return 0;
+        }
+        shift += 7;
+    }
+
+    sprintf(pcontext->error_info, "invalid varint value");
+    return EINVAL;
+}
+
+static int binlog_get_next_binary_field_value(FieldParserContext *pcontext)
+{
+    const char *fields_end;
+    unsigned char id;
+    uint64_t n;
+    int result;
+
+    fields_end = pcontext->rec_end - BINLOG_RECORD_END_TAG_LEN;
+    if (pcontext->p >= fields_end) {
+        sprintf(pcontext->error_info, "expect field id, "
+                "but reach the end of record");
+        return EINVAL;
+    }
+
+    id = *pcontext->p++;
+    if (id == BINLOG_BINARY_FIELD_ID_END) {
+        pcontext->p = pcontext->rec_end;  //skip the padding and end tag
+        return ENOENT;
+    }
+    if (id >= BINLOG_BINARY_FIELD_COUNT) {
+        sprintf(pcontext->error_info, "unkown field id: %d", id);
+        return EINVAL;
+    }
+
+    pcontext->fv.name = binary_fields[id].name;
+    if ((result=binlog_unpack_varint(pcontext, fields_end, &n)) != 0) {
+        return result;
+    }
+
+    if (binary_fields[id].type == BINLOG_FIELD_TYPE_STRING) {
+        if (n > fields_end - pcontext->p) {
+            sprintf(pcontext->error_info, "field: %.*s, value length: "
+                    "%"PRId64" out of bound", BINLOG_RECORD_FIELD_NAME_LENGTH,
+                    pcontext->fv.name, (int64_t)n);
+            return EINVAL;
+        }
+
+        pcontext->fv.type = BINLOG_FIELD_TYPE_STRING;
+        FC_SET_STRING_EX(pcontext->fv.value.s, (char *)pcontext->p, n);
+        pcontext->p += n;
+        if ((result=binlog_unescape_string_value(pcontext)) != 0) {
+            return result;
+        }
+    } else {
+        pcontext->fv.value.n = (int64_t)(n >> 1) ^ -(int64_t)(n & 1);
+        if (id == BINLOG_BINARY_FIELD_ID_OPERATION) {
+            pcontext->fv.type = BINLOG_FIELD_TYPE_STRING;
+            FC_SET_STRING(pcontext->fv.value.s, (char *)
+                    get_operation_label(pcontext->fv.value.n));
+        } else {
+            pcontext->fv.type = BINLOG_FIELD_TYPE_INTEGER;
+        }
+    }
+
+    return 0;
+}
+
+static inline int binlog_next_field_value(FieldParserContext *pcontext)
+{
+    if (pcontext->binary) {
+        return binlog_get_next_binary_field_value(pcontext);
+    } else {
+        return binlog_get_next_field_value(pcontext);
+    }
+}
+
 static inline const char *get_field_type_caption(const int type)
 {
     switch (type) {
@@ -781,7 +1185,7 @@ static int binlog_parse_first_field(FieldParserContext *pcontext,
 {
     int result;
 
-    if ((result=binlog_get_next_field_value(pcontext)) != 0) {
+    if ((result=binlog_next_field_value(pcontext)) != 0) {
         return result;
     }
 
@@ -805,7 +1209,7 @@ static int binlog_parse_fields(FieldParserContext *pcontext,
         return result;
     }
 
-    while ((result=binlog_get_next_field_value(pcontext)) == 0) {
+    while ((result=binlog_next_field_value(pcontext)) == 0) {
         if ((result=binlog_set_field_value(pcontext, record)) != 0) {
             if (result == ENOENT) {
                 logWarning("file: "__FILE__", line: %d, "
@@ -834,6 +1238,30 @@ static inline int binlog_check_rec_length(const int len,
     return 0;
 }
 
+static inline bool binlog_parse_start_tag(const char *rec_start,
+        FieldParserContext *pcontext)
+{
+    if (memcmp(rec_start, BINLOG_RECORD_START_TAG_STR,
+                BINLOG_RECORD_START_TAG_LEN) == 0)
+    {
+        pcontext->binary = false;
+        pcontext->p = rec_start + BINLOG_RECORD_START_TAG_LEN;
+        return true;
+    }
+
+    if (memcmp(rec_start, BINLOG_BINARY_START_TAG_STR,
+                BINLOG_RECORD_START_TAG_LEN) == 0 &&
+            *(rec_start + BINLOG_RECORD_START_TAG_LEN) ==
+            BINLOG_BINARY_FORMAT_VERSION)
+    {
+        pcontext->binary = true;
+        pcontext->p = rec_start + BINLOG_RECORD_START_TAG_LEN + 1;
+        return true;
+    }
+
+    return false;
+}
+
 static int binlog_check_record(const char *str, const int len,
         FieldParserContext *pcontext)
 {
@@ -855,12 +1283,11 @@ static int binlog_check_record(const char *str, const int len,
         return EINVAL;
     }
 
-    if (memcmp(rec_start, BINLOG_RECORD_START_TAG_STR,
-                BINLOG_RECORD_START_TAG_LEN) != 0)
-    {
-        sprintf(pcontext->error_info, "expect record start tag: %s, "
-                "but the start string is: %.*s",
-                BINLOG_RECORD_START_TAG_STR,
+    if (!binlog_parse_start_tag(rec_start, pcontext)) {
+        sprintf(pcontext->error_info, "expect record start tag: %s or "
+                "%s with version %d, but the start string is: %.*s",
+                BINLOG_RECORD_START_TAG_STR, BINLOG_BINARY_START_TAG_STR,
+                BINLOG_BINARY_FORMAT_VERSION,
                 (int)BINLOG_RECORD_START_TAG_LEN, rec_start);
         return EINVAL;
     }
@@ -895,7 +1322,6 @@ static int binlog_check_record(const char *str, const int len,
         return EINVAL;
     }
 
-    pcontext->p = rec_start + BINLOG_RECORD_START_TAG_LEN;
     return 0;
 }
 
@@ -972,21 +1398,17 @@ static bool binlog_is_record_start(const char *str, const int len,
         return false;
     }
 
-    if (memcmp(rec_start, BINLOG_RECORD_START_TAG_STR,
-                BINLOG_RECORD_START_TAG_LEN) != 0)
-    {
+    if (record_len < BINLOG_RECORD_MIN_SIZE - BINLOG_RECORD_SIZE_STRLEN) {
         return false;
     }
 
-    pcontext->rec_end = str + BINLOG_RECORD_SIZE_STRLEN + record_len;
-    if (memcmp(pcontext->rec_end - BINLOG_RECORD_END_TAG_LEN,
-                BINLOG_RECORD_END_TAG_STR,
-                BINLOG_RECORD_END_TAG_LEN) == 0)
-    {
-        pcontext->p = rec_start + BINLOG_RECORD_START_TAG_LEN;
-        return true;
+    if (!binlog_parse_start_tag(rec_start, pcontext)) {
+        return false;
     }
-    return false;
+
+    pcontext->rec_end = str + BINLOG_RECORD_SIZE_STRLEN + record_len;
+    return memcmp(pcontext->rec_end - BINLOG_RECORD_END_TAG_LEN,
+            BINLOG_RECORD_END_TAG_STR, BINLOG_RECORD_END_TAG_LEN) == 0;
 }
 
 int binlog_detect_record_forward(const char *str, const int len,
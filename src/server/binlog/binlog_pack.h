@@ -32,7 +32,14 @@ extern "C" {
 
 int binlog_pack_init();
 
-int binlog_pack_record(const FDIRBinlogRecord *record, FastBuffer *buffer);
+/* format: FDIR_BINLOG_FORMAT_TEXT or FDIR_BINLOG_FORMAT_BINARY,
+ * the unpack and detect functions accept both formats
+ */
+int binlog_pack_record_ex(const FDIRBinlogRecord *record,
+        FastBuffer *buffer, const int format);
+
+#define binlog_pack_record(record, buffer) \
+    binlog_pack_record_ex(record, buffer, BINLOG_FORMAT)
 
 int binlog_unpack_record_ex(const char *str, const int len,
         FDIRBinlogRecord *record, const char **record_end,
@@ -25,12 +25,14 @@
 #include <limits.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <sys/time.h>
 #include "fastcommon/logger.h"
 #include "fastcommon/sockopt.h"
 #include "fastcommon/shared_func.h"
 #include "fastcommon/pthread_func.h"
 #include "sf/sf_global.h"
 #include "../server_global.h"
+#include "../server_func.h"
 #include "binlog_reader.h"
 #include "binlog_local_consumer.h"
 #include "binlog_producer.h"
@@ -53,6 +55,14 @@ typedef struct binlog_producer_context {
 
     ProducerRecordBufferQueue queue;
 
+    struct {
+        ServerBinlogRecordBuffer *head;
+        ServerBinlogRecordBuffer *tail;
+        int count;
+        int bytes;
+        int64_t start_time_ms;
+    } group;  //for group commit
+
     struct fast_mblock_man rb_allocator;
     int rb_init_capacity;
 } BinlogProducerContext;
@@ -187,6 +197,7 @@ ServerBinlogRecordBuffer *server_binlog_alloc_hold_rbuffer()
     old_value = 0;  //for hint
     FC_ATOMIC_CAS(rbuffer->reffer_count, old_value, 1);
     rbuffer->buffer.length = 0;
+    rbuffer->members = NULL;
     return rbuffer;
 }
 
@@ -269,10 +280,95 @@ static void repush_to_queue(ServerBinlogRecordBuffer *rb)
     PTHREAD_MUTEX_UNLOCK(&proceduer_ctx.queue.lock);
 }
 
+static void push_members_to_consumer_queues(ServerBinlogRecordBuffer *head)
+{
+    ServerBinlogRecordBuffer *rb;
+
+    while (head != NULL) {
+        rb = head;
+        head = head->next;
+        binlog_local_consumer_push_to_queues(rb);
+    }
+}
+
+static void group_commit_flush()
+{
+    ServerBinlogRecordBuffer *group;
+    ServerBinlogRecordBuffer *rb;
+    int result;
+
+    if (proceduer_ctx.group.count == 0) {
+        return;
+    }
+
+    if (proceduer_ctx.group.count == 1) {
+        binlog_local_consumer_push_to_queues(proceduer_ctx.group.head);
+    } else if ((group=server_binlog_alloc_hold_rbuffer()) == NULL) {
+        push_members_to_consumer_queues(proceduer_ctx.group.head);
+    } else {
+        result = 0;
+        rb = proceduer_ctx.group.head;
+        while (rb != NULL) {
+            if ((result=fast_buffer_append_buff(&group->buffer,
+                            rb->buffer.data, rb->buffer.length)) != 0)
+            {
+                break;
+            }
+            rb = rb->next;
+        }
+
+        if (result == 0) {
+            group->data_version.first = proceduer_ctx.
+                group.head->data_version.first;
+            group->data_version.last = proceduer_ctx.
+                group.tail->data_version.last;
+            group->args = NULL;
+            group->members = proceduer_ctx.group.head;
+            binlog_local_consumer_push_to_queues(group);
+        } else {
+            push_members_to_consumer_queues(proceduer_ctx.group.head);
+        }
+        server_binlog_release_rbuffer(group);
+    }
+
+    proceduer_ctx.group.head = proceduer_ctx.group.tail = NULL;
+    proceduer_ctx.group.count = 0;
+    proceduer_ctx.group.bytes = 0;
+}
+
+static void group_commit_add(ServerBinlogRecordBuffer *rb)
+{
+    if (BINLOG_GROUP_COMMIT_BYTES == 0) {
+        binlog_local_consumer_push_to_queues(rb);
+        return;
+    }
+
+    if (proceduer_ctx.group.count > 0 && proceduer_ctx.group.bytes +
+            rb->buffer.length > BINLOG_GROUP_COMMIT_BYTES)
+    {
+        group_commit_flush();
+    }
+
+    rb->next = NULL;
+    if (proceduer_ctx.group.count == 0) {
+        proceduer_ctx.group.head = rb;
+        proceduer_ctx.group.start_time_ms = get_current_time_ms();
+    } else {
+        proceduer_ctx.group.tail->next = rb;
+    }
+    proceduer_ctx.group.tail = rb;
+    proceduer_ctx.group.count++;
+    proceduer_ctx.group.bytes += rb->buffer.length;
+
+    if (proceduer_ctx.group.bytes >= BINLOG_GROUP_COMMIT_BYTES) {
+        group_commit_flush();
+    }
+}
+
 #define PUSH_TO_CONSUMER_QUEQUES(rb, version_count) \
     do { \
-        binlog_local_consumer_push_to_queues(rb); \
-        next_data_version += version_count;       \
+        group_commit_add(rb);               \
+        next_data_version += version_count; \
     } while (0)
 
 #define GET_RBUFFER_VERSION_COUNT(rb)  \
@@ -368,6 +464,7 @@ static void deal_queue()
 {
     ServerBinlogRecordBuffer *rb;
     ServerBinlogRecordBuffer *head;
+    int64_t remain_ms;
     static int max_ring_count = 0;
 
     if (proceduer_ctx.ring.count > max_ring_count) {
@@ -377,8 +474,17 @@ static void deal_queue()
 
     PTHREAD_MUTEX_LOCK(&proceduer_ctx.queue.lock);
     if (proceduer_ctx.queue.head == NULL) {
-        pthread_cond_wait(&proceduer_ctx.queue.cond,
-                &proceduer_ctx.queue.lock);
+        if (proceduer_ctx.group.count == 0) {
+            pthread_cond_wait(&proceduer_ctx.queue.cond,
+                    &proceduer_ctx.queue.lock);
+        } else {
+            remain_ms = proceduer_ctx.group.start_time_ms +
+                BINLOG_GROUP_COMMIT_WAIT_MS - get_current_time_ms();
+            if (remain_ms > 0) {
+                server_cond_timedwait_ms(&proceduer_ctx.queue.cond,
+                        &proceduer_ctx.queue.lock, remain_ms);
+            }
+        }
     }
 
     head = proceduer_ctx.queue.head;
@@ -386,6 +492,7 @@ static void deal_queue()
     PTHREAD_MUTEX_UNLOCK(&proceduer_ctx.queue.lock);
 
     if (head == NULL) {
+        group_commit_flush();
         return;
     }
 
@@ -395,6 +502,13 @@ static void deal_queue()
 
         deal_record(rb);
     }
+
+    if (proceduer_ctx.group.count > 0 && (BINLOG_GROUP_COMMIT_WAIT_MS == 0 ||
+                get_current_time_ms() - proceduer_ctx.group.start_time_ms >=
+                BINLOG_GROUP_COMMIT_WAIT_MS))
+    {
+        group_commit_flush();
+    }
 }
 
 static void *producer_thread_func(void *arg)
@@ -416,6 +530,7 @@ static void *producer_thread_func(void *arg)
     while (SF_G_CONTINUE_FLAG && CLUSTER_MYSELF_PTR == CLUSTER_MASTER_PTR) {
         deal_queue();
     }
+    group_commit_flush();
     FC_ATOMIC_SET(running, 0);
 
     logDebug("file: "__FILE__", line: %d, "
@@ -35,6 +35,7 @@
 #include "binlog_producer.h"
 #include "binlog_write.h"
 #include "binlog_pack.h"
+#include "binlog_index.h"
 #include "binlog_reader.h"
 
 static int open_readable_binlog(ServerBinlogReader *reader)
@@ -322,7 +323,12 @@ static int find_data_version(ServerBinlogReader *reader,
     char *rec_end;
     char error_info[SF_ERROR_INFO_SIZE];
 
-    reader->position.offset = 0;
+    //skip to the indexed record before the data version
+    if (binlog_index_find_offset(reader->position.index, last_data_version,
+                &reader->position.offset) != 0)
+    {
+        reader->position.offset = 0;
+    }
     if ((result=open_readable_binlog(reader)) != 0) {
         return result;
     }
@@ -714,11 +720,24 @@ int binlog_unpack_records(const string_t *buffer,
     char *rec_end;
     char error_info[SF_ERROR_INFO_SIZE];
     FDIRBinlogRecord *record;
+    int64_t data_version;
+    int rstart_offset;
+    int rend_offset;
 
     *count = 0;
     record = records;
     p = buffer->str;
     end = buffer->str + buffer->len;
+
+    /* the buffer is split by new line and the binary record
+       maybe contains the new line char, so skip the partial record */
+    if (binlog_detect_record_forward(p, end - p, &data_version,
+                &rstart_offset, &rend_offset, error_info,
+                sizeof(error_info)) == 0)
+    {
+        p += rstart_offset;
+    }
+
     while (p < end) {
         if ((result=binlog_unpack_record(p, end - p,
                         record++, (const char **)&rec_end,
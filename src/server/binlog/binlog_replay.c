@@ -32,10 +32,19 @@
 #include "sf/sf_global.h"
 #include "../server_global.h"
 #include "../data_thread.h"
+#include "../version_waiter.h"
 #include "binlog_pack.h"
 #include "binlog_reader.h"
 #include "binlog_replay.h"
 
+//the record batches pushed to the data threads and not done
+static volatile int inflight_batches = 0;
+
+int binlog_replay_inflight_batches()
+{
+    return __sync_add_and_fetch(&inflight_batches, 0);
+}
+
 static void data_thread_deal_done_callback(
         struct fdir_binlog_record *record,
         const int result, const bool is_error)
@@ -97,6 +106,8 @@ int binlog_replay_init_ex(BinlogReplayContext *replay_ctx,
     replay_ctx->notify.args = args;
     replay_ctx->data_current_version = __sync_add_and_fetch(
             &DATA_CURRENT_VERSION, 0);
+    //no batch in flight, the data versions are continuous
+    version_waiter_set_applied(replay_ctx->data_current_version);
     replay_ctx->record_array.size = batch_size * DATA_THREAD_COUNT;
     bytes = sizeof(FDIRBinlogRecord) * replay_ctx->record_array.size;
     replay_ctx->record_array.records = (FDIRBinlogRecord *)fc_malloc(bytes);
@@ -199,6 +210,7 @@ int binlog_replay_deal_buffer(BinlogReplayContext *replay_ctx,
         }
 
         rec_end = record;
+        __sync_add_and_fetch(&inflight_batches, 1);
         PTHREAD_MUTEX_LOCK(&replay_ctx->lcp.lock);
         replay_ctx->waiting_count = rec_end -
             replay_ctx->record_array.records;
@@ -222,10 +234,14 @@ int binlog_replay_deal_buffer(BinlogReplayContext *replay_ctx,
                     &replay_ctx->lcp.lock);
         }
         PTHREAD_MUTEX_UNLOCK(&replay_ctx->lcp.lock);
+        __sync_sub_and_fetch(&inflight_batches, 1);
 
         if (replay_ctx->fail_count > 0) {
             return replay_ctx->last_errno;
         }
+
+        //all the records of the batch are applied
+        version_waiter_set_applied(replay_ctx->data_current_version);
     }
 
     /*
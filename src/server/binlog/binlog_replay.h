@@ -62,6 +62,10 @@ int binlog_replay_deal_buffer(BinlogReplayContext *replay_ctx,
          const char *buff, const int len,
          SFBinlogFilePosition *binlog_position);
 
+/* the record batches which are dealing by the data threads,
+ * the applied data versions are continuous when it is 0 */
+int binlog_replay_inflight_batches();
+
 #ifdef __cplusplus
 }
 #endif
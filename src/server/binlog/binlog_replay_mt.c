@@ -25,6 +25,7 @@
 #include <limits.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
 #include "fastcommon/logger.h"
 #include "fastcommon/sockopt.h"
 #include "fastcommon/shared_func.h"
@@ -293,14 +294,48 @@ void binlog_replay_mt_destroy(BinlogReplayMTContext *ctx)
         free(bctx->records);
         free(bctx->counters);
     }
+
+    if (ctx->shard.entries != NULL) {
+        free(ctx->shard.entries);
+        ctx->shard.entries = NULL;
+    }
+}
+
+static int init_shard_context(BinlogReplayMTContext *replay_ctx)
+{
+    int bytes;
+
+    replay_ctx->shard.capacity = 256 * 1024;
+    bytes = sizeof(BinlogReplayInodeEntry) * replay_ctx->shard.capacity;
+    replay_ctx->shard.entries = (BinlogReplayInodeEntry *)fc_malloc(bytes);
+    if (replay_ctx->shard.entries == NULL) {
+        return ENOMEM;
+    }
+    memset(replay_ctx->shard.entries, 0, bytes);
+
+    replay_ctx->shard.count = 0;
+    replay_ctx->shard.generation = 1;
+    replay_ctx->shard.barrier_pending = false;
+    return 0;
 }
 
-int binlog_replay_mt_init(BinlogReplayMTContext *replay_ctx,
-        BinlogReadThreadContext *read_thread_ctx, const int parse_threads)
+int binlog_replay_mt_init_ex(BinlogReplayMTContext *replay_ctx,
+        BinlogReadThreadContext *read_thread_ctx, const int parse_threads,
+        const bool shard_dispatch)
 {
     int result;
 
+    replay_ctx->shard.enabled = shard_dispatch;
+    replay_ctx->shard.entries = NULL;
+    replay_ctx->shard.barrier_count = 0;
+    if (shard_dispatch) {
+        if ((result=init_shard_context(replay_ctx)) != 0) {
+            return result;
+        }
+    }
+
     replay_ctx->record_count = 0;
+    replay_ctx->dispatch_count = 0;
     replay_ctx->skip_count = 0;
     replay_ctx->warning_count = 0;
     replay_ctx->fail_count = 0;
@@ -319,6 +354,123 @@ int binlog_replay_mt_init(BinlogReplayMTContext *replay_ctx,
     return 0;
 }
 
+/* wait for all dispatched records done, the result buffers keep held */
+static void replay_shard_barrier(BinlogReplayMTContext *replay_ctx)
+{
+    BinlogBatchContext *bctx;
+    BinlogBatchContext *bend;
+    DataThreadCounter *counter;
+    DataThreadCounter *end;
+
+    bend = replay_ctx->record_allocator.bcontexts +
+        BINLOG_REPLAY_DOUBLE_BUFFER_COUNT;
+    for (bctx=replay_ctx->record_allocator.bcontexts; bctx<bend; bctx++) {
+        end = bctx->counters + DATA_THREAD_COUNT;
+        for (counter=bctx->counters; counter<end; counter++) {
+            while ((FC_ATOMIC_GET(counter->done) < FC_ATOMIC_GET(
+                            counter->total)) && SF_G_CONTINUE_FLAG)
+            {
+                sched_yield();
+            }
+        }
+    }
+
+    replay_ctx->shard.generation++;
+    replay_ctx->shard.count = 0;
+    replay_ctx->shard.barrier_pending = false;
+    replay_ctx->shard.barrier_count++;
+}
+
+static BinlogReplayInodeEntry *replay_shard_find(
+        BinlogReplayMTContext *replay_ctx, const int64_t inode)
+{
+    BinlogReplayInodeEntry *entry;
+    unsigned int index;
+
+    index = (unsigned int)(((uint64_t)inode * 0x9E3779B97F4A7C15ULL) >>
+            32) & (replay_ctx->shard.capacity - 1);
+    while (1) {
+        entry = replay_ctx->shard.entries + index;
+        if (entry->generation != replay_ctx->shard.generation ||
+                entry->inode == inode)
+        {
+            return entry;
+        }
+        index = (index + 1) & (replay_ctx->shard.capacity - 1);
+    }
+}
+
+static int replay_shard_get_inodes(const FDIRBinlogRecord *record,
+        int64_t *inodes)
+{
+    int count;
+
+    count = 0;
+    if (record->inode > 0) {
+        inodes[count++] = record->inode;
+    }
+    if (record->dentry_type == fdir_dentry_type_pname &&
+            record->me.pname.parent_inode > 0)
+    {
+        inodes[count++] = record->me.pname.parent_inode;
+    }
+    if (record->operation == BINLOG_OP_CREATE_DENTRY_INT &&
+            FDIR_IS_DENTRY_HARD_LINK(record->stat.mode) &&
+            record->hdlink.src.inode > 0)
+    {
+        inodes[count++] = record->hdlink.src.inode;
+    }
+    return count;
+}
+
+/* set the data thread index of the record by the subtree shard,
+ * the order of the records which refer to the same inode is kept */
+static void replay_shard_dispatch(BinlogReplayMTContext *replay_ctx,
+        FDIRBinlogRecord *record)
+{
+    BinlogReplayInodeEntry *entry;
+    int64_t inodes[3];
+    int count;
+    int i;
+
+    record->extra.data_thread_index = data_thread_get_index(record);
+    if (record->dentry_type == fdir_dentry_type_fullname ||
+            data_thread_get_shard_inode(record) <= 0)
+    {
+        //cross shards: replay alone
+        replay_shard_barrier(replay_ctx);
+        replay_ctx->shard.barrier_pending = true;
+        return;
+    }
+
+    if (replay_ctx->shard.barrier_pending || replay_ctx->shard.
+            count >= replay_ctx->shard.capacity / 2)
+    {
+        replay_shard_barrier(replay_ctx);
+    }
+
+    count = replay_shard_get_inodes(record, inodes);
+    for (i=0; i<count; i++) {
+        entry = replay_shard_find(replay_ctx, inodes[i]);
+        if (entry->generation == replay_ctx->shard.generation &&
+                entry->thread_index != record->extra.data_thread_index)
+        {
+            replay_shard_barrier(replay_ctx);
+            break;
+        }
+    }
+
+    for (i=0; i<count; i++) {
+        entry = replay_shard_find(replay_ctx, inodes[i]);
+        if (entry->generation != replay_ctx->shard.generation) {
+            entry->inode = inodes[i];
+            entry->generation = replay_ctx->shard.generation;
+            replay_ctx->shard.count++;
+        }
+        entry->thread_index = record->extra.data_thread_index;
+    }
+}
+
 static void waiting_and_process_parse_result(BinlogReplayMTContext
         *replay_ctx, BinlogParseThreadContext *parse_thread)
 {
@@ -342,18 +494,28 @@ static void waiting_and_process_parse_result(BinlogReplayMTContext
         record = current;
         current = current->next;
 
-        set_data_thread_index(record);
-        counter = replay_ctx->record_allocator.bcontexts[record->extra.
-            arr_index].counters + record->extra.data_thread_index;
-        counter->total++;
-
+        replay_ctx->dispatch_count++;
         if (record->data_version <= replay_ctx->data_current_version) {
+            set_data_thread_index(record);
+            counter = replay_ctx->record_allocator.bcontexts[record->
+                extra.arr_index].counters + record->extra.data_thread_index;
+            counter->total++;
             replay_ctx->skip_count++;
             FC_ATOMIC_INC(counter->done);
+            continue;
+        }
+
+        if (replay_ctx->shard.enabled) {
+            replay_shard_dispatch(replay_ctx, record);
         } else {
-            replay_ctx->data_current_version = record->data_version;
-            push_to_data_thread_queue(record);
+            set_data_thread_index(record);
         }
+        counter = replay_ctx->record_allocator.bcontexts[record->extra.
+            arr_index].counters + record->extra.data_thread_index;
+        counter->total++;
+
+        replay_ctx->data_current_version = record->data_version;
+        push_to_data_thread_queue(record);
     }
 
     parse_thread->records.head = parse_thread->records.tail = NULL;
@@ -401,8 +563,10 @@ static void waiting_data_thread_done(BinlogReplayMTContext *replay_ctx,
 
     for (i=0; i<replay_ctx->parse_thread_array.count; i++) {
         if (bctx->results[i] != NULL) {
-            binlog_read_thread_return_result_buffer(replay_ctx->
-                    read_thread_ctx, bctx->results[i]);
+            if (replay_ctx->read_thread_ctx != NULL) {
+                binlog_read_thread_return_result_buffer(replay_ctx->
+                        read_thread_ctx, bctx->results[i]);
+            }
             bctx->results[i] = NULL;
         }
     }
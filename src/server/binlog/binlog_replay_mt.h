@@ -54,6 +54,12 @@ typedef struct binlog_parse_thread_context {
     struct binlog_replay_mt_context *replay_ctx;
 } BinlogParseThreadContext;
 
+typedef struct binlog_replay_inode_entry {
+    int64_t inode;
+    int64_t generation;
+    int thread_index;
+} BinlogReplayInodeEntry;
+
 typedef struct binlog_parse_thread_ctx_array {
     BinlogParseThreadContext *contexts;
     int count;
@@ -73,7 +79,21 @@ typedef struct binlog_replay_mt_context {
     volatile bool parse_continue_flag;
     BinlogParseThreadCtxArray parse_thread_array;
 
+    /* replay the records of independent subtrees in parallel,
+       the records which refer to the inodes dispatched to another
+       data thread must wait for the data threads done */
+    struct {
+        bool enabled;
+        bool barrier_pending;  //after the record across shards
+        int count;
+        int capacity;  //power of 2
+        int64_t generation;
+        int64_t barrier_count;
+        BinlogReplayInodeEntry *entries;
+    } shard;
+
     int64_t data_current_version;
+    int64_t dispatch_count;
     int last_errno;
     int64_t record_count;
     int64_t skip_count;
@@ -85,8 +105,14 @@ typedef struct binlog_replay_mt_context {
 extern "C" {
 #endif
 
-int binlog_replay_mt_init(BinlogReplayMTContext *replay_ctx,
-        BinlogReadThreadContext *read_thread_ctx, const int parse_threads);
+#define binlog_replay_mt_init(replay_ctx, read_thread_ctx, parse_threads) \
+    binlog_replay_mt_init_ex(replay_ctx, read_thread_ctx, parse_threads, false)
+
+/* read_thread_ctx: NULL for the buffers owned by the caller,
+ * the buffer of the result must be kept until read done */
+int binlog_replay_mt_init_ex(BinlogReplayMTContext *replay_ctx,
+        BinlogReadThreadContext *read_thread_ctx, const int parse_threads,
+        const bool shard_dispatch);
 
 void binlog_replay_mt_destroy(BinlogReplayMTContext *replay_ctx);
 
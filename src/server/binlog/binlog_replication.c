@@ -155,10 +155,12 @@ int binlog_replication_bind_thread(FDIRSlaveReplication *replication)
         replication->index % CLUSTER_SF_CTX.work_threads;
 
     set_replication_stage(replication, FDIR_REPLICATION_STAGE_NONE);
-    replication->context.last_data_versions.by_disk.previous = 0;
     replication->context.last_data_versions.by_disk.current = 0;
+    replication->context.last_data_versions.by_disk.window.head = 0;
+    replication->context.last_data_versions.by_disk.window.count = 0;
     replication->context.last_data_versions.by_queue = 0;
     replication->context.last_data_versions.by_resp = 0;
+    replication->context.credits = 0;
 
     replication->context.sync_by_disk_stat.start_time_ms = 0;
     replication->context.sync_by_disk_stat.binlog_size = 0;
@@ -299,13 +301,21 @@ static int check_and_make_replica_connection(FDIRSlaveReplication *replication)
 static int send_join_slave_package(FDIRSlaveReplication *replication)
 {
 	int result;
+    int out_bytes;
 	FDIRProtoHeader *header;
     FDIRProtoJoinSlaveReq *req;
-	char out_buff[sizeof(FDIRProtoHeader) + sizeof(FDIRProtoJoinSlaveReq)];
-
-    header = (FDIRProtoHeader *)out_buff;
-    SF_PROTO_SET_HEADER(header, FDIR_REPLICA_PROTO_JOIN_SLAVE_REQ,
-            sizeof(out_buff) - sizeof(FDIRProtoHeader));
+    FDIRProtoJoinSlaveReqExtra *extra;
+	char out_buff[sizeof(FDIRProtoHeader) + sizeof(FDIRProtoJoinSlaveReq) +
+        sizeof(FDIRProtoJoinSlaveReqExtra)];
+
+    /* the old slave rejects the extra part, so the next join after the
+       rejection goes without it and the binlog is pushed without credits */
+    if (replication->join.rejected) {
+        replication->join.rejected = false;
+        replication->join.flags = 0;
+    } else {
+        replication->join.flags = FDIR_REPLICA_JOIN_FLAGS_CREDITS;
+    }
 
     req = (FDIRProtoJoinSlaveReq *)(out_buff + sizeof(FDIRProtoHeader));
     int2buff(CLUSTER_ID, req->cluster_id);
@@ -313,8 +323,20 @@ static int send_join_slave_package(FDIRSlaveReplication *replication)
     int2buff(replication->task->size, req->buffer_size);
     memcpy(req->key, replication->slave->key, FDIR_REPLICA_KEY_SIZE);
 
+    out_bytes = sizeof(FDIRProtoHeader) + sizeof(FDIRProtoJoinSlaveReq);
+    if (replication->join.flags != 0) {
+        extra = (FDIRProtoJoinSlaveReqExtra *)(req + 1);
+        int2buff(replication->join.flags, extra->flags);
+        memset(extra->padding, 0, sizeof(extra->padding));
+        out_bytes += sizeof(FDIRProtoJoinSlaveReqExtra);
+    }
+
+    header = (FDIRProtoHeader *)out_buff;
+    SF_PROTO_SET_HEADER(header, FDIR_REPLICA_PROTO_JOIN_SLAVE_REQ,
+            out_bytes - sizeof(FDIRProtoHeader));
+
     if ((result=tcpsenddata_nb(replication->connection_info.conn.sock,
-                    out_buff, sizeof(out_buff), SF_G_NETWORK_TIMEOUT)) != 0)
+                    out_buff, out_bytes, SF_G_NETWORK_TIMEOUT)) != 0)
     {
         logError("file: "__FILE__", line: %d, "
                 "send data to server %s:%u fail, "
@@ -329,10 +351,8 @@ static int send_join_slave_package(FDIRSlaveReplication *replication)
     return result;
 }
 
-static void decrease_task_waiting_rpc_count(ServerBinlogRecordBuffer *rb)
+static inline void decrease_waiting_rpc_count(struct fast_task_info *task)
 {
-    struct fast_task_info *task;
-    task = (struct fast_task_info *)rb->args;
     if (__sync_sub_and_fetch(&((FDIRServerTaskArg *)task->arg)->
                 context.service.waiting_rpc_count, 1) == 0)
     {
@@ -340,6 +360,25 @@ static void decrease_task_waiting_rpc_count(ServerBinlogRecordBuffer *rb)
     }
 }
 
+static void decrease_task_waiting_rpc_count(ServerBinlogRecordBuffer *rb)
+{
+    ServerBinlogRecordBuffer *member;
+    ServerBinlogRecordBuffer *next;
+
+    if (rb->members == NULL) {
+        decrease_waiting_rpc_count((struct fast_task_info *)rb->args);
+        return;
+    }
+
+    /* the member maybe released after the task notified */
+    member = rb->members;
+    while (member != NULL) {
+        next = member->next;
+        decrease_waiting_rpc_count((struct fast_task_info *)member->args);
+        member = next;
+    }
+}
+
 static void discard_queue(FDIRSlaveReplication *replication,
         ServerBinlogRecordBuffer *head, ServerBinlogRecordBuffer *tail)
 {
@@ -524,12 +563,38 @@ static void repush_to_replication_queue(FDIRSlaveReplication *replication,
     PTHREAD_MUTEX_UNLOCK(&replication->context.queue.lock);
 }
 
+static int push_to_result_ring(FDIRSlaveReplication *replication,
+        ServerBinlogRecordBuffer *rb)
+{
+    ServerBinlogRecordBuffer *member;
+    ServerBinlogRecordBuffer *next;
+    int result;
+
+    if (rb->members == NULL) {
+        return push_result_ring_add(&replication->context.push_result_ctx,
+                &rb->data_version, (struct fast_task_info *)rb->args);
+    }
+
+    member = rb->members;
+    while (member != NULL) {
+        next = member->next;
+        if ((result=push_result_ring_add(&replication->context.
+                        push_result_ctx, &member->data_version,
+                        (struct fast_task_info *)member->args)) != 0)
+        {
+            return result;
+        }
+        member = next;
+    }
+
+    return 0;
+}
+
 static int sync_binlog_from_queue(FDIRSlaveReplication *replication)
 {
     ServerBinlogRecordBuffer *rb;
     ServerBinlogRecordBuffer *head;
     ServerBinlogRecordBuffer *tail;
-    struct fast_task_info *waiting_task;
     FDIRProtoPushBinlogReqBodyHeader *body_header;
     SFVersionRange data_version;
     int body_len;
@@ -553,8 +618,6 @@ static int sync_binlog_from_queue(FDIRSlaveReplication *replication)
         sizeof(FDIRProtoPushBinlogReqBodyHeader);
     while (head != NULL) {
         rb = head;
-
-        waiting_task = (struct fast_task_info *)rb->args;
         if (replication->task->length + rb->buffer.length >
                 replication->task->size)
         {
@@ -568,10 +631,7 @@ static int sync_binlog_from_queue(FDIRSlaveReplication *replication)
                 rb->buffer.data, rb->buffer.length);
         replication->task->length += rb->buffer.length;
 
-        if ((result=push_result_ring_add(&replication->context.
-                        push_result_ctx, &rb->data_version,
-                        waiting_task)) != 0)
-        {
+        if ((result=push_to_result_ring(replication, rb)) != 0) {
             sf_terminate_myself();
             return result;
         }
@@ -580,6 +640,21 @@ static int sync_binlog_from_queue(FDIRSlaveReplication *replication)
         rb->release_func(rb);
     }
 
+    /* avoid pushing the empty package forever, the slave will sync
+       from the binlog files after the reconnection */
+    if (head == rb && replication->task->length == sizeof(FDIRProtoHeader)
+            + sizeof(FDIRProtoPushBinlogReqBodyHeader))
+    {
+        logError("file: "__FILE__", line: %d, "
+                "slave server id: %d, binlog buffer length: %d "
+                "exceeds the task buffer size: %d", __LINE__,
+                replication->slave->server->id, rb->buffer.length,
+                replication->task->size);
+        replication->task->length = 0;
+        repush_to_replication_queue(replication, head, tail);
+        return EOVERFLOW;
+    }
+
     body_header = (FDIRProtoPushBinlogReqBodyHeader *)
         (replication->task->data + sizeof(FDIRProtoHeader));
     body_len = replication->task->length - sizeof(FDIRProtoHeader);
@@ -591,6 +666,7 @@ static int sync_binlog_from_queue(FDIRSlaveReplication *replication)
     SF_PROTO_SET_HEADER((FDIRProtoHeader *)replication->task->data,
             FDIR_REPLICA_PROTO_PUSH_BINLOG_REQ, body_len);
     sf_send_add_event(replication->task);
+    replication->context.credits--;
 
     if (head != NULL) {
         repush_to_replication_queue(replication, head, tail);
@@ -616,11 +692,12 @@ static int start_binlog_read_thread(FDIRSlaveReplication *replication)
     if ((result=free_queue_realloc_max_buffer(replication->task)) != 0) {
         return result;
     }
-    return binlog_read_thread_init(replication->context.reader_ctx,
+    return binlog_read_thread_init_ex(replication->context.reader_ctx,
             &replication->slave->binlog_pos_hint, 
             replication->slave->last_data_version,
             replication->task->size - (sizeof(FDIRProtoHeader) +
-                sizeof(FDIRProtoPushBinlogReqBodyHeader)));
+                sizeof(FDIRProtoPushBinlogReqBodyHeader)),
+            REPLICA_SYNC_READ_AHEAD);
 }
 
 int binlog_replications_check_response_data_version(
@@ -661,6 +738,30 @@ static void sync_binlog_to_slave(FDIRSlaveReplication *replication,
             r->buffer.buff, r->buffer.length);
     replication->task->length = sizeof(FDIRProtoHeader) + body_len;
     sf_send_add_event(replication->task);
+    replication->context.credits--;
+}
+
+static inline void sync_window_push(FDIRReplicationWindow *window,
+        const int64_t data_version)
+{
+    window->versions[(window->head + window->count) %
+        FDIR_MAX_REPLICA_SYNC_WINDOW_SIZE] = data_version;
+    window->count++;
+}
+
+//flow control: the unacked packets must be less than the window size
+static bool sync_window_available(FDIRReplicationWindow *window,
+        const int64_t acked_version)
+{
+    while (window->count > 0 && window->versions[window->head] <=
+            acked_version)
+    {
+        window->head = (window->head + 1) %
+            FDIR_MAX_REPLICA_SYNC_WINDOW_SIZE;
+        window->count--;
+    }
+
+    return window->count < REPLICA_SYNC_WINDOW_SIZE;
 }
 
 static int sync_binlog_from_disk(FDIRSlaveReplication *replication)
@@ -685,10 +786,11 @@ static int sync_binlog_from_disk(FDIRSlaveReplication *replication)
         if (r->data_version.last > replication->context.
                 last_data_versions.by_disk.current)
         {
-            replication->context.last_data_versions.by_disk.previous =
-                replication->context.last_data_versions.by_disk.current;
             replication->context.last_data_versions.by_disk.current =
                 r->data_version.last;
+            sync_window_push(&replication->context.
+                    last_data_versions.by_disk.window,
+                    r->data_version.last);
         }
 
         /*
@@ -767,9 +869,21 @@ static int deal_connected_replication(FDIRSlaveReplication *replication)
         return 0;
     }
 
+    //the slave has no free buffer to receive
+    if ((replication->join.flags & FDIR_REPLICA_JOIN_FLAGS_CREDITS) &&
+            replication->context.credits <= 0)
+    {
+        if (replication->stage == FDIR_REPLICATION_STAGE_SYNC_FROM_QUEUE) {
+            push_result_ring_clear_timeouts(&replication->
+                    context.push_result_ctx);
+        }
+        return 0;
+    }
+
     if (replication->stage == FDIR_REPLICATION_STAGE_SYNC_FROM_DISK) {
-        if (replication->context.last_data_versions.by_resp >=
-                replication->context.last_data_versions.by_disk.previous) //flow control
+        if (sync_window_available(&replication->context.
+                    last_data_versions.by_disk.window,
+                    replication->context.last_data_versions.by_resp))
         {
             return sync_binlog_from_disk(replication);
         }
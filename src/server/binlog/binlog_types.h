@@ -37,6 +37,7 @@
 
 #define SERVICE_OP_SET_DSIZE_INT        101
 #define SERVICE_OP_BATCH_SET_DSIZE_INT  102
+#define SERVICE_OP_BATCH_UPDATE_INT     103
 
 #define SERVICE_OP_SYS_LOCK_APPLY_INT   111
 #define SERVICE_OP_FLOCK_APPLY_INT      112
@@ -91,6 +92,13 @@ typedef enum {
     fdir_dentry_type_inode = 'i'
 } FDIRDEntryType;
 
+typedef enum {
+    fdir_path_walk_none = 0,
+    fdir_path_walk_parent,  //the parent of the last component is resolved
+    fdir_path_walk_target,  //the dentry of the whole path is resolved
+    fdir_path_walk_fail
+} FDIRPathWalkStage;
+
 typedef struct {
     FDIRServerDentry *dentry;
     DABinlogOpType op_type;
@@ -126,7 +134,7 @@ typedef struct fdir_binlog_record {
 
         FDIRRecordDEntry me;  //for create and remove
 
-        struct fdir_record_ptr_array *parray; //for batch set dsize
+        struct fdir_record_ptr_array *parray; //for batch set dsize and update
         FLockTask *ftask;  //for flock apply
         SysLockTask *stask; //for sys lock apply
     };
@@ -145,8 +153,19 @@ typedef struct fdir_binlog_record {
     union {
         string_t link;
         key_value_pair_t xattr;
+        string_t last_name;  //for list dentry, resume after this name
     };
 
+    /* the full path resolved by the data threads which own the
+     * directories one by one, for data shard by subtree only */
+    struct {
+        FDIRPathWalkStage stage;
+        int depth;      //the resolved path components
+        int result;     //the errno for fdir_path_walk_fail
+        int64_t inode;  //the walking directory, the parent or the target
+        string_t name;  //the last path component
+    } path_walk;
+
     //must be the last to avoid being overwritten by memset
     struct {
         data_thread_notify_func func;
@@ -158,11 +177,14 @@ typedef struct fdir_binlog_record {
         short arr_index;
     } extra;   //for data loader
 
+    int64_t dequeue_time;  //in microseconds, for the latency stat
+
     struct fdir_binlog_record *next; //for data thread queue
 } FDIRBinlogRecord;
 
 typedef struct fdir_record_ptr_array {
     FDIRBinlogRecord **records;
+    short *results;  //the errno of each record for batch update
     int alloc;
     struct {
         int total;
@@ -178,6 +200,7 @@ typedef struct server_binlog_record_buffer {
     release_binlog_rbuffer_func release_func;
     FastBuffer buffer;
     struct server_binlog_record_buffer *next;      //for producer
+    struct server_binlog_record_buffer *members;   //for group commit
     struct server_binlog_record_buffer *nexts[0];  //for slave replications
 } ServerBinlogRecordBuffer;
 
@@ -204,6 +227,8 @@ static inline const char *get_operation_caption(const int operation)
             return "SET_DENTRY_SIZE";
         case SERVICE_OP_BATCH_SET_DSIZE_INT:
             return "BATCH_SET_DSIZE";
+        case SERVICE_OP_BATCH_UPDATE_INT:
+            return "BATCH_UPDATE";
         case SERVICE_OP_SYS_LOCK_APPLY_INT:
             return "SYS_LOCK_APPLY";
         case SERVICE_OP_FLOCK_APPLY_INT:
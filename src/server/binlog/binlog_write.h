@@ -99,6 +99,35 @@ static inline int push_to_binlog_write_queue(ServerBinlogRecordBuffer *rbuffer)
     return 0;
 }
 
+/* hand over the buffer of the rbuffer to the binlog writer without copy,
+ * the rbuffer takes the buffer of the writer in exchange */
+static inline int move_to_binlog_write_queue(
+        ServerBinlogRecordBuffer *rbuffer)
+{
+    SFBinlogWriterBuffer *wbuffer;
+    char *buff;
+    int alloc_size;
+
+    if ((wbuffer=sf_binlog_writer_alloc_buffer(
+                    &g_binlog_writer_ctx.thread)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    buff = wbuffer->bf.buff;
+    alloc_size = wbuffer->bf.alloc_size;
+    wbuffer->bf.buff = rbuffer->buffer.data;
+    wbuffer->bf.alloc_size = rbuffer->buffer.alloc_size;
+    wbuffer->bf.length = rbuffer->buffer.length;
+    wbuffer->version = rbuffer->data_version;
+
+    rbuffer->buffer.data = buff;
+    rbuffer->buffer.alloc_size = alloc_size;
+    rbuffer->buffer.length = 0;
+    sf_push_to_binlog_write_queue(&g_binlog_writer_ctx.writer, wbuffer);
+    return 0;
+}
+
 #ifdef __cplusplus
 }
 #endif
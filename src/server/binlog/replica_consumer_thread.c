@@ -50,6 +50,7 @@ static void release_record_buffer(ServerBinlogRecordBuffer *rbuffer)
 
     ctx = (ReplicaConsumerThreadContext *)rbuffer->args;
     common_blocked_queue_push_ex(&ctx->queues.free, rbuffer, &notify);
+    __sync_add_and_fetch(&ctx->credits.released, 1);
     if (notify) {
         ioevent_notify_thread(ctx->task->thread_data);
     }
@@ -82,10 +83,9 @@ static void replay_done_callback(const int result,
 }
    
 ReplicaConsumerThreadContext *replica_consumer_thread_init(
-        struct fast_task_info *task, const int buffer_size, int *err_no)
+        struct fast_task_info *task, const int buffer_size,
+        const int join_flags, int *err_no)
 {
-#define BINLOG_REPLAY_BATCH_SIZE  32
-
     ReplicaConsumerThreadContext *ctx;
     ServerBinlogRecordBuffer *rbuffer;
     int i;
@@ -112,7 +112,7 @@ ReplicaConsumerThreadContext *replica_consumer_thread_init(
 
     if ((*err_no=binlog_replay_init_ex(&ctx->replay_ctx,
                     replay_done_callback, ctx,
-                    BINLOG_REPLAY_BATCH_SIZE)) != 0)
+                    REPLICA_REPLAY_BATCH_SIZE)) != 0)
     {
         return NULL;
     }
@@ -145,6 +145,10 @@ ReplicaConsumerThreadContext *replica_consumer_thread_init(
 
     ctx->recv_rbuffer = (ServerBinlogRecordBuffer *)common_blocked_queue_pop(
                 &ctx->queues.free);
+    ctx->credits.enabled = (join_flags &
+            FDIR_REPLICA_JOIN_FLAGS_CREDITS) != 0;
+    ctx->credits.released = REPLICA_CONSUMER_THREAD_INPUT_BUFFER_COUNT - 1;
+    ctx->credits.granted = 0;
     if ((*err_no=fc_create_thread(&ctx->tid, deal_binlog_thread_func,
         ctx, SF_G_THREAD_STACK_SIZE)) != 0)
     {
@@ -227,11 +231,13 @@ int deal_replica_push_request(ReplicaConsumerThreadContext *ctx,
         const SFVersionRange *data_version)
 {
     ServerBinlogRecordBuffer *rb;
-    static int max_waiting_count = 0;
     int result;
-    int waiting_count;
 
-    ctx->recv_rbuffer->data_version = *data_version;
+    if (ctx->recv_rbuffer->buffer.length == 0) {
+        ctx->recv_rbuffer->data_version = *data_version;
+    } else {  //merged with the previous packet
+        ctx->recv_rbuffer->data_version.last = data_version->last;
+    }
     if ((result=fast_buffer_check(&ctx->recv_rbuffer->buffer,
                     length)) != 0)
     {
@@ -243,39 +249,16 @@ int deal_replica_push_request(ReplicaConsumerThreadContext *ctx,
             binlog_buff, length);
     ctx->recv_rbuffer->buffer.length += length;
 
+    /* the free buffer always exists when the master sends one packet
+       per credit, otherwise the packet is kept in the receive buffer
+       and pushed by check_retry_push_request */
     rb = (ServerBinlogRecordBuffer *)common_blocked_queue_pop_ex(
                 &ctx->queues.free, false);
     if (rb != NULL) {
         return push_and_set_next_recv_buffer(ctx, rb);
     }
 
-    if (ctx->recv_rbuffer->buffer.length < ctx->task->size) { //flow control
-        return 0;
-    }
-
-    waiting_count = 0;
-    while (ctx->continue_flag) {
-        rb = (ServerBinlogRecordBuffer *)common_blocked_queue_pop_ex(
-                &ctx->queues.free, false);
-        if (rb != NULL) {
-            break;
-        }
-
-        ++waiting_count;
-        fc_sleep_ms(10);
-    }
-
-    if (waiting_count > max_waiting_count) {
-        max_waiting_count = waiting_count;
-        logWarning("file: "__FILE__", line: %d, "
-                "alloc record buffer reachs max waiting count: %d, "
-                "buffer length: %d", __LINE__, max_waiting_count, length);
-    }
-    if (rb == NULL) {
-        return EAGAIN;
-    }
-
-    return push_and_set_next_recv_buffer(ctx, rb);
+    return 0;
 }
 
 static inline int check_retry_push_request(ReplicaConsumerThreadContext *ctx)
@@ -301,24 +284,33 @@ static int deal_replica_push_result(ReplicaConsumerThreadContext *ctx)
     RecordProcessResult *r;
     char *p;
     int count;
+    int credits;
+    int header_len;
 
     if (!(ctx->task->offset == 0 && ctx->task->length == 0)) {
         return 0;
     }
 
+    if (ctx->credits.enabled) {
+        credits = __sync_add_and_fetch(&ctx->credits.released, 0) -
+            ctx->credits.granted;
+        header_len = sizeof(FDIRProtoPushBinlogRespCreditHeader);
+    } else {
+        credits = 0;
+        header_len = sizeof(FDIRProtoPushBinlogRespBodyHeader);
+    }
     if ((node=common_blocked_queue_try_pop_all_nodes(
-                    &ctx->queues.result)) == NULL)
+                    &ctx->queues.result)) == NULL && credits == 0)
     {
         return EAGAIN;
     }
 
     count = 0;
-    p = ctx->task->data + sizeof(FDIRProtoHeader) +
-        sizeof(FDIRProtoPushBinlogRespBodyHeader);
+    p = ctx->task->data + sizeof(FDIRProtoHeader) + header_len;
 
     last = NULL;
     current = node;
-    do {
+    while (current != NULL) {
         if ((p - ctx->task->data) + sizeof(FDIRProtoPushBinlogRespBodyPart) >
                 ctx->task->size)
         {
@@ -340,11 +332,18 @@ static int deal_replica_push_result(ReplicaConsumerThreadContext *ctx)
 
         last = current;
         current = current->next;
-    } while (current != NULL);
-    common_blocked_queue_free_all_nodes(&ctx->queues.result, node);
+    }
+    if (node != NULL) {
+        common_blocked_queue_free_all_nodes(&ctx->queues.result, node);
+    }
 
     int2buff(count, ((FDIRProtoPushBinlogRespBodyHeader *)
                 (ctx->task->data + sizeof(FDIRProtoHeader)))->count);
+    if (ctx->credits.enabled) {
+        ctx->credits.granted += credits;
+        int2buff(credits, ((FDIRProtoPushBinlogRespCreditHeader *)
+                    (ctx->task->data + sizeof(FDIRProtoHeader)))->credits);
+    }
 
     ctx->task->length = p - ctx->task->data;
     SF_PROTO_SET_HEADER((FDIRProtoHeader *)ctx->task->data,
@@ -401,9 +400,9 @@ static void *deal_binlog_thread_func(void *arg)
             if (binlog_replay_deal_buffer(&ctx->replay_ctx,
                     rb->buffer.data, rb->buffer.length, NULL) == 0)
             {
-                if (push_to_binlog_write_queue(rb) != 0) {
+                if (move_to_binlog_write_queue(rb) != 0) {
                     logCrit("file: "__FILE__", line: %d, "
-                            "push_to_binlog_write_queue fail, "
+                            "move_to_binlog_write_queue fail, "
                             "program exit!", __LINE__);
                     ctx->continue_flag = false;
                     sf_terminate_myself();
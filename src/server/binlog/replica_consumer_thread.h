@@ -46,6 +46,14 @@ typedef struct replica_consumer_thread_context {
     struct fast_task_info *task;
     ServerBinlogRecordBuffer *recv_rbuffer;
 
+    /* the credit based flow control: the master sends one push packet
+       per credit, and the credits are granted by the freed buffers */
+    struct {
+        bool enabled;  //negotiated by JOIN_SLAVE, false for the old master
+        volatile int64_t released;
+        int64_t granted;
+    } credits;
+
     BinlogReplayContext replay_ctx;
 } ReplicaConsumerThreadContext;
 
@@ -54,7 +62,8 @@ extern "C" {
 #endif
 
 ReplicaConsumerThreadContext *replica_consumer_thread_init(
-        struct fast_task_info *task, const int buffer_size, int *err_no);
+        struct fast_task_info *task, const int buffer_size,
+        const int join_flags, int *err_no);
 
 int deal_replica_push_request(ReplicaConsumerThreadContext *ctx,
         char *binlog_buff, const int length,
@@ -0,0 +1,577 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/hash.h"
+#include "fastcommon/logger.h"
+#include "server_types.h"
+#include "child_index.h"
+
+#define CHILD_HTABLE_MIN_CAPACITY  (4 * FDIR_CHILD_HTABLE_THRESHOLD)
+
+static struct {
+    fdir_child_free_func free_func;
+    int delay_free_seconds;
+} child_index_ctx = {NULL, 0};
+
+void child_index_global_init(fdir_child_free_func free_func,
+        const int delay_free_seconds)
+{
+    child_index_ctx.free_func = free_func;
+    child_index_ctx.delay_free_seconds = delay_free_seconds;
+}
+
+FDIRChildIndex *child_index_new()
+{
+    FDIRChildIndex *index;
+
+    index = (FDIRChildIndex *)fc_malloc(sizeof(FDIRChildIndex));
+    if (index == NULL) {
+        return NULL;
+    }
+
+    memset(index, 0, sizeof(FDIRChildIndex));
+    index->blocks = index->fixed_blocks;
+    index->block_alloc = 1;
+    return index;
+}
+
+void child_index_free(FDIRChildIndex *index)
+{
+    FDIRChildBlock *block;
+    int i;
+    int k;
+
+    for (i=0; i<index->block_count; i++) {
+        block = index->blocks[i];
+        for (k=0; k<block->count; k++) {
+            child_index_ctx.free_func(block->entries[k], 0);
+        }
+        free(block);
+    }
+
+    if (index->blocks != index->fixed_blocks) {
+        free(index->blocks);
+    }
+    if (index->htable.buckets != NULL) {
+        free(index->htable.buckets);
+    }
+    free(index);
+}
+
+static inline unsigned int child_hash_code(const string_t *name)
+{
+    return simple_hash(name->str, name->len);
+}
+
+//return the first block which last name >= the name
+static int child_find_block(FDIRChildIndex *index, const string_t *name)
+{
+    FDIRChildBlock *block;
+    int low;
+    int high;
+    int mid;
+
+    low = 0;
+    high = index->block_count - 1;
+    while (low <= high) {
+        mid = (low + high) / 2;
+        block = index->blocks[mid];
+        if (fc_string_compare(&block->entries[block->count - 1]->
+                    name, name) < 0)
+        {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    return low;
+}
+
+//return the first position which name >= the name
+static int child_find_pos(FDIRChildBlock *block,
+        const string_t *name, bool *found)
+{
+    int low;
+    int high;
+    int mid;
+    int r;
+
+    low = 0;
+    high = block->count - 1;
+    while (low <= high) {
+        mid = (low + high) / 2;
+        r = fc_string_compare(&block->entries[mid]->name, name);
+        if (r < 0) {
+            low = mid + 1;
+        } else if (r > 0) {
+            high = mid - 1;
+        } else {
+            *found = true;
+            return mid;
+        }
+    }
+
+    *found = false;
+    return low;
+}
+
+static FDIRChildHashEntry *child_htable_find(FDIRChildIndex *index,
+        const string_t *name)
+{
+    FDIRChildHashEntry *bucket;
+    unsigned int hash_code;
+    unsigned int i;
+
+    hash_code = child_hash_code(name);
+    i = hash_code & index->htable.mask;
+    while (1) {
+        bucket = index->htable.buckets + i;
+        if (bucket->dentry == NULL) {
+            return NULL;
+        }
+        if (bucket->hash_code == hash_code &&
+                fc_string_equal(&bucket->dentry->name, name))
+        {
+            return bucket;
+        }
+        i = (i + 1) & index->htable.mask;
+    }
+}
+
+static void child_htable_add(FDIRChildIndex *index,
+        FDIRServerDentry *dentry)
+{
+    unsigned int hash_code;
+    unsigned int i;
+
+    hash_code = child_hash_code(&dentry->name);
+    i = hash_code & index->htable.mask;
+    while (index->htable.buckets[i].dentry != NULL) {
+        i = (i + 1) & index->htable.mask;
+    }
+    index->htable.buckets[i].hash_code = hash_code;
+    index->htable.buckets[i].dentry = dentry;
+}
+
+//the backward shift deletion for linear probing
+static void child_htable_remove(FDIRChildIndex *index,
+        FDIRChildHashEntry *bucket)
+{
+    unsigned int mask;
+    unsigned int i;
+    unsigned int j;
+    unsigned int k;
+
+    mask = index->htable.mask;
+    i = bucket - index->htable.buckets;
+    j = i;
+    while (1) {
+        j = (j + 1) & mask;
+        if (index->htable.buckets[j].dentry == NULL) {
+            break;
+        }
+
+        k = index->htable.buckets[j].hash_code & mask;
+        if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+            index->htable.buckets[i] = index->htable.buckets[j];
+            i = j;
+        }
+    }
+    index->htable.buckets[i].dentry = NULL;
+}
+
+static inline void child_htable_destroy(FDIRChildIndex *index)
+{
+    free(index->htable.buckets);
+    index->htable.buckets = NULL;
+    index->htable.mask = 0;
+}
+
+static int child_htable_rebuild(FDIRChildIndex *index)
+{
+    FDIRChildHashEntry *old_buckets;
+    FDIRChildBlock *block;
+    unsigned int capacity;
+    int bytes;
+    int i;
+    int k;
+
+    capacity = CHILD_HTABLE_MIN_CAPACITY;
+    while (capacity < 4 * index->count) {
+        capacity *= 2;
+    }
+
+    bytes = sizeof(FDIRChildHashEntry) * capacity;
+    old_buckets = index->htable.buckets;
+    if ((index->htable.buckets=(FDIRChildHashEntry *)
+                fc_malloc(bytes)) == NULL)
+    {
+        //keep the old hash table when it exists
+        index->htable.buckets = old_buckets;
+        return ENOMEM;
+    }
+    memset(index->htable.buckets, 0, bytes);
+    index->htable.mask = capacity - 1;
+
+    for (i=0; i<index->block_count; i++) {
+        block = index->blocks[i];
+        for (k=0; k<block->count; k++) {
+            child_htable_add(index, block->entries[k]);
+        }
+    }
+
+    if (old_buckets != NULL) {
+        free(old_buckets);
+    }
+    return 0;
+}
+
+static void child_htable_check_rebuild(FDIRChildIndex *index)
+{
+    unsigned int capacity;
+
+    if (index->htable.buckets == NULL) {
+        if (index->count >= FDIR_CHILD_HTABLE_THRESHOLD) {
+            child_htable_rebuild(index);  //lookup by the blocks when fail
+        }
+        return;
+    }
+
+    if (index->count < FDIR_CHILD_HTABLE_THRESHOLD / 2) {
+        child_htable_destroy(index);
+        return;
+    }
+
+    capacity = index->htable.mask + 1;
+    if (2 * index->count > capacity || (capacity >
+                CHILD_HTABLE_MIN_CAPACITY && 8 * index->count < capacity))
+    {
+        if (child_htable_rebuild(index) != 0 && 4 * index->count > 3 *
+                capacity)
+        {
+            //too crowded to probe, lookup by the blocks instead
+            child_htable_destroy(index);
+        }
+    }
+}
+
+static FDIRChildBlock *child_block_alloc(const int alloc)
+{
+    FDIRChildBlock *block;
+
+    block = (FDIRChildBlock *)fc_malloc(sizeof(FDIRChildBlock) +
+            sizeof(FDIRServerDentry *) * alloc);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->count = 0;
+    block->alloc = alloc;
+    return block;
+}
+
+static int child_block_resize(FDIRChildIndex *index,
+        const int bindex, const int alloc)
+{
+    FDIRChildBlock *block;
+
+    block = (FDIRChildBlock *)fc_realloc(index->blocks[bindex],
+            sizeof(FDIRChildBlock) + sizeof(FDIRServerDentry *) * alloc);
+    if (block == NULL) {
+        return ENOMEM;
+    }
+    block->alloc = alloc;
+    index->blocks[bindex] = block;
+    return 0;
+}
+
+static int child_blocks_insert(FDIRChildIndex *index,
+        const int bindex, FDIRChildBlock *block)
+{
+    FDIRChildBlock **blocks;
+    int alloc;
+
+    if (index->block_count == index->block_alloc) {
+        alloc = (index->block_alloc < 8) ? 8 : 2 * index->block_alloc;
+        if (index->blocks == index->fixed_blocks) {
+            blocks = (FDIRChildBlock **)fc_malloc(
+                    sizeof(FDIRChildBlock *) * alloc);
+            if (blocks != NULL) {
+                memcpy(blocks, index->blocks, sizeof(FDIRChildBlock *) *
+                        index->block_count);
+            }
+        } else {
+            blocks = (FDIRChildBlock **)fc_realloc(index->blocks,
+                    sizeof(FDIRChildBlock *) * alloc);
+        }
+        if (blocks == NULL) {
+            return ENOMEM;
+        }
+        index->blocks = blocks;
+        index->block_alloc = alloc;
+    }
+
+    if (bindex < index->block_count) {
+        memmove(index->blocks + bindex + 1, index->blocks + bindex,
+                sizeof(FDIRChildBlock *) * (index->block_count - bindex));
+    }
+    index->blocks[bindex] = block;
+    index->block_count++;
+    return 0;
+}
+
+static void child_blocks_remove(FDIRChildIndex *index, const int bindex)
+{
+    free(index->blocks[bindex]);
+    index->block_count--;
+    if (bindex < index->block_count) {
+        memmove(index->blocks + bindex, index->blocks + bindex + 1,
+                sizeof(FDIRChildBlock *) * (index->block_count - bindex));
+    }
+}
+
+//split the full block into two halves, adjust the bindex and the pos
+static int child_block_split(FDIRChildIndex *index, int *bindex, int *pos)
+{
+    FDIRChildBlock *block;
+    FDIRChildBlock *next;
+    int half;
+    int result;
+
+    block = index->blocks[*bindex];
+    if ((next=child_block_alloc(FDIR_CHILD_BLOCK_MAX_SIZE)) == NULL) {
+        return ENOMEM;
+    }
+
+    if ((result=child_blocks_insert(index, *bindex + 1, next)) != 0) {
+        free(next);
+        return result;
+    }
+
+    half = block->count / 2;
+    next->count = block->count - half;
+    memcpy(next->entries, block->entries + half,
+            sizeof(FDIRServerDentry *) * next->count);
+    block->count = half;
+    if (*pos > half) {
+        (*bindex)++;
+        *pos -= half;
+    }
+    return 0;
+}
+
+struct fdir_server_dentry *child_index_find(FDIRChildIndex *index,
+        const string_t *name)
+{
+    FDIRChildHashEntry *bucket;
+    FDIRChildBlock *block;
+    int bindex;
+    int pos;
+    bool found;
+
+    if (index->htable.buckets != NULL) {
+        bucket = child_htable_find(index, name);
+        return (bucket != NULL ? bucket->dentry : NULL);
+    }
+
+    if ((bindex=child_find_block(index, name)) == index->block_count) {
+        return NULL;
+    }
+
+    block = index->blocks[bindex];
+    pos = child_find_pos(block, name, &found);
+    return (found ? block->entries[pos] : NULL);
+}
+
+int child_index_insert(FDIRChildIndex *index,
+        struct fdir_server_dentry *dentry)
+{
+    FDIRChildBlock *block;
+    int bindex;
+    int pos;
+    int result;
+    bool found;
+
+    if (index->block_count == 0) {
+        if ((block=child_block_alloc(FDIR_CHILD_BLOCK_INIT_SIZE)) == NULL) {
+            return ENOMEM;
+        }
+        if ((result=child_blocks_insert(index, 0, block)) != 0) {
+            free(block);
+            return result;
+        }
+        bindex = pos = 0;
+    } else {
+        bindex = child_find_block(index, &dentry->name);
+        if (bindex == index->block_count) {  //append to the last block
+            bindex--;
+            pos = index->blocks[bindex]->count;
+        } else {
+            pos = child_find_pos(index->blocks[bindex],
+                    &dentry->name, &found);
+            if (found) {
+                return EEXIST;
+            }
+        }
+
+        block = index->blocks[bindex];
+        if (block->count == block->alloc) {
+            if (block->alloc < FDIR_CHILD_BLOCK_MAX_SIZE) {
+                result = child_block_resize(index, bindex,
+                        2 * block->alloc);
+            } else {
+                result = child_block_split(index, &bindex, &pos);
+            }
+            if (result != 0) {
+                return result;
+            }
+            block = index->blocks[bindex];
+        }
+    }
+
+    if (pos < block->count) {
+        memmove(block->entries + pos + 1, block->entries + pos,
+                sizeof(FDIRServerDentry *) * (block->count - pos));
+    }
+    block->entries[pos] = dentry;
+    block->count++;
+    index->count++;
+
+    if (index->htable.buckets != NULL) {
+        child_htable_add(index, dentry);
+    }
+    child_htable_check_rebuild(index);
+    return 0;
+}
+
+static int child_index_locate(FDIRChildIndex *index,
+        const string_t *name, int *bindex, int *pos)
+{
+    bool found;
+
+    if ((*bindex=child_find_block(index, name)) == index->block_count) {
+        return ENOENT;
+    }
+
+    *pos = child_find_pos(index->blocks[*bindex], name, &found);
+    return (found ? 0 : ENOENT);
+}
+
+int child_index_delete_ex(FDIRChildIndex *index,
+        struct fdir_server_dentry *dentry, const bool need_free)
+{
+    FDIRChildHashEntry *bucket;
+    FDIRChildBlock *block;
+    FDIRServerDentry *old;
+    int bindex;
+    int pos;
+    int result;
+
+    if ((result=child_index_locate(index, &dentry->name,
+                    &bindex, &pos)) != 0)
+    {
+        return result;
+    }
+
+    block = index->blocks[bindex];
+    old = block->entries[pos];
+    if (index->htable.buckets != NULL) {
+        if ((bucket=child_htable_find(index, &old->name)) != NULL) {
+            child_htable_remove(index, bucket);
+        }
+    }
+
+    block->count--;
+    index->count--;
+    if (block->count == 0) {
+        child_blocks_remove(index, bindex);
+    } else {
+        if (pos < block->count) {
+            memmove(block->entries + pos, block->entries + pos + 1,
+                    sizeof(FDIRServerDentry *) * (block->count - pos));
+        }
+        if (block->alloc > FDIR_CHILD_BLOCK_INIT_SIZE &&
+                4 * block->count < block->alloc)
+        {
+            child_block_resize(index, bindex, block->alloc / 2);
+        }
+    }
+    child_htable_check_rebuild(index);
+
+    if (need_free) {
+        child_index_ctx.free_func(old, child_index_ctx.delay_free_seconds);
+    }
+    return 0;
+}
+
+int child_index_replace_ex(FDIRChildIndex *index,
+        struct fdir_server_dentry *dentry, const bool need_free)
+{
+    FDIRChildHashEntry *bucket;
+    FDIRChildBlock *block;
+    FDIRServerDentry *old;
+    int bindex;
+    int pos;
+    int result;
+
+    if ((result=child_index_locate(index, &dentry->name,
+                    &bindex, &pos)) != 0)
+    {
+        return result;
+    }
+
+    block = index->blocks[bindex];
+    old = block->entries[pos];
+    block->entries[pos] = dentry;
+    if (index->htable.buckets != NULL) {
+        if ((bucket=child_htable_find(index, &old->name)) != NULL) {
+            bucket->dentry = dentry;  //the same name and hash code
+        }
+    }
+
+    if (need_free) {
+        child_index_ctx.free_func(old, child_index_ctx.delay_free_seconds);
+    }
+    return 0;
+}
+
+void child_index_iterator_after(FDIRChildIndex *index,
+        const string_t *last_name, FDIRChildIndexIterator *iterator)
+{
+    bool found;
+
+    iterator->index = index;
+    iterator->block = 0;
+    iterator->pos = 0;
+    if (last_name->len == 0) {
+        return;
+    }
+
+    if ((iterator->block=child_find_block(index, last_name)) ==
+            index->block_count)
+    {
+        return;  //reach the end
+    }
+
+    iterator->pos = child_find_pos(index->blocks[iterator->block],
+            last_name, &found);
+    if (found) {
+        iterator->pos++;  //skip the last listed one
+    }
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//child_index.h
+
+#ifndef _FDIR_CHILD_INDEX_H
+#define _FDIR_CHILD_INDEX_H
+
+#include "fastcommon/common_define.h"
+
+#define FDIR_CHILD_BLOCK_INIT_SIZE       4
+#define FDIR_CHILD_BLOCK_MAX_SIZE      256
+#define FDIR_CHILD_HTABLE_THRESHOLD     64  //build the hash table when reach
+
+struct fdir_server_dentry;
+
+typedef void (*fdir_child_free_func)(void *ptr, const int delay_seconds);
+
+typedef struct fdir_child_block {
+    int count;
+    int alloc;
+    struct fdir_server_dentry *entries[0];  //sorted by name
+} FDIRChildBlock;
+
+typedef struct fdir_child_hash_entry {
+    unsigned int hash_code;
+    struct fdir_server_dentry *dentry;  //NULL for empty bucket
+} FDIRChildHashEntry;
+
+/* the children of a directory: the sorted blocks for ordered iteration,
+ * and the open addressing hash table for lookup of the large directory */
+typedef struct fdir_child_index {
+    int count;
+    int block_count;
+    int block_alloc;
+    FDIRChildBlock **blocks;  //sorted by the last name of the block
+    FDIRChildBlock *fixed_blocks[1];  //avoid malloc for small directory
+    struct {
+        unsigned int mask;
+        FDIRChildHashEntry *buckets;  //NULL for not built
+    } htable;
+} FDIRChildIndex;
+
+typedef struct fdir_child_index_iterator {
+    FDIRChildIndex *index;
+    int block;
+    int pos;
+} FDIRChildIndexIterator;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void child_index_global_init(fdir_child_free_func free_func,
+            const int delay_free_seconds);
+
+    FDIRChildIndex *child_index_new();
+
+    //free the index and all the children without delay
+    void child_index_free(FDIRChildIndex *index);
+
+    struct fdir_server_dentry *child_index_find(FDIRChildIndex *index,
+            const string_t *name);
+
+    //return EEXIST when the name exists
+    int child_index_insert(FDIRChildIndex *index,
+            struct fdir_server_dentry *dentry);
+
+    //delete the child with the same name of the dentry
+    int child_index_delete_ex(FDIRChildIndex *index,
+            struct fdir_server_dentry *dentry, const bool need_free);
+
+    //replace the child with the same name of the dentry
+    int child_index_replace_ex(FDIRChildIndex *index,
+            struct fdir_server_dentry *dentry, const bool need_free);
+
+    /* position the iterator after last_name,
+     * from the first child when last_name is empty */
+    void child_index_iterator_after(FDIRChildIndex *index,
+            const string_t *last_name, FDIRChildIndexIterator *iterator);
+
+#define child_index_delete(index, dentry) \
+    child_index_delete_ex(index, dentry, true)
+
+#define child_index_replace(index, dentry) \
+    child_index_replace_ex(index, dentry, true)
+
+    static inline int child_index_count(FDIRChildIndex *index)
+    {
+        return index->count;
+    }
+
+    static inline bool child_index_empty(FDIRChildIndex *index)
+    {
+        return index->count == 0;
+    }
+
+    static inline void child_index_iterator(FDIRChildIndex *index,
+            FDIRChildIndexIterator *iterator)
+    {
+        iterator->index = index;
+        iterator->block = 0;
+        iterator->pos = 0;
+    }
+
+    static inline struct fdir_server_dentry *child_index_next(
+            FDIRChildIndexIterator *iterator)
+    {
+        FDIRChildBlock *block;
+
+        while (iterator->block < iterator->index->block_count) {
+            block = iterator->index->blocks[iterator->block];
+            if (iterator->pos < block->count) {
+                return block->entries[iterator->pos++];
+            }
+            iterator->block++;
+            iterator->pos = 0;
+        }
+
+        return NULL;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
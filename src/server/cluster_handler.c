@@ -409,9 +409,12 @@ static int cluster_deal_push_binlog_resp(struct fast_task_info *task)
 {
     int result;
     int count;
+    int header_len;
+    int min_body_len;
     int expect_body_len;
     int64_t data_version;
     short err_no;
+    bool credits_enabled;
     FDIRProtoPushBinlogRespBodyHeader *body_header;
     FDIRProtoPushBinlogRespBodyPart *body_part;
     FDIRProtoPushBinlogRespBodyPart *bp_end;
@@ -420,17 +423,23 @@ static int cluster_deal_push_binlog_resp(struct fast_task_info *task)
         return result;
     }
 
-    if ((result=server_check_min_body_length(
-                    sizeof(FDIRProtoPushBinlogRespBodyHeader) +
-                    sizeof(FDIRProtoPushBinlogRespBodyPart))) != 0)
-    {
+    //the response without results only grants the credits
+    credits_enabled = (CLUSTER_REPLICA->join.flags &
+            FDIR_REPLICA_JOIN_FLAGS_CREDITS) != 0;
+    if (credits_enabled) {
+        header_len = sizeof(FDIRProtoPushBinlogRespCreditHeader);
+        min_body_len = header_len;
+    } else {
+        header_len = sizeof(FDIRProtoPushBinlogRespBodyHeader);
+        min_body_len = header_len + sizeof(FDIRProtoPushBinlogRespBodyPart);
+    }
+    if ((result=server_check_min_body_length(min_body_len)) != 0) {
         return result;
     }
 
     body_header = (FDIRProtoPushBinlogRespBodyHeader *)REQUEST.body;
     count = buff2int(body_header->count);
-
-    expect_body_len = sizeof(FDIRProtoPushBinlogRespBodyHeader) +
+    expect_body_len = header_len +
         sizeof(FDIRProtoPushBinlogRespBodyPart) * count;
     if (REQUEST.header.body_len != expect_body_len) {
         RESPONSE.error.length = sprintf(RESPONSE.error.message,
@@ -439,8 +448,13 @@ static int cluster_deal_push_binlog_resp(struct fast_task_info *task)
         return EINVAL;
     }
 
-    body_part = (FDIRProtoPushBinlogRespBodyPart *)(REQUEST.body +
-            sizeof(FDIRProtoPushBinlogRespBodyHeader));
+    if (credits_enabled) {
+        CLUSTER_REPLICA->context.credits += buff2int(
+                ((FDIRProtoPushBinlogRespCreditHeader *)
+                 REQUEST.body)->credits);
+    }
+
+    body_part = (FDIRProtoPushBinlogRespBodyPart *)(REQUEST.body + header_len);
     bp_end = body_part + count;
     for (; body_part<bp_end; body_part++) {
         data_version = buff2long(body_part->data_version);
@@ -496,21 +510,34 @@ static int cluster_deal_join_slave_req(struct fast_task_info *task)
     int buffer_size;
     int binlog_count;
     int binlog_length;
+    int join_flags;
     FDIRServerContext *server_ctx;
     SFBinlogFilePosition bf_position;
     FDIRProtoJoinSlaveReq *req;
+    FDIRProtoJoinSlaveReqExtra *extra;
     FDIRClusterServerInfo *peer;
     FDIRClusterServerInfo *master;
     FDIRClusterServerInfo *next_master;
     FDIRProtoJoinSlaveResp *resp;
 
-    if ((result=server_expect_body_length(sizeof(
-                        FDIRProtoJoinSlaveReq))) != 0)
+    req = (FDIRProtoJoinSlaveReq *)REQUEST.body;
+    if (REQUEST.header.body_len == sizeof(FDIRProtoJoinSlaveReq)) {
+        join_flags = 0;  //the old master
+    } else if (REQUEST.header.body_len == sizeof(FDIRProtoJoinSlaveReq) +
+            sizeof(FDIRProtoJoinSlaveReqExtra))
     {
-        return result;
+        extra = (FDIRProtoJoinSlaveReqExtra *)(req + 1);
+        join_flags = buff2int(extra->flags) &
+            FDIR_REPLICA_JOIN_FLAGS_CREDITS;
+    } else {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "request body length: %d != %d or %d",
+                REQUEST.header.body_len, (int)sizeof(FDIRProtoJoinSlaveReq),
+                (int)(sizeof(FDIRProtoJoinSlaveReq) +
+                    sizeof(FDIRProtoJoinSlaveReqExtra)));
+        return EINVAL;
     }
 
-    req = (FDIRProtoJoinSlaveReq *)REQUEST.body;
     cluster_id = buff2int(req->cluster_id);
     server_id = buff2int(req->server_id);
     buffer_size = buff2int(req->buffer_size);
@@ -586,7 +613,7 @@ static int cluster_deal_join_slave_req(struct fast_task_info *task)
     }
 
     CLUSTER_CONSUMER_CTX = replica_consumer_thread_init(task,
-         BINLOG_BUFFER_INIT_SIZE, &result);
+         BINLOG_BUFFER_INIT_SIZE, join_flags, &result);
     if (CLUSTER_CONSUMER_CTX == NULL) {
         return result;
     }
@@ -747,6 +774,17 @@ static int cluster_deal_slave_ack(struct fast_task_info *task)
                     "happened, will trigger reselecting master", __LINE__);
             cluster_relationship_trigger_reselect_master();
             result = EEXIST;
+        } else if (result == EINVAL && CLUSTER_REPLICA->join.flags != 0 &&
+                CLUSTER_REPLICA->slave->last_data_version < 0 &&
+                CLUSTER_REPLICA->stage ==
+                FDIR_REPLICATION_STAGE_WAITING_JOIN_RESP)
+        {
+            logWarning("file: "__FILE__", line: %d, "
+                    "slave server id: %d rejects the join flags: %d, "
+                    "maybe an old version, rejoin without them", __LINE__,
+                    CLUSTER_REPLICA->slave->server->id,
+                    CLUSTER_REPLICA->join.flags);
+            CLUSTER_REPLICA->join.rejected = true;
         }
     }
 
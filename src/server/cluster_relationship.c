@@ -460,6 +460,7 @@ static int cluster_relationship_set_master(FDIRClusterServerInfo *new_master,
         }
 
         g_data_thread_vars.error_mode = FDIR_DATA_ERROR_MODE_STRICT;
+        data_thread_shard_set_active(true);
         binlog_write_set_order_by(SF_BINLOG_THREAD_TYPE_ORDER_BY_VERSION);
         binlog_write_set_next_version();
 
@@ -474,6 +475,8 @@ static int cluster_relationship_set_master(FDIRClusterServerInfo *new_master,
         }
     } else {
         char time_used[128];
+
+        data_thread_shard_set_active(false);
         if (start_time > 0) {
             sprintf(time_used, ", election time used: %ds",
                     (int)(g_current_time - start_time));
@@ -35,23 +35,24 @@ static DataDumperContext dump_ctx;
 static int output_xattr(FDIRServerDentry *dentry)
 {
     int result;
+    SFKeyValueArray *kv_array;
     key_value_pair_t *kv;
     key_value_pair_t *end;
 
     if (STORAGE_ENABLED) {
-        if ((result=dentry_load_xattr(dentry->context->
-                        thread_ctx, dentry)) != 0)
+        if ((result=dentry_load_xattr(FDIR_DENTRY_THREAD_CTX(
+                            dentry), dentry)) != 0)
         {
             return result;
         }
     }
 
-    if (dentry->kv_array != NULL) {
+    if ((kv_array=FDIR_DENTRY_KV_ARRAY(dentry)) != NULL) {
         fprintf(dump_ctx.fp, "\nxattrs:\n");
-        end = dentry->kv_array->elts + dentry->kv_array->count;
-        for (kv=dentry->kv_array->elts; kv<end; kv++) {
+        end = kv_array->elts + kv_array->count;
+        for (kv=kv_array->elts; kv<end; kv++) {
             fprintf(dump_ctx.fp, "%d. %.*s=>%.*s\n",
-                    (int)(kv - dentry->kv_array->elts),
+                    (int)(kv - kv_array->elts),
                     kv->key.len, kv->key.str,
                     kv->value.len, kv->value.str);
         }
@@ -70,9 +71,10 @@ static int output_dentry(FDIRServerDentry *dentry)
             dentry->name.len, dentry->name.str);
 
     if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
-        fprintf(dump_ctx.fp, " si=%"PRId64, dentry->src_dentry->inode);
+        fprintf(dump_ctx.fp, " si=%"PRId64, FDIR_DENTRY_SRC(dentry)->inode);
     } else if (S_ISLNK(dentry->stat.mode)) {
-        fprintf(dump_ctx.fp, " ln=%.*s", dentry->link.len, dentry->link.str);
+        fprintf(dump_ctx.fp, " ln=%.*s", FDIR_DENTRY_LINK(dentry).len,
+                FDIR_DENTRY_LINK(dentry).str);
     }
 
     fprintf(dump_ctx.fp, " md=%d ui=%d gi=%d bt=%u at=%u ct=%u mt=%u "
@@ -92,13 +94,13 @@ static int output_dentry(FDIRServerDentry *dentry)
 static void output_child_list(FDIRServerDentry *dentry)
 {
     FDIRServerDentry *current;
-    UniqSkiplistIterator iterator;
+    FDIRChildIndexIterator iterator;
     int count;
 
     fprintf(dump_ctx.fp, "\nchilren:\n");
     count = 0;
-    uniq_skiplist_iterator(dentry->children, &iterator);
-    while ((current=uniq_skiplist_next(&iterator)) != NULL) {
+    child_index_iterator(dentry->children, &iterator);
+    while ((current=child_index_next(&iterator)) != NULL) {
         fprintf(dump_ctx.fp, "%d. %"PRId64" %.*s\n", ++count,
                 current->inode, current->name.len, current->name.str);
     }
@@ -108,11 +110,11 @@ static int dentry_dump(FDIRServerDentry *dentry)
 {
     int result;
     FDIRServerDentry *current;
-    UniqSkiplistIterator iterator;
+    FDIRChildIndexIterator iterator;
 
     if (STORAGE_ENABLED) {
-        if ((result=dentry_check_load(dentry->context->
-                        thread_ctx, dentry)) != 0)
+        if ((result=dentry_check_load(FDIR_DENTRY_THREAD_CTX(
+                            dentry), dentry)) != 0)
         {
             return result;
         }
@@ -128,8 +130,8 @@ static int dentry_dump(FDIRServerDentry *dentry)
 
     output_child_list(dentry);
 
-    uniq_skiplist_iterator(dentry->children, &iterator);
-    while ((current=uniq_skiplist_next(&iterator)) != NULL) {
+    child_index_iterator(dentry->children, &iterator);
+    while ((current=child_index_next(&iterator)) != NULL) {
         if ((result=dentry_dump(current)) != 0) {
             return result;
         }
@@ -29,13 +29,95 @@
 #include "fastcommon/sockopt.h"
 #include "fastcommon/shared_func.h"
 #include "fastcommon/pthread_func.h"
+#include "fastcommon/sched_thread.h"
 #include "sf/sf_global.h"
 #include "db/event_dealer.h"
 #include "server_global.h"
 #include "server_binlog.h"
 #include "data_thread.h"
+#include "data_snapshot.h"
 #include "data_loader.h"
 
+#define DATA_LOAD_PROGRESS_LOG_INTERVAL  10
+
+typedef struct data_load_progress {
+    int64_t total_bytes;
+    int64_t done_bytes;
+    int64_t start_time_ms;
+    time_t last_log_time;
+} DataLoadProgress;
+
+static FDIRDataLoadStat load_stat;
+
+void server_get_data_load_stat(FDIRDataLoadStat *stat)
+{
+    *stat = load_stat;
+}
+
+static int64_t get_binlog_total_bytes(const SFBinlogFilePosition *hint_pos)
+{
+    char filename[PATH_MAX];
+    struct stat buf;
+    int start_index;
+    int last_index;
+    int index;
+    int64_t total_bytes;
+
+    start_index = (hint_pos != NULL ? hint_pos->index : 0);
+    last_index = binlog_get_current_write_index();
+    total_bytes = 0;
+    for (index=start_index; index<=last_index; index++) {
+        sf_binlog_writer_get_filename(DATA_PATH_STR, FDIR_BINLOG_SUBDIR_NAME,
+                index, filename, sizeof(filename));
+        if (stat(filename, &buf) == 0) {
+            total_bytes += buf.st_size;
+        }
+    }
+
+    if (hint_pos != NULL) {
+        total_bytes -= hint_pos->offset;
+    }
+    return (total_bytes > 0 ? total_bytes : 0);
+}
+
+static void log_load_progress(DataLoadProgress *progress,
+        BinlogReplayMTContext *replay_ctx)
+{
+    int64_t time_used_ms;
+    int64_t records_per_second;
+    int64_t remain_seconds;
+    double percent;
+
+    if (g_current_time - progress->last_log_time <
+            DATA_LOAD_PROGRESS_LOG_INTERVAL)
+    {
+        return;
+    }
+    progress->last_log_time = g_current_time;
+
+    time_used_ms = get_current_time_ms() - progress->start_time_ms;
+    if (time_used_ms <= 0 || progress->done_bytes <= 0) {
+        return;
+    }
+
+    records_per_second = replay_ctx->dispatch_count * 1000 / time_used_ms;
+    if (progress->done_bytes < progress->total_bytes) {
+        percent = 100.00 * progress->done_bytes / progress->total_bytes;
+        remain_seconds = (int64_t)((double)time_used_ms * (progress->
+                    total_bytes - progress->done_bytes) /
+                progress->done_bytes / 1000);
+    } else {
+        percent = 100.00;
+        remain_seconds = 0;
+    }
+
+    logInfo("file: "__FILE__", line: %d, "
+            "loading data %.2f%%, record count: %"PRId64", "
+            "speed: %"PRId64" records/s, ETA: %"PRId64" s", __LINE__,
+            percent, replay_ctx->dispatch_count, records_per_second,
+            remain_seconds);
+}
+
 int server_load_data()
 {
     BinlogReplayMTContext replay_ctx;
@@ -44,6 +126,8 @@ int server_load_data()
     SFBinlogFilePosition *hint_pos;
     BinlogReadThreadContext reader_ctx;
     BinlogReadThreadResult *r;
+    DataLoadProgress progress;
+    bool shard_dispatch;
     int64_t start_time;
     int64_t end_time;
     char time_buff[32];
@@ -74,6 +158,24 @@ int server_load_data()
         last_data_version = 0;
     }
 
+    /* replay the independent subtrees in parallel, the allocators
+       of the data threads are locked in subtree shard mode */
+    shard_dispatch = DATA_SHARD_ENABLED;
+    if (shard_dispatch) {
+        data_thread_shard_set_active(true);
+    }
+
+    if (!STORAGE_ENABLED) {
+        //replay the binlog records after the snapshot only
+        if ((result=data_snapshot_load(parse_threads, shard_dispatch,
+                        &last_data_version, &pos)) == 0)
+        {
+            hint_pos = &pos;
+        } else if (result != ENOENT) {
+            return result;
+        }
+    }
+
     if ((result=binlog_read_thread_init_ex(&reader_ctx, hint_pos,
                     last_data_version, BINLOG_BUFFER_SIZE,
                     parse_threads * 2)) != 0)
@@ -85,15 +187,21 @@ int server_load_data()
         return result;
     }
 
-    if ((result=binlog_replay_mt_init(&replay_ctx, &reader_ctx,
-                    parse_threads)) != 0)
+    if ((result=binlog_replay_mt_init_ex(&replay_ctx, &reader_ctx,
+                    parse_threads, shard_dispatch)) != 0)
     {
         return result;
     }
 
+    progress.total_bytes = get_binlog_total_bytes(hint_pos);
+    progress.done_bytes = 0;
+    progress.start_time_ms = start_time;
+    progress.last_log_time = g_current_time;
     logInfo("file: "__FILE__", line: %d, "
-            "loading data, parse thread count: %d ...",
-            __LINE__, parse_threads);
+            "loading data, parse thread count: %d, dispatch by %s, "
+            "binlog bytes: %"PRId64" ...", __LINE__, parse_threads,
+            shard_dispatch ? "subtree shard" : "namespace",
+            progress.total_bytes);
 
     result = 0;
     while (SF_G_CONTINUE_FLAG && replay_ctx.fail_count == 0) {
@@ -110,14 +218,20 @@ int server_load_data()
             break;
         }
 
+        progress.done_bytes += r->buffer.length;
         if ((result=binlog_replay_mt_parse_buffer(&replay_ctx, r)) != 0) {
             break;
         }
+        log_load_progress(&progress, &replay_ctx);
     }
 
     binlog_replay_mt_read_done(&replay_ctx);
     binlog_replay_mt_destroy(&replay_ctx);
     binlog_read_thread_terminate(&reader_ctx);
+    if (shard_dispatch) {
+        //set by the cluster relationship when this server becomes master
+        data_thread_shard_set_active(false);
+    }
 
     if (result == 0) {
         if (replay_ctx.fail_count > 0) {
@@ -127,15 +241,23 @@ int server_load_data()
 
     if (result == 0) {
         end_time = get_current_time_ms();
+        load_stat.record_count = replay_ctx.record_count;
+        load_stat.skip_count = replay_ctx.skip_count;
+        load_stat.barrier_count = replay_ctx.shard.barrier_count;
+        load_stat.time_used_ms = end_time - start_time;
+        load_stat.parallel = shard_dispatch;
         logInfo("file: "__FILE__", line: %d, "
                 "load data done. record count: %"PRId64", "
                 "skip count: %"PRId64", warning count: %"PRId64
                 ", fail count: %"PRId64", current data version: %"PRId64
-                ", time used: %s ms", __LINE__, replay_ctx.record_count,
-                replay_ctx.skip_count, replay_ctx.warning_count,
-                replay_ctx.fail_count, __sync_add_and_fetch(
-                    &DATA_CURRENT_VERSION, 0), long_to_comma_str(
-                        end_time - start_time, time_buff));
+                ", shard barrier count: %"PRId64", speed: %"PRId64
+                " records/s, time used: %s ms", __LINE__,
+                replay_ctx.record_count, replay_ctx.skip_count,
+                replay_ctx.warning_count, replay_ctx.fail_count,
+                __sync_add_and_fetch(&DATA_CURRENT_VERSION, 0),
+                load_stat.barrier_count, load_stat.record_count * 1000 /
+                FC_MAX(load_stat.time_used_ms, 1), long_to_comma_str(
+                    load_stat.time_used_ms, time_buff));
     }
     return result;
 }
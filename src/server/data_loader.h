@@ -18,12 +18,25 @@
 #ifndef _DATA_LOADER_H_
 #define _DATA_LOADER_H_
 
+#include "server_types.h"
+
+typedef struct fdir_data_load_stat {
+    int64_t record_count;
+    int64_t skip_count;
+    int64_t barrier_count;  //for parallel replay by subtree shard
+    int64_t time_used_ms;
+    bool parallel;
+} FDIRDataLoadStat;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 int server_load_data();
 
+//the stat of the last data loading
+void server_get_data_load_stat(FDIRDataLoadStat *stat);
+
 #ifdef __cplusplus
 }
 #endif
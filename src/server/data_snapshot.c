@@ -0,0 +1,997 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/fast_buffer.h"
+#include "fastcommon/fc_atomic.h"
+#include "sf/sf_global.h"
+#include "server_global.h"
+#include "server_binlog.h"
+#include "ns_manager.h"
+#include "child_index.h"
+#include "data_thread.h"
+#include "data_snapshot.h"
+
+#define SNAPSHOT_FILENAME          "snapshot.dat"
+#define SNAPSHOT_TMP_FILENAME      "snapshot.tmp"
+#define SNAPSHOT_MAGIC_STR         "FDIRSNAP"
+#define SNAPSHOT_MAGIC_LEN         (sizeof(SNAPSHOT_MAGIC_STR) - 1)
+#define SNAPSHOT_FORMAT_VERSION    1
+#define SNAPSHOT_FLUSH_BYTES       (1024 * 1024)
+#define SNAPSHOT_ORPHAN_NAME_PREFIX  ".fdir-snapshot-"
+#define SNAPSHOT_WAIT_BINLOG_TIMEOUT_MS  (30 * 1000)
+
+/* the snapshot file: the header and the binary binlog records which
+ * rebuild the dentry tree, the data versions of the records are
+ * sequential from 1, the records of the same namespace are continuous */
+typedef struct fdir_snapshot_header {
+    char magic[8];
+    char format_version[4];
+    char binlog_index[4];   //the binlog position for the tail replay
+    char binlog_offset[8];
+    char data_version[8];   //the data version of the snapshot
+    char record_count[8];
+    char body_size[8];
+    char create_time[8];
+    char padding[8];
+} FDIRSnapshotHeader;
+
+typedef struct fdir_snapshot_info {
+    int binlog_index;
+    int64_t binlog_offset;
+    int64_t data_version;
+    int64_t record_count;
+    int64_t body_size;
+} FDIRSnapshotInfo;
+
+typedef struct fdir_snapshot_stack_entry {
+    FDIRServerDentry *dentry;
+    FDIRChildIndexIterator iterator;
+} FDIRSnapshotStackEntry;
+
+typedef struct fdir_snapshot_writer {
+    int fd;
+    int64_t record_count;
+    int64_t body_size;
+    FastBuffer buffer;
+    FDIRBinlogRecord record;
+    FDIRNamespaceEntry *ns_entry;
+    struct {
+        FDIRSnapshotStackEntry *entries;
+        int alloc;
+    } stack;   //for the depth first traversal
+    FDIRServerDentryArray srcs;     //the hard link sources in the tree
+    FDIRServerDentryArray hdlinks;
+    FDIRServerDentryArray orphans;  //the removed sources with links
+} FDIRSnapshotWriter;
+
+//the data version of the last saved or loaded snapshot
+static int64_t last_snapshot_version = 0;
+
+static inline void get_snapshot_filename(const char *fname,
+        char *filename, const int size)
+{
+    snprintf(filename, size, "%s/%s/%s", DATA_PATH_STR,
+            FDIR_SNAPSHOT_SUBDIR_NAME, fname);
+}
+
+static int dentry_array_add(FDIRServerDentryArray *array,
+        FDIRServerDentry *dentry)
+{
+    FDIRServerDentry **entries;
+    int alloc;
+
+    if (array->count == array->alloc) {
+        alloc = (array->alloc == 0 ? 256 : array->alloc * 2);
+        entries = (FDIRServerDentry **)realloc(array->entries,
+                sizeof(FDIRServerDentry *) * alloc);
+        if (entries == NULL) {
+            return ENOMEM;
+        }
+        array->entries = entries;
+        array->alloc = alloc;
+    }
+
+    array->entries[array->count++] = dentry;
+    return 0;
+}
+
+static int compare_dentry_ptr(const void *p1, const void *p2)
+{
+    const FDIRServerDentry *d1;
+    const FDIRServerDentry *d2;
+
+    d1 = *((const FDIRServerDentry **)p1);
+    d2 = *((const FDIRServerDentry **)p2);
+    return (d1 < d2 ? -1 : (d1 > d2 ? 1 : 0));
+}
+
+static inline bool dentry_array_exists(FDIRServerDentryArray *array,
+        FDIRServerDentry *dentry)
+{
+    return bsearch(&dentry, array->entries, array->count,
+            sizeof(FDIRServerDentry *), compare_dentry_ptr) != NULL;
+}
+
+static int writer_flush(FDIRSnapshotWriter *writer)
+{
+    if (writer->buffer.length == 0) {
+        return 0;
+    }
+
+    if (fc_safe_write(writer->fd, writer->buffer.data,
+                writer->buffer.length) != writer->buffer.length)
+    {
+        return (errno != 0 ? errno : EIO);
+    }
+
+    writer->body_size += writer->buffer.length;
+    writer->buffer.length = 0;
+    return 0;
+}
+
+static inline FDIRBinlogRecord *writer_init_record(
+        FDIRSnapshotWriter *writer, const int operation,
+        const int64_t inode)
+{
+    FDIRBinlogRecord *record;
+
+    record = &writer->record;
+    memset(record, 0, sizeof(*record));
+    record->data_version = ++(writer->record_count);
+    record->inode = inode;
+    record->operation = operation;
+    record->ns = writer->ns_entry->name;
+    record->hash_code = writer->ns_entry->hash_code;
+    record->timestamp = time(NULL);
+    return record;
+}
+
+static int writer_pack_record(FDIRSnapshotWriter *writer)
+{
+    int result;
+
+    if ((result=binlog_pack_record_ex(&writer->record, &writer->buffer,
+                    FDIR_BINLOG_FORMAT_BINARY)) != 0)
+    {
+        return result;
+    }
+
+    if (writer->buffer.length >= SNAPSHOT_FLUSH_BYTES) {
+        return writer_flush(writer);
+    }
+    return 0;
+}
+
+static int output_create_record(FDIRSnapshotWriter *writer,
+        FDIRServerDentry *dentry, const int64_t parent_inode,
+        const string_t *name)
+{
+    FDIRBinlogRecord *record;
+
+    record = writer_init_record(writer, BINLOG_OP_CREATE_DENTRY_INT,
+            dentry->inode);
+    record->options.path_info.flags = BINLOG_OPTIONS_PATH_ENABLED;
+    record->me.pname.parent_inode = parent_inode;
+    record->me.pname.name = *name;
+    record->stat = dentry->stat;
+    record->options.mode = 1;
+    record->options.btime = 1;
+    record->options.atime = 1;
+    record->options.ctime = 1;
+    record->options.mtime = 1;
+    record->options.uid = 1;
+    record->options.gid = 1;
+    record->options.size = 1;
+
+    if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
+        record->options.src_inode = 1;
+        record->hdlink.src.inode = FDIR_DENTRY_SRC(dentry)->inode;
+    } else if (S_ISLNK(dentry->stat.mode)) {
+        record->options.link = 1;
+        record->link = FDIR_DENTRY_LINK(dentry);
+    }
+
+    return writer_pack_record(writer);
+}
+
+//the fields which are NOT set by the create operation
+static int output_extra_records(FDIRSnapshotWriter *writer,
+        FDIRServerDentry *dentry)
+{
+    FDIRBinlogRecord *record;
+    SFKeyValueArray *kv_array;
+    key_value_pair_t *kv;
+    key_value_pair_t *end;
+    int result;
+
+    if (dentry->stat.alloc != 0 || dentry->stat.space_end != 0) {
+        record = writer_init_record(writer,
+                BINLOG_OP_UPDATE_DENTRY_INT, dentry->inode);
+        if (dentry->stat.alloc != 0) {
+            record->options.inc_alloc = 1;
+            record->stat.alloc = dentry->stat.alloc;
+        }
+        if (dentry->stat.space_end != 0) {
+            record->options.space_end = 1;
+            record->stat.space_end = dentry->stat.space_end;
+        }
+        if ((result=writer_pack_record(writer)) != 0) {
+            return result;
+        }
+    }
+
+    if ((kv_array=FDIR_DENTRY_KV_ARRAY(dentry)) == NULL) {
+        return 0;
+    }
+
+    end = kv_array->elts + kv_array->count;
+    for (kv=kv_array->elts; kv<end; kv++) {
+        record = writer_init_record(writer,
+                BINLOG_OP_SET_XATTR_INT, dentry->inode);
+        record->xattr = *kv;
+        if ((result=writer_pack_record(writer)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int output_dentry(FDIRSnapshotWriter *writer,
+        FDIRServerDentry *dentry, const int64_t parent_inode,
+        const string_t *name)
+{
+    int result;
+
+    if ((result=output_create_record(writer, dentry,
+                    parent_inode, name)) != 0)
+    {
+        return result;
+    }
+    return output_extra_records(writer, dentry);
+}
+
+static inline void get_orphan_name(FDIRServerDentry *dentry,
+        char *buff, string_t *name)
+{
+    name->str = buff;
+    name->len = sprintf(buff, "%s%"PRId64,
+            SNAPSHOT_ORPHAN_NAME_PREFIX, dentry->inode);
+}
+
+/* the hard links are created after all dentries of the namespace,
+ * the removed sources which still have links are created under the
+ * root with the temporary names, and removed after the links created */
+static int output_hdlinks(FDIRSnapshotWriter *writer)
+{
+    FDIRServerDentry *root;
+    FDIRServerDentry *src;
+    FDIRServerDentry **dentry;
+    FDIRServerDentry **end;
+    FDIRBinlogRecord *record;
+    char buff[64];
+    string_t name;
+    int count;
+    int result;
+
+    if (writer->hdlinks.count == 0) {
+        return 0;
+    }
+
+    qsort(writer->srcs.entries, writer->srcs.count,
+            sizeof(FDIRServerDentry *), compare_dentry_ptr);
+    writer->orphans.count = 0;
+    end = writer->hdlinks.entries + writer->hdlinks.count;
+    for (dentry=writer->hdlinks.entries; dentry<end; dentry++) {
+        src = FDIR_DENTRY_SRC(*dentry);
+        if (!dentry_array_exists(&writer->srcs, src)) {
+            if ((result=dentry_array_add(&writer->orphans, src)) != 0) {
+                return result;
+            }
+        }
+    }
+
+    if (writer->orphans.count > 0) {
+        qsort(writer->orphans.entries, writer->orphans.count,
+                sizeof(FDIRServerDentry *), compare_dentry_ptr);
+        count = 1;
+        for (dentry=writer->orphans.entries + 1; dentry<writer->
+                orphans.entries + writer->orphans.count; dentry++)
+        {
+            if (*dentry != writer->orphans.entries[count - 1]) {
+                writer->orphans.entries[count++] = *dentry;
+            }
+        }
+        writer->orphans.count = count;
+    }
+
+    root = writer->ns_entry->current.root.ptr;
+    end = writer->orphans.entries + writer->orphans.count;
+    for (dentry=writer->orphans.entries; dentry<end; dentry++) {
+        get_orphan_name(*dentry, buff, &name);
+        if ((result=output_dentry(writer, *dentry,
+                        root->inode, &name)) != 0)
+        {
+            return result;
+        }
+    }
+
+    end = writer->hdlinks.entries + writer->hdlinks.count;
+    for (dentry=writer->hdlinks.entries; dentry<end; dentry++) {
+        if ((result=output_create_record(writer, *dentry, (*dentry)->
+                        parent->inode, &(*dentry)->name)) != 0)
+        {
+            return result;
+        }
+    }
+
+    end = writer->orphans.entries + writer->orphans.count;
+    for (dentry=writer->orphans.entries; dentry<end; dentry++) {
+        get_orphan_name(*dentry, buff, &name);
+        record = writer_init_record(writer, BINLOG_OP_REMOVE_DENTRY_INT,
+                (*dentry)->inode);
+        record->options.path_info.flags = BINLOG_OPTIONS_PATH_ENABLED;
+        record->me.pname.parent_inode = root->inode;
+        record->me.pname.name = name;
+        if ((result=writer_pack_record(writer)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static inline int stack_push(FDIRSnapshotWriter *writer,
+        const int depth, FDIRServerDentry *dentry)
+{
+    FDIRSnapshotStackEntry *entries;
+    int alloc;
+
+    if (depth == writer->stack.alloc) {
+        alloc = (writer->stack.alloc == 0 ? 64 : writer->stack.alloc * 2);
+        entries = (FDIRSnapshotStackEntry *)realloc(writer->stack.entries,
+                sizeof(FDIRSnapshotStackEntry) * alloc);
+        if (entries == NULL) {
+            return ENOMEM;
+        }
+        writer->stack.entries = entries;
+        writer->stack.alloc = alloc;
+    }
+
+    writer->stack.entries[depth].dentry = dentry;
+    child_index_iterator(dentry->children, &writer->stack.entries[depth].
+            iterator);
+    return 0;
+}
+
+//depth first, the parent is always output before the children
+static int output_namespace(FDIRSnapshotWriter *writer,
+        FDIRNamespaceEntry *ns_entry)
+{
+    FDIRServerDentry *root;
+    FDIRServerDentry *current;
+    FDIRSnapshotStackEntry *top;
+    string_t empty;
+    int depth;
+    int result;
+
+    if ((root=ns_entry->current.root.ptr) == NULL) {
+        return 0;
+    }
+
+    writer->ns_entry = ns_entry;
+    writer->srcs.count = 0;
+    writer->hdlinks.count = 0;
+    FC_SET_STRING_NULL(empty);
+    if ((result=output_dentry(writer, root, 0, &empty)) != 0) {
+        return result;
+    }
+
+    if ((result=stack_push(writer, 0, root)) != 0) {
+        return result;
+    }
+    depth = 1;
+    while (depth > 0) {
+        top = writer->stack.entries + depth - 1;
+        if ((current=child_index_next(&top->iterator)) == NULL) {
+            depth--;
+            continue;
+        }
+
+        if (FDIR_IS_DENTRY_HARD_LINK(current->stat.mode)) {
+            if ((result=dentry_array_add(&writer->hdlinks, current)) != 0) {
+                return result;
+            }
+            continue;
+        }
+
+        if ((result=output_dentry(writer, current, top->dentry->inode,
+                        &current->name)) != 0)
+        {
+            return result;
+        }
+
+        if (S_ISDIR(current->stat.mode)) {
+            if ((result=stack_push(writer, depth, current)) != 0) {
+                return result;
+            }
+            depth++;
+        } else if (current->stat.nlink > 1) {
+            if ((result=dentry_array_add(&writer->srcs, current)) != 0) {
+                return result;
+            }
+        }
+    }
+
+    return output_hdlinks(writer);
+}
+
+static void pack_header(const FDIRSnapshotInfo *info,
+        FDIRSnapshotHeader *header)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, SNAPSHOT_MAGIC_STR, SNAPSHOT_MAGIC_LEN);
+    int2buff(SNAPSHOT_FORMAT_VERSION, header->format_version);
+    int2buff(info->binlog_index, header->binlog_index);
+    long2buff(info->binlog_offset, header->binlog_offset);
+    long2buff(info->data_version, header->data_version);
+    long2buff(info->record_count, header->record_count);
+    long2buff(info->body_size, header->body_size);
+    long2buff(time(NULL), header->create_time);
+}
+
+//run in the child process, NOT log for the lock held by other threads
+static int write_snapshot_file(const char *filename,
+        const int64_t data_version)
+{
+    FDIRSnapshotWriter writer;
+    FDIRSnapshotHeader header;
+    FDIRSnapshotInfo info;
+    const FDIRNamespacePtrArray *ns_parray;
+    FDIRNamespaceEntry **ns_entry;
+    FDIRNamespaceEntry **ns_end;
+    int result;
+
+    memset(&writer, 0, sizeof(writer));
+    if ((result=fast_buffer_init_ex(&writer.buffer, SNAPSHOT_FLUSH_BYTES +
+                    2 * BINLOG_RECORD_MAX_SIZE)) != 0)
+    {
+        return result;
+    }
+
+    if ((writer.fd=open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        return (errno != 0 ? errno : EACCES);
+    }
+
+    //reserve the header space
+    memset(&header, 0, sizeof(header));
+    if (fc_safe_write(writer.fd, (char *)&header,
+                sizeof(header)) != sizeof(header))
+    {
+        return (errno != 0 ? errno : EIO);
+    }
+
+    ns_parray = fdir_namespace_get_all();
+    ns_end = ns_parray->namespaces + ns_parray->count;
+    for (ns_entry=ns_parray->namespaces; ns_entry<ns_end; ns_entry++) {
+        if ((result=output_namespace(&writer, *ns_entry)) != 0) {
+            return result;
+        }
+    }
+    if ((result=writer_flush(&writer)) != 0) {
+        return result;
+    }
+
+    info.binlog_index = 0;
+    info.binlog_offset = 0;
+    info.data_version = data_version;
+    info.record_count = writer.record_count;
+    info.body_size = writer.body_size;
+    pack_header(&info, &header);
+    if (pwrite(writer.fd, &header, sizeof(header), 0) != sizeof(header)) {
+        return (errno != 0 ? errno : EIO);
+    }
+    if (fsync(writer.fd) != 0) {
+        return (errno != 0 ? errno : EIO);
+    }
+
+    close(writer.fd);
+    return 0;
+}
+
+static int read_snapshot_info(const char *filename, FDIRSnapshotInfo *info)
+{
+    FDIRSnapshotHeader header;
+    struct stat stbuf;
+    int64_t bytes;
+    int result;
+
+    if (stat(filename, &stbuf) != 0) {
+        return (errno != 0 ? errno : ENOENT);
+    }
+
+    bytes = sizeof(header);
+    if ((result=getFileContentEx(filename, (char *)&header,
+                    0, &bytes)) != 0)
+    {
+        return result;
+    }
+
+    if (bytes != sizeof(header) || memcmp(header.magic,
+                SNAPSHOT_MAGIC_STR, SNAPSHOT_MAGIC_LEN) != 0 ||
+            buff2int(header.format_version) != SNAPSHOT_FORMAT_VERSION)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "snapshot file: %s, invalid file header",
+                __LINE__, filename);
+        return EINVAL;
+    }
+
+    info->binlog_index = buff2int(header.binlog_index);
+    info->binlog_offset = buff2long(header.binlog_offset);
+    info->data_version = buff2long(header.data_version);
+    info->record_count = buff2long(header.record_count);
+    info->body_size = buff2long(header.body_size);
+    if (info->body_size != stbuf.st_size - (int64_t)sizeof(header)) {
+        logError("file: "__FILE__", line: %d, "
+                "snapshot file: %s, body size: %"PRId64" != "
+                "file size: %"PRId64" - header size: %d", __LINE__,
+                filename, info->body_size, (int64_t)stbuf.st_size,
+                (int)sizeof(header));
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+static int wait_child_done(const pid_t pid, const char *tmp_filename,
+        FDIRSnapshotInfo *info)
+{
+    int status;
+    int result;
+
+    while (waitpid(pid, &status, 0) < 0) {
+        result = (errno != 0 ? errno : EINTR);
+        if (result == EINTR) {
+            continue;
+        }
+
+        if (result != ECHILD) {
+            return result;
+        }
+
+        //SIGCHLD ignored, check the snapshot file instead
+        return read_snapshot_info(tmp_filename, info);
+    }
+
+    if (WIFEXITED(status)) {
+        if ((result=WEXITSTATUS(status)) != 0) {
+            return result;
+        }
+    } else {
+        return EINTR;
+    }
+
+    return read_snapshot_info(tmp_filename, info);
+}
+
+//the binlog records before the snapshot version MUST be written
+static int wait_binlog_written(const int64_t data_version,
+        SFBinlogFilePosition *binlog_pos)
+{
+    int64_t start_time_ms;
+
+    start_time_ms = get_current_time_ms();
+    while (binlog_writer_get_last_version() < data_version) {
+        if (!SF_G_CONTINUE_FLAG) {
+            return EINTR;
+        }
+        if (get_current_time_ms() - start_time_ms >
+                SNAPSHOT_WAIT_BINLOG_TIMEOUT_MS)
+        {
+            return ETIMEDOUT;
+        }
+        fc_sleep_ms(10);
+    }
+
+    binlog_get_current_write_position(binlog_pos);
+    return 0;
+}
+
+static int finish_snapshot_file(const char *tmp_filename,
+        FDIRSnapshotInfo *info)
+{
+    char filename[PATH_MAX];
+    FDIRSnapshotHeader header;
+    int bytes;
+    int fd;
+    int result;
+
+    if ((fd=open(tmp_filename, O_WRONLY)) < 0) {
+        result = (errno != 0 ? errno : EACCES);
+        logError("file: "__FILE__", line: %d, "
+                "open file %s fail, errno: %d, error info: %s",
+                __LINE__, tmp_filename, result, STRERROR(result));
+        return result;
+    }
+
+    //fill the binlog position only
+    pack_header(info, &header);
+    bytes = sizeof(header.binlog_index) + sizeof(header.binlog_offset);
+    if (pwrite(fd, header.binlog_index, bytes, header.binlog_index -
+                header.magic) != bytes || fsync(fd) != 0)
+    {
+        result = (errno != 0 ? errno : EIO);
+        logError("file: "__FILE__", line: %d, "
+                "write to file %s fail, errno: %d, error info: %s",
+                __LINE__, tmp_filename, result, STRERROR(result));
+        close(fd);
+        return result;
+    }
+    close(fd);
+
+    get_snapshot_filename(SNAPSHOT_FILENAME, filename, sizeof(filename));
+    if (rename(tmp_filename, filename) != 0) {
+        result = (errno != 0 ? errno : EPERM);
+        logError("file: "__FILE__", line: %d, "
+                "rename file %s to %s fail, errno: %d, error info: %s",
+                __LINE__, tmp_filename, filename, result, STRERROR(result));
+        return result;
+    }
+
+    return 0;
+}
+
+static int save_snapshot()
+{
+    char tmp_filename[PATH_MAX];
+    FDIRSnapshotInfo info;
+    SFBinlogFilePosition binlog_pos;
+    int64_t start_time_ms;
+    int64_t data_version;
+    pid_t pid;
+    int result;
+
+    start_time_ms = get_current_time_ms();
+    get_snapshot_filename(SNAPSHOT_TMP_FILENAME,
+            tmp_filename, sizeof(tmp_filename));
+
+    /* pause the data threads for the consistent data version,
+       the replicated records of the slave must be applied continuously */
+    while (1) {
+        data_thread_exclusive_enter(NULL);
+        if (binlog_replay_inflight_batches() == 0) {
+            break;
+        }
+        data_thread_exclusive_leave(NULL);
+
+        if (!SF_G_CONTINUE_FLAG) {
+            return EINTR;
+        }
+        fc_sleep_ms(1);
+    }
+
+    data_version = FC_ATOMIC_GET(DATA_CURRENT_VERSION);
+    if ((pid=fork()) == 0) {
+#ifdef OS_LINUX
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+        _exit(write_snapshot_file(tmp_filename, data_version));
+    }
+    result = (pid < 0 ? (errno != 0 ? errno : EAGAIN) : 0);
+    data_thread_exclusive_leave(NULL);
+
+    if (result != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "fork fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return result;
+    }
+
+    if ((result=wait_child_done(pid, tmp_filename, &info)) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "write snapshot file %s fail, errno: %d, error info: %s",
+                __LINE__, tmp_filename, result, STRERROR(result));
+        unlink(tmp_filename);
+        return result;
+    }
+
+    if ((result=wait_binlog_written(data_version, &binlog_pos)) != 0) {
+        logWarning("file: "__FILE__", line: %d, "
+                "wait binlog written to data version: %"PRId64" fail, "
+                "errno: %d, error info: %s, discard the snapshot",
+                __LINE__, data_version, result, STRERROR(result));
+        unlink(tmp_filename);
+        return result;
+    }
+
+    info.binlog_index = binlog_pos.index;
+    info.binlog_offset = binlog_pos.offset;
+    if ((result=finish_snapshot_file(tmp_filename, &info)) != 0) {
+        return result;
+    }
+
+    last_snapshot_version = data_version;
+    logInfo("file: "__FILE__", line: %d, "
+            "save snapshot done, data version: %"PRId64", record count: "
+            "%"PRId64", file size: %"PRId64", time used: %"PRId64" ms",
+            __LINE__, data_version, info.record_count, info.body_size +
+            (int64_t)sizeof(FDIRSnapshotHeader),
+            get_current_time_ms() - start_time_ms);
+    return 0;
+}
+
+static void *snapshot_thread_func(void *arg)
+{
+    time_t last_time;
+
+#ifdef OS_LINUX
+    prctl(PR_SET_NAME, "data-snapshot");
+#endif
+
+    last_time = g_current_time;
+    while (SF_G_CONTINUE_FLAG) {
+        sleep(1);
+        if (g_current_time - last_time < SNAPSHOT_INTERVAL) {
+            continue;
+        }
+        last_time = g_current_time;
+
+        if (FC_ATOMIC_GET(DATA_CURRENT_VERSION) != last_snapshot_version) {
+            save_snapshot();
+        }
+    }
+
+    return NULL;
+}
+
+int data_snapshot_init()
+{
+    char path[PATH_MAX];
+    pthread_t tid;
+    int result;
+
+    if (SNAPSHOT_INTERVAL <= 0) {
+        return 0;
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", DATA_PATH_STR,
+            FDIR_SNAPSHOT_SUBDIR_NAME);
+    if ((result=fc_check_mkdir(path, 0755)) != 0) {
+        return result;
+    }
+
+    return fc_create_thread(&tid, snapshot_thread_func,
+            NULL, SF_G_THREAD_STACK_SIZE);
+}
+
+static inline int get_record_size(const char *p, const char *end)
+{
+    const char *size_end;
+    int size;
+
+    if (end - p < BINLOG_RECORD_SIZE_STRLEN) {
+        return -1;
+    }
+
+    size = 0;
+    size_end = p + BINLOG_RECORD_SIZE_STRLEN;
+    while (p < size_end) {
+        if (!(*p >= '0' && *p <= '9')) {
+            return -1;
+        }
+        size = size * 10 + (*p++ - '0');
+    }
+    return BINLOG_RECORD_SIZE_STRLEN + size;
+}
+
+/* split the body into the buffers for the parse threads,
+ * the buffer size MUST <= BINLOG_BUFFER_SIZE */
+static int split_snapshot_body(char *body, const int64_t body_size,
+        BinlogReadThreadResult **results, int *count)
+{
+    BinlogReadThreadResult *r;
+    char *p;
+    char *end;
+    char *start;
+    int alloc;
+    int size;
+
+    *results = NULL;
+    *count = alloc = 0;
+    p = body;
+    end = body + body_size;
+    while (p < end) {
+        start = p;
+        while (p < end) {
+            if ((size=get_record_size(p, end)) < BINLOG_RECORD_MIN_SIZE ||
+                    size > end - p)
+            {
+                logError("file: "__FILE__", line: %d, "
+                        "snapshot offset: %"PRId64", invalid record",
+                        __LINE__, (int64_t)(p - body));
+                return EINVAL;
+            }
+            if ((p + size) - start > BINLOG_BUFFER_SIZE) {
+                break;
+            }
+            p += size;
+        }
+        if (p == start) {  //the record is larger than the buffer
+            return EOVERFLOW;
+        }
+
+        if (*count == alloc) {
+            alloc = (alloc == 0 ? 64 : alloc * 2);
+            r = (BinlogReadThreadResult *)realloc(*results,
+                    sizeof(BinlogReadThreadResult) * alloc);
+            if (r == NULL) {
+                return ENOMEM;
+            }
+            *results = r;
+        }
+
+        r = *results + (*count)++;
+        memset(r, 0, sizeof(*r));
+        r->buffer.buff = start;
+        r->buffer.length = p - start;
+    }
+
+    return 0;
+}
+
+static int replay_snapshot_body(char *body, const int64_t body_size,
+        const int parse_threads, const bool shard_dispatch,
+        int64_t *record_count)
+{
+    BinlogReplayMTContext replay_ctx;
+    BinlogReadThreadResult *results;
+    BinlogReadThreadResult *r;
+    BinlogReadThreadResult *end;
+    int count;
+    int result;
+
+    if ((result=split_snapshot_body(body, body_size,
+                    &results, &count)) == 0)
+    {
+        result = binlog_replay_mt_init_ex(&replay_ctx, NULL,
+                parse_threads, shard_dispatch);
+    }
+    if (result != 0) {
+        free(results);
+        return result;
+    }
+
+    end = results + count;
+    for (r=results; r<end && SF_G_CONTINUE_FLAG &&
+            replay_ctx.fail_count == 0; r++)
+    {
+        if ((result=binlog_replay_mt_parse_buffer(&replay_ctx, r)) != 0) {
+            break;
+        }
+    }
+
+    binlog_replay_mt_read_done(&replay_ctx);
+    binlog_replay_mt_destroy(&replay_ctx);
+    free(results);
+
+    if (result == 0) {
+        if (replay_ctx.fail_count > 0) {
+            result = replay_ctx.last_errno;
+        } else if (!SF_G_CONTINUE_FLAG) {
+            result = EINTR;
+        }
+    }
+    *record_count = replay_ctx.record_count;
+    return result;
+}
+
+int data_snapshot_load(const int parse_threads, const bool shard_dispatch,
+        int64_t *data_version, SFBinlogFilePosition *binlog_pos)
+{
+    char filename[PATH_MAX];
+    FDIRSnapshotInfo info;
+    int64_t max_version;
+    int64_t record_count;
+    int64_t start_time_ms;
+    int64_t file_size;
+    char *addr;
+    int fd;
+    int result;
+
+    get_snapshot_filename(SNAPSHOT_FILENAME, filename, sizeof(filename));
+    if (access(filename, F_OK) != 0) {
+        return ENOENT;
+    }
+
+    if (read_snapshot_info(filename, &info) != 0) {
+        return ENOENT;
+    }
+
+    if ((result=binlog_get_max_record_version(&max_version)) != 0 ||
+            max_version < info.data_version)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "snapshot data version: %"PRId64" > binlog max version: "
+                "%"PRId64", ignore the snapshot file %s", __LINE__,
+                info.data_version, (result == 0 ? max_version : 0),
+                filename);
+        return ENOENT;
+    }
+
+    if ((fd=open(filename, O_RDONLY)) < 0) {
+        result = (errno != 0 ? errno : EACCES);
+        logError("file: "__FILE__", line: %d, "
+                "open file %s fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        return result;
+    }
+
+    start_time_ms = get_current_time_ms();
+    file_size = sizeof(FDIRSnapshotHeader) + info.body_size;
+    addr = (char *)mmap(NULL, file_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        result = (errno != 0 ? errno : ENOMEM);
+        logError("file: "__FILE__", line: %d, "
+                "mmap file %s fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        return result;
+    }
+
+    logInfo("file: "__FILE__", line: %d, "
+            "loading snapshot, data version: %"PRId64", record count: "
+            "%"PRId64" ...", __LINE__, info.data_version, info.record_count);
+    result = replay_snapshot_body(addr + sizeof(FDIRSnapshotHeader),
+            info.body_size, parse_threads, shard_dispatch, &record_count);
+    munmap(addr, file_size);
+    if (result != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "load snapshot file %s fail, errno: %d, error info: %s, "
+                "you can remove this file and restart", __LINE__,
+                filename, result, STRERROR(result));
+        return (result == ENOENT ? EINVAL : result);
+    }
+
+    FC_ATOMIC_SET(DATA_CURRENT_VERSION, info.data_version);
+    last_snapshot_version = info.data_version;
+    *data_version = info.data_version;
+    binlog_pos->index = info.binlog_index;
+    binlog_pos->offset = info.binlog_offset;
+
+    logInfo("file: "__FILE__", line: %d, "
+            "load snapshot done, data version: %"PRId64", record count: "
+            "%"PRId64", time used: %"PRId64" ms", __LINE__,
+            info.data_version, record_count,
+            get_current_time_ms() - start_time_ms);
+    return 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//data_snapshot.h
+
+#ifndef _DATA_SNAPSHOT_H_
+#define _DATA_SNAPSHOT_H_
+
+#include "server_types.h"
+
+#define FDIR_SNAPSHOT_SUBDIR_NAME  "snapshot"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//start the snapshot thread when snapshot_interval > 0
+int data_snapshot_init();
+
+/* load the dentries from the snapshot file before the binlog replay
+ * data_version: return the data version of the snapshot
+ * binlog_pos: return the binlog position as the hint of the replay
+ * return ENOENT when the snapshot not exist or unusable
+ */
+int data_snapshot_load(const int parse_threads, const bool shard_dispatch,
+        int64_t *data_version, SFBinlogFilePosition *binlog_pos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,6 +15,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -35,14 +36,20 @@
 #include "dentry.h"
 #include "inode_index.h"
 #include "service_handler.h"
+#include "invalidate_subscribe.h"
+#include "latency_stat.h"
+#include "server_func.h"
 #include "db/change_notify.h"
 #include "db/dentry_serializer.h"
+#include "db/children_chunk.h"
 #include "db/dentry_loader.h"
+#include "db/dentry_lru.h"
 #include "data_thread.h"
 
 #define DATA_THREAD_RUNNING_COUNT g_data_thread_vars.running_count
 
 FDIRDataThreadVariables g_data_thread_vars = {{NULL, 0}, 0, 0};
+__thread int g_read_epoch_slot_index = -1;
 static void *data_thread_func(void *arg);
 
 void data_thread_sum_counters(FDIRDentryCounters *counters)
@@ -69,12 +76,18 @@ static inline void add_to_delay_free_queue(ServerDelayFreeContext *dfctx,
 {
     node->expires = g_current_time + delay_seconds;
     node->next = NULL;
+    if (DATA_SHARD_ENABLED) {
+        PTHREAD_MUTEX_LOCK(&dfctx->lock);
+    }
     if (dfctx->queue.head == NULL) {
         dfctx->queue.head = node;
     } else {
         dfctx->queue.tail->next = node;
     }
     dfctx->queue.tail = node;
+    if (DATA_SHARD_ENABLED) {
+        PTHREAD_MUTEX_UNLOCK(&dfctx->lock);
+    }
 }
 
 int server_add_to_delay_free_queue(ServerFreeContext *free_ctx, void *ptr,
@@ -92,6 +105,7 @@ int server_add_to_delay_free_queue(ServerFreeContext *free_ctx, void *ptr,
     node->free_func_ex = NULL;
     node->ctx = NULL;
     node->ptr = ptr;
+    node->epoch = (LOCKFREE_QUERY_ENABLED ? data_thread_retire_epoch() : 0);
     add_to_delay_free_queue(&free_ctx->delay, node, delay_seconds);
     return 0;
 }
@@ -112,6 +126,7 @@ int server_add_to_delay_free_queue_ex(ServerFreeContext *free_ctx,
     node->free_func_ex = free_func_ex;
     node->ctx = ctx;
     node->ptr = ptr;
+    node->epoch = (LOCKFREE_QUERY_ENABLED ? data_thread_retire_epoch() : 0);
     add_to_delay_free_queue(&free_ctx->delay, node, delay_seconds);
     return 0;
 }
@@ -131,6 +146,7 @@ int server_add_to_immediate_free_queue_ex(ServerFreeContext *free_ctx,
     node->free_func_ex = free_func_ex;
     node->ctx = ctx;
     node->ptr = ptr;
+    node->epoch = (LOCKFREE_QUERY_ENABLED ? data_thread_retire_epoch() : 0);
     __sync_add_and_fetch(&free_ctx->immediate.waiting_count, 1);
     fc_queue_push_silence(&free_ctx->immediate.queue, node);
     return 0;
@@ -151,17 +167,47 @@ int server_add_to_immediate_free_queue(ServerFreeContext *free_ctx,
     node->free_func_ex = NULL;
     node->ctx = NULL;
     node->ptr = ptr;
+    node->epoch = (LOCKFREE_QUERY_ENABLED ? data_thread_retire_epoch() : 0);
     __sync_add_and_fetch(&free_ctx->immediate.waiting_count, 1);
     fc_queue_push_silence(&free_ctx->immediate.queue, node);
     return 0;
 }
 
+static int64_t get_min_read_epoch()
+{
+    volatile int64_t *slot;
+    volatile int64_t *end;
+    int64_t epoch;
+    int64_t min_epoch;
+    int count;
+
+    count = __sync_add_and_fetch(&g_data_thread_vars.
+            read_epoch.next_slot, 0);
+    if (count > FDIR_READ_EPOCH_MAX_SLOTS) {
+        count = FDIR_READ_EPOCH_MAX_SLOTS;
+    }
+
+    min_epoch = INT64_MAX;
+    end = g_data_thread_vars.read_epoch.slots + count;
+    for (slot=g_data_thread_vars.read_epoch.slots; slot<end; slot++) {
+        epoch = __sync_add_and_fetch(slot, 0);
+        if (epoch > 0 && epoch < min_epoch) {
+            min_epoch = epoch;
+        }
+    }
+
+    return min_epoch;
+}
+
 static void deal_delay_free_queue(FDIRDataThreadContext *thread_ctx)
 {
     ServerDelayFreeContext *delay_context;
+    ServerDelayFreeNode *head;
+    ServerDelayFreeNode *tail;
     ServerDelayFreeNode *node;
     struct fast_mblock_node *current;
     struct fast_mblock_chain chain;
+    int64_t min_epoch;
 
     delay_context = &thread_ctx->free_context.delay;
     if (delay_context->last_check_time == g_current_time ||
@@ -170,10 +216,38 @@ static void deal_delay_free_queue(FDIRDataThreadContext *thread_ctx)
         return;
     }
 
-    chain.head = chain.tail = NULL;
     delay_context->last_check_time = g_current_time;
-    node = delay_context->queue.head;
-    while ((node != NULL) && (node->expires < g_current_time)) {
+    min_epoch = (LOCKFREE_QUERY_ENABLED ? get_min_read_epoch() : INT64_MAX);
+
+    /* detach the expired nodes first because the free functions
+     * maybe add new nodes to this queue */
+    if (DATA_SHARD_ENABLED) {
+        PTHREAD_MUTEX_LOCK(&delay_context->lock);
+    }
+    head = node = delay_context->queue.head;
+    tail = NULL;
+    while ((node != NULL) && (node->expires < g_current_time) &&
+            (node->epoch < min_epoch))
+    {
+        tail = node;
+        node = node->next;
+    }
+    delay_context->queue.head = node;
+    if (node == NULL) {
+        delay_context->queue.tail = NULL;
+    }
+    if (DATA_SHARD_ENABLED) {
+        PTHREAD_MUTEX_UNLOCK(&delay_context->lock);
+    }
+
+    if (tail == NULL) {
+        return;
+    }
+    tail->next = NULL;
+
+    chain.head = chain.tail = NULL;
+    node = head;
+    while (node != NULL) {
         if (node->free_func != NULL) {
             node->free_func(node->ptr);
         } else {
@@ -191,17 +265,43 @@ static void deal_delay_free_queue(FDIRDataThreadContext *thread_ctx)
         node = node->next;
     }
 
-    if (chain.head == NULL) {
-        return;
-    }
-
     chain.tail->next = NULL;
     fast_mblock_batch_free(&thread_ctx->free_context.allocator, &chain);
+}
 
-    delay_context->queue.head = node;
-    if (node == NULL) {
-        delay_context->queue.tail = NULL;
-    }
+/* the nodes maybe read by the lockfree query are moved to the delay queue */
+static void deal_immediate_free_chain(FDIRDataThreadContext *thread_ctx,
+        ServerDelayFreeNode *head)
+{
+    ServerDelayFreeNode *node;
+    ServerDelayFreeNode *next;
+    int64_t min_epoch;
+    int count;
+
+    min_epoch = get_min_read_epoch();
+    count = 0;
+    node = head;
+    do {
+        next = node->next;
+        if (node->epoch < min_epoch) {
+            if (node->free_func != NULL) {
+                node->free_func(node->ptr);
+            } else {
+                node->free_func_ex(node->ctx, node->ptr);
+            }
+            fast_mblock_free_object(&thread_ctx->
+                    free_context.allocator, node);
+        } else {
+            add_to_delay_free_queue(&thread_ctx->
+                    free_context.delay, node, 0);
+        }
+
+        ++count;
+        node = next;
+    } while (node != NULL);
+
+    __sync_sub_and_fetch(&thread_ctx->free_context.
+            immediate.waiting_count, count);
 }
 
 static void deal_immediate_free_queue(FDIRDataThreadContext *thread_ctx)
@@ -216,6 +316,11 @@ static void deal_immediate_free_queue(FDIRDataThreadContext *thread_ctx)
         return;
     }
 
+    if (LOCKFREE_QUERY_ENABLED) {
+        deal_immediate_free_chain(thread_ctx, qinfo.head);
+        return;
+    }
+
     count = 0;
     node = qinfo.head;
     do {
@@ -256,6 +361,14 @@ static int init_thread_ctx(FDIRDataThreadContext *context)
         return result;
     }
 
+    if (DATA_SHARD_ENABLED) {
+        if ((result=init_pthread_lock(&context->
+                        free_context.delay.lock)) != 0)
+        {
+            return result;
+        }
+    }
+
     if ((result=fast_mblock_init_ex1(&context->free_context.allocator,
                     "delay_free_node", sizeof(ServerDelayFreeNode),
                     16 * 1024, 0, NULL, NULL, true)) != 0)
@@ -327,6 +440,7 @@ int data_thread_init()
     int result;
     int count;
     int limit;
+    int bytes;
 
     if (STORAGE_ENABLED) {
         if (BATCH_STORE_ON_MODIFIES < 1000) {
@@ -353,6 +467,25 @@ int data_thread_init()
         return result;
     }
 
+    if (LOCKFREE_QUERY_ENABLED) {
+        bytes = sizeof(int64_t) * FDIR_READ_EPOCH_MAX_SLOTS;
+        g_data_thread_vars.read_epoch.slots = (volatile int64_t *)
+            fc_malloc(bytes);
+        if (g_data_thread_vars.read_epoch.slots == NULL) {
+            return ENOMEM;
+        }
+        memset((void *)g_data_thread_vars.read_epoch.slots, 0, bytes);
+        g_data_thread_vars.read_epoch.current = 1;
+    }
+
+    //the exclusive section is also used by the snapshot
+    if ((result=init_pthread_lock_cond_pair(&g_data_thread_vars.
+                    shard.lcp)) != 0)
+    {
+        return result;
+    }
+    g_data_thread_vars.shard.owner = DATA_SHARD_OWNER_NONE;
+
     g_data_thread_vars.error_mode = FDIR_DATA_ERROR_MODE_LOOSE;
     count = g_data_thread_vars.thread_array.count;
     if ((result=create_work_threads_ex(&count, data_thread_func,
@@ -422,6 +555,58 @@ static inline int check_parent(FDIRDataThreadContext *thread_ctx,
             me.pname.parent_inode, &record->me.parent);
 }
 
+/* the path resolved by the data shard is used when the walk is done */
+static int record_find_parent(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    int result;
+
+    switch (record->path_walk.stage) {
+        case fdir_path_walk_parent:
+            record->me.pname.name = record->path_walk.name;
+            if ((result=inode_index_get_dentry(thread_ctx, record->
+                            path_walk.inode, &record->me.parent)) != 0)
+            {
+                record->me.parent = NULL;
+                return result;
+            }
+            if (!S_ISDIR(record->me.parent->stat.mode)) {
+                record->me.parent = NULL;
+                return ENOTDIR;
+            }
+            return 0;
+        case fdir_path_walk_fail:
+            record->me.parent = NULL;
+            return record->path_walk.result;
+        default:
+            return dentry_find_parent(&record->me.fullname,
+                    &record->me.parent, &record->me.pname.name);
+    }
+}
+
+static int record_find_me(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record, const bool hdlink_follow)
+{
+    int result;
+
+    switch (record->path_walk.stage) {
+        case fdir_path_walk_target:
+            return inode_index_get_dentry(thread_ctx, record->
+                    path_walk.inode, &record->me.dentry);
+        case fdir_path_walk_parent:
+            if ((result=record_find_parent(thread_ctx, record)) != 0) {
+                return result;
+            }
+            return dentry_find_by_pname_ex(record->me.parent, &record->
+                    me.pname.name, &record->me.dentry, hdlink_follow);
+        case fdir_path_walk_fail:
+            return record->path_walk.result;
+        default:
+            return dentry_find_ex(&record->me.fullname,
+                    &record->me.dentry, hdlink_follow);
+    }
+}
+
 static int find_or_check_parent(FDIRDataThreadContext *thread_ctx,
         FDIRBinlogRecord *record)
 {
@@ -440,9 +625,7 @@ static int find_or_check_parent(FDIRDataThreadContext *thread_ctx,
             */
 
     is_create = (record->operation == BINLOG_OP_CREATE_DENTRY_INT);
-    if ((result=dentry_find_parent(&record->me.fullname, &record->
-                    me.parent, &record->me.pname.name)) != 0)
-    {
+    if ((result=record_find_parent(thread_ctx, record)) != 0) {
         if (!(result == ENOENT && is_create)) {
             return result;
         }
@@ -563,6 +746,7 @@ static inline int deal_record_rename_op(FDIRDataThreadContext *thread_ctx,
 static inline int xattr_update_prepare(FDIRDataThreadContext *thread_ctx,
         FDIRBinlogRecord *record)
 {
+    const bool hdlink_follow = true;
     int result;
 
     if (record->dentry_type == fdir_dentry_type_inode) {
@@ -570,7 +754,7 @@ static inline int xattr_update_prepare(FDIRDataThreadContext *thread_ctx,
                 record->inode, &record->me.dentry);
     }
 
-    if ((result=dentry_find(&record->me.fullname, &record->me.dentry)) != 0) {
+    if ((result=record_find_me(thread_ctx, record, hdlink_follow)) != 0) {
         return result;
     }
 
@@ -621,46 +805,58 @@ static int batch_set_dentry_size(FDIRDataThreadContext *thread_ctx,
     return 0;
 }
 
+static int compare_id_name_pair(const id_name_pair_t *pair1,
+        const id_name_pair_t *pair2)
+{
+    return fc_compare_int64(pair1->id, pair2->id);
+}
+
 static int check_load_children(FDIRServerDentry *parent)
 {
     int result;
-    int target_count;
+    int count;
     FDIRServerDentry *child;
-    id_name_pair_t pair;
-    UniqSkiplistIterator it;
+    id_name_pair_t *pairs;
+    id_name_pair_t *pair;
+    FDIRChildIndexIterator it;
 
     if ((parent->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_CLIST) != 0) {
         return 0;
     }
 
-    target_count = 0;
-    uniq_skiplist_iterator(parent->children, &it);
-    while ((child=(FDIRServerDentry *)uniq_skiplist_next(&it)) != NULL) {
-        ++target_count;
-    }
-
-    if (target_count > 0) {
-        parent->db_args->children = id_name_array_allocator_alloc(
-                &ID_NAME_ARRAY_ALLOCATOR_CTX, target_count);
-        if (parent->db_args->children == NULL) {
+    count = child_index_count(parent->children);
+    if (count > 0) {
+        pairs = (id_name_pair_t *)fc_malloc(sizeof(id_name_pair_t) * count);
+        if (pairs == NULL) {
             return ENOMEM;
         }
 
-        uniq_skiplist_iterator(parent->children, &it);
-        while ((child=(FDIRServerDentry *)uniq_skiplist_next(&it)) != NULL) {
-            pair.id = child->inode;
-            if ((result=dentry_strdup(parent->context,
-                            &pair.name, &child->name)) != 0)
-            {
-                return result;
-            }
-            if ((result=sorted_array_insert(&ID_NAME_SORTED_ARRAY_CTX,
-                            parent->db_args->children->elts, &parent->
-                            db_args->children->count, &pair)) != 0)
+        pair = pairs;
+        child_index_iterator(parent->children, &it);
+        while ((child=child_index_next(&it)) != NULL) {
+            pair->id = child->inode;
+            if ((result=dentry_strdup(FDIR_DENTRY_CONTEXT(parent),
+                            &pair->name, &child->name)) != 0)
             {
+                free(pairs);
                 return result;
             }
+            pair++;
         }
+
+        qsort(pairs, count, sizeof(id_name_pair_t), (int (*)(const void *,
+                        const void *))compare_id_name_pair);
+    } else {
+        pairs = NULL;
+    }
+
+    result = children_chunk_array_build(&parent->db_args->
+            children, pairs, count);
+    if (pairs != NULL) {
+        free(pairs);
+    }
+    if (result != 0) {
+        return result;
     }
 
     parent->loaded_flags |= FDIR_DENTRY_LOADED_FLAGS_CLIST;
@@ -677,7 +873,7 @@ static int check_load_children(FDIRServerDentry *parent)
                 op_type, FDIR_PIECE_FIELD_INDEX_CHILDREN, 0);  \
         if ((dentry)->parent->add_to_clist) { \
             (msg)->child.id = (dentry)->inode;  \
-            if ((result=dentry_strdup((dentry)->context, &(msg)-> \
+            if ((result=dentry_strdup(FDIR_DENTRY_CONTEXT(dentry), &(msg)-> \
                             child.name, &(dentry)->name)) != 0)   \
             {  \
                 return result; \
@@ -945,7 +1141,7 @@ static int push_to_db_update_queue(FDIRDataThreadContext *thread_ctx,
     return 0;
 }
 
-static int push_batch_set_dsize_to_db_update_queue(FDIRDataThreadContext
+static int push_batch_records_to_db_update_queue(FDIRDataThreadContext
         *thread_ctx, FDIRBinlogRecord *record)
 {
     FDIRBinlogRecord **pp;
@@ -964,15 +1160,14 @@ static int push_batch_set_dsize_to_db_update_queue(FDIRDataThreadContext
     return 0;
 }
 
-static int deal_update_record(FDIRDataThreadContext *thread_ctx,
-        FDIRBinlogRecord *record)
+static int batch_update_records(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record);
+
+static int do_update_record(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record, int *ignore_errno)
 {
     int result;
-    int ignore_errno;
-    bool set_data_verson;
-    bool is_error;
 
-    record->affected.count = 0;
     switch (record->operation) {
         case BINLOG_OP_CREATE_DENTRY_INT:
         case BINLOG_OP_REMOVE_DENTRY_INT:
@@ -981,7 +1176,7 @@ static int deal_update_record(FDIRDataThreadContext *thread_ctx,
                         "hash code: %u, inode: %"PRId64", get parent: %"
                         PRId64", fail", __LINE__, record->hash_code,
                         record->inode, record->me.pname.parent_inode);
-                ignore_errno = 0;
+                *ignore_errno = 0;
                 break;
             }
             if (record->operation == BINLOG_OP_CREATE_DENTRY_INT) {
@@ -989,7 +1184,7 @@ static int deal_update_record(FDIRDataThreadContext *thread_ctx,
                     if ((result=set_hdlink_src_dentry(thread_ctx,
                                     record)) != 0)
                     {
-                        ignore_errno = 0;
+                        *ignore_errno = 0;
                         break;
                     }
                 } else if (S_ISLNK(record->stat.mode) && record->dentry_type
@@ -999,40 +1194,40 @@ static int deal_update_record(FDIRDataThreadContext *thread_ctx,
                                     (struct fast_task_info *)
                                     record->notify.args)) != 0)
                     {
-                        ignore_errno = 0;
+                        *ignore_errno = 0;
                         break;
                     }
                 }
                 result = dentry_create(thread_ctx, record);
-                ignore_errno = EEXIST;
+                *ignore_errno = EEXIST;
             } else {
                 result = dentry_remove(thread_ctx, record);
-                ignore_errno = ENOENT;
+                *ignore_errno = ENOENT;
             }
             break;
         case BINLOG_OP_RENAME_DENTRY_INT:
-            ignore_errno = 0;
+            *ignore_errno = 0;
             result = deal_record_rename_op(thread_ctx, record);
             break;
         case BINLOG_OP_UPDATE_DENTRY_INT:
             result = inode_index_update_dentry(thread_ctx, record);
-            ignore_errno = 0;
+            *ignore_errno = 0;
             break;
         case BINLOG_OP_SET_XATTR_INT:
             if ((result=xattr_update_prepare(thread_ctx, record)) == 0) {
                 result = inode_index_set_xattr(record->me.dentry, record);
             }
-            ignore_errno = 0;
+            *ignore_errno = 0;
             break;
         case BINLOG_OP_REMOVE_XATTR_INT:
             if ((result=xattr_update_prepare(thread_ctx, record)) == 0) {
                 result = inode_index_remove_xattr(record->me.dentry,
                         &record->xattr.key);
             }
-            ignore_errno = ENODATA;
+            *ignore_errno = ENODATA;
             break;
         case SERVICE_OP_SYS_LOCK_RELEASE_INT:
-            ignore_errno = 0;
+            *ignore_errno = 0;
             if ((result=service_sys_lock_release((struct fast_task_info *)
                             record->notify.args, true)) != 0)
             {
@@ -1040,7 +1235,7 @@ static int deal_update_record(FDIRDataThreadContext *thread_ctx,
             }
             record->operation = SERVICE_OP_SET_DSIZE_INT;
         case SERVICE_OP_SET_DSIZE_INT:
-            ignore_errno = 0;
+            *ignore_errno = 0;
             if ((result=inode_index_check_set_dentry_size(
                             thread_ctx, record)) == 0)
             {
@@ -1051,16 +1246,79 @@ static int deal_update_record(FDIRDataThreadContext *thread_ctx,
             }
             break;
         case SERVICE_OP_BATCH_SET_DSIZE_INT:
-            ignore_errno = ENOENT;
+            *ignore_errno = ENOENT;
             result = batch_set_dentry_size(thread_ctx, record);
             break;
+        case SERVICE_OP_BATCH_UPDATE_INT:
+            *ignore_errno = 0;
+            result = batch_update_records(thread_ctx, record);
+            break;
         default:
-            ignore_errno = 0;
+            *ignore_errno = 0;
             result = 0;
             break;
     }
 
+    if (result == 0) {
+        invalidate_subscribe_notify(record);
+    }
+    return result;
+}
+
+/* execute the sub records in order, the failure of one record
+ * does NOT stop the following records */
+static int batch_update_records(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    FDIRBinlogRecord **pp;
+    FDIRBinlogRecord **recend;
+    short *result;
+    int64_t current_version;
+    int ignore_errno;
+
+    record->parray->counts.success = 0;
+    recend = record->parray->records + record->parray->counts.total;
+    for (pp=record->parray->records, result=record->parray->results;
+            pp<recend; pp++, result++)
+    {
+        (*pp)->affected.count = 0;
+        if ((*result=do_update_record(thread_ctx, *pp, &ignore_errno)) == 0) {
+            record->parray->counts.success++;
+        }
+    }
+
+    record->parray->counts.updated = record->parray->counts.success;
+    if (record->parray->counts.updated == 0) {
+        return 0;
+    }
+
+    //the data versions of one batch MUST be continuous
+    record->data_version = __sync_add_and_fetch(&DATA_CURRENT_VERSION,
+            record->parray->counts.updated);
+    current_version = record->data_version - record->parray->counts.updated;
+    for (pp=record->parray->records, result=record->parray->results;
+            pp<recend; pp++, result++)
+    {
+        if (*result == 0) {
+            (*pp)->data_version = ++current_version;
+        }
+    }
+
+    return 0;
+}
+
+static int deal_update_record(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    int result;
+    int ignore_errno;
+    bool set_data_verson;
+    bool is_error;
+
+    record->affected.count = 0;
+    result = do_update_record(thread_ctx, record, &ignore_errno);
     if (record->operation == SERVICE_OP_BATCH_SET_DSIZE_INT ||
+            record->operation == SERVICE_OP_BATCH_UPDATE_INT ||
             record->operation == SERVICE_OP_SET_DSIZE_INT)
     {
         if (record->operation == SERVICE_OP_SET_DSIZE_INT) {
@@ -1098,8 +1356,10 @@ static int deal_update_record(FDIRDataThreadContext *thread_ctx,
             thread_ctx->DATA_THREAD_LAST_VERSION = record->data_version;
         }
 
-        if (record->operation == SERVICE_OP_BATCH_SET_DSIZE_INT) {
-            result = push_batch_set_dsize_to_db_update_queue(
+        if (record->operation == SERVICE_OP_BATCH_SET_DSIZE_INT ||
+                record->operation == SERVICE_OP_BATCH_UPDATE_INT)
+        {
+            result = push_batch_records_to_db_update_queue(
                     thread_ctx, record);
         } else {
             result = push_to_db_update_queue(thread_ctx, record);
@@ -1130,23 +1390,23 @@ static int deal_update_record(FDIRDataThreadContext *thread_ctx,
 static int deal_list_dentry(FDIRDataThreadContext *thread_ctx,
         FDIRBinlogRecord *record)
 {
+    const bool hdlink_follow = false;
     int result;
-    struct fast_task_info *task;
 
-    task = (struct fast_task_info *)record->notify.args;
     if (record->dentry_type == fdir_dentry_type_inode) {
-        if ((result=inode_index_get_dentry(thread_ctx, record->inode,
-                        &record->me.dentry)) != 0)
-        {
-            return result;
-        }
-
-        result = dentry_list(record->me.dentry, &DENTRY_LIST_CACHE.array);
+        result = inode_index_get_dentry(thread_ctx,
+                record->inode, &record->me.dentry);
     } else {
-        result = dentry_list_by_path(&record->me.fullname,
-                &DENTRY_LIST_CACHE.array);
+        result = record_find_me(thread_ctx, record, hdlink_follow);
+    }
+    if (result != 0) {
+        return result;
     }
 
+    //the children are iterated by the notify func in this thread
+    if (STORAGE_ENABLED && S_ISDIR(record->me.dentry->stat.mode)) {
+        result = dentry_check_load(thread_ctx, record->me.dentry);
+    }
     return result;
 }
 
@@ -1178,6 +1438,7 @@ static int deal_sys_lock_apply(FDIRDataThreadContext *thread_ctx,
 static int deal_query_record(FDIRDataThreadContext *thread_ctx,
         FDIRBinlogRecord *record)
 {
+    const bool hdlink_follow = true;
     int result;
     switch (record->operation) {
         case SERVICE_OP_STAT_DENTRY_INT:
@@ -1193,7 +1454,7 @@ static int deal_query_record(FDIRDataThreadContext *thread_ctx,
                         record->me.pname.parent_inode, &record->
                         me.pname.name, &record->me.dentry);
             } else {
-                result = dentry_find(&record->me.fullname, &record->me.dentry);
+                result = record_find_me(thread_ctx, record, hdlink_follow);
             }
 
             if (result == 0) {
@@ -1227,6 +1488,340 @@ static int deal_query_record(FDIRDataThreadContext *thread_ctx,
     return result;
 }
 
+#define shard_timed_wait(milliseconds) \
+    server_cond_timedwait_ms(&g_data_thread_vars.shard.lcp.cond, \
+            &g_data_thread_vars.shard.lcp.lock, milliseconds)
+
+void data_thread_exclusive_enter(FDIRDataThreadContext *thread_ctx)
+{
+    FDIRDataThreadContext *context;
+    FDIRDataThreadContext *end;
+    int owner;
+    int expect_parked;
+
+    if (thread_ctx != NULL) {
+        owner = thread_ctx->index;
+        expect_parked = g_data_thread_vars.thread_array.count - 1;
+    } else {
+        owner = g_data_thread_vars.thread_array.count;
+        expect_parked = g_data_thread_vars.thread_array.count;
+    }
+
+    PTHREAD_MUTEX_LOCK(&g_data_thread_vars.shard.lcp.lock);
+    __sync_add_and_fetch(&g_data_thread_vars.shard.waitings, 1);
+    while (g_data_thread_vars.shard.owner != DATA_SHARD_OWNER_NONE) {
+        if (thread_ctx != NULL) {  //as a paused thread for the owner
+            g_data_thread_vars.shard.parked++;
+            pthread_cond_broadcast(&g_data_thread_vars.shard.lcp.cond);
+        }
+        shard_timed_wait(1);
+        if (thread_ctx != NULL) {
+            g_data_thread_vars.shard.parked--;
+        }
+    }
+    g_data_thread_vars.shard.owner = owner;
+
+    end = g_data_thread_vars.thread_array.contexts +
+        g_data_thread_vars.thread_array.count;
+    while (g_data_thread_vars.shard.parked < expect_parked &&
+            SF_G_CONTINUE_FLAG)
+    {
+        //wake up the idle data threads
+        for (context=g_data_thread_vars.thread_array.contexts;
+                context<end; context++)
+        {
+            if (context != thread_ctx) {
+                fc_queue_terminate(&context->queue);
+            }
+        }
+        shard_timed_wait(1);
+    }
+    PTHREAD_MUTEX_UNLOCK(&g_data_thread_vars.shard.lcp.lock);
+}
+
+void data_thread_exclusive_leave(FDIRDataThreadContext *thread_ctx)
+{
+    PTHREAD_MUTEX_LOCK(&g_data_thread_vars.shard.lcp.lock);
+    g_data_thread_vars.shard.owner = DATA_SHARD_OWNER_NONE;
+    __sync_sub_and_fetch(&g_data_thread_vars.shard.waitings, 1);
+    pthread_cond_broadcast(&g_data_thread_vars.shard.lcp.cond);
+    PTHREAD_MUTEX_UNLOCK(&g_data_thread_vars.shard.lcp.lock);
+}
+
+static void data_thread_shard_checkpoint(FDIRDataThreadContext *thread_ctx)
+{
+    if (__sync_add_and_fetch(&g_data_thread_vars.shard.waitings, 0) == 0) {
+        return;
+    }
+
+    PTHREAD_MUTEX_LOCK(&g_data_thread_vars.shard.lcp.lock);
+    while (g_data_thread_vars.shard.owner != DATA_SHARD_OWNER_NONE &&
+            g_data_thread_vars.shard.owner != thread_ctx->index &&
+            SF_G_CONTINUE_FLAG)
+    {
+        g_data_thread_vars.shard.parked++;
+        pthread_cond_broadcast(&g_data_thread_vars.shard.lcp.cond);
+        shard_timed_wait(1);
+        g_data_thread_vars.shard.parked--;
+    }
+    PTHREAD_MUTEX_UNLOCK(&g_data_thread_vars.shard.lcp.lock);
+}
+
+void data_thread_shard_set_active(const bool active)
+{
+    if (!DATA_SHARD_ENABLED || __sync_add_and_fetch(&g_data_thread_vars.
+                shard.active, 0) == (active ? 1 : 0))
+    {
+        return;
+    }
+
+    if (g_data_thread_vars.thread_array.contexts == NULL ||
+            __sync_add_and_fetch(&DATA_THREAD_RUNNING_COUNT, 0) == 0)
+    {
+        g_data_thread_vars.shard.active = (active ? 1 : 0);
+    } else {
+        data_thread_exclusive_enter(NULL);
+        g_data_thread_vars.shard.active = (active ? 1 : 0);
+        data_thread_exclusive_leave(NULL);
+    }
+
+    logInfo("file: "__FILE__", line: %d, "
+            "data thread dispatch by %s", __LINE__,
+            active ? "subtree shard" : "namespace");
+}
+
+#define SHARD_IS_LOCAL(thread_ctx, inode) \
+    (DATA_SHARD_INDEX(inode) == (thread_ctx)->index)
+
+#define SHARD_RECORD_LOCAL      0
+#define SHARD_RECORD_EXCLUSIVE  1
+#define SHARD_RECORD_FORWARDED  2
+
+static inline int shard_forward_record(FDIRBinlogRecord *record,
+        const int64_t inode)
+{
+    FDIRDataThreadContext *context;
+
+    record->path_walk.inode = inode;
+    context = g_data_thread_vars.thread_array.contexts +
+        DATA_SHARD_INDEX(inode);
+    fc_queue_push(&context->queue, record);
+    return SHARD_RECORD_FORWARDED;
+}
+
+//the error is returned when the record is dealt in this thread
+static inline int shard_walk_fail(FDIRBinlogRecord *record,
+        const int result)
+{
+    record->path_walk.stage = fdir_path_walk_fail;
+    record->path_walk.result = result;
+    return SHARD_RECORD_LOCAL;
+}
+
+/* the parent is owned by this thread, the child and the source
+ * dentry of the hard link should be owned by this thread too */
+static int shard_check_child(FDIRDataThreadContext *thread_ctx,
+        FDIRServerDentry *parent, const string_t *name)
+{
+    FDIRServerDentry *child;
+    const bool hdlink_follow = false;
+
+    /* the target not exist, fail in the local thread */
+    if (dentry_find_by_pname_ex(parent, name, &child, hdlink_follow) != 0) {
+        return SHARD_RECORD_LOCAL;
+    }
+
+    if (!SHARD_IS_LOCAL(thread_ctx, child->inode)) {
+        return SHARD_RECORD_EXCLUSIVE;
+    }
+    if (FDIR_IS_DENTRY_HARD_LINK(child->stat.mode) && !SHARD_IS_LOCAL(
+                thread_ctx, FDIR_DENTRY_SRC(child)->inode))
+    {
+        return SHARD_RECORD_EXCLUSIVE;
+    }
+    return SHARD_RECORD_LOCAL;
+}
+
+/* walk the full path by the data threads which own the directories,
+ * each thread reads the children of its own directories only:
+ *   - the update is dealt by the owner of the parent directory
+ *   - the query is dealt by the owner of the target dentry
+ */
+static int shard_walk_path(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    FDIRPathInfo path_info;
+    FDIRNamespaceEntry *ns_entry;
+    FDIRServerDentry *dentry;
+    FDIRServerDentry *child;
+    const string_t *path;
+    bool hdlink_follow;
+    int last;
+    int result;
+
+    switch (record->path_walk.stage) {
+        case fdir_path_walk_none:
+            break;
+        case fdir_path_walk_target:
+            if (SHARD_IS_LOCAL(thread_ctx, record->path_walk.inode)) {
+                return SHARD_RECORD_LOCAL;
+            }
+            return shard_forward_record(record, record->path_walk.inode);
+        default:
+            return SHARD_RECORD_LOCAL;
+    }
+
+    /* the invalid path and the root path fail or be dealt by
+     * the owner of the namespace root as before */
+    path = &record->me.fullname.path;
+    if (path->len == 0 || path->str[0] != '/') {
+        return SHARD_RECORD_LOCAL;
+    }
+    path_info.count = split_string_ex(path, '/', path_info.paths,
+            FDIR_MAX_PATH_COUNT, true);
+    if (path_info.count == 0) {
+        return SHARD_RECORD_LOCAL;
+    }
+
+    if (record->path_walk.inode == 0) {
+        ns_entry = fdir_namespace_get(NULL, &record->me.fullname.ns,
+                false, &result);
+        if (ns_entry == NULL || ns_entry->current.root.ptr == NULL) {
+            return SHARD_RECORD_LOCAL;
+        }
+        dentry = ns_entry->current.root.ptr;
+        record->path_walk.depth = 0;
+    } else if ((result=inode_index_get_dentry(thread_ctx, record->
+                    path_walk.inode, &dentry)) != 0)
+    {
+        return shard_walk_fail(record, result);
+    }
+
+    last = path_info.count - 1;
+    while (1) {
+        if (!SHARD_IS_LOCAL(thread_ctx, dentry->inode)) {
+            return shard_forward_record(record, dentry->inode);
+        }
+        if (record->path_walk.depth == last) {
+            break;
+        }
+
+        hdlink_follow = false;
+        if ((result=dentry_find_by_pname_ex(dentry, path_info.paths +
+                        record->path_walk.depth, &child,
+                        hdlink_follow)) != 0)
+        {
+            return shard_walk_fail(record, result);
+        }
+        dentry = child;
+        record->path_walk.depth++;
+    }
+
+    record->path_walk.name = path_info.paths[last];
+    if (record->is_update) {
+        record->path_walk.stage = fdir_path_walk_parent;
+        record->path_walk.inode = dentry->inode;
+        if (record->operation == BINLOG_OP_CREATE_DENTRY_INT) {
+            return SHARD_RECORD_LOCAL;
+        }
+        return shard_check_child(thread_ctx, dentry,
+                &record->path_walk.name);
+    }
+
+    hdlink_follow = (record->operation != SERVICE_OP_LIST_DENTRY_INT);
+    if ((result=dentry_find_by_pname_ex(dentry, &record->path_walk.name,
+                    &child, hdlink_follow)) != 0)
+    {
+        return shard_walk_fail(record, result);
+    }
+
+    record->path_walk.stage = fdir_path_walk_target;
+    record->path_walk.inode = child->inode;
+    if (SHARD_IS_LOCAL(thread_ctx, child->inode)) {
+        return SHARD_RECORD_LOCAL;
+    }
+    return shard_forward_record(record, child->inode);
+}
+
+static int shard_check_record(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    FDIRBinlogRecord **pp;
+    FDIRBinlogRecord **recend;
+    FDIRServerDentry *parent;
+
+    if (!DATA_SHARD_ACTIVE) {
+        return (record->hash_code % g_data_thread_vars.thread_array.
+                count == thread_ctx->index) ? SHARD_RECORD_LOCAL :
+            SHARD_RECORD_EXCLUSIVE;
+    }
+
+    switch (record->operation) {
+        case BINLOG_OP_RENAME_DENTRY_INT:
+        case SERVICE_OP_BATCH_UPDATE_INT:
+            return SHARD_RECORD_EXCLUSIVE;
+        case SERVICE_OP_BATCH_SET_DSIZE_INT:
+            recend = record->parray->records + record->parray->counts.total;
+            for (pp=record->parray->records; pp<recend; pp++) {
+                if (!SHARD_IS_LOCAL(thread_ctx, (*pp)->inode)) {
+                    return SHARD_RECORD_EXCLUSIVE;
+                }
+            }
+            return SHARD_RECORD_LOCAL;
+        case SERVICE_OP_SET_DSIZE_INT:
+        case SERVICE_OP_FLOCK_APPLY_INT:
+        case SERVICE_OP_SYS_LOCK_APPLY_INT:
+        case SERVICE_OP_SYS_LOCK_RELEASE_INT:
+            return SHARD_IS_LOCAL(thread_ctx, record->inode) ?
+                SHARD_RECORD_LOCAL : SHARD_RECORD_EXCLUSIVE;
+        default:
+            break;
+    }
+
+    if (record->operation == BINLOG_OP_CREATE_DENTRY_INT &&
+            FDIR_IS_DENTRY_HARD_LINK(record->stat.mode))
+    {
+        //the source dentry of the hard link maybe in other shard
+        return SHARD_RECORD_EXCLUSIVE;
+    }
+
+    switch (record->dentry_type) {
+        case fdir_dentry_type_inode:
+            return SHARD_IS_LOCAL(thread_ctx, record->inode) ?
+                SHARD_RECORD_LOCAL : SHARD_RECORD_EXCLUSIVE;
+        case fdir_dentry_type_fullname:
+            return shard_walk_path(thread_ctx, record);
+        default:
+            break;
+    }
+
+    if (!SHARD_IS_LOCAL(thread_ctx, record->me.pname.parent_inode)) {
+        return SHARD_RECORD_EXCLUSIVE;
+    }
+    if (record->operation == BINLOG_OP_CREATE_DENTRY_INT) {
+        return SHARD_RECORD_LOCAL;
+    }
+
+    /* the parent not exist, fail in the local thread */
+    if (inode_index_get_dentry(thread_ctx, record->me.pname.
+                parent_inode, &parent) != 0)
+    {
+        return SHARD_RECORD_LOCAL;
+    }
+    return shard_check_child(thread_ctx, parent, &record->me.pname.name);
+}
+
+static inline void deal_record(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    record->dequeue_time = latency_stat_now();
+    if (record->is_update) {
+        deal_update_record(thread_ctx, record);
+    } else {
+        deal_query_record(thread_ctx, record);
+    }
+}
+
 static void *data_thread_func(void *arg)
 {
     FDIRBinlogRecord *record;
@@ -1247,6 +1842,8 @@ static void *data_thread_func(void *arg)
 #endif
 
     while (SF_G_CONTINUE_FLAG) {
+        data_thread_shard_checkpoint(thread_ctx);
+
         record = (FDIRBinlogRecord *)fc_queue_pop_all(&thread_ctx->queue);
         if (record == NULL) {
             continue;
@@ -1258,9 +1855,24 @@ static void *data_thread_func(void *arg)
             record = record->next;
             if (current->is_update) {
                 ++update_count;
-                deal_update_record(thread_ctx, current);
+            }
+
+            if (DATA_SHARD_ENABLED) {
+                data_thread_shard_checkpoint(thread_ctx);
+                switch (shard_check_record(thread_ctx, current)) {
+                    case SHARD_RECORD_LOCAL:
+                        deal_record(thread_ctx, current);
+                        break;
+                    case SHARD_RECORD_EXCLUSIVE:
+                        data_thread_exclusive_enter(thread_ctx);
+                        deal_record(thread_ctx, current);
+                        data_thread_exclusive_leave(thread_ctx);
+                        break;
+                    default:  //forwarded to the owner thread
+                        break;
+                }
             } else {
-                deal_query_record(thread_ctx, current);
+                deal_record(thread_ctx, current);
             }
         } while (record != NULL && SF_G_CONTINUE_FLAG);
 
@@ -1270,6 +1882,9 @@ static void *data_thread_func(void *arg)
         }
 
         deal_delay_free_queue(thread_ctx);
+        if (STORAGE_ENABLED) {
+            dentry_lru_check_evict(thread_ctx);
+        }
         if (__sync_add_and_fetch(&thread_ctx->free_context.
                     immediate.waiting_count, 0) != 0)
         {
@@ -25,10 +25,13 @@
 #include "common/fdir_types.h"
 #include "binlog/binlog_types.h"
 #include "server_global.h"
+#include "path_cache.h"
 
 #define FDIR_DATA_ERROR_MODE_STRICT   1   //for master update operations
 #define FDIR_DATA_ERROR_MODE_LOOSE    2   //for data load or binlog replication
 
+#define FDIR_STAT_SEQ_COUNT  1024   //must be power of 2
+
 typedef struct fdir_dentry_counters {
     int64_t ns;
     int64_t dir;
@@ -37,18 +40,20 @@ typedef struct fdir_dentry_counters {
 
 struct fdir_data_thread_context;
 typedef struct fdir_dentry_context {
-    UniqSkiplistFactory factory;
     struct fast_mblock_man dentry_allocator;
+    struct fast_mblock_man extra_allocator;  //element: FDIRServerDentryExtra
     struct fast_mblock_man kvarray_allocators[FDIR_XATTR_KVARRAY_ALLOCATOR_COUNT];
     struct fast_allocator_context name_acontext;
     struct fdir_data_thread_context *thread_ctx;
     FDIRDentryCounters counters;
+    FDIRPathCache path_cache;  //for lookup by path
 } FDIRDentryContext;
 
 typedef struct server_delay_free_node {
     int expires;
     void *ctx;     //the context
     void *ptr;     //ptr to free
+    int64_t epoch; //the read epoch when retired, for lockfree query
     server_free_func free_func;
     server_free_func_ex free_func_ex;
     struct server_delay_free_node *next;
@@ -61,6 +66,7 @@ typedef struct server_delay_free_queue {
 
 typedef struct server_delay_free_context {
     time_t last_check_time;
+    pthread_mutex_t lock;  //for data shard only
     ServerDelayFreeQueue queue;
 } ServerDelayFreeContext;
 
@@ -97,6 +103,21 @@ typedef struct fdir_data_thread_context {
         struct fast_mblock_chain chain;        //for batch free event
         struct fdir_data_thread_context *next; //for batch free event
     } event;  //for change notify when data persistency
+
+    struct {
+        FDIRServerDentry *head;  //the least recently used directory
+        FDIRServerDentry *tail;
+        int64_t limit;           //the max dentry count of this thread
+        volatile int64_t evict_count;   //the evicted dentries
+        volatile int64_t reload_count;  //the evicted children reloaded
+        time_t last_check_time;
+        FDIRServerDentryArray array;    //for evict children
+    } lru;  //for dentry eviction when memory exceeds the limit
+
+    /* the change sequences of the stat of the dentries dealt by this
+     * thread, hashed by inode, for the lockfree query to detect the
+     * torn stat, see dentry_stat_change_begin */
+    volatile unsigned int stat_seqs[FDIR_STAT_SEQ_COUNT];
 } FDIRDataThreadContext;
 
 typedef struct fdir_data_thread_array {
@@ -109,6 +130,20 @@ typedef struct fdir_data_thread_variables {
     volatile int running_count;
     int error_mode;
 
+    struct {
+        volatile int active;    //dispatch and check by the inode shard
+        volatile int waitings;  //the exclusive requests
+        int owner;   //the thread index which owns the exclusive right
+        int parked;  //the paused data thread count
+        pthread_lock_cond_pair_t lcp;
+    } shard;  //for data shard by subtree
+
+    struct {
+        volatile int64_t current;
+        volatile int next_slot;
+        volatile int64_t *slots;  //the epoch of the active readers
+    } read_epoch;  //for lockfree query
+
     struct {
         volatile int64_t current_id;
         int alloc_elements_once;
@@ -124,6 +159,21 @@ typedef struct fdir_data_thread_variables {
 
 #define DATA_THREAD_LAST_VERSION  update_notify.last_version
 
+#define FDIR_DENTRY_THREAD_CTX(dentry) (g_data_thread_vars. \
+        thread_array.contexts + (dentry)->thread_index)
+#define FDIR_DENTRY_CONTEXT(dentry) \
+    (&FDIR_DENTRY_THREAD_CTX(dentry)->dentry_context)
+
+#define DATA_SHARD_ACTIVE  (DATA_SHARD_ENABLED && \
+        __sync_add_and_fetch(&g_data_thread_vars.shard.active, 0))
+
+#define DATA_SHARD_OWNER_NONE  -1
+
+#define FDIR_READ_EPOCH_MAX_SLOTS  1024
+
+#define DATA_SHARD_INDEX(inode) \
+    ((inode) % g_data_thread_vars.thread_array.count)
+
 #define EVENT_ALLOC_ELEMENTS_ONCE  g_data_thread_vars.event.alloc_elements_once
 #define EVENT_ALLOC_ELEMENTS_LIMIT g_data_thread_vars.event.alloc_elements_limit
 
@@ -132,6 +182,7 @@ extern "C" {
 #endif
 
     extern FDIRDataThreadVariables g_data_thread_vars;
+    extern __thread int g_read_epoch_slot_index;
 
     int data_thread_init();
     void data_thread_destroy();
@@ -139,6 +190,14 @@ extern "C" {
 
     void data_thread_sum_counters(FDIRDentryCounters *counters);
 
+    /* switch the dispatch mode between namespace and subtree shard,
+     * called when the master changed */
+    void data_thread_shard_set_active(const bool active);
+
+    /* pause all other data threads, thread_ctx is NULL for other threads */
+    void data_thread_exclusive_enter(FDIRDataThreadContext *thread_ctx);
+    void data_thread_exclusive_leave(FDIRDataThreadContext *thread_ctx);
+
     int server_add_to_delay_free_queue(ServerFreeContext *free_ctx,
             void *ptr, server_free_func free_func, const int delay_seconds);
 
@@ -182,12 +241,54 @@ extern "C" {
             g_data_thread_vars.thread_array.count;
     }
 
+    /* the inode which determines the data thread in subtree shard mode,
+     * return 0 for dispatching by the namespace */
+    static inline int64_t data_thread_get_shard_inode(
+            const FDIRBinlogRecord *record)
+    {
+        switch (record->operation) {
+            case BINLOG_OP_RENAME_DENTRY_INT:
+            case SERVICE_OP_BATCH_SET_DSIZE_INT:
+            case SERVICE_OP_BATCH_UPDATE_INT:
+                return 0;
+            case SERVICE_OP_SET_DSIZE_INT:
+            case SERVICE_OP_FLOCK_APPLY_INT:
+            case SERVICE_OP_SYS_LOCK_APPLY_INT:
+            case SERVICE_OP_SYS_LOCK_RELEASE_INT:
+                return record->inode;
+            default:
+                break;
+        }
+
+        switch (record->dentry_type) {
+            case fdir_dentry_type_inode:
+                return record->inode;
+            case fdir_dentry_type_pname:
+                return record->me.pname.parent_inode;
+            default:
+                return 0;
+        }
+    }
+
+    static inline int data_thread_get_index(const FDIRBinlogRecord *record)
+    {
+        int64_t inode;
+
+        if (DATA_SHARD_ACTIVE) {
+            if ((inode=data_thread_get_shard_inode(record)) > 0) {
+                return DATA_SHARD_INDEX(inode);
+            }
+        }
+
+        return record->hash_code % g_data_thread_vars.thread_array.count;
+    }
+
     static inline void push_to_data_thread_queue(FDIRBinlogRecord *record)
     {
         FDIRDataThreadContext *context;
 
         context = g_data_thread_vars.thread_array.contexts +
-            record->hash_code % g_data_thread_vars.thread_array.count;
+            data_thread_get_index(record);
         if (STORAGE_ENABLED && record->is_update) {
             __sync_add_and_fetch(&context->update_notify.waiting_records, 1);
         }
@@ -232,6 +333,40 @@ extern "C" {
         return 0;
     }
 
+    static inline int64_t data_thread_retire_epoch()
+    {
+        return __sync_add_and_fetch(&g_data_thread_vars.
+                read_epoch.current, 1);
+    }
+
+    /* the dentries got in the read section are not freed until leave,
+     * return the slot index, < 0 for no free slot */
+    static inline int data_thread_read_enter()
+    {
+        if (g_read_epoch_slot_index < 0) {
+            g_read_epoch_slot_index = __sync_fetch_and_add(
+                    &g_data_thread_vars.read_epoch.next_slot, 1);
+            if (g_read_epoch_slot_index >= FDIR_READ_EPOCH_MAX_SLOTS) {
+                g_read_epoch_slot_index = FDIR_READ_EPOCH_MAX_SLOTS;
+                return -1;
+            }
+        } else if (g_read_epoch_slot_index == FDIR_READ_EPOCH_MAX_SLOTS) {
+            return -1;
+        }
+
+        __sync_lock_test_and_set(g_data_thread_vars.read_epoch.slots +
+                g_read_epoch_slot_index, __sync_add_and_fetch(
+                    &g_data_thread_vars.read_epoch.current, 0));
+        __sync_synchronize();
+        return g_read_epoch_slot_index;
+    }
+
+    static inline void data_thread_read_leave(const int slot_index)
+    {
+        __sync_synchronize();
+        g_data_thread_vars.read_epoch.slots[slot_index] = 0;
+    }
+
 #ifdef __cplusplus
 }
 #endif
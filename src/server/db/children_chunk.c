@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "../data_thread.h"
+#include "dentry_serializer.h"
+#include "children_chunk.h"
+
+static int check_alloc_chunks(FDIRChildrenChunkArray *carray,
+        const int target_count)
+{
+    int alloc;
+    FDIRChildrenChunk *chunks;
+
+    if (carray->alloc >= target_count) {
+        return 0;
+    }
+
+    alloc = carray->alloc > 0 ? carray->alloc : 4;
+    while (alloc < target_count) {
+        alloc *= 2;
+    }
+
+    chunks = (FDIRChildrenChunk *)fc_malloc(sizeof(FDIRChildrenChunk) * alloc);
+    if (chunks == NULL) {
+        return ENOMEM;
+    }
+    memset(chunks, 0, sizeof(FDIRChildrenChunk) * alloc);
+
+    if (carray->chunks != NULL) {
+        memcpy(chunks, carray->chunks, sizeof(
+                    FDIRChildrenChunk) * carray->count);
+        free(carray->chunks);
+    }
+
+    carray->chunks = chunks;
+    carray->alloc = alloc;
+    return 0;
+}
+
+FDIRChildrenChunkArray *children_chunk_array_create(const int count)
+{
+    FDIRChildrenChunkArray *carray;
+
+    carray = (FDIRChildrenChunkArray *)fc_malloc(
+            sizeof(FDIRChildrenChunkArray));
+    if (carray == NULL) {
+        return NULL;
+    }
+
+    memset(carray, 0, sizeof(FDIRChildrenChunkArray));
+    if (check_alloc_chunks(carray, count) != 0) {
+        free(carray);
+        return NULL;
+    }
+    carray->count = count;
+    return carray;
+}
+
+void children_chunk_array_free(FDIRDentryContext *context,
+        FDIRChildrenChunkArray *carray)
+{
+    FDIRChildrenChunk *chunk;
+    FDIRChildrenChunk *end;
+    id_name_pair_t *pair;
+    id_name_pair_t *pend;
+
+    end = carray->chunks + carray->count;
+    for (chunk=carray->chunks; chunk<end; chunk++) {
+        if (chunk->array == NULL) {
+            continue;
+        }
+
+        pend = chunk->array->elts + chunk->array->count;
+        for (pair=chunk->array->elts; pair<pend; pair++) {
+            dentry_strfree(context, &pair->name);
+        }
+        id_name_array_allocator_free(&ID_NAME_ARRAY_ALLOCATOR_CTX,
+                chunk->array);
+    }
+
+    if (carray->chunks != NULL) {
+        free(carray->chunks);
+    }
+    free(carray);
+}
+
+static inline int set_chunk_pairs(FDIRChildrenChunk *chunk,
+        const id_name_pair_t *pairs, const int count)
+{
+    chunk->array = id_name_array_allocator_alloc(&ID_NAME_ARRAY_ALLOCATOR_CTX,
+            (count > 0 ? count : 1));
+    if (chunk->array == NULL) {
+        return ENOMEM;
+    }
+
+    if (count > 0) {
+        memcpy(chunk->array->elts, pairs, sizeof(id_name_pair_t) * count);
+    }
+    chunk->array->count = count;
+    return 0;
+}
+
+static int build_new_chunks(FDIRChildrenChunkArray *carray,
+        const id_name_pair_t *pairs, const int count)
+{
+    int result;
+    int chunk_count;
+    int start;
+    int i;
+    FDIRChildrenChunk *chunk;
+
+    chunk_count = (count + FDIR_CHILDREN_CHUNK_FILL_SIZE - 1) /
+        FDIR_CHILDREN_CHUNK_FILL_SIZE;
+    if ((result=check_alloc_chunks(carray, chunk_count)) != 0) {
+        return result;
+    }
+
+    for (i=0; i<chunk_count; i++) {
+        chunk = carray->chunks + i;
+        start = i * FDIR_CHILDREN_CHUNK_FILL_SIZE;
+        chunk->key = 0;
+        chunk->first_id = (i == 0 ? 0 : pairs[start].id);
+        chunk->dirty = true;
+        if ((result=set_chunk_pairs(chunk, pairs + start, FC_MIN(
+                            FDIR_CHILDREN_CHUNK_FILL_SIZE,
+                            count - start))) != 0)
+        {
+            return result;
+        }
+    }
+
+    carray->count = chunk_count;
+    carray->index_dirty = (chunk_count > 0);
+    return 0;
+}
+
+static int build_by_layout(FDIRChildrenChunkArray *carray,
+        const id_name_pair_t *pairs, const int count)
+{
+    int result;
+    int chunk_index;
+    const id_name_pair_t *start;
+    const id_name_pair_t *pair;
+    const id_name_pair_t *end;
+    FDIRChildrenChunk *chunk;
+
+    start = pairs;
+    end = pairs + count;
+    for (chunk_index=0; chunk_index<carray->count; chunk_index++) {
+        chunk = carray->chunks + chunk_index;
+        pair = start;
+        if (chunk_index + 1 < carray->count) {
+            while (pair < end && pair->id < (chunk + 1)->first_id) {
+                pair++;
+            }
+        } else {
+            pair = end;
+        }
+
+        if ((result=set_chunk_pairs(chunk, start, pair - start)) != 0) {
+            return result;
+        }
+        chunk->dirty = (pair == start);  //empty chunk to remove
+        start = pair;
+    }
+
+    return 0;
+}
+
+int children_chunk_array_build(FDIRChildrenChunkArray **carray,
+        const id_name_pair_t *pairs, const int count)
+{
+    int result;
+
+    if (*carray == NULL) {
+        if ((*carray=children_chunk_array_create(0)) == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    if ((*carray)->count == 0) {
+        result = build_new_chunks(*carray, pairs, count);
+    } else {
+        result = build_by_layout(*carray, pairs, count);
+    }
+
+    (*carray)->total = count;
+    return result;
+}
+
+static int split_chunk(FDIRChildrenChunkArray *carray, const int chunk_index)
+{
+    int result;
+    int keep_count;
+    FDIRChildrenChunk *chunk;
+    FDIRChildrenChunk *next;
+    IdNameArray *array;
+
+    if ((result=check_alloc_chunks(carray, carray->count + 1)) != 0) {
+        return result;
+    }
+
+    chunk = carray->chunks + chunk_index;
+    keep_count = chunk->array->count / 2;
+    array = id_name_array_allocator_alloc(&ID_NAME_ARRAY_ALLOCATOR_CTX,
+            chunk->array->count - keep_count);
+    if (array == NULL) {
+        return ENOMEM;
+    }
+    array->count = chunk->array->count - keep_count;
+    memcpy(array->elts, chunk->array->elts + keep_count,
+            sizeof(id_name_pair_t) * array->count);
+    chunk->array->count = keep_count;
+
+    next = chunk + 1;
+    if (chunk_index + 1 < carray->count) {
+        memmove(next + 1, next, sizeof(FDIRChildrenChunk) *
+                (carray->count - (chunk_index + 1)));
+    }
+    next->key = 0;
+    next->first_id = array->elts[0].id;
+    next->array = array;
+    next->dirty = true;
+
+    carray->count++;
+    carray->index_dirty = true;
+    return 0;
+}
+
+int children_chunk_insert(FDIRChildrenChunkArray *carray,
+        const id_name_pair_t *pair)
+{
+    int result;
+    int chunk_index;
+    FDIRChildrenChunk *chunk;
+
+    if (carray->count == 0) {
+        if ((result=check_alloc_chunks(carray, 1)) != 0) {
+            return result;
+        }
+        memset(carray->chunks, 0, sizeof(FDIRChildrenChunk));
+        carray->count = 1;
+        carray->index_dirty = true;
+    }
+
+    chunk_index = children_chunk_locate(carray, pair->id);
+    chunk = carray->chunks + chunk_index;
+    if (chunk->array == NULL || chunk->array->count >= chunk->array->alloc) {
+        chunk->array = id_name_array_allocator_realloc(
+                &ID_NAME_ARRAY_ALLOCATOR_CTX, chunk->array,
+                (chunk->array != NULL ? chunk->array->count + 1 : 1));
+        if (chunk->array == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    if ((result=sorted_array_insert(&ID_NAME_SORTED_ARRAY_CTX,
+                    chunk->array->elts, &chunk->array->count, pair)) != 0)
+    {
+        return result;
+    }
+
+    chunk->dirty = true;
+    carray->total++;
+    if (chunk->array->count > FDIR_CHILDREN_CHUNK_MAX_SIZE) {
+        return split_chunk(carray, chunk_index);
+    }
+    return 0;
+}
+
+id_name_pair_t *children_chunk_find(FDIRChildrenChunkArray *carray,
+        const int64_t id, int *chunk_index)
+{
+    FDIRChildrenChunk *chunk;
+    id_name_pair_t target;
+
+    if (carray->count == 0) {
+        return NULL;
+    }
+
+    *chunk_index = children_chunk_locate(carray, id);
+    chunk = carray->chunks + *chunk_index;
+    if (chunk->array == NULL) {
+        return NULL;
+    }
+
+    target.id = id;
+    FC_SET_STRING_NULL(target.name);
+    return (id_name_pair_t *)sorted_array_find(&ID_NAME_SORTED_ARRAY_CTX,
+            chunk->array->elts, chunk->array->count, &target);
+}
+
+void children_chunk_delete(FDIRChildrenChunkArray *carray,
+        const int chunk_index, id_name_pair_t *pair)
+{
+    FDIRChildrenChunk *chunk;
+
+    chunk = carray->chunks + chunk_index;
+    sorted_array_delete_by_index(&ID_NAME_SORTED_ARRAY_CTX,
+            chunk->array->elts, &chunk->array->count,
+            pair - chunk->array->elts);
+    chunk->dirty = true;
+    carray->total--;
+}
+
+void children_chunk_array_compact(FDIRChildrenChunkArray *carray)
+{
+    FDIRChildrenChunk *chunk;
+    FDIRChildrenChunk *end;
+    FDIRChildrenChunk *dest;
+
+    dest = carray->chunks;
+    end = carray->chunks + carray->count;
+    for (chunk=carray->chunks; chunk<end; chunk++) {
+        if (chunk->array != NULL && chunk->array->count == 0) {
+            id_name_array_allocator_free(&ID_NAME_ARRAY_ALLOCATOR_CTX,
+                    chunk->array);
+            continue;
+        }
+
+        if (dest != chunk) {
+            *dest = *chunk;
+        }
+        dest++;
+    }
+
+    if (dest - carray->chunks != carray->count) {
+        carray->count = dest - carray->chunks;
+        carray->index_dirty = true;
+        if (carray->count > 0) {
+            carray->chunks[0].first_id = 0;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//children_chunk.h
+
+#ifndef _FDIR_CHILDREN_CHUNK_H
+#define _FDIR_CHILDREN_CHUNK_H
+
+#include "../server_types.h"
+
+#define FDIR_CHILDREN_CHUNK_MAX_SIZE   1024
+#define FDIR_CHILDREN_CHUNK_FILL_SIZE   768  //for building
+
+/* the keys of the chunks have the sign bit set which the inodes never have,
+ * the field version is used as the unique sequence */
+#define FDIR_CHILDREN_CHUNK_KEY(version) \
+    ((int64_t)((uint64_t)(version) | ((uint64_t)1 << 63)))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    FDIRChildrenChunkArray *children_chunk_array_create(const int count);
+
+    void children_chunk_array_free(struct fdir_dentry_context *context,
+            FDIRChildrenChunkArray *carray);
+
+    /* build the chunks from the pairs sorted by id,
+     * keep the chunk layout when the chunk keys loaded */
+    int children_chunk_array_build(FDIRChildrenChunkArray **carray,
+            const id_name_pair_t *pairs, const int count);
+
+    /* return the index of the chunk which the inode belongs to */
+    static inline int children_chunk_locate(const FDIRChildrenChunkArray
+            *carray, const int64_t id)
+    {
+        int low;
+        int high;
+        int mid;
+
+        low = 1;
+        high = carray->count - 1;
+        while (low <= high) {
+            mid = (low + high) / 2;
+            if (carray->chunks[mid].first_id <= id) {
+                low = mid + 1;
+            } else {
+                high = mid - 1;
+            }
+        }
+        return high > 0 ? high : 0;
+    }
+
+    int children_chunk_insert(FDIRChildrenChunkArray *carray,
+            const id_name_pair_t *pair);
+
+    id_name_pair_t *children_chunk_find(FDIRChildrenChunkArray *carray,
+            const int64_t id, int *chunk_index);
+
+    void children_chunk_delete(FDIRChildrenChunkArray *carray,
+            const int chunk_index, id_name_pair_t *pair);
+
+    static inline void children_chunk_mark_dirty(
+            FDIRChildrenChunkArray *carray, const int64_t id)
+    {
+        if (carray->count > 0) {
+            carray->chunks[children_chunk_locate(carray, id)].dirty = true;
+        }
+    }
+
+    /* remove the empty chunks after persisted */
+    void children_chunk_array_compact(FDIRChildrenChunkArray *carray);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
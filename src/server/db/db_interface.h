@@ -29,6 +29,15 @@ typedef int (*fdir_storage_engine_start_func)();
 
 typedef void (*fdir_storage_engine_terminate_func)();
 
+/* the entries of the array:
+ *   the dentry: op create or update with the field of the piece, and op
+ *     remove with the field FDIR_PIECE_FIELD_INDEX_BASIC for all pieces
+ *   the children chunk of the directory: the inode is the chunk key
+ *     FDIR_CHILDREN_CHUNK_KEY (the sign bit set, never a real inode) and
+ *     the field is FDIR_PIECE_FIELD_INDEX_CHILDREN, op create for the
+ *     first piece, op update for the later pieces, and op remove when
+ *     the chunk is dropped
+ */
 typedef int (*fdir_storage_engine_store_func)(const FDIRDBUpdateFieldArray *array);
 
 typedef int (*fdir_storage_engine_redo_func)(const FDIRDBUpdateFieldArray *array);
@@ -36,6 +45,12 @@ typedef int (*fdir_storage_engine_redo_func)(const FDIRDBUpdateFieldArray *array
 typedef int (*fdir_storage_engine_fetch_func)(const int64_t inode,
         const int field_index, DASynchronizedReadContext *ctx);
 
+/* resolve one child by name through the name index of the storage engine,
+ * return ENOENT when the child not exist */
+typedef int (*fdir_storage_engine_fetch_child_func)(
+        const int64_t parent_inode, const string_t *name,
+        int64_t *child_inode);
+
 typedef struct fdir_storage_engine_interface {
     fdir_storage_engine_init_func init;
     fdir_storage_engine_start_func start;
@@ -43,6 +58,7 @@ typedef struct fdir_storage_engine_interface {
     fdir_storage_engine_store_func store;
     fdir_storage_engine_redo_func redo;
     fdir_storage_engine_fetch_func fetch;
+    fdir_storage_engine_fetch_child_func fetch_child;  //optional
 } FDIRStorageEngineInterface;
 
 #endif
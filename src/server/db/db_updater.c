@@ -380,6 +380,10 @@ static int unpack_one_dentry(SFSerializerIterator *it,
         return it->error_no;
     }
 
+    if ((result=dentry_serializer_extract_pname(it, entry)) != 0) {
+        return result;
+    }
+
     ctx->array.count++;
     return 0;
 }
@@ -449,7 +453,9 @@ static int dump_namespaces(FDIRDBUpdaterContext *ctx)
                 ns_entry->delay.counts.file += 1;
             }
             ++change_count;
-        } else if (entry->op_type == da_binlog_op_type_remove) {
+        } else if (entry->op_type == da_binlog_op_type_remove &&
+                entry->field_index == FDIR_PIECE_FIELD_INDEX_BASIC)
+        {
             if (ns_entry->delay.root.inode == entry->inode) {
                 ns_entry->delay.root.inode = 0;
             }
@@ -19,7 +19,10 @@
 #include "fastcommon/pthread_func.h"
 #include "sf/sf_func.h"
 #include "../server_global.h"
+#include "../dentry.h"
 #include "../inode_index.h"
+#include "children_chunk.h"
+#include "dentry_lru.h"
 #include "dentry_loader.h"
 
 typedef struct {
@@ -85,7 +88,7 @@ static int alloc_init_dentry(FDIRNamespaceEntry *ns_entry,
 
     (*dentry)->parent = parent;
     if (parent != NULL) {
-        if ((result=uniq_skiplist_insert(parent->children, *dentry)) != 0) {
+        if ((result=child_index_insert(parent->children, *dentry)) != 0) {
             logError("file: "__FILE__", line: %d, "
                     "parent inode: %"PRId64", insert child {inode: %"PRId64", "
                     "name: %.*s} fail, errno: %d, error info: %s", __LINE__,
@@ -99,26 +102,108 @@ static int alloc_init_dentry(FDIRNamespaceEntry *ns_entry,
     return 0;
 }
 
+/* the children loaded by name are kept when load all children */
+/* count the reload of the children evicted by the LRU before */
+static inline void dentry_check_reload(FDIRDataThreadContext *thread_ctx,
+        FDIRServerDentry *parent)
+{
+    if ((parent->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_EVICTED) != 0) {
+        parent->loaded_flags &= ~FDIR_DENTRY_LOADED_FLAGS_EVICTED;
+        thread_ctx->lru.reload_count++;
+    }
+}
+
+static int add_child_dentry(FDIRServerDentry *parent, const int64_t inode,
+        const string_t *name, DentryPair *current_pair)
+{
+    int result;
+    FDIRServerDentry *child;
+
+    child = NULL;
+    if ((parent->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_PARTIAL) != 0) {
+        child = child_index_find(parent->children, name);
+    }
+
+    if (child == NULL) {
+        if ((result=alloc_init_dentry(parent->ns_entry, parent,
+                        inode, name, &child)) != 0)
+        {
+            return result;
+        }
+    }
+
+    if (current_pair->inode == child->inode) {
+        current_pair->dentry = child;
+    }
+    return 0;
+}
+
+/* page in one chunk of the children */
+static int dentry_load_children_chunk(FDIRServerDentry *parent,
+        const FDIRChildrenChunk *chunk, DentryPair *current_pair)
+{
+    int result;
+    string_t content;
+    FDIRDataThreadContext *thread_ctx;
+    const id_name_array_t *id_name_array;
+    const id_name_pair_t *pair;
+    const id_name_pair_t *end;
+
+    thread_ctx = parent->ns_entry->thread_ctx;
+    if ((result=STORAGE_ENGINE_FETCH_API(chunk->key,
+                    FDIR_PIECE_FIELD_INDEX_CHILDREN,
+                    &thread_ctx->db_fetch_ctx.read_ctx)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "inode: %"PRId64", load children chunk %"PRId64" fail, "
+                "result: %d", __LINE__, parent->inode, chunk->key, result);
+        return (result == ENODATA ? ENOENT : result);
+    }
+
+    FC_SET_STRING_EX(content, DA_OP_CTX_BUFFER_PTR(thread_ctx->db_fetch_ctx.
+                read_ctx.op_ctx), DA_OP_CTX_BUFFER_LEN(thread_ctx->
+                    db_fetch_ctx.read_ctx.op_ctx));
+    if ((result=dentry_serializer_unpack_children(thread_ctx, &content,
+                    parent->inode, &id_name_array)) != 0)
+    {
+        return result;
+    }
+
+    end = id_name_array->elts + id_name_array->count;
+    for (pair=id_name_array->elts; pair<end; pair++) {
+        if ((result=add_child_dentry(parent, pair->id,
+                        &pair->name, current_pair)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
 static int dentry_load_children_ex(FDIRServerDentry *parent,
         DentryPair *current_pair)
 {
     int result;
+    int chunk_index;
+    int64_t child_count;
     string_t content;
     FDIRDataThreadContext *thread_ctx;
     id_name_array_t array_holder;
     const id_name_array_t *id_name_array;
     const id_name_pair_t *pair;
     const id_name_pair_t *end;
+    FDIRChildrenChunkArray *carray;
     FDIRServerDentry *child;
-    UniqSkiplistIterator it;
+    FDIRChildIndexIterator it;
 
     if ((parent->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_CHILDREN) != 0) {
         if (current_pair->inode == 0) {
             return 0;
         }
 
-        uniq_skiplist_iterator(parent->children, &it);
-        while ((child=(FDIRServerDentry *)uniq_skiplist_next(&it)) != NULL) {
+        child_index_iterator(parent->children, &it);
+        while ((child=child_index_next(&it)) != NULL) {
             if (current_pair->inode == child->inode) {
                 current_pair->dentry = child;
                 return 0;
@@ -129,8 +214,8 @@ static int dentry_load_children_ex(FDIRServerDentry *parent,
             int count = 0;
             logError("line: %d, parent inode: %"PRId64", %.*s", __LINE__,
                     parent->inode, parent->name.len, parent->name.str);
-            uniq_skiplist_iterator(parent->children, &it);
-            while ((child=(FDIRServerDentry *)uniq_skiplist_next(&it)) != NULL) {
+            child_index_iterator(parent->children, &it);
+            while ((child=child_index_next(&it)) != NULL) {
                 logError("%d. %"PRId64" => %.*s", ++count, child->inode,
                         child->name.len, child->name.str);
             }
@@ -153,38 +238,70 @@ static int dentry_load_children_ex(FDIRServerDentry *parent,
         array_holder.elts = NULL;
         array_holder.count = 0;
         id_name_array = &array_holder;
+        carray = NULL;
     } else {
         FC_SET_STRING_EX(content, DA_OP_CTX_BUFFER_PTR(thread_ctx->db_fetch_ctx.
                     read_ctx.op_ctx), DA_OP_CTX_BUFFER_LEN(thread_ctx->
                         db_fetch_ctx.read_ctx.op_ctx));
-        if ((result=dentry_serializer_unpack_children(thread_ctx, &content,
-                        parent->inode, &id_name_array)) != 0)
+        if ((result=dentry_serializer_unpack_children_index(thread_ctx,
+                        &content, parent->inode, &id_name_array,
+                        &carray)) != 0)
         {
             return result;
         }
     }
 
-    parent->children = uniq_skiplist_new(&thread_ctx->dentry_context.
-            factory, DENTRY_SKIPLIST_INIT_LEVEL_COUNT);
     if (parent->children == NULL) {
-        return ENOMEM;
+        parent->children = child_index_new();
+        if (parent->children == NULL) {
+            if (carray != NULL) {
+                children_chunk_array_free(&thread_ctx->
+                        dentry_context, carray);
+            }
+            return ENOMEM;
+        }
     }
 
-    end = id_name_array->elts + id_name_array->count;
-    for (pair=id_name_array->elts; pair<end; pair++) {
-        if ((result=alloc_init_dentry(parent->ns_entry, parent,
-                        pair->id, &pair->name, &child)) != 0)
-        {
-            return result;
+    if (carray != NULL) {
+        for (chunk_index=0; chunk_index<carray->count; chunk_index++) {
+            if ((result=dentry_load_children_chunk(parent, carray->
+                            chunks + chunk_index, current_pair)) != 0)
+            {
+                break;
+            }
         }
 
-        if (current_pair->inode == child->inode) {
-            current_pair->dentry = child;
+        child_count = carray->total;
+        if (result == 0 && parent->db_args->children == NULL) {
+            parent->db_args->children = carray;  //keep the chunk layout
+        } else {
+            children_chunk_array_free(&thread_ctx->dentry_context, carray);
+        }
+        if (result != 0) {
+            return result;
+        }
+    } else {
+        end = id_name_array->elts + id_name_array->count;
+        for (pair=id_name_array->elts; pair<end; pair++) {
+            if ((result=add_child_dentry(parent, pair->id,
+                            &pair->name, current_pair)) != 0)
+            {
+                return result;
+            }
         }
+        child_count = id_name_array->count;
     }
 
-    parent->stat.nlink += id_name_array->count;
+    if ((parent->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_PARTIAL) != 0) {
+        //nlink counted when the first child loaded by name
+        parent->loaded_flags &= ~FDIR_DENTRY_LOADED_FLAGS_PARTIAL;
+        dentry_lru_remove(parent);
+    } else {
+        parent->stat.nlink += child_count;
+    }
     parent->loaded_flags |= FDIR_DENTRY_LOADED_FLAGS_CHILDREN;
+    dentry_lru_add(parent);
+    dentry_check_reload(thread_ctx, parent);
     if (current_pair->inode == 0) {
         return 0;
     } else {
@@ -193,8 +310,8 @@ static int dentry_load_children_ex(FDIRServerDentry *parent,
             int count = 0;
             logError("line: %d, parent inode: %"PRId64", %.*s", __LINE__,
                     parent->inode, parent->name.len, parent->name.str);
-            uniq_skiplist_iterator(parent->children, &it);
-            while ((child=(FDIRServerDentry *)uniq_skiplist_next(&it)) != NULL) {
+            child_index_iterator(parent->children, &it);
+            while ((child=child_index_next(&it)) != NULL) {
                 logError("%d. %"PRId64" => %.*s", ++count, child->inode,
                         child->name.len, child->name.str);
             }
@@ -247,8 +364,11 @@ static int dentry_load_basic(FDIRDataThreadContext *thread_ctx,
         dentry->stat.nlink = 1;   //reset nlink for directory
     }
     if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
-        result = dentry_load_inode(thread_ctx, dentry->
-                ns_entry, src_inode, &dentry->src_dentry);
+        if ((result=dentry_check_alloc_extra(dentry)) != 0) {
+            return result;
+        }
+        result = dentry_load_inode(thread_ctx, dentry->ns_entry,
+                src_inode, &dentry->extra->src_dentry);
     } else {
         if ((result=inode_index_add_dentry(dentry)) != 0) {
             logError("file: "__FILE__", line: %d, "
@@ -319,17 +439,141 @@ int dentry_check_load(FDIRDataThreadContext *thread_ctx,
         }
     }
 
-    if (S_ISDIR(dentry->stat.mode) && (dentry->loaded_flags &
-                FDIR_DENTRY_LOADED_FLAGS_CHILDREN) == 0)
-    {
-        if ((result=dentry_load_children(dentry)) != 0) {
+    if (S_ISDIR(dentry->stat.mode)) {
+        if ((dentry->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_CHILDREN) == 0) {
+            if ((result=dentry_load_children(dentry)) != 0) {
+                return result;
+            }
+        } else {
+            dentry_lru_touch(dentry);
+        }
+    }
+
+    return 0;
+}
+
+int dentry_check_load_basic(FDIRDataThreadContext *thread_ctx,
+        FDIRServerDentry *dentry)
+{
+    if ((dentry->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_BASIC) != 0) {
+        return 0;
+    }
+    return dentry_load_basic(thread_ctx, dentry);
+}
+
+/* prepare the directory for loading the children by name,
+ * load all children for the old format or empty directory */
+static int dentry_init_partial(FDIRDataThreadContext *thread_ctx,
+        FDIRServerDentry *parent)
+{
+    int result;
+    string_t content;
+    const id_name_array_t *id_name_array;
+    FDIRChildrenChunkArray *carray;
+
+    if (parent->db_args->children == NULL) {
+        if ((result=STORAGE_ENGINE_FETCH_API(parent->inode,
+                        FDIR_PIECE_FIELD_INDEX_CHILDREN,
+                        &thread_ctx->db_fetch_ctx.read_ctx)) != 0)
+        {
+            if (result == ENODATA) {
+                return dentry_load_children(parent);
+            }
+
+            logError("file: "__FILE__", line: %d, "
+                    "inode: %"PRId64", load children index fail, "
+                    "result: %d", __LINE__, parent->inode, result);
             return result;
         }
+
+        FC_SET_STRING_EX(content, DA_OP_CTX_BUFFER_PTR(thread_ctx->
+                    db_fetch_ctx.read_ctx.op_ctx), DA_OP_CTX_BUFFER_LEN(
+                        thread_ctx->db_fetch_ctx.read_ctx.op_ctx));
+        if ((result=dentry_serializer_unpack_children_index(thread_ctx,
+                        &content, parent->inode, &id_name_array,
+                        &carray)) != 0)
+        {
+            return result;
+        }
+
+        if (carray == NULL) {
+            return dentry_load_children(parent);
+        }
+        parent->db_args->children = carray;
+    }
+
+    if (parent->children == NULL) {
+        parent->children = child_index_new();
+        if (parent->children == NULL) {
+            return ENOMEM;
+        }
     }
 
+    parent->stat.nlink = 1 + parent->db_args->children->total;
+    parent->loaded_flags |= FDIR_DENTRY_LOADED_FLAGS_PARTIAL;
+    dentry_lru_add(parent);
+    dentry_check_reload(thread_ctx, parent);
     return 0;
 }
 
+int dentry_find_child_by_name(FDIRDataThreadContext *thread_ctx,
+        FDIRServerDentry *parent, const string_t *name,
+        FDIRServerDentry **child)
+{
+    int result;
+    int64_t inode;
+
+    if ((parent->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_CHILDREN) == 0) {
+        if (STORAGE_ENGINE_FETCH_CHILD_API == NULL) {
+            result = dentry_load_children(parent);
+        } else if ((parent->loaded_flags &
+                    FDIR_DENTRY_LOADED_FLAGS_PARTIAL) == 0)
+        {
+            result = dentry_init_partial(thread_ctx, parent);
+        } else {
+            result = 0;
+        }
+
+        if (result != 0) {
+            *child = NULL;
+            return result;
+        }
+    }
+
+    dentry_lru_touch(parent);
+    if ((*child=child_index_find(parent->children, name)) != NULL)
+    {
+        return 0;
+    }
+
+    if ((parent->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_CHILDREN) != 0) {
+        return ENOENT;
+    }
+
+    if ((result=STORAGE_ENGINE_FETCH_CHILD_API(parent->inode,
+                    name, &inode)) != 0)
+    {
+        if (result == ENOENT || result == ENODATA) {
+            return ENOENT;
+        }
+
+        logError("file: "__FILE__", line: %d, "
+                "parent inode: %"PRId64", fetch child %.*s fail, "
+                "result: %d", __LINE__, parent->inode,
+                name->len, name->str, result);
+        return result;
+    }
+
+    if ((result=alloc_init_dentry(parent->ns_entry, parent,
+                    inode, name, child)) != 0)
+    {
+        *child = NULL;
+        return result;
+    }
+
+    return dentry_load_basic(thread_ctx, *child);
+}
+
 int dentry_load_root(FDIRNamespaceEntry *ns_entry,
         const int64_t inode, FDIRServerDentry **dentry)
 {
@@ -347,14 +591,67 @@ int dentry_load_root(FDIRNamespaceEntry *ns_entry,
     return dentry_load_basic(ns_entry->thread_ctx, *dentry);
 }
 
+/* the chunks are ranged by inode, so only the chunk which the child
+ * belongs to is paged in, the parent is kept as partial loaded */
+static int dentry_load_child_chunk(FDIRServerDentry *parent,
+        DentryPair *child_pair)
+{
+    int result;
+    FDIRDataThreadContext *thread_ctx;
+    FDIRChildrenChunkArray *carray;
+    FDIRChildrenChunk *chunk;
+
+    thread_ctx = parent->ns_entry->thread_ctx;
+    if ((parent->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_PARTIAL) == 0) {
+        if ((result=dentry_init_partial(thread_ctx, parent)) != 0) {
+            return result;
+        }
+    }
+
+    carray = parent->db_args->children;
+    if ((parent->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_CHILDREN) != 0 ||
+            carray == NULL || carray->count == 0)
+    {
+        return dentry_load_children_ex(parent, child_pair);
+    }
+
+    //the chunk not persisted yet
+    chunk = carray->chunks + children_chunk_locate(
+            carray, child_pair->inode);
+    if (chunk->key == 0 || chunk->dirty) {
+        return dentry_load_children_ex(parent, child_pair);
+    }
+
+    child_pair->dentry = NULL;
+    if ((result=dentry_load_children_chunk(parent,
+                    chunk, child_pair)) != 0)
+    {
+        return result;
+    }
+
+    dentry_lru_touch(parent);
+    return (child_pair->dentry != NULL ? 0 : ENOENT);
+}
+
 static inline int dentry_load_child(FDIRServerDentry *parent,
         DentryPair *child_pair)
 {
     int result;
 
-    if ((result=dentry_load_children_ex(parent, child_pair)) != 0) {
+    if ((parent->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_CHILDREN) != 0) {
+        result = dentry_load_children_ex(parent, child_pair);
+    } else {
+        result = dentry_load_child_chunk(parent, child_pair);
+    }
+    if (result != 0) {
         return result;
     }
+
+    if ((child_pair->dentry->loaded_flags &
+                FDIR_DENTRY_LOADED_FLAGS_BASIC) != 0)
+    {
+        return 0;
+    }
     return dentry_load_basic(parent->ns_entry->
             thread_ctx, child_pair->dentry);
 }
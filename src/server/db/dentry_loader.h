@@ -54,6 +54,16 @@ extern "C" {
     int dentry_check_load(FDIRDataThreadContext *thread_ctx,
             FDIRServerDentry *dentry);
 
+    int dentry_check_load_basic(FDIRDataThreadContext *thread_ctx,
+            FDIRServerDentry *dentry);
+
+    /* find the child without loading all children of the directory
+     * when the storage engine supports fetch child by name, the parent
+     * MUST be a directory with the basic loaded */
+    int dentry_find_child_by_name(FDIRDataThreadContext *thread_ctx,
+            FDIRServerDentry *parent, const string_t *name,
+            FDIRServerDentry **child);
+
     int dentry_load_xattr(FDIRDataThreadContext *thread_ctx,
             FDIRServerDentry *dentry);
 
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/system_info.h"
+#include "fastcommon/sched_thread.h"
+#include "../server_global.h"
+#include "../inode_index.h"
+#include "dentry_lru.h"
+
+#define DENTRY_LRU_MAX_SCAN_COUNT  (16 * 1024)
+
+/* the dentry object, the child index slot, the name and the index */
+#define DENTRY_ESTIMATED_SIZE(thread_ctx)  ((thread_ctx)->dentry_context. \
+        dentry_allocator.info.element_size + 128)
+
+int dentry_lru_init()
+{
+    int64_t mem_size;
+    int64_t limit;
+    FDIRDataThreadContext *thread_ctx;
+    FDIRDataThreadContext *end;
+
+    if (get_sys_total_mem_size(&mem_size) != 0 || mem_size <= 0) {
+        logWarning("file: "__FILE__", line: %d, "
+                "get total memory size fail, "
+                "dentry eviction disabled", __LINE__);
+        return 0;
+    }
+
+    limit = 0;
+    end = g_data_thread_vars.thread_array.contexts +
+        g_data_thread_vars.thread_array.count;
+    for (thread_ctx=g_data_thread_vars.thread_array.contexts;
+            thread_ctx<end; thread_ctx++)
+    {
+        thread_ctx->lru.limit = (int64_t)(mem_size * STORAGE_MEMORY_LIMIT) /
+            (g_data_thread_vars.thread_array.count *
+             DENTRY_ESTIMATED_SIZE(thread_ctx));
+        limit += thread_ctx->lru.limit;
+    }
+
+    logInfo("file: "__FILE__", line: %d, "
+            "memory limit: %.2f%%, the max loaded dentry count: %"PRId64,
+            __LINE__, STORAGE_MEMORY_LIMIT * 100, limit);
+    return 0;
+}
+
+static int check_alloc_dentry_array(FDIRServerDentryArray *array,
+        const int target_count)
+{
+    FDIRServerDentry **entries;
+    int new_alloc;
+
+    if (array->alloc >= target_count) {
+        return 0;
+    }
+
+    new_alloc = (array->alloc > 0) ? array->alloc : 1024;
+    while (new_alloc < target_count) {
+        new_alloc *= 2;
+    }
+
+    entries = (FDIRServerDentry **)fc_malloc(
+            sizeof(FDIRServerDentry *) * new_alloc);
+    if (entries == NULL) {
+        return ENOMEM;
+    }
+
+    if (array->entries != NULL) {
+        free(array->entries);
+    }
+    array->entries = entries;
+    array->alloc = new_alloc;
+    return 0;
+}
+
+static inline bool child_can_evict(FDIRServerDentry *child)
+{
+    if (__sync_add_and_fetch(&child->reffer_count, 0) != 1 ||
+            FDIR_DENTRY_FLOCK_ENTRY(child) != NULL)
+    {
+        return false;  //in use or has pending events
+    }
+
+    if (S_ISDIR(child->stat.mode)) {
+        //evict the subtree from bottom to top
+        return (child->loaded_flags & (FDIR_DENTRY_LOADED_FLAGS_CHILDREN |
+                    FDIR_DENTRY_LOADED_FLAGS_PARTIAL)) == 0;
+    } else if (FDIR_IS_DENTRY_HARD_LINK(child->stat.mode)) {
+        return true;
+    } else {
+        //the source dentry maybe referred by the hard links
+        return child->stat.nlink <= 1;
+    }
+}
+
+/* return the evicted count */
+static int evict_children(FDIRDataThreadContext *thread_ctx,
+        FDIRServerDentry *dir)
+{
+    FDIRServerDentryArray *array;
+    FDIRServerDentry *child;
+    FDIRServerDentry **pp;
+    FDIRServerDentry **end;
+    FDIRChildIndexIterator it;
+    int count;
+
+    if (__sync_add_and_fetch(&dir->reffer_count, 0) != 1) {
+        return 0;
+    }
+
+    array = &thread_ctx->lru.array;
+    count = child_index_count(dir->children);
+    if (check_alloc_dentry_array(array, count) != 0) {
+        return 0;
+    }
+
+    array->count = 0;
+    child_index_iterator(dir->children, &it);
+    while ((child=child_index_next(&it)) != NULL) {
+        if (!child_can_evict(child)) {
+            return 0;
+        }
+        array->entries[array->count++] = child;
+    }
+
+    end = array->entries + array->count;
+    for (pp=array->entries; pp<end; pp++) {
+        if (((*pp)->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_BASIC) != 0 &&
+                !FDIR_IS_DENTRY_HARD_LINK((*pp)->stat.mode))
+        {
+            inode_index_del_dentry_ex(*pp, false);
+        }
+        child_index_delete(dir->children, *pp);
+    }
+
+    child_index_free(dir->children);
+    dir->children = NULL;
+    if ((dir->loaded_flags & FDIR_DENTRY_LOADED_FLAGS_PARTIAL) != 0) {
+        dir->stat.nlink = 1;
+    } else {
+        dir->stat.nlink -= array->count;
+    }
+    dir->loaded_flags &= ~(FDIR_DENTRY_LOADED_FLAGS_CHILDREN |
+            FDIR_DENTRY_LOADED_FLAGS_PARTIAL);
+    dir->loaded_flags |= FDIR_DENTRY_LOADED_FLAGS_EVICTED;
+    dentry_lru_remove(dir);
+    return array->count;
+}
+
+void dentry_lru_check_evict(FDIRDataThreadContext *thread_ctx)
+{
+    FDIRServerDentry *dir;
+    FDIRServerDentry *next;
+    int64_t target;
+    int64_t evict_count;
+    int scan_count;
+
+    if (thread_ctx->lru.limit <= 0 || thread_ctx->lru.
+            last_check_time == g_current_time)
+    {
+        return;
+    }
+    thread_ctx->lru.last_check_time = g_current_time;
+
+    //evict to the low water mark (90% of the limit) avoid thrashing
+    target = thread_ctx->dentry_context.dentry_allocator.info.
+        element_used_count - (thread_ctx->lru.limit -
+                thread_ctx->lru.limit / 10);
+    if (thread_ctx->dentry_context.dentry_allocator.info.
+            element_used_count <= thread_ctx->lru.limit)
+    {
+        return;
+    }
+
+    evict_count = 0;
+    scan_count = 0;
+    dir = thread_ctx->lru.head;
+    while (dir != NULL && evict_count < target &&
+            scan_count++ < DENTRY_LRU_MAX_SCAN_COUNT)
+    {
+        next = dir->db_args->lru.next;
+        if ((dir->loaded_flags & (FDIR_DENTRY_LOADED_FLAGS_CHILDREN |
+                        FDIR_DENTRY_LOADED_FLAGS_PARTIAL)) == 0)
+        {
+            dentry_lru_remove(dir);
+        } else {
+            evict_count += evict_children(thread_ctx, dir);
+            if (thread_ctx->lru.tail != dir && DENTRY_LRU_IN_LIST(
+                        thread_ctx, dir))
+            {
+                //the parent is evicted after the children
+                dentry_lru_touch(dir);
+            }
+        }
+        dir = next;
+    }
+
+    if (evict_count > 0) {
+        __sync_add_and_fetch(&thread_ctx->lru.evict_count, evict_count);
+        logDebug("file: "__FILE__", line: %d, "
+                "data thread #%d, scan directory count: %d, "
+                "evict dentry count: %"PRId64, __LINE__,
+                thread_ctx->index, scan_count, evict_count);
+    }
+}
+
+void dentry_lru_sum_counters(int64_t *evict_count, int64_t *reload_count)
+{
+    FDIRDataThreadContext *thread_ctx;
+    FDIRDataThreadContext *end;
+
+    *evict_count = *reload_count = 0;
+    end = g_data_thread_vars.thread_array.contexts +
+        g_data_thread_vars.thread_array.count;
+    for (thread_ctx=g_data_thread_vars.thread_array.contexts;
+            thread_ctx<end; thread_ctx++)
+    {
+        *evict_count += __sync_add_and_fetch(
+                &thread_ctx->lru.evict_count, 0);
+        *reload_count += __sync_add_and_fetch(
+                &thread_ctx->lru.reload_count, 0);
+    }
+}
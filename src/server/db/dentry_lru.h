@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+//dentry_lru.h
+
+#ifndef _FDIR_DENTRY_LRU_H
+#define _FDIR_DENTRY_LRU_H
+
+#include "../server_types.h"
+#include "../data_thread.h"
+
+#define DENTRY_LRU_IN_LIST(thread_ctx, dentry) \
+    ((dentry)->db_args->lru.prev != NULL || \
+     (thread_ctx)->lru.head == (dentry))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int dentry_lru_init();
+
+    /* evict the children of the least recently used directories
+     * when the loaded dentries exceed the memory limit */
+    void dentry_lru_check_evict(FDIRDataThreadContext *thread_ctx);
+
+    void dentry_lru_sum_counters(int64_t *evict_count,
+            int64_t *reload_count);
+
+    static inline void dentry_lru_add(FDIRServerDentry *dentry)
+    {
+        FDIRDataThreadContext *thread_ctx;
+
+        thread_ctx = FDIR_DENTRY_THREAD_CTX(dentry);
+        dentry->db_args->lru.prev = thread_ctx->lru.tail;
+        dentry->db_args->lru.next = NULL;
+        if (thread_ctx->lru.tail == NULL) {
+            thread_ctx->lru.head = dentry;
+        } else {
+            thread_ctx->lru.tail->db_args->lru.next = dentry;
+        }
+        thread_ctx->lru.tail = dentry;
+    }
+
+    static inline void dentry_lru_remove(FDIRServerDentry *dentry)
+    {
+        FDIRDataThreadContext *thread_ctx;
+
+        thread_ctx = FDIR_DENTRY_THREAD_CTX(dentry);
+        if (!DENTRY_LRU_IN_LIST(thread_ctx, dentry)) {
+            return;
+        }
+
+        if (dentry->db_args->lru.prev == NULL) {
+            thread_ctx->lru.head = dentry->db_args->lru.next;
+        } else {
+            dentry->db_args->lru.prev->db_args->lru.next =
+                dentry->db_args->lru.next;
+        }
+
+        if (dentry->db_args->lru.next == NULL) {
+            thread_ctx->lru.tail = dentry->db_args->lru.prev;
+        } else {
+            dentry->db_args->lru.next->db_args->lru.prev =
+                dentry->db_args->lru.prev;
+        }
+
+        dentry->db_args->lru.prev = dentry->db_args->lru.next = NULL;
+    }
+
+    static inline void dentry_lru_touch(FDIRServerDentry *dentry)
+    {
+        if (FDIR_DENTRY_THREAD_CTX(dentry)->lru.tail != dentry) {
+            dentry_lru_remove(dentry);
+            dentry_lru_add(dentry);
+        }
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
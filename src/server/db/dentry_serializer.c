@@ -19,6 +19,7 @@
 #include "fastcommon/pthread_func.h"
 #include "../server_global.h"
 #include "../dentry.h"
+#include "children_chunk.h"
 #include "dentry_serializer.h"
 
 #define DENTRY_FIELD_ID_INODE         1
@@ -40,6 +41,10 @@
 #define DENTRY_FIELD_ID_NAMESPACE_ID 30
 #define DENTRY_FIELD_ID_XATTR       100
 #define DENTRY_FIELD_ID_CHILDREN    101
+#define DENTRY_FIELD_ID_CHUNK_INDEX 102  //children chunks: {key, first_id}
+#define DENTRY_FIELD_ID_CHILD_COUNT 103
+
+#define CHUNK_INDEX_ENTRY_SIZE  16
 
 #define FIXED_INODES_ARRAY_SIZE  1024
 
@@ -138,14 +143,14 @@ static int pack_basic(const FDIRServerDentry *dentry, FastBuffer *buffer)
     if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
         if ((result=sf_serializer_pack_int64(buffer,
                         DENTRY_FIELD_ID_SRC_INODE,
-                        dentry->src_dentry->inode)) != 0)
+                        FDIR_DENTRY_SRC(dentry)->inode)) != 0)
         {
             return result;
         }
     } else if (S_ISLNK(dentry->stat.mode)) {
         if ((result=sf_serializer_pack_string(buffer,
                         DENTRY_FIELD_ID_LINK,
-                        &dentry->link)) != 0)
+                        &FDIR_DENTRY_LINK(dentry))) != 0)
         {
             return result;
         }
@@ -231,6 +236,73 @@ static int pack_basic(const FDIRServerDentry *dentry, FastBuffer *buffer)
     return 0;
 }
 
+static int pack_chunk_index(const FDIRChildrenChunkArray *carray,
+        FastBuffer *buffer)
+{
+    int result;
+    char *index_buff;
+    char *p;
+    string_t index;
+    const FDIRChildrenChunk *chunk;
+    const FDIRChildrenChunk *end;
+
+    if ((result=sf_serializer_pack_int64(buffer,
+                    DENTRY_FIELD_ID_CHILD_COUNT,
+                    carray->total)) != 0)
+    {
+        return result;
+    }
+
+    index_buff = (char *)fc_malloc(CHUNK_INDEX_ENTRY_SIZE * carray->count);
+    if (index_buff == NULL) {
+        return ENOMEM;
+    }
+
+    p = index_buff;
+    end = carray->chunks + carray->count;
+    for (chunk=carray->chunks; chunk<end; chunk++) {
+        long2buff(chunk->key, p);
+        long2buff(chunk->first_id, p + 8);
+        p += CHUNK_INDEX_ENTRY_SIZE;
+    }
+
+    FC_SET_STRING_EX(index, index_buff, p - index_buff);
+    result = sf_serializer_pack_string(buffer,
+            DENTRY_FIELD_ID_CHUNK_INDEX, &index);
+    free(index_buff);
+    return result;
+}
+
+int dentry_serializer_pack_chunk(const FDIRServerDentry *dentry,
+        const FDIRChildrenChunk *chunk, FastBuffer **buffer)
+{
+    int result;
+
+    *buffer = (FastBuffer *)fast_mblock_alloc_object(
+            &g_serializer_ctx.buffer_allocator);
+    if (*buffer == NULL) {
+        return ENOMEM;
+    }
+
+    sf_serializer_pack_begin(*buffer);
+    if ((result=sf_serializer_pack_id_name_array(*buffer,
+                    DENTRY_FIELD_ID_CHILDREN, chunk->array->elts,
+                    chunk->array->count)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "pack children chunk fail, inode: %"PRId64", "
+                "chunk key: %"PRId64", errno: %d, error info: %s",
+                __LINE__, dentry->inode, chunk->key,
+                result, STRERROR(result));
+        fast_mblock_free_object(&g_serializer_ctx.buffer_allocator, *buffer);
+        *buffer = NULL;
+        return result;
+    }
+
+    sf_serializer_pack_end(*buffer);
+    return 0;
+}
+
 int dentry_serializer_pack(const FDIRServerDentry *dentry,
         const int field_index, FastBuffer **buffer)
 {
@@ -238,13 +310,15 @@ int dentry_serializer_pack(const FDIRServerDentry *dentry,
 
     if (field_index == FDIR_PIECE_FIELD_INDEX_CHILDREN) {
         if (dentry->db_args->children == NULL ||
-                dentry->db_args->children->count == 0)
+                dentry->db_args->children->total == 0)
         {
             *buffer = NULL;
             return 0;
         }
     } else if (field_index == FDIR_PIECE_FIELD_INDEX_XATTR) {
-        if (dentry->kv_array == NULL || dentry->kv_array->count == 0) {
+        if (FDIR_DENTRY_KV_ARRAY(dentry) == NULL ||
+                dentry->extra->kv_array->count == 0)
+        {
             *buffer = NULL;
             return 0;
         }
@@ -264,10 +338,7 @@ int dentry_serializer_pack(const FDIRServerDentry *dentry,
             break;
         case FDIR_PIECE_FIELD_INDEX_CHILDREN:
             if (S_ISDIR(dentry->stat.mode)) {
-                result = sf_serializer_pack_id_name_array(*buffer,
-                        DENTRY_FIELD_ID_CHILDREN,
-                        dentry->db_args->children->elts,
-                        dentry->db_args->children->count);
+                result = pack_chunk_index(dentry->db_args->children, *buffer);
             } else {
                 result = EINVAL;
             }
@@ -275,8 +346,8 @@ int dentry_serializer_pack(const FDIRServerDentry *dentry,
         case FDIR_PIECE_FIELD_INDEX_XATTR:
             result = sf_serializer_pack_map(*buffer,
                     DENTRY_FIELD_ID_XATTR,
-                    dentry->kv_array->elts,
-                    dentry->kv_array->count);
+                    dentry->extra->kv_array->elts,
+                    dentry->extra->kv_array->count);
             break;
         default:
             result = EINVAL;
@@ -381,8 +452,11 @@ int dentry_serializer_unpack_basic(FDIRDataThreadContext *thread_ctx,
                 found_src_inode = true;
                 break;
             case DENTRY_FIELD_ID_LINK:
+                if ((result=dentry_check_alloc_extra(dentry)) != 0) {
+                    return result;
+                }
                 if ((result=dentry_strdup(&thread_ctx->dentry_context,
-                                &dentry->link, &fv->value.s)) != 0)
+                                &dentry->extra->link, &fv->value.s)) != 0)
                 {
                     return result;
                 }
@@ -495,7 +569,7 @@ int dentry_serializer_unpack_basic(FDIRDataThreadContext *thread_ctx,
             return ENOENT;
         }
     } else if (S_ISLNK(dentry->stat.mode)) {
-        if (!(found_lnk && dentry->link.len > 0)) {
+        if (!(found_lnk && dentry->extra->link.len > 0)) {
             logError("file: "__FILE__", line: %d, "
                     "inode: %"PRId64", field link not exist",
                     __LINE__, dentry->inode);
@@ -567,6 +641,48 @@ int dentry_serializer_extract_parent(FDIRDBFetchContext *db_fetch_ctx,
     return ENOENT;
 }
 
+int dentry_serializer_extract_pname(SFSerializerIterator *it,
+        FDIRDBUpdateFieldInfo *entry)
+{
+    int result;
+    int found;
+    string_t content;
+    const SFSerializerFieldValue *fv;
+
+    entry->pname.parent_inode = 0;
+    FC_SET_STRING_NULL(entry->pname.name);
+    if (entry->field_index != FDIR_PIECE_FIELD_INDEX_BASIC ||
+            entry->buffer == NULL)
+    {
+        return 0;
+    }
+
+    FC_SET_STRING_EX(content, entry->buffer->data, entry->buffer->length);
+    if ((result=sf_serializer_unpack(it, &content)) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "unpack inode %"PRId64" fail, error info: %s",
+                __LINE__, entry->inode, it->error_info);
+        return result;
+    }
+
+    found = 0;
+    while ((fv=sf_serializer_next(it)) != NULL) {
+        if (fv->fid == DENTRY_FIELD_ID_PARENT) {
+            entry->pname.parent_inode = fv->value.n;
+            ++found;
+        } else if (fv->fid == DENTRY_FIELD_ID_SUBNAME) {
+            entry->pname.name = fv->value.s;
+            ++found;
+        }
+
+        if (found == 2) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
 int dentry_serializer_unpack_children(FDIRDataThreadContext *thread_ctx,
         const string_t *content, const int64_t inode,
         const id_name_array_t **array)
@@ -609,6 +725,84 @@ int dentry_serializer_unpack_children(FDIRDataThreadContext *thread_ctx,
     return 0;
 }
 
+int dentry_serializer_unpack_children_index(FDIRDataThreadContext
+        *thread_ctx, const string_t *content, const int64_t inode,
+        const id_name_array_t **array, FDIRChildrenChunkArray **carray)
+{
+    int result;
+    int count;
+    const char *p;
+    FDIRChildrenChunk *chunk;
+    FDIRChildrenChunk *end;
+    const SFSerializerFieldValue *fv;
+    string_t index;
+    int64_t total;
+
+    if ((result=sf_serializer_unpack(&thread_ctx->
+                    db_fetch_ctx.it, content)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "inode: %"PRId64", unpack children fail, error info: %s",
+                __LINE__, inode, thread_ctx->db_fetch_ctx.it.error_info);
+        return result;
+    }
+
+    *array = NULL;
+    *carray = NULL;
+    total = -1;
+    FC_SET_STRING_NULL(index);
+    while ((fv=sf_serializer_next(&thread_ctx->db_fetch_ctx.it)) != NULL) {
+        switch (fv->fid) {
+            case DENTRY_FIELD_ID_CHILDREN:  //the old format
+                if (fv->type != sf_serializer_value_type_id_name_array) {
+                    logError("file: "__FILE__", line: %d, "
+                            "inode: %"PRId64", the field type: %d is "
+                            "invalid, expected type: %d", __LINE__, inode,
+                            fv->type, sf_serializer_value_type_id_name_array);
+                    return EINVAL;
+                }
+                *array = &fv->value.id_name_array;
+                return 0;
+            case DENTRY_FIELD_ID_CHILD_COUNT:
+                total = fv->value.n;
+                break;
+            case DENTRY_FIELD_ID_CHUNK_INDEX:
+                index = fv->value.s;
+                break;
+            default:
+                logError("file: "__FILE__", line: %d, "
+                        "inode: %"PRId64" unkonw field index: %d",
+                        __LINE__, inode, fv->fid);
+                return EINVAL;
+        }
+    }
+
+    if (total < 0 || index.str == NULL || index.len %
+            CHUNK_INDEX_ENTRY_SIZE != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "inode: %"PRId64", invalid children chunk index, "
+                "child count: %"PRId64", index length: %d",
+                __LINE__, inode, total, index.len);
+        return EINVAL;
+    }
+
+    count = index.len / CHUNK_INDEX_ENTRY_SIZE;
+    if ((*carray=children_chunk_array_create(count)) == NULL) {
+        return ENOMEM;
+    }
+
+    p = index.str;
+    end = (*carray)->chunks + count;
+    for (chunk=(*carray)->chunks; chunk<end; chunk++) {
+        chunk->key = buff2long(p);
+        chunk->first_id = buff2long(p + 8);
+        p += CHUNK_INDEX_ENTRY_SIZE;
+    }
+    (*carray)->total = total;
+    return 0;
+}
+
 int dentry_serializer_unpack_xattr(FDIRDataThreadContext *thread_ctx,
         const string_t *content, const int64_t inode,
         const key_value_array_t **array)
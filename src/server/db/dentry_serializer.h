@@ -41,9 +41,13 @@ extern "C" {
     int dentry_serializer_init();
     void dentry_serializer_destroy();
 
+    /* the children field of the directory holds the chunk index */
     int dentry_serializer_pack(const FDIRServerDentry *dentry,
             const int field_index, FastBuffer **buffer);
 
+    int dentry_serializer_pack_chunk(const FDIRServerDentry *dentry,
+            const FDIRChildrenChunk *chunk, FastBuffer **buffer);
+
 
     static inline FastBuffer *dentry_serializer_alloc_buffer(
             const int capacity)
@@ -92,10 +96,21 @@ extern "C" {
             const string_t *content, const int64_t inode,
             int64_t *parent_inode);
 
+    /* set the parent inode and the name of the basic field entry,
+     * the name points to the buffer of the entry */
+    int dentry_serializer_extract_pname(SFSerializerIterator *it,
+            FDIRDBUpdateFieldInfo *entry);
+
     int dentry_serializer_unpack_children(FDIRDataThreadContext *thread_ctx,
             const string_t *content, const int64_t inode,
             const id_name_array_t **array);
 
+    /* return the children array for the old format (all in one array),
+     * otherwise the chunk layout without the children */
+    int dentry_serializer_unpack_children_index(FDIRDataThreadContext
+            *thread_ctx, const string_t *content, const int64_t inode,
+            const id_name_array_t **array, FDIRChildrenChunkArray **carray);
+
     int dentry_serializer_unpack_xattr(FDIRDataThreadContext *thread_ctx,
             const string_t *content, const int64_t inode,
             const key_value_array_t **array);
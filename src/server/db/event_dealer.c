@@ -19,6 +19,7 @@
 #include "fastcommon/pthread_func.h"
 #include "../server_global.h"
 #include "../dentry.h"
+#include "children_chunk.h"
 #include "dentry_serializer.h"
 #include "db_updater.h"
 #include "event_dealer.h"
@@ -28,6 +29,7 @@
 typedef struct fdir_event_dealer_context {
     FDIRChangeNotifyMessagePtrArray msg_ptr_array;
     FDIRDBUpdaterContext updater_ctx;
+    SFSerializerIterator it;  //for extract the parent and name
     struct {
         FastBuffer *buffers[BUFFER_BATCH_FREE_COUNT];
         int count;
@@ -50,6 +52,7 @@ int event_dealer_init()
         return result;
     }
 
+    sf_serializer_iterator_init(&event_dealer_ctx.it);
     return db_updater_init(&event_dealer_ctx.updater_ctx);
 }
 
@@ -144,40 +147,62 @@ static inline void free_message_buffer(
     }
 }
 
-static int insert_children(FDIRServerDentry *dentry,
-        const id_name_pair_t *pair)
+static int check_alloc_merged_entries(const int inc_count)
 {
-    int target_count;
-    if (dentry->db_args->children == NULL || dentry->db_args->
-            children->alloc <= dentry->db_args->children->count)
+    int result;
+
+    while (MERGED_DENTRY_ARRAY.count + inc_count >
+            MERGED_DENTRY_ARRAY.alloc)
     {
-        target_count = dentry->db_args->children != NULL ?
-            dentry->db_args->children->count + 1 : 1;
-        dentry->db_args->children = id_name_array_allocator_realloc(
-                &ID_NAME_ARRAY_ALLOCATOR_CTX, dentry->db_args->
-                children, target_count);
-        if (dentry->db_args->children == NULL) {
-            return ENOMEM;
+        if ((result=db_updater_realloc_dentry_array(
+                        &MERGED_DENTRY_ARRAY)) != 0)
+        {
+            return result;
         }
     }
 
-    return sorted_array_insert(&ID_NAME_SORTED_ARRAY_CTX, dentry->db_args->
-            children->elts, &dentry->db_args->children->count, pair);
+    return 0;
 }
 
-static int merge_children_messages(FDIRDBUpdateFieldInfo *merged,
+static inline FDIRDBUpdateFieldInfo *alloc_merged_entry(
+        FDIRServerDentry *dentry, const int field_index,
+        const int merge_count)
+{
+    FDIRDBUpdateFieldInfo *merged;
+
+    merged = MERGED_DENTRY_ARRAY.entries + MERGED_DENTRY_ARRAY.count++;
+    merged->version = ++event_dealer_ctx.updater_ctx.last_versions.field;
+    merged->inode = dentry->inode;
+    merged->field_index = field_index;
+    merged->args = dentry;
+    merged->merge_count = merge_count;
+    merged->inc_alloc = 0;
+    merged->mode = dentry->stat.mode;
+    merged->namespace_id = dentry->ns_entry->id;
+    merged->buffer = NULL;
+    merged->pname.parent_inode = 0;
+    FC_SET_STRING_NULL(merged->pname.name);
+    return merged;
+}
+
+static int apply_children_messages(FDIRChildrenChunkArray *carray,
         FDIRChangeNotifyMessage **start, FDIRChangeNotifyMessage **end)
 {
     int result;
+    int chunk_index;
+    id_name_pair_t *found;
     FDIRChangeNotifyMessage **msg;
 
     for (msg=start; msg<end; msg++) {
         if ((int64_t)(*msg)->child.id < 0) {
+            //the child list built after this change
+            children_chunk_mark_dirty(carray, -1 * (int64_t)
+                    (*msg)->child.id);
             continue;
         }
 
         if ((*msg)->op_type == da_binlog_op_type_create) {
-            if ((result=insert_children((*msg)->dentry,
+            if ((result=children_chunk_insert(carray,
                             &(*msg)->child)) != 0)
             {
                 if (result == ENOMEM) {
@@ -190,106 +215,165 @@ static int merge_children_messages(FDIRDBUpdateFieldInfo *merged,
                             result, STRERROR(result));
                 }
             }
-        } else {
-            id_name_pair_t *found;
-
-            if ((*msg)->dentry->db_args->children == NULL) {
-                logWarning("file: "__FILE__", line: %d, "
-                        "inode: %"PRId64", child inode: %"PRId64", "
-                        "the children array is NULL!", __LINE__,
-                        (*msg)->dentry->inode, (*msg)->child.id);
-                continue;
-            }
+            continue;
+        }
 
-            if ((found=sorted_array_find(&ID_NAME_SORTED_ARRAY_CTX,
-                            (*msg)->dentry->db_args->children->elts,
-                            (*msg)->dentry->db_args->children->count,
-                            &(*msg)->child)) == NULL)
-            {
-                id_name_pair_t *pair;
-                id_name_pair_t *end;
-
-                logWarning("file: "__FILE__", line: %d, "
-                        "parent inode: %"PRId64", child %"PRId64" not exist",
-                        __LINE__, (*msg)->dentry->inode, (*msg)->child.id);
-
-                end = (*msg)->dentry->db_args->children->elts +
-                    (*msg)->dentry->db_args->children->count;
-                for (pair=(*msg)->dentry->db_args->children->elts; pair<end; pair++) {
-                    logInfo("children[%d]: %"PRId64, (int)(pair - (*msg)->dentry->
-                        db_args->children->elts) + 1, pair->id);
-                }
+        if ((found=children_chunk_find(carray, (*msg)->child.id,
+                        &chunk_index)) == NULL)
+        {
+            logWarning("file: "__FILE__", line: %d, "
+                    "parent inode: %"PRId64", child %"PRId64" not exist",
+                    __LINE__, (*msg)->dentry->inode, (*msg)->child.id);
+            continue;
+        }
 
-                continue;
-            }
+        server_immediate_free_str(FDIR_DENTRY_CONTEXT((*msg)->dentry), found->name.str);
+        if ((*msg)->op_type == da_binlog_op_type_remove) {
+            children_chunk_delete(carray, chunk_index, found);
+        } else { //update
+            found->name = (*msg)->child.name;
+            carray->chunks[chunk_index].dirty = true;
+        }
+    }
+
+    return 0;
+}
+
+/* only the dirty chunks are persisted, and the chunk index of
+   the directory is persisted when the chunk layout changed */
+static int merge_children_messages(FDIRChangeNotifyMessage **start,
+        FDIRChangeNotifyMessage **end)
+{
+    int result;
+    int merge_count;
+    FDIRServerDentry *dentry;
+    FDIRChildrenChunkArray *carray;
+    FDIRChildrenChunk *chunk;
+    FDIRChildrenChunk *chunk_end;
+    FDIRDBUpdateFieldInfo *merged;
 
-            server_immediate_free_str((*msg)->dentry->context,
-                    found->name.str);
-
-            if ((*msg)->op_type == da_binlog_op_type_remove) {
-                sorted_array_delete_by_index(&ID_NAME_SORTED_ARRAY_CTX,
-                        (*msg)->dentry->db_args->children->elts,
-                        &(*msg)->dentry->db_args->children->count,
-                        found - (id_name_pair_t *)(*msg)->dentry->
-                        db_args->children->elts);
-            } else { //update
-                found->name = (*msg)->child.name;
+    dentry = (*start)->dentry;
+    merge_count = end - start;
+    if ((carray=dentry->db_args->children) == NULL) {
+        logWarning("file: "__FILE__", line: %d, "
+                "inode: %"PRId64", the children array is NULL!",
+                __LINE__, dentry->inode);
+        dentry_release_ex(dentry, merge_count);
+        return 0;
+    }
+
+    if ((result=apply_children_messages(carray, start, end)) != 0) {
+        return result;
+    }
+
+    chunk_end = carray->chunks + carray->count;
+    for (chunk=carray->chunks; chunk<chunk_end; chunk++) {
+        if (!chunk->dirty) {
+            continue;
+        }
+
+        chunk->dirty = false;
+        if (chunk->array->count == 0 && chunk->key == 0) {
+            continue;
+        }
+
+        if ((result=check_alloc_merged_entries(2)) != 0) {
+            return result;
+        }
+
+        /* each merged entry releases the dentry once */
+        if (merge_count == 0) {
+            dentry_hold(dentry);
+        }
+        merged = alloc_merged_entry(dentry, FDIR_PIECE_FIELD_INDEX_CHILDREN,
+                (merge_count > 0 ? merge_count : 1));
+        merge_count = 0;
+        if (chunk->key == 0) {  //the first piece of the chunk
+            chunk->key = FDIR_CHILDREN_CHUNK_KEY(merged->version);
+            carray->index_dirty = true;
+            merged->op_type = da_binlog_op_type_create;
+        } else if (chunk->array->count == 0) {  //the chunk is deleted
+            merged->op_type = da_binlog_op_type_remove;
+        } else {
+            merged->op_type = da_binlog_op_type_update;
+        }
+        merged->inode = chunk->key;
+        if (chunk->array->count > 0) {
+            if ((result=dentry_serializer_pack_chunk(dentry,
+                            chunk, &merged->buffer)) != 0)
+            {
+                return result;
             }
         }
     }
 
-    if ((result=dentry_serializer_pack((*start)->dentry, (*start)->
-                    field_index, &merged->buffer)) != 0)
-    {
-        return result;
+    children_chunk_array_compact(carray);
+    if (carray->index_dirty) {
+        carray->index_dirty = false;
+        if ((result=check_alloc_merged_entries(1)) != 0) {
+            return result;
+        }
+
+        if (merge_count == 0) {
+            dentry_hold(dentry);
+        }
+        merged = alloc_merged_entry(dentry, FDIR_PIECE_FIELD_INDEX_CHILDREN,
+                (merge_count > 0 ? merge_count : 1));
+        merge_count = 0;
+        merged->op_type = da_binlog_op_type_update;
+        if ((result=dentry_serializer_pack(dentry,
+                        FDIR_PIECE_FIELD_INDEX_CHILDREN,
+                        &merged->buffer)) != 0)
+        {
+            return result;
+        }
     }
 
+    if (merge_count > 0) {  //nothing changed
+        dentry_release_ex(dentry, merge_count);
+    }
     return 0;
 }
 
 static int merge_one_field_messages(FDIRChangeNotifyMessage **start,
         FDIRChangeNotifyMessage **end)
 {
+    int result;
     FDIRChangeNotifyMessage **last;
     FDIRChangeNotifyMessage **msg;
     FDIRDBUpdateFieldInfo *merged;
 
     last = end - 1;
-    merged = MERGED_DENTRY_ARRAY.entries + MERGED_DENTRY_ARRAY.count++;
-    merged->version = ++event_dealer_ctx.updater_ctx.last_versions.field;
-    merged->inode = (*start)->dentry->inode;
-    merged->field_index = (*last)->field_index;
-    merged->args = (*start)->dentry;
-    merged->merge_count = end - start;
-    merged->inc_alloc = 0;
-    merged->mode = (*start)->dentry->stat.mode;
-    merged->namespace_id = (*start)->dentry->ns_entry->id;
-
     if ((*last)->field_index == FDIR_PIECE_FIELD_INDEX_CHILDREN) {
-        merged->op_type = da_binlog_op_type_update;
-        return merge_children_messages(merged, start, end);
-    } else {
-        if ((*last)->op_type == da_binlog_op_type_remove &&
-                (*last)->field_index == FDIR_PIECE_FIELD_INDEX_BASIC)
-        {
-            merged->op_type = da_binlog_op_type_remove;
-        }
-        else if ((*start)->op_type == da_binlog_op_type_create &&
-                (*start)->field_index == FDIR_PIECE_FIELD_INDEX_BASIC)
-        {
-            merged->op_type = da_binlog_op_type_create;
-        } else {
-            merged->op_type = da_binlog_op_type_update;
-        }
+        return merge_children_messages(start, end);
+    }
 
-        for (msg=start; msg<end; msg++) {
-            merged->inc_alloc += (*msg)->inc_alloc;
-        }
+    if ((result=check_alloc_merged_entries(1)) != 0) {
+        return result;
+    }
 
-        merged->buffer = (*last)->buffer;
-        free_message_buffer(start, last);
-        return 0;
+    merged = alloc_merged_entry((*start)->dentry,
+            (*last)->field_index, end - start);
+    if ((*last)->op_type == da_binlog_op_type_remove &&
+            (*last)->field_index == FDIR_PIECE_FIELD_INDEX_BASIC)
+    {
+        merged->op_type = da_binlog_op_type_remove;
     }
+    else if ((*start)->op_type == da_binlog_op_type_create &&
+            (*start)->field_index == FDIR_PIECE_FIELD_INDEX_BASIC)
+    {
+        merged->op_type = da_binlog_op_type_create;
+    } else {
+        merged->op_type = da_binlog_op_type_update;
+    }
+
+    for (msg=start; msg<end; msg++) {
+        merged->inc_alloc += (*msg)->inc_alloc;
+    }
+
+    merged->buffer = (*last)->buffer;
+    free_message_buffer(start, last);
+    return dentry_serializer_extract_pname(&event_dealer_ctx.it, merged);
 }
 
 static int merge_one_dentry_messages(FDIRChangeNotifyMessage **start,
@@ -299,14 +383,8 @@ static int merge_one_dentry_messages(FDIRChangeNotifyMessage **start,
     FDIRChangeNotifyMessage **last;
     FDIRChangeNotifyMessage **msg;
 
-    if (MERGED_DENTRY_ARRAY.count + FDIR_PIECE_FIELD_COUNT >
-            MERGED_DENTRY_ARRAY.alloc)
-    {
-        if ((result=db_updater_realloc_dentry_array(
-                        &MERGED_DENTRY_ARRAY)) != 0)
-        {
-            return result;
-        }
+    if ((result=check_alloc_merged_entries(FDIR_PIECE_FIELD_COUNT)) != 0) {
+        return result;
     }
 
     last = end - 1;
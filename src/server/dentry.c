@@ -30,7 +30,9 @@
 #include "inode_generator.h"
 #include "inode_index.h"
 #include "db/change_notify.h"
+#include "db/children_chunk.h"
 #include "db/dentry_loader.h"
+#include "db/dentry_lru.h"
 #include "dentry.h"
 
 typedef struct {
@@ -38,15 +40,14 @@ typedef struct {
     string_t *ptr;
 } StringHolderPtrPair;
 
-const int max_level_count = 20;
-
 #define SET_HARD_LINK_DENTRY(dentry)  \
     do { \
         if (FDIR_IS_DENTRY_HARD_LINK((dentry)->stat.mode)) {  \
-            dentry = (dentry)->src_dentry;  \
+            dentry = FDIR_DENTRY_SRC(dentry);  \
         } \
     } while (0)
 
+static void dentry_free_func(void *ptr, const int delay_seconds);
 
 int dentry_init()
 {
@@ -55,6 +56,8 @@ int dentry_init()
     if ((result=ns_manager_init()) != 0) {
         return result;
     }
+
+    child_index_global_init(dentry_free_func, FDIR_DELAY_FREE_SECONDS);
     return inode_index_init();
 }
 
@@ -67,52 +70,124 @@ void dentry_destroy()
 static void dentry_children_print(FDIRServerDentry *dentry)
 {
     FDIRServerDentry *current;
-    UniqSkiplistIterator iterator;
+    FDIRChildIndexIterator iterator;
     int i = 0;
 
     if (dentry->children == NULL) {
-        logInfo("not skiplist");
+        logInfo("not directory");
         return;
     }
 
-    uniq_skiplist_iterator(dentry->children, &iterator);
-    while ((current=(FDIRServerDentry *)uniq_skiplist_next(&iterator)) != NULL) {
+    child_index_iterator(dentry->children, &iterator);
+    while ((current=child_index_next(&iterator)) != NULL) {
         logInfo("%d. %.*s(%d)", ++i, current->name.len,
                 current->name.str, current->name.len);
     }
 }
 */
 
-static int dentry_compare(const void *p1, const void *p2)
-{
-    return fc_string_compare(&((FDIRServerDentry *)p1)->name,
-            &((FDIRServerDentry *)p2)->name);
-}
-
 static void dentry_free_xattrs(FDIRServerDentry *dentry)
 {
+    FDIRDentryContext *context;
+    SFKeyValueArray *kv_array;
     key_value_pair_t *kv;
     key_value_pair_t *end;
     struct fast_mblock_man *allocator;
 
-    if (dentry->kv_array == NULL) {
+    kv_array = dentry->extra->kv_array;
+    if (kv_array == NULL) {
         return;
     }
 
-    end = dentry->kv_array->elts + dentry->kv_array->count;
-    for (kv=dentry->kv_array->elts; kv<end; kv++) {
-        fast_allocator_free(&dentry->context->name_acontext, kv->key.str);
-        fast_allocator_free(&dentry->context->name_acontext, kv->value.str);
+    context = FDIR_DENTRY_CONTEXT(dentry);
+    end = kv_array->elts + kv_array->count;
+    for (kv=kv_array->elts; kv<end; kv++) {
+        fast_allocator_free(&context->name_acontext, kv->key.str);
+        fast_allocator_free(&context->name_acontext, kv->value.str);
     }
 
-    dentry->kv_array->count = 0;
+    kv_array->count = 0;
     if ((allocator=dentry_get_kvarray_allocator_by_capacity(
-                    dentry->context, dentry->kv_array->alloc)) != NULL)
+                    context, kv_array->alloc)) != NULL)
     {
-        fast_mblock_free_object(allocator, dentry->kv_array);
+        fast_mblock_free_object(allocator, kv_array);
     }
 
-    dentry->kv_array = NULL;
+    dentry->extra->kv_array = NULL;
+}
+
+static void dentry_free_extra(FDIRServerDentry *dentry)
+{
+    FDIRDentryContext *context;
+
+    context = FDIR_DENTRY_CONTEXT(dentry);
+    if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
+        dentry->extra->src_dentry = NULL;
+    } else if (S_ISLNK(dentry->stat.mode) &&
+            dentry->extra->link.str != NULL)
+    {
+        fast_allocator_free(&context->name_acontext,
+                dentry->extra->link.str);
+        FC_SET_STRING_NULL(dentry->extra->link);
+    }
+    dentry_free_xattrs(dentry);
+
+    if (dentry->extra->flock_entry != NULL) {
+        inode_index_free_flock_entry(dentry);
+        dentry->extra->flock_entry = NULL;
+    }
+
+    fast_mblock_free_object(&context->extra_allocator, dentry->extra);
+    dentry->extra = NULL;
+}
+
+int dentry_alloc_extra(FDIRServerDentry *dentry)
+{
+    FDIRServerDentryExtra *extra;
+
+    extra = (FDIRServerDentryExtra *)fast_mblock_alloc_object(
+            &FDIR_DENTRY_CONTEXT(dentry)->extra_allocator);
+    if (extra == NULL) {
+        return ENOMEM;
+    }
+
+    memset(extra, 0, sizeof(*extra));
+    //the flock entry is set by the service threads
+    if (!__sync_bool_compare_and_swap(&dentry->extra, NULL, extra)) {
+        fast_mblock_free_object(&FDIR_DENTRY_CONTEXT(dentry)->
+                extra_allocator, extra);
+    }
+    return 0;
+}
+
+void dentry_get_memory_stat(FDIRDentryMemoryStat *stat)
+{
+    FDIRDataThreadContext *thread_ctx;
+    FDIRDataThreadContext *end;
+    FDIRDentryContext *context;
+    int64_t dentry_bytes;
+    int64_t extra_bytes;
+
+    memset(stat, 0, sizeof(*stat));
+    dentry_bytes = extra_bytes = 0;
+    end = g_data_thread_vars.thread_array.contexts +
+        g_data_thread_vars.thread_array.count;
+    for (thread_ctx=g_data_thread_vars.thread_array.contexts;
+            thread_ctx<end; thread_ctx++)
+    {
+        context = &thread_ctx->dentry_context;
+        stat->dentry_size = context->dentry_allocator.info.element_size;
+        stat->count += context->dentry_allocator.info.element_used_count;
+        stat->extra_count += context->extra_allocator.
+            info.element_used_count;
+        stat->name_bytes += context->name_acontext.alloc_bytes;
+        dentry_bytes += (int64_t)context->dentry_allocator.info.
+            element_size * context->dentry_allocator.info.element_used_count;
+        extra_bytes += (int64_t)context->extra_allocator.info.
+            element_size * context->extra_allocator.info.element_used_count;
+    }
+
+    stat->total_bytes = dentry_bytes + extra_bytes + stat->name_bytes;
 }
 
 static void dentry_do_free(void *ptr, const int dec_count)
@@ -125,42 +200,27 @@ static void dentry_do_free(void *ptr, const int dec_count)
     }
 
     if (dentry->children != NULL) {
-        uniq_skiplist_free(dentry->children);
+        child_index_free(dentry->children);
         dentry->children = NULL;
     }
 
-    fast_allocator_free(&dentry->context->name_acontext, dentry->name.str);
-    if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
-        dentry->src_dentry = NULL;
-    } else if (S_ISLNK(dentry->stat.mode) && dentry->link.str != NULL) {
-        fast_allocator_free(&dentry->context->
-                name_acontext, dentry->link.str);
-        FC_SET_STRING_NULL(dentry->link);
-    }
-    dentry_free_xattrs(dentry);
-
-    if (dentry->flock_entry != NULL) {
-        inode_index_free_flock_entry(dentry);
-        dentry->flock_entry = NULL;
+    fast_allocator_free(&FDIR_DENTRY_CONTEXT(dentry)->
+            name_acontext, dentry->name.str);
+    if (dentry->extra != NULL) {
+        dentry_free_extra(dentry);
     }
 
     if (STORAGE_ENABLED) {
+        dentry_lru_remove(dentry);
         if (dentry->db_args->children != NULL) {
-            id_name_pair_t *pair;
-            id_name_pair_t *end;
-
-            end = dentry->db_args->children->elts +
-                dentry->db_args->children->count;
-            for (pair=dentry->db_args->children->elts; pair<end; pair++) {
-                dentry_strfree(dentry->context, &pair->name);
-            }
-            id_name_array_allocator_free(&ID_NAME_ARRAY_ALLOCATOR_CTX,
+            children_chunk_array_free(FDIR_DENTRY_CONTEXT(dentry),
                     dentry->db_args->children);
             dentry->db_args->children = NULL;
         }
     }
 
-    fast_mblock_free_object(&dentry->context->dentry_allocator, dentry);
+    fast_mblock_free_object(&FDIR_DENTRY_CONTEXT(
+                dentry)->dentry_allocator, dentry);
 }
 
 static void dentry_free(void *ptr)
@@ -179,7 +239,7 @@ static void dentry_free_func(void *ptr, const int delay_seconds)
     dentry = (FDIRServerDentry *)ptr;
 
     if (delay_seconds > 0) {
-        server_add_to_delay_free_queue(&dentry->context->thread_ctx->
+        server_add_to_delay_free_queue(&FDIR_DENTRY_THREAD_CTX(dentry)->
                 free_context, ptr, dentry_free, delay_seconds);
     } else {
         dentry_free(ptr);
@@ -188,7 +248,7 @@ static void dentry_free_func(void *ptr, const int delay_seconds)
 
 void dentry_release_ex(FDIRServerDentry *dentry, const int dec_count)
 {
-    server_add_to_immediate_free_queue_ex(&dentry->context->thread_ctx->
+    server_add_to_immediate_free_queue_ex(&FDIR_DENTRY_THREAD_CTX(dentry)->
             free_context, (void *)(long)dec_count, dentry, dentry_free_ex);
 }
 
@@ -196,7 +256,8 @@ static int dentry_init_obj(void *element, void *init_args)
 {
     FDIRServerDentry *dentry;
     dentry = (FDIRServerDentry *)element;
-    dentry->context = (FDIRDentryContext *)init_args;
+    dentry->thread_index = ((FDIRDentryContext *)
+        init_args)->thread_ctx->index;
     return 0;
 }
 
@@ -225,7 +286,7 @@ static int init_name_allocators(struct fast_allocator_context *name_acontext)
     }
 
     return fast_allocator_init_ex(name_acontext, "name",
-            regions, count, 0, 0.00, 0, false);
+            regions, count, 0, 0.00, 0, DATA_SHARD_ENABLED);
 }
 
 static int kvarray_alloc_init(SFKeyValueArray *kv_array,
@@ -259,7 +320,8 @@ static int init_kvarray_allocators(struct fast_mblock_man
             sizeof(key_value_pair_t) * alloc_count;
         if ((result=fast_mblock_init_ex1(mblock, name, element_size,
                         alloc_elements_once, 0, (fast_mblock_alloc_init_func)
-                        kvarray_alloc_init, mblock, false)) != 0)
+                        kvarray_alloc_init, mblock,
+                        DATA_SHARD_ENABLED)) != 0)
         {
             return result;
         }
@@ -301,14 +363,6 @@ int dentry_init_context(FDIRDataThreadContext *thread_ctx)
 
     context = &thread_ctx->dentry_context;
     context->thread_ctx = thread_ctx;
-    if ((result=uniq_skiplist_init_ex(&context->factory,
-                    max_level_count, dentry_compare, dentry_free_func,
-                    16 * 1024, SKIPLIST_DEFAULT_MIN_ALLOC_ELEMENTS_ONCE,
-                    FDIR_DELAY_FREE_SECONDS)) != 0)
-    {
-        return result;
-    }
-
     if (STORAGE_ENABLED) {
         element_size = sizeof(FDIRServerDentry) +
             sizeof(FDIRServerDentryDBArgs);
@@ -317,7 +371,15 @@ int dentry_init_context(FDIRDataThreadContext *thread_ctx)
     }
     if ((result=fast_mblock_init_ex1(&context->dentry_allocator,
                     "dentry", element_size, 8 * 1024,
-                    0, dentry_init_obj, context, false)) != 0)
+                    0, dentry_init_obj, context, DATA_SHARD_ENABLED)) != 0)
+    {
+        return result;
+    }
+
+    //the flock entry is allocated by the service threads
+    if ((result=fast_mblock_init_ex1(&context->extra_allocator,
+                    "dentry-extra", sizeof(FDIRServerDentryExtra),
+                    4 * 1024, 0, NULL, NULL, true)) != 0)
     {
         return result;
     }
@@ -332,15 +394,41 @@ int dentry_init_context(FDIRDataThreadContext *thread_ctx)
         return result;
     }
 
+    if ((result=path_cache_init(&context->path_cache,
+                    PATH_CACHE_CAPACITY)) != 0)
+    {
+        return result;
+    }
+
     return 0;
 }
 
-static inline int find_child(FDIRDataThreadContext *thread_ctx,
+/* the parent of the intermediate path component is loaded partially,
+ * and all the children are loaded only for the last one */
+static inline int find_child_ex(FDIRDataThreadContext *thread_ctx,
         FDIRServerDentry *parent, const string_t *name,
-        FDIRServerDentry **child)
+        FDIRServerDentry **child, const bool intermediate)
 {
     int result;
-    FDIRServerDentry target;
+
+    if (STORAGE_ENABLED && intermediate) {
+        if ((result=dentry_check_load_basic(thread_ctx, parent)) != 0) {
+            *child = NULL;
+            return result;
+        }
+
+        if (!S_ISDIR(parent->stat.mode)) {
+            *child = NULL;
+            return ENOTDIR;
+        }
+
+        if ((result=dentry_find_child_by_name(thread_ctx,
+                        parent, name, child)) != 0)
+        {
+            return result;
+        }
+        return dentry_check_load_basic(thread_ctx, *child);
+    }
 
     if (STORAGE_ENABLED) {
         if ((result=dentry_check_load(thread_ctx, parent)) != 0) {
@@ -354,9 +442,7 @@ static inline int find_child(FDIRDataThreadContext *thread_ctx,
         return ENOTDIR;
     }
 
-    target.name = *name;
-    if ((*child=(FDIRServerDentry *)uniq_skiplist_find(
-                    parent->children, &target)) == NULL)
+    if ((*child=child_index_find(parent->children, name)) == NULL)
     {
         return ENOENT;
     }
@@ -370,6 +456,40 @@ static inline int find_child(FDIRDataThreadContext *thread_ctx,
     return 0;
 }
 
+#define find_child(thread_ctx, parent, name, child) \
+    find_child_ex(thread_ctx, parent, name, child, false)
+
+static int find_by_path_cache(FDIRNamespaceEntry *ns_entry,
+        FDIRPathCache *cache, const string_t *paths,
+        const int count, FDIRServerDentry **dentry)
+{
+    int result;
+    int index;
+    unsigned int hash_codes[FDIR_MAX_PATH_COUNT];
+
+    path_cache_calc_hash_codes(ns_entry, paths, count, hash_codes);
+    if ((index=path_cache_find(cache, ns_entry, paths,
+                    count, hash_codes, dentry)) == 0)
+    {
+        *dentry = ns_entry->current.root.ptr;
+    }
+
+    for (; index<count; index++) {
+        if ((result=find_child_ex(ns_entry->thread_ctx, *dentry,
+                        paths + index, dentry, index < count - 1)) != 0)
+        {
+            return result;
+        }
+
+        if (S_ISDIR((*dentry)->stat.mode)) {
+            path_cache_add(cache, ns_entry, paths, index,
+                    hash_codes[index], *dentry);
+        }
+    }
+
+    return 0;
+}
+
 static inline int do_find_ex(FDIRNamespaceEntry *ns_entry,
         const string_t *paths, const int count,
         FDIRServerDentry **dentry)
@@ -377,12 +497,18 @@ static inline int do_find_ex(FDIRNamespaceEntry *ns_entry,
     int result;
     const string_t *p;
     const string_t *end;
+    FDIRPathCache *cache;
+
+    cache = &ns_entry->thread_ctx->dentry_context.path_cache;
+    if (cache->entries != NULL) {
+        return find_by_path_cache(ns_entry, cache, paths, count, dentry);
+    }
 
     *dentry = ns_entry->current.root.ptr;
     end = paths + count;
     for (p=paths; p<end; p++) {
-        if ((result=find_child(ns_entry->thread_ctx,
-                        *dentry, p, dentry)) != 0)
+        if ((result=find_child_ex(ns_entry->thread_ctx,
+                        *dentry, p, dentry, p < end - 1)) != 0)
         {
             return result;
         }
@@ -543,6 +669,25 @@ static int dentry_find_me(FDIRDataThreadContext *thread_ctx,
         record->affected.count++;  \
     } while (0)
 
+/* the top level subtrees are spread over the data threads,
+ * and the other dentries follow their parents */
+static inline int get_shard_index(FDIRNamespaceEntry *ns_entry,
+        FDIRServerDentry *parent, const string_t *name)
+{
+    unsigned int hash_code;
+
+    if (parent == NULL) {
+        hash_code = ns_entry->hash_code;
+    } else if (parent->parent == NULL) {
+        hash_code = ns_entry->hash_code + (unsigned int)
+            simple_hash(name->str, name->len);
+    } else {
+        return DATA_SHARD_INDEX(parent->inode);
+    }
+
+    return hash_code % g_data_thread_vars.thread_array.count;
+}
+
 int dentry_create(FDIRDataThreadContext *thread_ctx, FDIRBinlogRecord *record)
 {
     FDIRNamespaceEntry *ns_entry;
@@ -574,8 +719,7 @@ int dentry_create(FDIRDataThreadContext *thread_ctx, FDIRBinlogRecord *record)
 
     is_dir = S_ISDIR(record->stat.mode);
     if (is_dir) {
-        current->children = uniq_skiplist_new(&thread_ctx->dentry_context.
-                factory, DENTRY_SKIPLIST_INIT_LEVEL_COUNT);
+        current->children = child_index_new();
         if (current->children == NULL) {
             return ENOMEM;
         }
@@ -591,10 +735,16 @@ int dentry_create(FDIRDataThreadContext *thread_ctx, FDIRBinlogRecord *record)
     }
 
     if (FDIR_IS_DENTRY_HARD_LINK(record->stat.mode)) {
-        current->src_dentry = record->hdlink.src.dentry;
+        if ((result=dentry_alloc_extra(current)) != 0) {
+            return result;
+        }
+        current->extra->src_dentry = record->hdlink.src.dentry;
     } else if (S_ISLNK(record->stat.mode)) {
+        if ((result=dentry_alloc_extra(current)) != 0) {
+            return result;
+        }
         if ((result=dentry_strdup(&thread_ctx->dentry_context,
-                        &current->link, &record->link)) != 0)
+                        &current->extra->link, &record->link)) != 0)
         {
             return result;
         }
@@ -615,7 +765,13 @@ int dentry_create(FDIRDataThreadContext *thread_ctx, FDIRBinlogRecord *record)
     */
 
     if (record->inode == 0) {
-        current->inode = inode_generator_next();
+        if (DATA_SHARD_ACTIVE) {
+            current->inode = inode_generator_next_ex(get_shard_index(
+                        ns_entry, record->me.parent, &current->name),
+                    g_data_thread_vars.thread_array.count);
+        } else {
+            current->inode = inode_generator_next();
+        }
     } else {
         current->inode = record->inode;
     }
@@ -635,8 +791,8 @@ int dentry_create(FDIRDataThreadContext *thread_ctx, FDIRBinlogRecord *record)
     current->loaded_flags = FDIR_DENTRY_LOADED_FLAGS_ALL;
 
     if (FDIR_IS_DENTRY_HARD_LINK(current->stat.mode)) {
-        current->src_dentry->stat.nlink++;
-        AFFECTED_DENTRIES_ADD(record, current->src_dentry,
+        FDIR_DENTRY_SRC(current)->stat.nlink++;
+        AFFECTED_DENTRIES_ADD(record, FDIR_DENTRY_SRC(current),
                 da_binlog_op_type_update);
     } else {
         if ((result=inode_index_add_dentry(current)) != 0) {
@@ -647,14 +803,14 @@ int dentry_create(FDIRDataThreadContext *thread_ctx, FDIRBinlogRecord *record)
 
     if (current->parent == NULL) {
         ns_entry->current.root.ptr = current;
-    } else if ((result=uniq_skiplist_insert(current->
+    } else if ((result=child_index_insert(current->
                     parent->children, current)) == 0)
     {
         current->parent->stat.nlink++;
     } else {
         logError("file: "__FILE__", line: %d, parent inode: %"PRId64", "
                 "insert child {inode: %"PRId64", name: %.*s} to "
-                "skiplist fail, errno: %d, error info: %s", __LINE__,
+                "child index fail, errno: %d, error info: %s", __LINE__,
                 current->parent->inode, current->inode, current->name.len,
                 current->name.str, result, STRERROR(result));
         return result;
@@ -666,12 +822,16 @@ int dentry_create(FDIRDataThreadContext *thread_ctx, FDIRBinlogRecord *record)
     }
 
     if (is_dir) {
+        if (STORAGE_ENABLED) {
+            dentry_lru_add(current);
+        }
         thread_ctx->dentry_context.counters.dir++;
         __sync_add_and_fetch(&ns_entry->current.counts.dir, 1);
     } else {
         thread_ctx->dentry_context.counters.file++;
         __sync_add_and_fetch(&ns_entry->current.counts.file, 1);
     }
+    fdir_namespace_set_usage_dirty(ns_entry);
     return 0;
 }
 
@@ -691,6 +851,7 @@ static inline int remove_src_dentry(FDIRDataThreadContext *thread_ctx,
         __sync_sub_and_fetch(&dentry->ns_entry->current.counts.file, 1);
         thread_ctx->dentry_context.counters.file--;
     }
+    fdir_namespace_set_usage_dirty(dentry->ns_entry);
 
     dentry_free_func(dentry, FDIR_DELAY_FREE_SECONDS);
     return 0;
@@ -704,15 +865,15 @@ static int do_remove_dentry(FDIRDataThreadContext *thread_ctx,
     DABinlogOpType op_type;
 
     if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
-        if (--(dentry->src_dentry->stat.nlink) == 0) {
+        if (--(FDIR_DENTRY_SRC(dentry)->stat.nlink) == 0) {
             /*
                logInfo("file: "__FILE__", line: %d, "
                "remove hard link src dentry: %"PRId64, __LINE__,
-               dentry->src_dentry->inode);
+               FDIR_DENTRY_SRC(dentry)->inode);
              */
 
             if ((result=remove_src_dentry(thread_ctx,
-                            dentry->src_dentry)) != 0)
+                            FDIR_DENTRY_SRC(dentry))) != 0)
             {
                 return result;
             }
@@ -722,7 +883,7 @@ static int do_remove_dentry(FDIRDataThreadContext *thread_ctx,
             op_type = da_binlog_op_type_update;
         }
 
-        AFFECTED_DENTRIES_ADD(record, dentry->src_dentry, op_type);
+        AFFECTED_DENTRIES_ADD(record, FDIR_DENTRY_SRC(dentry), op_type);
         AFFECTED_DENTRIES_ADD(record, dentry, da_binlog_op_type_remove);
         *free_dentry = true;
     } else {
@@ -754,6 +915,7 @@ static int do_remove_dentry(FDIRDataThreadContext *thread_ctx,
             thread_ctx->dentry_context.counters.file--;
             __sync_sub_and_fetch(&dentry->ns_entry->current.counts.file, 1);
         }
+        fdir_namespace_set_usage_dirty(dentry->ns_entry);
     }
 
     return 0;
@@ -773,7 +935,7 @@ int dentry_remove(FDIRDataThreadContext *thread_ctx,
     }
 
     if (S_ISDIR(record->me.dentry->stat.mode)) {
-        if (!uniq_skiplist_empty(record->me.dentry->children)) {
+        if (!child_index_empty(record->me.dentry->children)) {
             return ENOTEMPTY;
         }
     }
@@ -790,14 +952,14 @@ int dentry_remove(FDIRDataThreadContext *thread_ctx,
         if (free_dentry) {
             dentry_free_func(record->me.dentry, FDIR_DELAY_FREE_SECONDS);
         }
-    } else if ((result=uniq_skiplist_delete_ex(record->me.parent->
+    } else if ((result=child_index_delete_ex(record->me.parent->
                     children, record->me.dentry, free_dentry)) == 0)
     {
         record->me.parent->stat.nlink--;
     } else {
         logError("file: "__FILE__", line: %d, parent inode: %"PRId64", "
                 "delete child {inode: %"PRId64", name: %.*s} from "
-                "skiplist fail, errno: %d, error info: %s", __LINE__,
+                "child index fail, errno: %d, error info: %s", __LINE__,
                 record->me.parent->inode, record->me.dentry->inode,
                 record->me.dentry->name.len, record->me.dentry->name.str,
                 result, STRERROR(result));
@@ -867,7 +1029,7 @@ static int rename_check(FDIRDataThreadContext *thread_ctx,
     }
 
     if (S_ISDIR(record->rename.dest.dentry->stat.mode)) {
-        if (!uniq_skiplist_empty(record->rename.dest.dentry->children)) {
+        if (!child_index_empty(record->rename.dest.dentry->children)) {
             return ENOTEMPTY;
         }
     }
@@ -877,7 +1039,7 @@ static int rename_check(FDIRDataThreadContext *thread_ctx,
 
 static inline void free_dname(FDIRServerDentry *dentry, string_t *old_name)
 {
-    server_delay_free_str(dentry->context, old_name->str);
+    server_delay_free_str(FDIR_DENTRY_CONTEXT(dentry), old_name->str);
 }
 
 static inline void restore_dentry_name(FDIRServerDentry *dentry,
@@ -887,7 +1049,7 @@ static inline void restore_dentry_name(FDIRServerDentry *dentry,
 
     name_to_free = dentry->name.str;
     dentry->name = *old_name;
-    server_delay_free_str(dentry->context, name_to_free);
+    server_delay_free_str(FDIR_DENTRY_CONTEXT(dentry), name_to_free);
 }
 
 static int set_and_store_dentry_name(FDIRDataThreadContext *thread_ctx,
@@ -902,7 +1064,7 @@ static int set_and_store_dentry_name(FDIRDataThreadContext *thread_ctx,
         return 0;
     }
 
-    if ((result=dentry_strdup(dentry->context,
+    if ((result=dentry_strdup(FDIR_DENTRY_CONTEXT(dentry),
                     &cloned_name, new_name)) != 0)
     {
         return result;
@@ -936,7 +1098,7 @@ static int exchange_dentry(FDIRDataThreadContext *thread_ctx,
             record->rename.src.parent->inode);
             */
 
-    if ((result=uniq_skiplist_delete_ex(record->rename.src.parent->
+    if ((result=child_index_delete_ex(record->rename.src.parent->
                     children, record->rename.src.dentry, false)) != 0) {
         return result;
     }
@@ -951,7 +1113,7 @@ static int exchange_dentry(FDIRDataThreadContext *thread_ctx,
             break;
         }
 
-        if ((result=uniq_skiplist_replace_ex(record->rename.dest.parent->
+        if ((result=child_index_replace_ex(record->rename.dest.parent->
                         children, record->rename.src.dentry, false)) != 0)
         {
             break;
@@ -962,12 +1124,12 @@ static int exchange_dentry(FDIRDataThreadContext *thread_ctx,
                         rename.src.pname.name, name_changed,
                         &old_dest_pair)) != 0)
         {
-            uniq_skiplist_replace_ex(record->rename.dest.parent->
+            child_index_replace_ex(record->rename.dest.parent->
                     children, record->rename.dest.dentry, false);  //rollback
             break;
         }
 
-        if ((result=uniq_skiplist_insert(record->rename.src.parent->
+        if ((result=child_index_insert(record->rename.src.parent->
                         children, record->rename.dest.dentry)) != 0)
         {
             if (name_changed) {
@@ -975,7 +1137,7 @@ static int exchange_dentry(FDIRDataThreadContext *thread_ctx,
                         old_dest_pair.ptr);
             }
 
-            uniq_skiplist_replace_ex(record->rename.dest.parent->
+            child_index_replace_ex(record->rename.dest.parent->
                     children, record->rename.dest.dentry, false);  //rollback
             break;
         }
@@ -995,7 +1157,7 @@ static int exchange_dentry(FDIRDataThreadContext *thread_ctx,
                     old_src_pair.ptr);
         }
 
-        uniq_skiplist_insert(record->rename.src.parent->children,
+        child_index_insert(record->rename.src.parent->children,
                 record->rename.src.dentry);
     }
 
@@ -1008,7 +1170,7 @@ static int move_dentry(FDIRDataThreadContext *thread_ctx,
     int result;
     StringHolderPtrPair old_src_pair;
 
-    if ((result=uniq_skiplist_delete_ex(record->rename.src.parent->
+    if ((result=child_index_delete_ex(record->rename.src.parent->
                     children, record->rename.src.dentry, false)) != 0) {
         return result;
     }
@@ -1039,11 +1201,11 @@ static int move_dentry(FDIRDataThreadContext *thread_ctx,
             if ((result=do_remove_dentry(thread_ctx, record, record->
                             rename.dest.dentry, &free_dentry)) == 0)
             {
-                result = uniq_skiplist_replace_ex(record->rename.dest.parent->
+                result = child_index_replace_ex(record->rename.dest.parent->
                         children, record->rename.src.dentry, free_dentry);
             }
         } else {
-            result = uniq_skiplist_insert(record->rename.dest.
+            result = child_index_insert(record->rename.dest.
                     parent->children, record->rename.src.dentry);
         }
 
@@ -1072,7 +1234,7 @@ static int move_dentry(FDIRDataThreadContext *thread_ctx,
     } while (0);
 
     if (result != 0) {  //rollback
-        uniq_skiplist_insert(record->rename.src.parent->children,
+        child_index_insert(record->rename.src.parent->children,
                 record->rename.src.dentry);
     }
 
@@ -1155,83 +1317,23 @@ int dentry_find_ex(const FDIRDEntryFullName *fullname,
     return 0;
 }
 
-int dentry_find_by_pname(FDIRServerDentry *parent, const string_t *name,
-        FDIRServerDentry **dentry)
+int dentry_find_by_pname_ex(FDIRServerDentry *parent, const string_t *name,
+        FDIRServerDentry **dentry, const bool hdlink_follow)
 {
     int result;
 
     if ((result=find_child(parent->ns_entry->thread_ctx,
-                    parent, name, dentry)) == 0)
+                    parent, name, dentry)) == 0 && hdlink_follow)
     {
         SET_HARD_LINK_DENTRY(*dentry);
     }
     return result;
 }
 
-static int check_alloc_dentry_array(FDIRServerDentryArray *array, const int target_count)
-{
-    FDIRServerDentry **entries;
-    int new_alloc;
-    int bytes;
-
-    if (array->alloc >= target_count) {
-        return 0;
-    }
-
-    new_alloc = (array->alloc > 0) ? array->alloc : 4 * 1024;
-    while (new_alloc < target_count) {
-        new_alloc *= 2;
-    }
-
-    bytes = sizeof(FDIRServerDentry *) * new_alloc;
-    entries = (FDIRServerDentry **)fc_malloc(bytes);
-    if (entries == NULL) {
-        return ENOMEM;
-    }
-
-    if (array->entries != NULL) {
-        if (array->count > 0) {
-            memcpy(entries, array->entries,
-                    sizeof(FDIRServerDentry *) * array->count);
-        }
-        free(array->entries);
-    }
-
-    array->alloc = new_alloc;
-    array->entries = entries;
-    return 0;
-}
-
-int dentry_list(FDIRServerDentry *dentry, FDIRServerDentryArray *array)
+void dentry_list_iterator(FDIRServerDentry *dentry,
+        const string_t *last_name, FDIRChildIndexIterator *iterator)
 {
-    FDIRServerDentry *current;
-    FDIRServerDentry **pp;
-    UniqSkiplistIterator iterator;
-    int result;
-    int count;
-
-    if (!S_ISDIR(dentry->stat.mode)) {
-        count = 1;
-    } else {
-        count = uniq_skiplist_count(dentry->children);
-    }
-
-    if ((result=check_alloc_dentry_array(array, count)) != 0) {
-        return result;
-    }
-
-    if (!S_ISDIR(dentry->stat.mode)) {
-        array->entries[array->count++] = dentry;
-    } else {
-        pp = array->entries;
-        uniq_skiplist_iterator(dentry->children, &iterator);
-        while ((current=(FDIRServerDentry *)uniq_skiplist_next(&iterator)) != NULL) {
-            *pp++ = current;
-        }
-        array->count = pp - array->entries;
-    }
-
-    return 0;
+    child_index_iterator_after(dentry->children, last_name, iterator);
 }
 
 int dentry_get_full_path(const FDIRServerDentry *dentry, BufferInfo *full_path,
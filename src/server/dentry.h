@@ -23,7 +23,15 @@
 
 #define FDIR_GET_REAL_DENTRY(dentry)  \
     FDIR_IS_DENTRY_HARD_LINK((dentry)->stat.mode) ? \
-    (dentry)->src_dentry : dentry
+    FDIR_DENTRY_SRC(dentry) : dentry
+
+typedef struct fdir_dentry_memory_stat {
+    int dentry_size;  //the element size of the dentry allocator
+    int64_t count;    //the dentries in memory
+    int64_t extra_count;
+    int64_t name_bytes;
+    int64_t total_bytes;
+} FDIRDentryMemoryStat;
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,6 +45,18 @@ extern "C" {
 
     int dentry_init_context(FDIRDataThreadContext *thread_ctx);
 
+    int dentry_alloc_extra(FDIRServerDentry *dentry);
+
+    void dentry_get_memory_stat(FDIRDentryMemoryStat *stat);
+
+    static inline int dentry_check_alloc_extra(FDIRServerDentry *dentry)
+    {
+        if (dentry->extra != NULL) {
+            return 0;
+        }
+        return dentry_alloc_extra(dentry);
+    }
+
     int dentry_create(FDIRDataThreadContext *thread_ctx,
             FDIRBinlogRecord *record);
 
@@ -59,28 +79,24 @@ extern "C" {
         return dentry_find_ex(fullname, dentry, hdlink_follow);
     }
 
-    int dentry_find_by_pname(FDIRServerDentry *parent,
-            const string_t *name, FDIRServerDentry **dentry);
+    int dentry_find_by_pname_ex(FDIRServerDentry *parent,
+            const string_t *name, FDIRServerDentry **dentry,
+            const bool hdlink_follow);
 
-    int dentry_get_full_path(const FDIRServerDentry *dentry,
-            BufferInfo *full_path, SFErrorInfo *error_info);
-
-    int dentry_list(FDIRServerDentry *dentry, FDIRServerDentryArray *array);
-
-    static inline int dentry_list_by_path(const FDIRDEntryFullName *fullname,
-            FDIRServerDentryArray *array)
+    static inline int dentry_find_by_pname(FDIRServerDentry *parent,
+            const string_t *name, FDIRServerDentry **dentry)
     {
-        const bool hdlink_follow = false;
-        int result;
-        FDIRServerDentry *dentry;
+        const bool hdlink_follow = true;
+        return dentry_find_by_pname_ex(parent, name, dentry, hdlink_follow);
+    }
 
-        array->count = 0;
-        if ((result=dentry_find_ex(fullname, &dentry, hdlink_follow)) != 0) {
-            return result;
-        }
+    int dentry_get_full_path(const FDIRServerDentry *dentry,
+            BufferInfo *full_path, SFErrorInfo *error_info);
 
-        return dentry_list(dentry, array);
-    }
+    /* position the iterator of the directory's children after last_name,
+     * from the first child when last_name is empty */
+    void dentry_list_iterator(FDIRServerDentry *dentry,
+            const string_t *last_name, FDIRChildIndexIterator *iterator);
 
     static inline void dentry_array_free(FDIRServerDentryArray *array)
     {
@@ -106,6 +122,64 @@ extern "C" {
         dentry_release_ex(dentry, 1);
     }
 
+    /* the stat sequence of the data thread which changes the dentry,
+     * the thread is parked while the dispatch mode changes */
+    static inline volatile unsigned int *dentry_stat_seq(
+            const FDIRServerDentry *dentry, const int shard_active)
+    {
+        FDIRDataThreadContext *thread_ctx;
+
+        if (shard_active) {
+            thread_ctx = g_data_thread_vars.thread_array.contexts +
+                DATA_SHARD_INDEX(dentry->inode);
+        } else {
+            thread_ctx = get_data_thread_context(
+                    dentry->ns_entry->hash_code);
+        }
+        return thread_ctx->stat_seqs + (dentry->inode &
+                (FDIR_STAT_SEQ_COUNT - 1));
+    }
+
+    /* called by the data thread around the change of more than one
+     * stat field, the odd sequence means changing, can't be nested */
+    static inline void dentry_stat_change_begin(FDIRServerDentry *dentry)
+    {
+        if (LOCKFREE_QUERY_ENABLED) {
+            ++(*dentry_stat_seq(dentry, DATA_SHARD_ACTIVE));
+            __sync_synchronize();
+        }
+    }
+
+    static inline void dentry_stat_change_end(FDIRServerDentry *dentry)
+    {
+        if (LOCKFREE_QUERY_ENABLED) {
+            __sync_synchronize();
+            ++(*dentry_stat_seq(dentry, DATA_SHARD_ACTIVE));
+        }
+    }
+
+    /* copy the stat in the read section of the lockfree query,
+     * return false when the stat may be changed during the copy */
+    static inline bool dentry_stat_read(const FDIRServerDentry *dentry,
+            FDIRDEntryStat *stat)
+    {
+        volatile unsigned int *seq;
+        unsigned int old_seq;
+        int shard_active;
+
+        shard_active = DATA_SHARD_ACTIVE;
+        seq = dentry_stat_seq(dentry, shard_active);
+        old_seq = *seq;
+        if ((old_seq & 1) != 0) {
+            return false;
+        }
+
+        __sync_synchronize();
+        *stat = dentry->stat;
+        __sync_synchronize();
+        return (*seq == old_seq && DATA_SHARD_ACTIVE == shard_active);
+    }
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "server_global.h"
+#include "binlog/binlog_pack.h"
+#include "binlog/binlog_compact.h"
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-k keep_files=1] <data path>\n"
+            "\tkeep_files: the latest binlog files which are not "
+            "compacted\n\n"
+            "drop the records of the inodes created and removed within "
+            "the compacted binlog files and merge the consecutive updates, "
+            "the fdir_serverd must be stopped\n", argv[0]);
+}
+
+static int get_last_binlog_index()
+{
+    char filename[PATH_MAX];
+    int index;
+
+    index = 0;
+    while (1) {
+        sf_binlog_writer_get_filename(DATA_PATH_STR,
+                FDIR_BINLOG_SUBDIR_NAME, index, filename,
+                sizeof(filename));
+        if (access(filename, F_OK) != 0) {
+            return index - 1;
+        }
+        index++;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int ch;
+    int keep_files;
+    int last_index;
+    int result;
+    BinlogCompactStat stat;
+
+    keep_files = 1;
+    while ((ch=getopt(argc, argv, "hk:")) != -1) {
+        switch (ch) {
+            case 'h':
+                usage(argv);
+                return 0;
+            case 'k':
+                keep_files = strtol(optarg, NULL, 10);
+                if (keep_files < 1) {
+                    usage(argv);
+                    return EINVAL;
+                }
+                break;
+            default:
+                usage(argv);
+                return EINVAL;
+        }
+    }
+
+    if (optind + 1 != argc) {
+        usage(argv);
+        return EINVAL;
+    }
+
+    log_init();
+    DATA_PATH_STR = argv[optind];
+    DATA_PATH_LEN = strlen(DATA_PATH_STR);
+    SF_G_CONTINUE_FLAG = true;
+    if ((result=binlog_pack_init()) != 0) {
+        return result;
+    }
+
+    last_index = get_last_binlog_index() - keep_files;
+    if (last_index < 0) {
+        printf("no binlog file to compact, keep files: %d\n", keep_files);
+        return 0;
+    }
+
+    if ((result=binlog_compact_files(last_index, &stat)) != 0) {
+        fprintf(stderr, "compact binlog files [%d, %d] fail, "
+                "errno: %d, error info: %s\n", stat.start_index,
+                last_index, result, STRERROR(result));
+        return result;
+    }
+    if (stat.start_index > last_index) {
+        printf("the binlog files [0, %d] are already compacted\n",
+                last_index);
+        return 0;
+    }
+
+    printf("compact binlog files [%d, %d] done, rewritten file count: %d, "
+            "record count: %"PRId64", drop count: %"PRId64", "
+            "merge count: %"PRId64", bytes: %"PRId64" => %"PRId64"\n",
+            stat.start_index, last_index, stat.file_count, stat.record_count,
+            stat.drop_count, stat.merge_count, stat.bytes_before,
+            stat.bytes_after);
+    return 0;
+}
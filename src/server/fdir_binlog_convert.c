@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fast_buffer.h"
+#include "server_global.h"
+#include "binlog/binlog_pack.h"
+
+#define CONVERT_INPUT_BUFFER_SIZE   (1024 * 1024)
+#define CONVERT_OUTPUT_FLUSH_SIZE   (256 * 1024)
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-f format=binary] <src binlog file> "
+            "<dest binlog file>\n"
+            "\tformat: text or binary\n\n"
+            "convert the records of the src binlog file to the format, "
+            "the fdir_serverd must be stopped\n", argv[0]);
+}
+
+static int write_buffer(const char *filename, int fd, FastBuffer *buffer)
+{
+    int result;
+
+    if (fc_safe_write(fd, buffer->data, buffer->length) != buffer->length) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "write to file %s fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        return result;
+    }
+
+    buffer->length = 0;
+    return 0;
+}
+
+static int convert_binlog(const char *src_filename,
+        const char *dest_filename, const int format, int64_t *count)
+{
+    int src_fd;
+    int dest_fd;
+    int result;
+    int read_bytes;
+    int remain;
+    int64_t offset;
+    char *in_buff;
+    const char *p;
+    const char *end;
+    const char *rec_end;
+    FDIRBinlogRecord record;
+    FastBuffer out_buffer;
+    char error_info[SF_ERROR_INFO_SIZE];
+
+    if ((result=fast_buffer_init_ex(&out_buffer, CONVERT_OUTPUT_FLUSH_SIZE
+                    + 2 * BINLOG_RECORD_MAX_SIZE)) != 0)
+    {
+        return result;
+    }
+
+    if ((src_fd=open(src_filename, O_RDONLY)) < 0) {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "open file %s fail, errno: %d, error info: %s",
+                __LINE__, src_filename, result, STRERROR(result));
+        fast_buffer_destroy(&out_buffer);
+        return result;
+    }
+
+    if ((dest_fd=open(dest_filename, O_WRONLY | O_CREAT | O_EXCL,
+                    0644)) < 0)
+    {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "create file %s fail, errno: %d, error info: %s",
+                __LINE__, dest_filename, result, STRERROR(result));
+        close(src_fd);
+        fast_buffer_destroy(&out_buffer);
+        return result;
+    }
+
+    in_buff = NULL;
+    if ((in_buff=(char *)fc_malloc(CONVERT_INPUT_BUFFER_SIZE)) == NULL) {
+        result = ENOMEM;
+        goto out;
+    }
+
+    *count = 0;
+    offset = 0;
+    remain = 0;
+    result = 0;
+    while ((read_bytes=read(src_fd, in_buff + remain,
+                    CONVERT_INPUT_BUFFER_SIZE - remain)) > 0)
+    {
+        p = in_buff;
+        end = in_buff + remain + read_bytes;
+        while (p < end) {
+            result = binlog_unpack_record(p, end - p, &record,
+                    &rec_end, error_info, sizeof(error_info));
+            if (result == EAGAIN || result == EOVERFLOW) {
+                result = 0;  //partial record, read more
+                break;
+            } else if (result != 0) {
+                logError("file: "__FILE__", line: %d, "
+                        "binlog file: %s, offset: %"PRId64", "
+                        "unpack record fail, %s", __LINE__,
+                        src_filename, offset, error_info);
+                goto out;
+            }
+
+            if ((result=binlog_pack_record_ex(&record,
+                            &out_buffer, format)) != 0)
+            {
+                goto out;
+            }
+            if (out_buffer.length >= CONVERT_OUTPUT_FLUSH_SIZE) {
+                if ((result=write_buffer(dest_filename, dest_fd,
+                                &out_buffer)) != 0)
+                {
+                    goto out;
+                }
+            }
+
+            offset += rec_end - p;
+            p = rec_end;
+            (*count)++;
+        }
+
+        remain = end - p;
+        if (remain > 0 && p != in_buff) {
+            memmove(in_buff, p, remain);
+        }
+    }
+
+    if (read_bytes < 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "read from file %s fail, errno: %d, error info: %s",
+                __LINE__, src_filename, result, STRERROR(result));
+    } else if (remain > 0) {
+        logError("file: "__FILE__", line: %d, "
+                "binlog file: %s, offset: %"PRId64", the last "
+                "record is incomplete, length: %d", __LINE__,
+                src_filename, offset, remain);
+        result = EINVAL;
+    } else {
+        if ((result=write_buffer(dest_filename, dest_fd,
+                        &out_buffer)) == 0)
+        {
+            if (fsync(dest_fd) != 0) {
+                result = errno != 0 ? errno : EIO;
+                logError("file: "__FILE__", line: %d, "
+                        "fsync file %s fail, errno: %d, error info: %s",
+                        __LINE__, dest_filename, result, STRERROR(result));
+            }
+        }
+    }
+
+out:
+    if (in_buff != NULL) {
+        free(in_buff);
+    }
+    fast_buffer_destroy(&out_buffer);
+    close(src_fd);
+    close(dest_fd);
+    if (result != 0) {
+        unlink(dest_filename);
+    }
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    int ch;
+    int format;
+    int result;
+    int64_t count;
+    char *src_filename;
+    char *dest_filename;
+
+    format = FDIR_BINLOG_FORMAT_BINARY;
+    while ((ch=getopt(argc, argv, "hf:")) != -1) {
+        switch (ch) {
+            case 'h':
+                usage(argv);
+                return 0;
+            case 'f':
+                if (strcasecmp(optarg, "text") == 0) {
+                    format = FDIR_BINLOG_FORMAT_TEXT;
+                } else if (strcasecmp(optarg, "binary") == 0) {
+                    format = FDIR_BINLOG_FORMAT_BINARY;
+                } else {
+                    usage(argv);
+                    return EINVAL;
+                }
+                break;
+            default:
+                usage(argv);
+                return EINVAL;
+        }
+    }
+
+    if (optind + 2 != argc) {
+        usage(argv);
+        return EINVAL;
+    }
+
+    log_init();
+    src_filename = argv[optind];
+    dest_filename = argv[optind + 1];
+    if ((result=binlog_pack_init()) != 0) {
+        return result;
+    }
+
+    if ((result=convert_binlog(src_filename, dest_filename,
+                    format, &count)) != 0)
+    {
+        return result;
+    }
+
+    printf("convert %s to %s done, record count: %"PRId64"\n",
+            src_filename, dest_filename, count);
+    return 0;
+}
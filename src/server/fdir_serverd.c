@@ -45,11 +45,15 @@
 #include "server_func.h"
 #include "dentry.h"
 #include "ns_subscribe.h"
+#include "invalidate_subscribe.h"
+#include "version_waiter.h"
 #include "cluster_relationship.h"
 #include "inode_generator.h"
 #include "server_binlog.h"
 #include "data_thread.h"
 #include "data_loader.h"
+#include "data_snapshot.h"
+#include "binlog/binlog_compact.h"
 #include "cluster_info.h"
 #include "common_handler.h"
 #include "service_handler.h"
@@ -226,6 +230,14 @@ int main(int argc, char *argv[])
             break;
         }
 
+        if ((result=invalidate_subscribe_init()) != 0) {
+            break;
+        }
+
+        if ((result=version_waiter_init()) != 0) {
+            break;
+        }
+
         if ((result=shared_thread_pool_init()) != 0) {
             break;
         }
@@ -252,6 +264,12 @@ int main(int argc, char *argv[])
 
         if (STORAGE_ENABLED) {
             change_notify_load_done_signal();
+        } else if ((result=data_snapshot_init()) != 0) {
+            break;
+        }
+
+        if ((result=binlog_compact_init()) != 0) {
+            break;
         }
 
 #ifdef FDIR_DUMP_DATA_FOR_DEBUG
@@ -289,7 +307,7 @@ int main(int argc, char *argv[])
 
         result = sf_service_init_ex2(&g_sf_context, "service",
                 service_alloc_thread_extra_data, NULL,
-                NULL, sf_proto_set_body_length, service_deal_task,
+                NULL, service_set_body_length, service_deal_task,
                 service_task_finish_cleanup, NULL, 5000,
                 sizeof(FDIRProtoHeader), sizeof(FDIRServerTaskArg),
                 init_nio_task, NULL);
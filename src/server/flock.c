@@ -205,8 +205,9 @@ static inline FLockTask *get_conflict_flock_task(FLockTask *ftask,
     FLockTask *wait;
     int conflict_regions;
 
-    if ((found=get_conflict_ftask_by_region(ftask->dentry->flock_entry,
-                    ftask, check_waiting, &conflict_regions)) == NULL)
+    if ((found=get_conflict_ftask_by_region(ftask->dentry->extra->
+                    flock_entry, ftask, check_waiting,
+                    &conflict_regions)) == NULL)
     {
         if (ftask->type == LOCK_EX) {
             *global_conflict = false;
@@ -217,7 +218,7 @@ static inline FLockTask *get_conflict_flock_task(FLockTask *ftask,
         return found;
     }
 
-    fc_list_for_each_entry(wait, &ftask->dentry->
+    fc_list_for_each_entry(wait, &ftask->dentry->extra->
             flock_entry->waiting_tasks, flink)
     {
         if (is_region_overlap(ftask->region, wait->region)) {
@@ -240,8 +241,8 @@ int flock_apply(FLockContext *ctx, const int64_t offset,
     FLockTask *holder;
     bool global_conflict;
 
-    if ((ftask->region=get_region(ctx, ftask->dentry->flock_entry,
-                    offset, length)) == NULL)
+    if ((ftask->region=get_region(ctx, ftask->dentry->extra->
+                    flock_entry, offset, length)) == NULL)
     {
         return ENOMEM;
     }
@@ -262,7 +263,7 @@ int flock_apply(FLockContext *ctx, const int64_t offset,
     if (global_conflict) {
         ftask->which_queue = FDIR_FLOCK_TASK_IN_GLOBAL_WAITING_QUEUE;
         fc_list_add_tail(&ftask->flink, &ftask->dentry->
-                flock_entry->waiting_tasks);
+                extra->flock_entry->waiting_tasks);
     } else {
         ftask->which_queue = FDIR_FLOCK_TASK_IN_REGION_WAITING_QUEUE;
         fc_list_add_tail(&ftask->flink, &ftask->region->waiting);
@@ -29,10 +29,13 @@ extern "C" {
 int inode_generator_init();
 void inode_generator_destroy();
 
-//skip avoid conflict
+/* skip avoid conflict, the sn file is flushed once per second,
+ * and each inode takes the sn window of data threads in shard mode */
 static inline void inode_generator_skip()
 {
-    __sync_add_and_fetch(&CURRENT_INODE_SN, INODE_SN_MAX_QPS);
+    __sync_add_and_fetch(&CURRENT_INODE_SN, (int64_t)INODE_SN_MAX_QPS *
+            (DATA_SHARD_ENABLED && DATA_THREAD_COUNT > 1 ?
+             DATA_THREAD_COUNT : 1));
 }
 
 static inline int64_t inode_generator_next()
@@ -40,6 +43,26 @@ static inline int64_t inode_generator_next()
     return INODE_CLUSTER_PART | __sync_add_and_fetch(&CURRENT_INODE_SN, 1);
 }
 
+/* generate the inode which satisfies: inode % shard_count == shard_index
+ * the sn window (old_sn, old_sn + shard_count] is reserved for this call
+ */
+static inline int64_t inode_generator_next_ex(const int shard_index,
+        const int shard_count)
+{
+    uint64_t inode;
+    int offset;
+
+    if (shard_count <= 1) {
+        return inode_generator_next();
+    }
+
+    inode = INODE_CLUSTER_PART | (__sync_fetch_and_add(
+                &CURRENT_INODE_SN, shard_count) + 1);
+    offset = (shard_index + shard_count - (int)(inode %
+                shard_count)) % shard_count;
+    return inode + offset;
+}
+
 #ifdef __cplusplus
 }
 #endif
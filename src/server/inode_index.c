@@ -37,13 +37,33 @@ typedef struct {
 } InodeSharedContextArray;
 
 typedef struct {
-    int64_t count;
     int64_t capacity;
     FDIRServerDentry **buckets;
+} InodeBucketArray;
+
+/* the capacities are the multiple of the shared locks count, so the lock
+ * of an inode is the same one for the old and the new bucket arrays */
+typedef struct {
+    volatile int64_t count;
+    int64_t init_capacity;
+    InodeBucketArray *current;
+    InodeBucketArray *rehash_to;  //not NULL when rehashing
+    InodeBucketArray arrays[2];
+    volatile int resize_count;
+
+    struct {
+        pthread_mutex_t lock;
+        FDIRInodeHashtableStat stat;
+    } stat_ctx;  //for chain length histogram
 } InodeHashtable;
 
+#define INODE_HT_REHASH_BATCH_BUCKETS  1024
+#define INODE_HT_STAT_INTERVAL         60
+
 static InodeSharedContextArray inode_shared_ctx_array = {0, NULL};
-static InodeHashtable inode_hashtable = {0, 0, NULL};
+static InodeHashtable inode_hashtable;
+
+static void *inode_hashtable_thread_func(void *arg);
 
 static int init_inode_shared_ctx_array()
 {
@@ -76,24 +96,49 @@ static int init_inode_shared_ctx_array()
     return 0;
 }
 
-static int init_inode_hashtable()
+static int alloc_bucket_array(InodeBucketArray *array,
+        const int64_t capacity)
 {
     int64_t bytes;
 
-    inode_hashtable.capacity = INODE_HASHTABLE_CAPACITY;
-    bytes = sizeof(FDIRServerDentry *) * inode_hashtable.capacity;
-    inode_hashtable.buckets = (FDIRServerDentry **)fc_malloc(bytes);
-    if (inode_hashtable.buckets == NULL) {
+    bytes = sizeof(FDIRServerDentry *) * capacity;
+    array->buckets = (FDIRServerDentry **)fc_malloc(bytes);
+    if (array->buckets == NULL) {
         return ENOMEM;
     }
-    memset(inode_hashtable.buckets, 0, bytes);
+    memset(array->buckets, 0, bytes);
+    array->capacity = capacity;
+    return 0;
+}
 
+static int init_inode_hashtable()
+{
+    int result;
+
+    memset(&inode_hashtable, 0, sizeof(inode_hashtable));
+    if ((result=init_pthread_lock(&inode_hashtable.stat_ctx.lock)) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "init_pthread_lock fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return result;
+    }
+
+    inode_hashtable.init_capacity = ((INODE_HASHTABLE_CAPACITY +
+                inode_shared_ctx_array.count - 1) / inode_shared_ctx_array.
+            count) * inode_shared_ctx_array.count;
+    inode_hashtable.current = inode_hashtable.arrays + 0;
+    if ((result=alloc_bucket_array(inode_hashtable.current,
+                    inode_hashtable.init_capacity)) != 0)
+    {
+        return result;
+    }
     return 0;
 }
 
 int inode_index_init()
 {
     int result;
+    pthread_t tid;
 
     if ((result=init_inode_shared_ctx_array()) != 0) {
         return result;
@@ -103,7 +148,8 @@ int inode_index_init()
         return result;
     }
 
-    return 0;
+    return fc_create_thread(&tid, inode_hashtable_thread_func,
+            NULL, SF_G_THREAD_STACK_SIZE);
 }
 
 void inode_index_destroy()
@@ -169,57 +215,78 @@ static FDIRServerDentry *find_inode_entry(FDIRServerDentry
     return NULL;
 }
 
+static inline void insert_inode_entry(FDIRServerDentry **bucket,
+        FDIRServerDentry *previous, FDIRServerDentry *dentry)
+{
+    if (previous == NULL) {
+        dentry->ht_next = *bucket;
+        *bucket = dentry;
+    } else {
+        dentry->ht_next = previous->ht_next;
+        previous->ht_next = dentry;
+    }
+}
+
+#define INODE_HT_GET_BUCKET(array, inode) \
+    ((array)->buckets + ((uint64_t)(inode)) % (array)->capacity)
+
 #define SET_INODE_HASHTABLE_CTX(inode)  \
-    uint64_t bucket_index;       \
     InodeSharedContext *ctx;    \
     do {  \
-        bucket_index = ((uint64_t)inode) % inode_hashtable.capacity;  \
-        ctx = inode_shared_ctx_array.contexts + bucket_index %    \
+        ctx = inode_shared_ctx_array.contexts + ((uint64_t)inode) % \
             inode_shared_ctx_array.count;   \
     } while (0)
 
 
-#define SET_INODE_HT_BUCKET_AND_CTX(inode)  \
-    FDIRServerDentry **bucket;  \
-    SET_INODE_HASHTABLE_CTX(inode);  \
-    do {  \
-        bucket = inode_hashtable.buckets + bucket_index;   \
-    } while (0)
-
-
 int inode_index_add_dentry(FDIRServerDentry *dentry)
 {
     int result;
+    FDIRServerDentry **bucket;
     FDIRServerDentry *previous;
 
-    SET_INODE_HT_BUCKET_AND_CTX(dentry->inode);
+    SET_INODE_HASHTABLE_CTX(dentry->inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
-    if (find_dentry_for_update(bucket, dentry, &previous) == NULL) {
-        if (previous == NULL) {
-            dentry->ht_next = *bucket;
-            *bucket = dentry;
-        } else {
-            dentry->ht_next = previous->ht_next;
-            previous->ht_next = dentry;
-        }
+    bucket = INODE_HT_GET_BUCKET(inode_hashtable.current, dentry->inode);
+    if (find_dentry_for_update(bucket, dentry, &previous) != NULL) {
+        result = EEXIST;
+    } else if (inode_hashtable.rehash_to == NULL) {
+        insert_inode_entry(bucket, previous, dentry);
         result = 0;
     } else {
-        result = EEXIST;
+        bucket = INODE_HT_GET_BUCKET(inode_hashtable.
+                rehash_to, dentry->inode);
+        if (find_dentry_for_update(bucket, dentry, &previous) == NULL) {
+            insert_inode_entry(bucket, previous, dentry);
+            result = 0;
+        } else {
+            result = EEXIST;
+        }
     }
     PTHREAD_MUTEX_UNLOCK(&ctx->lock);
 
+    if (result == 0) {
+        __sync_add_and_fetch(&inode_hashtable.count, 1);
+    }
     return result;
 }
 
-int inode_index_del_dentry(FDIRServerDentry *dentry)
+int inode_index_del_dentry_ex(FDIRServerDentry *dentry, const bool dec_alloc)
 {
     int result;
+    FDIRServerDentry **bucket;
     FDIRServerDentry *previous;
     FDIRServerDentry *deleted;
 
-    SET_INODE_HT_BUCKET_AND_CTX(dentry->inode);
+    SET_INODE_HASHTABLE_CTX(dentry->inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
-    if ((deleted=find_dentry_for_update(bucket, dentry, &previous)) != NULL) {
+    bucket = INODE_HT_GET_BUCKET(inode_hashtable.current, dentry->inode);
+    deleted = find_dentry_for_update(bucket, dentry, &previous);
+    if (deleted == NULL && inode_hashtable.rehash_to != NULL) {
+        bucket = INODE_HT_GET_BUCKET(inode_hashtable.
+                rehash_to, dentry->inode);
+        deleted = find_dentry_for_update(bucket, dentry, &previous);
+    }
+    if (deleted != NULL) {
         if (previous == NULL) {
             *bucket = (*bucket)->ht_next;
         } else {
@@ -231,9 +298,12 @@ int inode_index_del_dentry(FDIRServerDentry *dentry)
     }
     PTHREAD_MUTEX_UNLOCK(&ctx->lock);
 
-    if (deleted != NULL && deleted->stat.alloc > 0) {
-        fdir_namespace_inc_alloc_bytes(deleted->ns_entry,
-                -1 * deleted->stat.alloc);
+    if (deleted != NULL) {
+        __sync_sub_and_fetch(&inode_hashtable.count, 1);
+        if (dec_alloc && deleted->stat.alloc > 0) {
+            fdir_namespace_inc_alloc_bytes(deleted->ns_entry,
+                    -1 * deleted->stat.alloc);
+        }
     }
 
     return result;
@@ -243,14 +313,226 @@ FDIRServerDentry *inode_index_find_dentry(const int64_t inode)
 {
     FDIRServerDentry *dentry;
 
-    SET_INODE_HT_BUCKET_AND_CTX(inode);
+    SET_INODE_HASHTABLE_CTX(inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
-    dentry = find_inode_entry(bucket, inode);
+    dentry = find_inode_entry(INODE_HT_GET_BUCKET(
+                inode_hashtable.current, inode), inode);
+    if (dentry == NULL && inode_hashtable.rehash_to != NULL) {
+        dentry = find_inode_entry(INODE_HT_GET_BUCKET(
+                    inode_hashtable.rehash_to, inode), inode);
+    }
     PTHREAD_MUTEX_UNLOCK(&ctx->lock);
 
     return dentry;
 }
 
+static void lock_all_shared_contexts()
+{
+    InodeSharedContext *ctx;
+    InodeSharedContext *end;
+
+    end = inode_shared_ctx_array.contexts + inode_shared_ctx_array.count;
+    for (ctx=inode_shared_ctx_array.contexts; ctx<end; ctx++) {
+        PTHREAD_MUTEX_LOCK(&ctx->lock);
+    }
+}
+
+static void unlock_all_shared_contexts()
+{
+    InodeSharedContext *ctx;
+    InodeSharedContext *end;
+
+    end = inode_shared_ctx_array.contexts + inode_shared_ctx_array.count;
+    for (ctx=inode_shared_ctx_array.contexts; ctx<end; ctx++) {
+        PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+    }
+}
+
+static void rehash_bucket(FDIRServerDentry **src, InodeBucketArray *dest)
+{
+    FDIRServerDentry *dentry;
+    FDIRServerDentry *previous;
+    FDIRServerDentry **bucket;
+
+    while (*src != NULL) {
+        dentry = *src;
+        *src = dentry->ht_next;
+
+        bucket = INODE_HT_GET_BUCKET(dest, dentry->inode);
+        find_dentry_for_update(bucket, dentry, &previous);
+        insert_inode_entry(bucket, previous, dentry);
+    }
+}
+
+/* the buckets of the old array are moved stripe by stripe in small batches,
+ * only the switch of the bucket arrays holds all of the shared locks */
+static int inode_hashtable_resize(const int64_t new_capacity)
+{
+    InodeBucketArray *old_array;
+    InodeBucketArray *new_array;
+    InodeSharedContext *ctx;
+    FDIRServerDentry **bucket;
+    FDIRServerDentry **end;
+    int64_t start_time;
+    int result;
+    int i;
+    int count;
+
+    start_time = get_current_time_ms();
+    old_array = inode_hashtable.current;
+    new_array = (old_array == inode_hashtable.arrays + 0) ?
+        inode_hashtable.arrays + 1 : inode_hashtable.arrays + 0;
+    if ((result=alloc_bucket_array(new_array, new_capacity)) != 0) {
+        return result;
+    }
+
+    lock_all_shared_contexts();
+    inode_hashtable.rehash_to = new_array;
+    unlock_all_shared_contexts();
+
+    end = old_array->buckets + old_array->capacity;
+    for (i=0; i<inode_shared_ctx_array.count; i++) {
+        ctx = inode_shared_ctx_array.contexts + i;
+        bucket = old_array->buckets + i;
+        while (bucket < end) {
+            PTHREAD_MUTEX_LOCK(&ctx->lock);
+            count = 0;
+            while (bucket < end && count++ <
+                    INODE_HT_REHASH_BATCH_BUCKETS)
+            {
+                rehash_bucket(bucket, new_array);
+                bucket += inode_shared_ctx_array.count;
+            }
+            PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+        }
+    }
+
+    lock_all_shared_contexts();
+    inode_hashtable.current = new_array;
+    inode_hashtable.rehash_to = NULL;
+    unlock_all_shared_contexts();
+
+    free(old_array->buckets);
+    old_array->buckets = NULL;
+    __sync_add_and_fetch(&inode_hashtable.resize_count, 1);
+
+    logInfo("file: "__FILE__", line: %d, "
+            "inode hashtable resize from %"PRId64" to %"PRId64", "
+            "entry count: %"PRId64", time used: %"PRId64" ms",
+            __LINE__, old_array->capacity, new_capacity,
+            FC_ATOMIC_GET(inode_hashtable.count),
+            get_current_time_ms() - start_time);
+    return 0;
+}
+
+static void inode_hashtable_check_resize()
+{
+    int64_t count;
+    int64_t capacity;
+
+    count = FC_ATOMIC_GET(inode_hashtable.count);
+    capacity = inode_hashtable.current->capacity;
+    if (count > capacity) {
+        inode_hashtable_resize(capacity * 2);
+    } else if (count < capacity / 8 && capacity / 2 >=
+            inode_hashtable.init_capacity)
+    {
+        inode_hashtable_resize(capacity / 2);
+    }
+}
+
+static void inode_hashtable_calc_stat()
+{
+    FDIRInodeHashtableStat stat;
+    InodeSharedContext *ctx;
+    FDIRServerDentry **bucket;
+    FDIRServerDentry **end;
+    FDIRServerDentry *dentry;
+    int length;
+    int index;
+    int count;
+    int i;
+
+    memset(&stat, 0, sizeof(stat));
+    stat.capacity = inode_hashtable.current->capacity;
+    end = inode_hashtable.current->buckets + stat.capacity;
+    for (i=0; i<inode_shared_ctx_array.count; i++) {
+        ctx = inode_shared_ctx_array.contexts + i;
+        bucket = inode_hashtable.current->buckets + i;
+        while (bucket < end) {
+            PTHREAD_MUTEX_LOCK(&ctx->lock);
+            count = 0;
+            while (bucket < end && count++ <
+                    INODE_HT_REHASH_BATCH_BUCKETS)
+            {
+                length = 0;
+                for (dentry=*bucket; dentry!=NULL; dentry=dentry->ht_next) {
+                    length++;
+                }
+
+                if (length > stat.max_chain_length) {
+                    stat.max_chain_length = length;
+                }
+                if (length < 4) {
+                    index = length;
+                } else if (length < 8) {
+                    index = 4;
+                } else if (length < 16) {
+                    index = 5;
+                } else {
+                    index = 6;
+                }
+                stat.chain_histogram[index]++;
+                bucket += inode_shared_ctx_array.count;
+            }
+            PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+        }
+    }
+
+    PTHREAD_MUTEX_LOCK(&inode_hashtable.stat_ctx.lock);
+    inode_hashtable.stat_ctx.stat = stat;
+    PTHREAD_MUTEX_UNLOCK(&inode_hashtable.stat_ctx.lock);
+}
+
+void inode_index_get_stat(FDIRInodeHashtableStat *stat)
+{
+    InodeBucketArray *rehash_to;
+
+    PTHREAD_MUTEX_LOCK(&inode_hashtable.stat_ctx.lock);
+    *stat = inode_hashtable.stat_ctx.stat;
+    PTHREAD_MUTEX_UNLOCK(&inode_hashtable.stat_ctx.lock);
+
+    stat->capacity = inode_hashtable.current->capacity;
+    stat->count = FC_ATOMIC_GET(inode_hashtable.count);
+    stat->resize_count = FC_ATOMIC_GET(inode_hashtable.resize_count);
+    rehash_to = inode_hashtable.rehash_to;
+    stat->rehash_capacity = (rehash_to != NULL ? rehash_to->capacity : 0);
+}
+
+static void *inode_hashtable_thread_func(void *arg)
+{
+    time_t last_stat_time;
+
+#ifdef OS_LINUX
+    prctl(PR_SET_NAME, "inode-rehash");
+#endif
+
+    last_stat_time = 0;
+    while (SF_G_CONTINUE_FLAG) {
+        fc_sleep_ms(1000);
+        if (INODE_HASHTABLE_AUTO_RESIZE) {
+            inode_hashtable_check_resize();
+        }
+
+        if (g_current_time - last_stat_time >= INODE_HT_STAT_INTERVAL) {
+            inode_hashtable_calc_stat();
+            last_stat_time = g_current_time;
+        }
+    }
+
+    return NULL;
+}
+
 int inode_index_get_dentry(FDIRDataThreadContext *thread_ctx,
         const int64_t inode, FDIRServerDentry **dentry)
 {
@@ -297,6 +579,7 @@ int inode_index_check_set_dentry_size(FDIRDataThreadContext *thread_ctx,
     flags = record->options.flags;
     force = ((flags & FDIR_DENTRY_FIELD_MODIFIED_FLAG_FORCE) != 0);
     record->options.flags = 0;
+    dentry_stat_change_begin(record->me.dentry);
     if ((flags & FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE)) {
         if (force || (record->me.dentry->stat.size < record->stat.size)) {
             if (record->me.dentry->stat.size != record->stat.size) {
@@ -330,6 +613,7 @@ int inode_index_check_set_dentry_size(FDIRDataThreadContext *thread_ctx,
         dentry_set_inc_alloc_bytes(record->me.dentry, record->stat.alloc);
         record->options.inc_alloc = 1;
     }
+    dentry_stat_change_end(record->me.dentry);
 
     /*
     logInfo("old size: %"PRId64", new size: %"PRId64", "
@@ -345,6 +629,7 @@ int inode_index_check_set_dentry_size(FDIRDataThreadContext *thread_ctx,
 static void update_dentry(FDIRServerDentry *dentry,
         const FDIRBinlogRecord *record)
 {
+    dentry_stat_change_begin(dentry);
     if (record->options.mode) {
         dentry->stat.mode = record->stat.mode;
     }
@@ -372,6 +657,7 @@ static void update_dentry(FDIRServerDentry *dentry,
     if (record->options.inc_alloc) {
         dentry_set_inc_alloc_bytes(dentry, record->stat.alloc);
     }
+    dentry_stat_change_end(dentry);
 }
 
 int inode_index_update_dentry(FDIRDataThreadContext *thread_ctx,
@@ -393,20 +679,21 @@ static int get_xattr(FDIRServerDentry *dentry, const string_t *name,
         key_value_pair_t **kv)
 {
     int result;
+    SFKeyValueArray *kv_array;
     key_value_pair_t *end;
 
     if (STORAGE_ENABLED) {
-        if ((result=dentry_load_xattr(dentry->context->
-                        thread_ctx, dentry)) != 0)
+        if ((result=dentry_load_xattr(FDIR_DENTRY_THREAD_CTX(
+                            dentry), dentry)) != 0)
         {
             *kv = NULL;
             return result;
         }
     }
 
-    if (dentry->kv_array != NULL) {
-        end = dentry->kv_array->elts + dentry->kv_array->count;
-        for (*kv=dentry->kv_array->elts; *kv<end; (*kv)++) {
+    if ((kv_array=FDIR_DENTRY_KV_ARRAY(dentry)) != NULL) {
+        end = kv_array->elts + kv_array->count;
+        for (*kv=kv_array->elts; *kv<end; (*kv)++) {
             if (fc_string_equal(name, &(*kv)->key)) {
                 return 0;
             }
@@ -427,14 +714,14 @@ int inode_index_remove_xattr(FDIRServerDentry *dentry, const string_t *name)
         return result;
     }
 
-    server_delay_free_str(dentry->context, kv->key.str);
-    server_delay_free_str(dentry->context, kv->value.str);
+    server_delay_free_str(FDIR_DENTRY_CONTEXT(dentry), kv->key.str);
+    server_delay_free_str(FDIR_DENTRY_CONTEXT(dentry), kv->value.str);
 
-    end = dentry->kv_array->elts + dentry->kv_array->count;
+    end = dentry->extra->kv_array->elts + dentry->extra->kv_array->count;
     for (kv=kv+1; kv<end; kv++) {
         *(kv - 1) = *kv;
     }
-    dentry->kv_array->count--;
+    dentry->extra->kv_array->count--;
 
     return 0;
 }
@@ -444,12 +731,18 @@ static key_value_pair_t *check_alloc_kvpair(FDIRDentryContext *context,
 {
     struct fast_mblock_man *allocator;
     SFKeyValueArray *new_array;
+    SFKeyValueArray *kv_array;
+
+    if ((*err_no=dentry_check_alloc_extra(dentry)) != 0) {
+        return NULL;
+    }
 
-    if (dentry->kv_array == NULL) {
+    kv_array = dentry->extra->kv_array;
+    if (kv_array == NULL) {
         allocator = context->kvarray_allocators + 0;
-    } else if (dentry->kv_array->count == dentry->kv_array->alloc) {
+    } else if (kv_array->count == kv_array->alloc) {
         if ((allocator=dentry_get_kvarray_allocator_by_capacity(context,
-                        dentry->kv_array->alloc * 2)) == NULL)
+                        kv_array->alloc * 2)) == NULL)
         {
             *err_no = EOVERFLOW;
             return NULL;
@@ -465,21 +758,21 @@ static key_value_pair_t *check_alloc_kvpair(FDIRDentryContext *context,
             return NULL;
         }
 
-        if (dentry->kv_array == NULL) {
+        if (kv_array == NULL) {
             new_array->count = 0;
         } else {
-            memcpy(new_array->elts, dentry->kv_array->elts,
-                    sizeof(key_value_pair_t) * dentry->kv_array->count);
-            new_array->count = dentry->kv_array->count;
+            memcpy(new_array->elts, kv_array->elts,
+                    sizeof(key_value_pair_t) * kv_array->count);
+            new_array->count = kv_array->count;
             fast_mblock_delay_free_object(allocator - 1,
-                    dentry->kv_array, FDIR_DELAY_FREE_SECONDS);
+                    kv_array, FDIR_DELAY_FREE_SECONDS);
         }
 
-        dentry->kv_array = new_array;
+        kv_array = dentry->extra->kv_array = new_array;
     }
 
     *err_no = 0;
-    return dentry->kv_array->elts + dentry->kv_array->count;
+    return kv_array->elts + kv_array->count;
 }
 
 int inode_index_set_xattr(FDIRServerDentry *dentry,
@@ -502,12 +795,12 @@ int inode_index_set_xattr(FDIRServerDentry *dentry,
             return result;
         }
 
-        if ((kv=check_alloc_kvpair(dentry->context,
+        if ((kv=check_alloc_kvpair(FDIR_DENTRY_CONTEXT(dentry),
                         dentry, &result)) == NULL)
         {
             return result;
         }
-        if ((result=dentry_strdup(dentry->context, &kv->key,
+        if ((result=dentry_strdup(FDIR_DENTRY_CONTEXT(dentry), &kv->key,
                         &record->xattr.key)) != 0)
         {
             return result;
@@ -516,19 +809,19 @@ int inode_index_set_xattr(FDIRServerDentry *dentry,
         new_create = true;
     }
 
-    if ((result=dentry_strdup(dentry->context, &value,
+    if ((result=dentry_strdup(FDIR_DENTRY_CONTEXT(dentry), &value,
                     &record->xattr.value)) != 0)
     {
         if (new_create) {
-            dentry_strfree(dentry->context, &kv->key);
+            dentry_strfree(FDIR_DENTRY_CONTEXT(dentry), &kv->key);
         }
         return result;
     }
 
     if (new_create) {
-        dentry->kv_array->count++;
+        dentry->extra->kv_array->count++;
     } else {
-        server_delay_free_str(dentry->context, kv->value.str);
+        server_delay_free_str(FDIR_DENTRY_CONTEXT(dentry), kv->value.str);
     }
     kv->value = value;
 
@@ -563,9 +856,14 @@ FLockTask *inode_index_flock_apply(FDIRDataThreadContext *thread_ctx,
         SET_INODE_HASHTABLE_CTX(inode);
         PTHREAD_MUTEX_LOCK(&ctx->lock);
         do {
-            if (dentry->flock_entry == NULL) {
-                dentry->flock_entry = flock_alloc_entry(&ctx->flock_ctx);
-                if (dentry->flock_entry == NULL) {
+            if ((*result=dentry_check_alloc_extra(dentry)) != 0) {
+                ftask = NULL;
+                break;
+            }
+            if (dentry->extra->flock_entry == NULL) {
+                dentry->extra->flock_entry = flock_alloc_entry(
+                        &ctx->flock_ctx);
+                if (dentry->extra->flock_entry == NULL) {
                     *result = ENOMEM;
                     ftask = NULL;
                     break;
@@ -608,7 +906,7 @@ int inode_index_flock_getlk(const int64_t inode, FLockTask *ftask)
     {
         SET_INODE_HASHTABLE_CTX(inode);
         PTHREAD_MUTEX_LOCK(&ctx->lock);
-        if (ftask->dentry->flock_entry == NULL) {
+        if (FDIR_DENTRY_FLOCK_ENTRY(ftask->dentry) == NULL) {
             result = ENOENT;
         } else {
             result = flock_get_conflict_lock(&ctx->flock_ctx, ftask);
@@ -623,8 +921,9 @@ void inode_index_flock_release(FLockTask *ftask)
 {
     SET_INODE_HASHTABLE_CTX(ftask->dentry->inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
-    if (ftask->dentry->flock_entry != NULL) {
-        flock_release(&ctx->flock_ctx, ftask->dentry->flock_entry, ftask);
+    if (FDIR_DENTRY_FLOCK_ENTRY(ftask->dentry) != NULL) {
+        flock_release(&ctx->flock_ctx, ftask->dentry->
+                extra->flock_entry, ftask);
     }
     dentry_release(ftask->dentry);
     flock_free_ftask(&ctx->flock_ctx, ftask);
@@ -646,9 +945,14 @@ SysLockTask *inode_index_sys_lock_apply(FDIRDataThreadContext *thread_ctx,
         SET_INODE_HASHTABLE_CTX(inode);
         PTHREAD_MUTEX_LOCK(&ctx->lock);
         do {
-            if (dentry->flock_entry == NULL) {
-                dentry->flock_entry = flock_alloc_entry(&ctx->flock_ctx);
-                if (dentry->flock_entry == NULL) {
+            if ((*result=dentry_check_alloc_extra(dentry)) != 0) {
+                sys_task = NULL;
+                break;
+            }
+            if (dentry->extra->flock_entry == NULL) {
+                dentry->extra->flock_entry = flock_alloc_entry(
+                        &ctx->flock_ctx);
+                if (dentry->extra->flock_entry == NULL) {
                     *result = ENOMEM;
                     sys_task = NULL;
                     break;
@@ -662,7 +966,8 @@ SysLockTask *inode_index_sys_lock_apply(FDIRDataThreadContext *thread_ctx,
 
             sys_task->dentry = dentry;
             sys_task->task = task;
-            *result = sys_lock_apply(dentry->flock_entry, sys_task, block);
+            *result = sys_lock_apply(dentry->extra->flock_entry,
+                    sys_task, block);
             if (*result == 0 || *result == EINPROGRESS) {
                 dentry_hold(dentry);
             } else {
@@ -681,8 +986,9 @@ int inode_index_sys_lock_release(SysLockTask *sys_task)
     int result;
     SET_INODE_HASHTABLE_CTX(sys_task->dentry->inode);
     PTHREAD_MUTEX_LOCK(&ctx->lock);
-    if (sys_task->dentry->flock_entry != NULL) {
-        result = sys_lock_release(sys_task->dentry->flock_entry, sys_task);
+    if (FDIR_DENTRY_FLOCK_ENTRY(sys_task->dentry) != NULL) {
+        result = sys_lock_release(sys_task->dentry->
+                extra->flock_entry, sys_task);
     } else {
         result = ENOENT;
     }
@@ -698,7 +1004,7 @@ void inode_index_free_flock_entry(FDIRServerDentry *dentry)
     SET_INODE_HASHTABLE_CTX(dentry->inode);
 
     PTHREAD_MUTEX_LOCK(&ctx->lock);
-    flock_free_entry(&ctx->flock_ctx, dentry->flock_entry);
+    flock_free_entry(&ctx->flock_ctx, dentry->extra->flock_entry);
     PTHREAD_MUTEX_UNLOCK(&ctx->lock);
 }
 
@@ -712,23 +1018,23 @@ int inode_index_xattrs_copy(const key_value_array_t *kv_array,
 
     end = kv_array->kv_pairs + kv_array->count;
     for (src=kv_array->kv_pairs; src<end; src++) {
-        if ((dest=check_alloc_kvpair(dentry->context,
+        if ((dest=check_alloc_kvpair(FDIR_DENTRY_CONTEXT(dentry),
                         dentry, &result)) == NULL)
         {
             return result;
         }
-        if ((result=dentry_strdup(dentry->context,
+        if ((result=dentry_strdup(FDIR_DENTRY_CONTEXT(dentry),
                         &dest->key, &src->key)) != 0)
         {
             return result;
         }
 
-        if ((result=dentry_strdup(dentry->context,
+        if ((result=dentry_strdup(FDIR_DENTRY_CONTEXT(dentry),
                         &dest->value, &src->value)) != 0)
         {
             return result;
         }
-        dentry->kv_array->count++;
+        dentry->extra->kv_array->count++;
     }
 
     return 0;
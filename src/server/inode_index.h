@@ -23,6 +23,15 @@
 #include "flock.h"
 #include "data_thread.h"
 
+typedef struct fdir_inode_hashtable_stat {
+    int64_t capacity;
+    int64_t count;
+    int64_t rehash_capacity;  //0 for not rehashing
+    int resize_count;
+    int max_chain_length;
+    int64_t chain_histogram[FDIR_INODE_HT_CHAIN_HISTOGRAM_SIZE];
+} FDIRInodeHashtableStat;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -32,10 +41,22 @@ extern "C" {
 
     int inode_index_add_dentry(FDIRServerDentry *dentry);
 
-    int inode_index_del_dentry(FDIRServerDentry *dentry);
+    /* dec_alloc: if decrease the allocated space of the namespace,
+     * false for dentry eviction */
+    int inode_index_del_dentry_ex(FDIRServerDentry *dentry,
+            const bool dec_alloc);
+
+    static inline int inode_index_del_dentry(FDIRServerDentry *dentry)
+    {
+        const bool dec_alloc = true;
+        return inode_index_del_dentry_ex(dentry, dec_alloc);
+    }
 
     FDIRServerDentry *inode_index_find_dentry(const int64_t inode);
 
+    /* the chain length histogram is calculated periodically */
+    void inode_index_get_stat(FDIRInodeHashtableStat *stat);
+
     int inode_index_get_dentry(FDIRDataThreadContext *thread_ctx,
             const int64_t inode, FDIRServerDentry **dentry);
 
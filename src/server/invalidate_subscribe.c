@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/hash.h"
+#include "fastcommon/logger.h"
+#include "sf/sf_global.h"
+#include "common/fdir_proto.h"
+#include "binlog/binlog_types.h"
+#include "server_global.h"
+#include "invalidate_subscribe.h"
+
+#define FDIR_INVALIDATE_MAX_EVENTS_PER_RECORD  6
+
+/* seq is sn + 1 after the event of sn is written, 0 during the writing */
+typedef struct fdir_invalidate_ring_slot {
+    volatile int64_t seq;
+    FDIRInvalidateEvent event;
+} FDIRInvalidateRingSlot;
+
+/* the data threads claim the sn of the ring by atomic add and publish
+ * the slot by the seq without any lock, the lock is only for the
+ * subscriber allocator */
+typedef struct fdir_invalidate_subscribe_context {
+    struct {
+        FDIRInvalidateSubscriber *objects;
+        FDIRInvalidateSubscriber *freelist;
+    } allocator;
+
+    struct {
+        FDIRInvalidateRingSlot *slots;
+        int64_t mask;
+        volatile int64_t next_sn;  //the sn of the next event
+    } ring;
+
+    volatile int subscriber_count;
+    pthread_mutex_t lock;
+} FDIRInvalidateSubscribeContext;
+
+static FDIRInvalidateSubscribeContext invalidate_ctx;
+
+static int init_subscriber_freelist()
+{
+    int bytes;
+    FDIRInvalidateSubscriber *subs;
+    FDIRInvalidateSubscriber *end;
+
+    bytes = sizeof(FDIRInvalidateSubscriber) *
+        FDIR_MAX_INVALIDATE_SUBSCRIBERS;
+    invalidate_ctx.allocator.objects = (FDIRInvalidateSubscriber *)
+        fc_calloc(bytes);
+    if (invalidate_ctx.allocator.objects == NULL) {
+        return ENOMEM;
+    }
+
+    end = invalidate_ctx.allocator.objects + FDIR_MAX_INVALIDATE_SUBSCRIBERS;
+    for (subs=invalidate_ctx.allocator.objects; subs<end - 1; subs++) {
+        subs->next = subs + 1;
+    }
+    (end - 1)->next = NULL;
+    invalidate_ctx.allocator.freelist = invalidate_ctx.allocator.objects;
+    return 0;
+}
+
+int invalidate_subscribe_init()
+{
+    int result;
+    int64_t size;
+    int bytes;
+
+    if ((result=init_subscriber_freelist()) != 0) {
+        return result;
+    }
+
+    size = 1;
+    while (size < INVALIDATE_RING_SIZE) {
+        size *= 2;
+    }
+    bytes = sizeof(FDIRInvalidateRingSlot) * size;
+    invalidate_ctx.ring.slots = (FDIRInvalidateRingSlot *)fc_calloc(bytes);
+    if (invalidate_ctx.ring.slots == NULL) {
+        return ENOMEM;
+    }
+    invalidate_ctx.ring.mask = size - 1;
+    invalidate_ctx.ring.next_sn = 0;
+
+    return init_pthread_lock(&invalidate_ctx.lock);
+}
+
+void invalidate_subscribe_destroy()
+{
+}
+
+FDIRInvalidateSubscriber *invalidate_subscribe_register()
+{
+    FDIRInvalidateSubscriber *subscriber;
+
+    PTHREAD_MUTEX_LOCK(&invalidate_ctx.lock);
+    if ((subscriber=invalidate_ctx.allocator.freelist) != NULL) {
+        invalidate_ctx.allocator.freelist = subscriber->next;
+        subscriber->next_sn = __sync_add_and_fetch(
+                &invalidate_ctx.ring.next_sn, 0);
+        __sync_add_and_fetch(&invalidate_ctx.subscriber_count, 1);
+    }
+    PTHREAD_MUTEX_UNLOCK(&invalidate_ctx.lock);
+
+    return subscriber;
+}
+
+void invalidate_subscribe_unregister(FDIRInvalidateSubscriber *subscriber)
+{
+    PTHREAD_MUTEX_LOCK(&invalidate_ctx.lock);
+    subscriber->next = invalidate_ctx.allocator.freelist;
+    invalidate_ctx.allocator.freelist = subscriber;
+    __sync_sub_and_fetch(&invalidate_ctx.subscriber_count, 1);
+    PTHREAD_MUTEX_UNLOCK(&invalidate_ctx.lock);
+}
+
+#define INVALIDATE_SET_INODE_EVENT(event, _inode) \
+    do { \
+        (event)->inode = _inode;  \
+        (event)->parent_inode = 0; \
+        (event)->name_hash_code = 0; \
+        (event)->flags = FDIR_INVALIDATE_FLAGS_INODE; \
+        (event)++;  \
+    } while (0)
+
+#define INVALIDATE_SET_PNAME_EVENT(event, parent, name, _inode) \
+    do { \
+        (event)->parent_inode = (parent)->inode;  \
+        (event)->name_hash_code = simple_hash((name)->str, (name)->len); \
+        (event)->flags = FDIR_INVALIDATE_FLAGS_PNAME;  \
+        (event)->inode = _inode;  \
+        if (_inode != 0) {  \
+            (event)->flags |= FDIR_INVALIDATE_FLAGS_INODE; \
+        }  \
+        (event)++;  \
+    } while (0)
+
+static int generate_events(FDIRBinlogRecord *record,
+        FDIRInvalidateEvent *events)
+{
+    FDIRInvalidateEvent *event;
+    FDIRServerDentry *dest;
+
+    event = events;
+    switch (record->operation) {
+        case BINLOG_OP_CREATE_DENTRY_INT:
+            if (record->me.parent != NULL) {
+                INVALIDATE_SET_INODE_EVENT(event, record->me.parent->inode);
+            }
+            if (FDIR_IS_DENTRY_HARD_LINK(record->stat.mode)) {
+                INVALIDATE_SET_INODE_EVENT(event, record->hdlink.src.inode);
+            }
+            break;
+        case BINLOG_OP_REMOVE_DENTRY_INT:
+            if (record->me.parent != NULL) {
+                INVALIDATE_SET_PNAME_EVENT(event, record->me.parent,
+                        &record->me.pname.name, record->inode);
+                INVALIDATE_SET_INODE_EVENT(event, record->me.parent->inode);
+            } else {
+                INVALIDATE_SET_INODE_EVENT(event, record->inode);
+            }
+            if (record->me.dentry != NULL && FDIR_IS_DENTRY_HARD_LINK(
+                        record->me.dentry->stat.mode))
+            {
+                INVALIDATE_SET_INODE_EVENT(event, FDIR_DENTRY_SRC(
+                            record->me.dentry)->inode);
+            }
+            break;
+        case BINLOG_OP_RENAME_DENTRY_INT:
+            dest = (record->rename.dest.dentry != NULL ?
+                    record->rename.dest.dentry : record->rename.overwritten);
+            INVALIDATE_SET_PNAME_EVENT(event, record->rename.src.parent,
+                    &record->rename.src.pname.name,
+                    record->rename.src.dentry->inode);
+            INVALIDATE_SET_PNAME_EVENT(event, record->rename.dest.parent,
+                    &record->rename.dest.pname.name,
+                    (dest != NULL ? dest->inode : 0));
+            INVALIDATE_SET_INODE_EVENT(event,
+                    record->rename.src.parent->inode);
+            if (record->rename.dest.parent != record->rename.src.parent) {
+                INVALIDATE_SET_INODE_EVENT(event,
+                        record->rename.dest.parent->inode);
+            }
+            break;
+        case BINLOG_OP_UPDATE_DENTRY_INT:
+            INVALIDATE_SET_INODE_EVENT(event, record->inode);
+            break;
+        case SERVICE_OP_SET_DSIZE_INT:
+            if (record->options.flags != 0) {
+                INVALIDATE_SET_INODE_EVENT(event, record->inode);
+            }
+            break;
+        default:
+            break;
+    }
+
+    return event - events;
+}
+
+static void push_events(const FDIRInvalidateEvent *events, const int count)
+{
+    const FDIRInvalidateEvent *event;
+    const FDIRInvalidateEvent *end;
+    FDIRInvalidateRingSlot *slot;
+    int64_t sn;
+
+    sn = __sync_fetch_and_add(&invalidate_ctx.ring.next_sn, count);
+    end = events + count;
+    for (event=events; event<end; event++, sn++) {
+        slot = invalidate_ctx.ring.slots + (sn & invalidate_ctx.ring.mask);
+        slot->seq = 0;
+        __sync_synchronize();
+        slot->event = *event;
+        __sync_synchronize();
+        slot->seq = sn + 1;
+    }
+}
+
+void invalidate_subscribe_notify(FDIRBinlogRecord *record)
+{
+    FDIRInvalidateEvent events[FDIR_INVALIDATE_MAX_EVENTS_PER_RECORD];
+    FDIRInvalidateEvent *event;
+    FDIRBinlogRecord **pp;
+    FDIRBinlogRecord **recend;
+    int count;
+
+    if (__sync_add_and_fetch(&invalidate_ctx.subscriber_count, 0) == 0) {
+        return;
+    }
+
+    if (record->operation == SERVICE_OP_BATCH_SET_DSIZE_INT) {
+        recend = record->parray->records + record->parray->counts.total;
+        event = events;
+        for (pp=record->parray->records; pp<recend; pp++) {
+            if ((*pp)->options.flags == 0) {
+                continue;
+            }
+
+            INVALIDATE_SET_INODE_EVENT(event, (*pp)->inode);
+            if (event - events == FDIR_INVALIDATE_MAX_EVENTS_PER_RECORD) {
+                push_events(events, event - events);
+                event = events;
+            }
+        }
+        if (event > events) {
+            push_events(events, event - events);
+        }
+        return;
+    }
+
+    if ((count=generate_events(record, events)) == 0) {
+        return;
+    }
+
+    push_events(events, count);
+}
+
+/* the subscriber MUST drop all when the events are overwritten */
+static inline int fetch_overflow(FDIRInvalidateSubscriber *subscriber,
+        bool *overflow, bool *is_last)
+{
+    *overflow = true;
+    *is_last = true;
+    subscriber->next_sn = __sync_add_and_fetch(
+            &invalidate_ctx.ring.next_sn, 0);
+    return 0;
+}
+
+int invalidate_subscribe_fetch(FDIRInvalidateSubscriber *subscriber,
+        FDIRProtoInvalidateEvent *events, const int size,
+        bool *overflow, bool *is_last)
+{
+    FDIRInvalidateRingSlot *slot;
+    FDIRInvalidateEvent event;
+    FDIRProtoInvalidateEvent *proto;
+    int64_t next_sn;
+    int64_t end_sn;
+    int64_t seq;
+
+    next_sn = __sync_add_and_fetch(&invalidate_ctx.ring.next_sn, 0);
+    if (subscriber->next_sn < next_sn - (invalidate_ctx.ring.mask + 1)) {
+        return fetch_overflow(subscriber, overflow, is_last);
+    }
+
+    *overflow = false;
+    end_sn = next_sn;
+    if (end_sn - subscriber->next_sn > size) {
+        end_sn = subscriber->next_sn + size;
+        *is_last = false;
+    } else {
+        *is_last = true;
+    }
+
+    proto = events;
+    for (; subscriber->next_sn < end_sn; subscriber->next_sn++) {
+        slot = invalidate_ctx.ring.slots + (subscriber->next_sn &
+                invalidate_ctx.ring.mask);
+        seq = slot->seq;
+        if (seq != subscriber->next_sn + 1) {
+            if (seq > subscriber->next_sn + 1) {
+                return fetch_overflow(subscriber, overflow, is_last);
+            }
+
+            //claimed but not published yet, fetch it next time
+            *is_last = true;
+            break;
+        }
+
+        __sync_synchronize();
+        event = slot->event;
+        __sync_synchronize();
+        if (slot->seq != seq) {
+            return fetch_overflow(subscriber, overflow, is_last);
+        }
+
+        long2buff(event.inode, proto->inode);
+        long2buff(event.parent_inode, proto->parent_inode);
+        int2buff(event.name_hash_code, proto->name_hash_code);
+        proto->flags = event.flags;
+        proto++;
+    }
+
+    return proto - events;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _INVALIDATE_SUBSCRIBE_H
+#define _INVALIDATE_SUBSCRIBE_H
+
+#include "server_types.h"
+
+struct fdir_binlog_record;
+struct fdir_proto_invalidate_event;
+
+typedef struct fdir_invalidate_event {
+    int64_t inode;         //valid when flags contain INODE
+    int64_t parent_inode;  //valid when flags contain PNAME
+    unsigned int name_hash_code;
+    int flags;
+} FDIRInvalidateEvent;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int invalidate_subscribe_init();
+    void invalidate_subscribe_destroy();
+
+    FDIRInvalidateSubscriber *invalidate_subscribe_register();
+
+    void invalidate_subscribe_unregister(FDIRInvalidateSubscriber
+            *subscriber);
+
+    /* generate the invalidate events of the updated record,
+     * do nothing when no subscriber */
+    void invalidate_subscribe_notify(struct fdir_binlog_record *record);
+
+    /* fetch the events after the subscriber's cursor
+     * return the event count, *overflow set to true when the events
+     * have been overwritten and the subscriber should drop all */
+    int invalidate_subscribe_fetch(FDIRInvalidateSubscriber *subscriber,
+            struct fdir_proto_invalidate_event *events, const int size,
+            bool *overflow, bool *is_last);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "sf/sf_global.h"
+#include "server_global.h"
+#include "latency_stat.h"
+
+static inline void histogram_add(FDIRHistogram *histogram,
+        const int64_t start_time, const int64_t end_time)
+{
+    fdir_histogram_add(histogram, end_time > start_time ?
+            end_time - start_time : 0);
+}
+
+FDIRLatencyStatTable *latency_stat_alloc_table()
+{
+    return (FDIRLatencyStatTable *)fc_calloc(sizeof(FDIRLatencyStatTable));
+}
+
+void latency_stat_add(FDIRLatencyStatTable *table, const int cmd,
+        const FDIRRequestLatency *latency, const int64_t end_time)
+{
+    FDIRCmdLatencyStat *stat;
+    int64_t recv_time;
+
+    if (latency->deal_time == 0 || end_time == 0 ||
+            cmd < 0 || cmd >= FDIR_LATENCY_STAT_MAX_CMD_COUNT)
+    {
+        return;
+    }
+
+    if ((stat=table->cmds[cmd]) == NULL) {
+        if ((stat=(FDIRCmdLatencyStat *)fc_calloc(sizeof(
+                            FDIRCmdLatencyStat))) == NULL)
+        {
+            return;
+        }
+        __sync_synchronize();  //publish to the readers after zeroed
+        table->cmds[cmd] = stat;
+    }
+
+    recv_time = (latency->recv_time > 0 ? latency->recv_time :
+            latency->deal_time);
+    histogram_add(stat->stages + FDIR_LATENCY_STAGE_RECV,
+            recv_time, latency->deal_time);
+    if (latency->enqueue_time > 0 && latency->dequeue_time > 0) {
+        histogram_add(stat->stages + FDIR_LATENCY_STAGE_QUEUE,
+                latency->enqueue_time, latency->dequeue_time);
+        if (latency->done_time > 0) {
+            histogram_add(stat->stages + FDIR_LATENCY_STAGE_EXEC,
+                    latency->dequeue_time, latency->done_time);
+        }
+    }
+
+    if (latency->produce_time > 0) {
+        if (latency->dispatch_time > 0) {
+            histogram_add(stat->stages + FDIR_LATENCY_STAGE_BINLOG,
+                    latency->produce_time, latency->dispatch_time);
+            histogram_add(stat->stages + FDIR_LATENCY_STAGE_REPLICA,
+                    latency->dispatch_time, end_time);
+        } else {
+            histogram_add(stat->stages + FDIR_LATENCY_STAGE_BINLOG,
+                    latency->produce_time, end_time);
+        }
+    }
+
+    histogram_add(stat->stages + FDIR_LATENCY_STAGE_TOTAL,
+            recv_time, end_time);
+}
+
+bool latency_stat_sum(const int cmd, FDIRCmdLatencyStat *stat)
+{
+    struct nio_thread_data *thread_data;
+    struct nio_thread_data *data_end;
+    FDIRLatencyStatTable *table;
+    FDIRCmdLatencyStat *current;
+    bool found;
+    int i;
+
+    memset(stat, 0, sizeof(FDIRCmdLatencyStat));
+    if (cmd < 0 || cmd >= FDIR_LATENCY_STAT_MAX_CMD_COUNT) {
+        return false;
+    }
+
+    /* the counters are updated by the owner threads without lock,
+     * so the sum is approximate when the requests are in progress */
+    found = false;
+    data_end = g_sf_context.thread_data + g_sf_context.work_threads;
+    for (thread_data=g_sf_context.thread_data;
+            thread_data<data_end; thread_data++)
+    {
+        table = ((FDIRServerContext *)thread_data->arg)->
+            service.latency_table;
+        if (table == NULL || (current=table->cmds[cmd]) == NULL) {
+            continue;
+        }
+
+        for (i=0; i<FDIR_LATENCY_STAGE_COUNT; i++) {
+            fdir_histogram_merge(stat->stages + i, current->stages + i);
+        }
+        found = true;
+    }
+
+    return found;
+}
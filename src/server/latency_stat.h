@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//latency_stat.h
+
+#ifndef _LATENCY_STAT_H_
+#define _LATENCY_STAT_H_
+
+#include <string.h>
+#include "fastcommon/shared_func.h"
+#include "common/fdir_histogram.h"
+#include "server_global.h"
+
+typedef struct fdir_cmd_latency_stat {
+    FDIRHistogram stages[FDIR_LATENCY_STAGE_COUNT];
+} FDIRCmdLatencyStat;
+
+/* one table per service thread, written by the owner thread only,
+ * the stat of the command is allocated on demand */
+typedef struct fdir_latency_stat_table {
+    FDIRCmdLatencyStat * volatile cmds[FDIR_LATENCY_STAT_MAX_CMD_COUNT];
+} FDIRLatencyStatTable;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+FDIRLatencyStatTable *latency_stat_alloc_table();
+
+/* add the stages of the finished request to the table of current thread */
+void latency_stat_add(FDIRLatencyStatTable *table, const int cmd,
+        const FDIRRequestLatency *latency, const int64_t end_time);
+
+/* sum the histograms of the command from all service threads,
+ * return false when no request of the command */
+bool latency_stat_sum(const int cmd, FDIRCmdLatencyStat *stat);
+
+//return 0 when the latency stat is disabled
+static inline int64_t latency_stat_now()
+{
+    return LATENCY_STAT_ENABLED ? get_current_time_us() : 0;
+}
+
+/* called when the request body received, the recv_time is set
+ * by the header receiving of this request */
+static inline void latency_stat_request_start(FDIRRequestLatency *latency)
+{
+    int64_t recv_time;
+
+    recv_time = latency->recv_time;
+    memset(latency, 0, sizeof(FDIRRequestLatency));
+    latency->recv_time = recv_time;
+    latency->deal_time = latency_stat_now();
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
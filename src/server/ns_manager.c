@@ -161,7 +161,7 @@ void fdir_namespace_inc_alloc_bytes(FDIRNamespaceEntry *ns_entry,
         const int64_t inc_alloc)
 {
     __sync_add_and_fetch(&ns_entry->current.used_bytes, inc_alloc);
-    ns_subscribe_notify_all(ns_entry);
+    fdir_namespace_set_usage_dirty(ns_entry);
 }
 
 static int write_binlog(const FDIRNamespaceEntry *entry)
@@ -396,6 +396,26 @@ void fdir_namespace_push_all_to_holding_queue(FDIRNSSubscriber *subscriber)
     }
 }
 
+void fdir_namespace_publish_usages()
+{
+    FDIRNamespaceEntry **ns_entry;
+    FDIRNamespaceEntry **ns_end;
+
+    PTHREAD_MUTEX_LOCK(&fdir_manager.lock);
+    ns_end = fdir_manager.array.namespaces + fdir_manager.array.count;
+    for (ns_entry=fdir_manager.array.namespaces;
+            ns_entry<ns_end; ns_entry++)
+    {
+        if (FC_ATOMIC_GET((*ns_entry)->usage_dirty) &&
+                __sync_bool_compare_and_swap(&(*ns_entry)->
+                    usage_dirty, 1, 0))
+        {
+            ns_subscribe_notify_all(*ns_entry);
+        }
+    }
+    PTHREAD_MUTEX_UNLOCK(&fdir_manager.lock);
+}
+
 static int realloc_namespace_ptr_array(FDIRNamespaceDumpContext *ctx,
         const int target_count)
 {
@@ -40,6 +40,7 @@ typedef struct fdir_namespace_entry {
     FDIRNamespaceInfo current;
     FDIRNamespaceInfo delay;   //for storage engine
     FDIRDataThreadContext *thread_ctx;
+    volatile int usage_dirty;  //published by the subscribe thread
 
     struct {
         struct fdir_namespace_entry *htable; //for hashtable
@@ -84,6 +85,17 @@ extern "C" {
     void fdir_namespace_push_all_to_holding_queue(
             FDIRNSSubscriber *subscriber);
 
+    //notify the subscribers of the namespaces which usage changed
+    void fdir_namespace_publish_usages();
+
+    static inline void fdir_namespace_set_usage_dirty(
+            FDIRNamespaceEntry *ns_entry)
+    {
+        if (!FC_ATOMIC_GET(ns_entry->usage_dirty)) {
+            FC_ATOMIC_SET(ns_entry->usage_dirty, 1);
+        }
+    }
+
     int fdir_namespace_dump(FDIRNamespaceDumpContext *ctx);
     int fdir_namespace_load(int64_t *last_version);
 
@@ -17,6 +17,7 @@
 #include <sys/stat.h>
 #include <sys/xattr.h>
 #include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
 #include "fastcommon/sched_thread.h"
 #include "fastcommon/logger.h"
 #include "sf/sf_global.h"
@@ -85,9 +86,30 @@ static int init_subscriber_freelist(FDIRNSSubscribersAllocator *allocator)
     return 0;
 }
 
+/* coalesce the usage changes of the namespaces, so the data threads
+   only set the dirty flag without the subscribe lock */
+static void *ns_publish_thread_func(void *arg)
+{
+#ifdef OS_LINUX
+    prctl(PR_SET_NAME, "ns-publish");
+#endif
+
+    while (SF_G_CONTINUE_FLAG) {
+        fc_sleep_ms(NS_USAGE_NOTIFY_INTERVAL_MS);
+        if (fc_list_empty(&subscribe_ctx.subscribers.head)) {
+            continue;
+        }
+
+        fdir_namespace_publish_usages();
+    }
+
+    return NULL;
+}
+
 int ns_subscribe_init()
 {
     int result;
+    pthread_t tid;
 
     if ((result=init_subscriber_freelist(&subscribe_ctx.allocator)) != 0) {
         return result;
@@ -98,7 +120,8 @@ int ns_subscribe_init()
     }
 
     FC_INIT_LIST_HEAD(&subscribe_ctx.subscribers.head);
-    return 0;
+    return fc_create_thread(&tid, ns_publish_thread_func,
+            NULL, SF_G_THREAD_STACK_SIZE);
 }
 
 void ns_subscribe_destroy()
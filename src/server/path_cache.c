@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sys/stat.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "server_global.h"
+#include "ns_manager.h"
+#include "inode_index.h"
+#include "path_cache.h"
+
+int path_cache_init(FDIRPathCache *cache, const int capacity)
+{
+    int64_t bytes;
+    unsigned int size;
+
+    cache->hit_count = cache->miss_count = 0;
+    if (capacity <= 0) {
+        cache->mask = 0;
+        cache->entries = NULL;
+        return 0;
+    }
+
+    size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    bytes = sizeof(FDIRPathCacheEntry) * size;
+    cache->entries = (FDIRPathCacheEntry *)fc_malloc(bytes);
+    if (cache->entries == NULL) {
+        return ENOMEM;
+    }
+    memset(cache->entries, 0, bytes);
+    cache->mask = size - 1;
+    return 0;
+}
+
+void path_cache_calc_hash_codes(FDIRNamespaceEntry *ns_entry,
+        const string_t *paths, const int count,
+        unsigned int *hash_codes)
+{
+    const string_t *p;
+    const string_t *end;
+    const char *s;
+    const char *send;
+    unsigned int hash_code;
+
+    hash_code = ns_entry->hash_code;
+    s = paths[0].str;
+    end = paths + count;
+    for (p=paths; p<end; p++) {
+        send = p->str + p->len;
+        while (s < send) {
+            hash_code = hash_code * 31 + (unsigned char)*s++;
+        }
+        *hash_codes++ = hash_code;
+    }
+}
+
+static inline void get_path_prefix(const string_t *paths,
+        const int index, string_t *prefix)
+{
+    prefix->str = paths[0].str;
+    prefix->len = (paths[index].str + paths[index].len) - paths[0].str;
+}
+
+static inline void clear_entry(FDIRPathCacheEntry *entry)
+{
+    entry->dentry = NULL;
+    entry->ns_entry = NULL;
+}
+
+/* check the dentry and its ancestors from bottom to top */
+static bool check_entry_dentry(FDIRNamespaceEntry *ns_entry,
+        FDIRServerDentry *dentry, const string_t *paths, const int index)
+{
+    const string_t *p;
+
+    for (p=paths+index; p>=paths; p--) {
+        if (dentry == NULL || dentry->stat.nlink == 0 ||
+                !fc_string_equal(&dentry->name, p))
+        {
+            return false;
+        }
+        dentry = dentry->parent;
+    }
+
+    return (dentry != NULL && dentry == ns_entry->current.root.ptr);
+}
+
+int path_cache_find(FDIRPathCache *cache, FDIRNamespaceEntry *ns_entry,
+        const string_t *paths, const int count,
+        const unsigned int *hash_codes, FDIRServerDentry **dentry)
+{
+    FDIRPathCacheEntry *entry;
+    string_t prefix;
+    int index;
+
+    for (index=count-1; index>=0; index--) {
+        entry = cache->entries + (hash_codes[index] & cache->mask);
+        if (entry->dentry == NULL || entry->ns_entry != ns_entry ||
+                entry->hash_code != hash_codes[index])
+        {
+            continue;
+        }
+
+        get_path_prefix(paths, index, &prefix);
+        if (!fc_string_equal(&entry->path, &prefix)) {
+            continue;
+        }
+
+        if (inode_index_find_dentry(entry->inode) == entry->dentry &&
+                check_entry_dentry(ns_entry, entry->dentry, paths, index))
+        {
+            cache->hit_count++;
+            *dentry = entry->dentry;
+            return index + 1;
+        }
+
+        //renamed or removed
+        clear_entry(entry);
+    }
+
+    cache->miss_count++;
+    return 0;
+}
+
+void path_cache_add(FDIRPathCache *cache, FDIRNamespaceEntry *ns_entry,
+        const string_t *paths, const int index,
+        const unsigned int hash_code, FDIRServerDentry *dentry)
+{
+    FDIRPathCacheEntry *entry;
+    string_t prefix;
+    char *buff;
+    int alloc_size;
+
+    get_path_prefix(paths, index, &prefix);
+    entry = cache->entries + (hash_code & cache->mask);
+    if (prefix.len > entry->alloc_size) {
+        alloc_size = (entry->alloc_size > 0) ? entry->alloc_size : 64;
+        while (alloc_size < prefix.len) {
+            alloc_size *= 2;
+        }
+        if ((buff=(char *)fc_malloc(alloc_size)) == NULL) {
+            return;
+        }
+
+        if (entry->path.str != NULL) {
+            free(entry->path.str);
+        }
+        entry->path.str = buff;
+        entry->alloc_size = alloc_size;
+    }
+
+    memcpy(entry->path.str, prefix.str, prefix.len);
+    entry->path.len = prefix.len;
+    entry->hash_code = hash_code;
+    entry->ns_entry = ns_entry;
+    entry->inode = dentry->inode;
+    entry->dentry = dentry;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//path_cache.h
+
+#ifndef _FDIR_PATH_CACHE_H
+#define _FDIR_PATH_CACHE_H
+
+#include "server_types.h"
+
+typedef struct fdir_path_cache_entry {
+    unsigned int hash_code;
+    int alloc_size;   //the buffer size of the path
+    struct fdir_namespace_entry *ns_entry;
+    int64_t inode;    //for checking the dentry alive
+    FDIRServerDentry *dentry;  //NOT hold the reference
+    string_t path;    //the path prefix without the leading slash
+} FDIRPathCacheEntry;
+
+/* the direct mapped cache of the directory path prefix to the dentry,
+ * the entries are checked by the names and the parents when hit,
+ * so the renamed and removed dentries never be returned.
+ *
+ * the entry does not hold the dentry, so the removed dentry is freed
+ * as usual. the dentry is dereferenced only after the inode index
+ * returns the same dentry of the inode, which means it is not removed */
+typedef struct fdir_path_cache {
+    unsigned int mask;
+    FDIRPathCacheEntry *entries;  //NULL for disabled
+    int64_t hit_count;
+    int64_t miss_count;
+} FDIRPathCache;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int path_cache_init(FDIRPathCache *cache, const int capacity);
+
+    void path_cache_calc_hash_codes(struct fdir_namespace_entry *ns_entry,
+            const string_t *paths, const int count,
+            unsigned int *hash_codes);
+
+    /* return the count of the resolved paths, 0 for not found */
+    int path_cache_find(FDIRPathCache *cache,
+            struct fdir_namespace_entry *ns_entry, const string_t *paths,
+            const int count, const unsigned int *hash_codes,
+            FDIRServerDentry **dentry);
+
+    /* add the path prefix paths[0..index] which resolved to the dentry */
+    void path_cache_add(FDIRPathCache *cache,
+            struct fdir_namespace_entry *ns_entry, const string_t *paths,
+            const int index, const unsigned int hash_code,
+            FDIRServerDentry *dentry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
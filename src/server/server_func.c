@@ -245,6 +245,16 @@ static int load_storage_engine_apis()
     LOAD_API(STORAGE_ENGINE_REDO_API, fdir_storage_engine_redo);
     LOAD_API(STORAGE_ENGINE_FETCH_API, fdir_storage_engine_fetch);
 
+    //optional, load all children of the parent when not supported
+    STORAGE_ENGINE_FETCH_CHILD_API = (fdir_storage_engine_fetch_child_func)
+        dlsym(dlhandle, "fdir_storage_engine_fetch_child");
+    if (STORAGE_ENGINE_FETCH_CHILD_API == NULL) {
+        logInfo("file: "__FILE__", line: %d, "
+                "%s without api fdir_storage_engine_fetch_child, "
+                "the children of the directory will be loaded entirely",
+                __LINE__, STORAGE_ENGINE_LIBRARY);
+    }
+
     return 0;
 }
 
@@ -351,25 +361,47 @@ static void server_log_configs()
 
     len = snprintf(sz_server_config, sizeof(sz_server_config),
             "cluster_id = %d, my server id = %d, data_path = %s, "
-            "data_threads = %d, dentry_max_data_size = %d, "
+            "data_threads = %d, data_shard_by_subtree = %d, "
+            "lockfree_query = %d, "
+            "path_cache_capacity = %d, "
+            "invalidate_ring_size = %d, "
+            "snapshot_interval = %d s, "
+            "binlog_compact {interval: %d s, keep_files: %d}, "
+            "dentry_max_data_size = %d, "
             "binlog_buffer_size = %d KB, "
             "slave_binlog_check_last_rows = %d, "
+            "binlog_format = %s, "
+            "binlog_group_commit {bytes: %d KB, wait_ms: %d}, "
+            "replica_sync {read_ahead: %d, window_size: %d, "
+            "replay_batch_size: %d}, "
             "reload_interval_ms = %d ms, "
             "check_alive_interval = %d s, "
             "namespace_hashtable_capacity = %d, "
+            "ns_usage_notify_interval_ms = %d, "
+            "latency_stat_enabled = %d, "
             "inode_hashtable_capacity = %"PRId64", "
             "inode_shared_locks_count = %d, "
+            "inode_hashtable_auto_resize = %d, "
             "cluster server count = %d, "
             "master-election {master_lost_timeout: %ds, "
             "max_wait_time: %ds}, storage-engine { enabled: %d",
             CLUSTER_ID, CLUSTER_MY_SERVER_ID,
-            DATA_PATH_STR, DATA_THREAD_COUNT,
+            DATA_PATH_STR, DATA_THREAD_COUNT, DATA_SHARD_ENABLED,
+            LOCKFREE_QUERY_ENABLED, PATH_CACHE_CAPACITY,
+            INVALIDATE_RING_SIZE, SNAPSHOT_INTERVAL,
+            BINLOG_COMPACT_INTERVAL, BINLOG_COMPACT_KEEP_FILES,
             DENTRY_MAX_DATA_SIZE, BINLOG_BUFFER_SIZE / 1024,
             SLAVE_BINLOG_CHECK_LAST_ROWS,
+            (BINLOG_FORMAT_BINARY ? "binary" : "text"),
+            BINLOG_GROUP_COMMIT_BYTES / 1024, BINLOG_GROUP_COMMIT_WAIT_MS,
+            REPLICA_SYNC_READ_AHEAD, REPLICA_SYNC_WINDOW_SIZE,
+            REPLICA_REPLAY_BATCH_SIZE,
             g_server_global_vars.reload_interval_ms,
             g_server_global_vars.check_alive_interval,
             g_server_global_vars.namespace_hashtable_capacity,
+            NS_USAGE_NOTIFY_INTERVAL_MS, LATENCY_STAT_ENABLED,
             INODE_HASHTABLE_CAPACITY, INODE_SHARED_LOCKS_COUNT,
+            INODE_HASHTABLE_AUTO_RESIZE,
             FC_SID_SERVER_COUNT(CLUSTER_SERVER_CONFIG),
             ELECTION_MASTER_LOST_TIMEOUT, ELECTION_MAX_WAIT_TIME,
             STORAGE_ENABLED);
@@ -408,6 +440,28 @@ static void server_log_configs()
     log_cluster_server_config();
 }
 
+static int load_binlog_format(IniFullContext *ini_ctx)
+{
+    char *format;
+
+    format = iniGetStrValue(NULL, "binlog_format", ini_ctx->context);
+    if (format == NULL || *format == '\0' ||
+            strcasecmp(format, "text") == 0)
+    {
+        BINLOG_FORMAT = FDIR_BINLOG_FORMAT_TEXT;
+    } else if (strcasecmp(format, "binary") == 0) {
+        BINLOG_FORMAT = FDIR_BINLOG_FORMAT_BINARY;
+    } else {
+        logError("file: "__FILE__", line: %d, "
+                "config file: %s , invalid binlog_format: %s, "
+                "expect: text or binary", __LINE__,
+                ini_ctx->filename, format);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
 static int load_binlog_buffer_size(IniFullContext *ini_ctx)
 {
     int64_t bytes;
@@ -427,6 +481,45 @@ static int load_binlog_buffer_size(IniFullContext *ini_ctx)
     return 0;
 }
 
+static void load_binlog_group_commit(IniFullContext *ini_ctx)
+{
+    int max_bytes;
+
+    BINLOG_GROUP_COMMIT_BYTES = iniGetByteCorrectValue(ini_ctx,
+            "binlog_group_commit_bytes",
+            FDIR_DEFAULT_BINLOG_GROUP_COMMIT_BYTES, 0,
+            FDIR_MAX_BINLOG_GROUP_COMMIT_BYTES);
+
+    /* the group is pushed to the slave in one package,
+       which must fit the replication task buffer */
+    max_bytes = g_sf_global_vars.min_buff_size - (sizeof(FDIRProtoHeader) +
+            sizeof(FDIRProtoPushBinlogReqBodyHeader));
+    if (BINLOG_GROUP_COMMIT_BYTES > max_bytes) {
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s , binlog_group_commit_bytes: %d "
+                "is too large, set it to %d", __LINE__,
+                ini_ctx->filename, BINLOG_GROUP_COMMIT_BYTES, max_bytes);
+        BINLOG_GROUP_COMMIT_BYTES = max_bytes;
+    }
+    BINLOG_GROUP_COMMIT_WAIT_MS = iniGetIntCorrectValue(ini_ctx,
+            "binlog_group_commit_wait_ms", 0, 0, 100);
+}
+
+static void load_replica_sync_config(IniFullContext *ini_ctx)
+{
+    REPLICA_SYNC_READ_AHEAD = iniGetIntCorrectValue(ini_ctx,
+            "replica_sync_read_ahead", FDIR_DEFAULT_REPLICA_SYNC_READ_AHEAD,
+            2, FDIR_MAX_REPLICA_SYNC_READ_AHEAD);
+    REPLICA_SYNC_WINDOW_SIZE = iniGetIntCorrectValue(ini_ctx,
+            "replica_sync_window_size",
+            FDIR_DEFAULT_REPLICA_SYNC_WINDOW_SIZE,
+            1, FDIR_MAX_REPLICA_SYNC_WINDOW_SIZE);
+    REPLICA_REPLAY_BATCH_SIZE = iniGetIntCorrectValue(ini_ctx,
+            "replica_replay_batch_size",
+            FDIR_DEFAULT_REPLICA_REPLAY_BATCH_SIZE,
+            32, FDIR_MAX_REPLICA_REPLAY_BATCH_SIZE);
+}
+
 int server_load_config(const char *filename)
 {
     const int task_buffer_extra_size = 0;
@@ -473,6 +566,36 @@ int server_load_config(const char *filename)
     if (DATA_THREAD_COUNT <= 0) {
         DATA_THREAD_COUNT = FDIR_DEFAULT_DATA_THREAD_COUNT;
     }
+    DATA_SHARD_ENABLED = iniGetBoolValue(NULL, "data_shard_by_subtree",
+            &ini_context, false);
+    LOCKFREE_QUERY_ENABLED = iniGetBoolValue(NULL, "lockfree_query",
+            &ini_context, true);
+    PATH_CACHE_CAPACITY = iniGetIntValue(NULL, "path_cache_capacity",
+            &ini_context, FDIR_DEFAULT_PATH_CACHE_CAPACITY);
+    if (PATH_CACHE_CAPACITY < 0) {
+        PATH_CACHE_CAPACITY = 0;
+    }
+    INVALIDATE_RING_SIZE = iniGetIntValue(NULL, "invalidate_ring_size",
+            &ini_context, FDIR_DEFAULT_INVALIDATE_RING_SIZE);
+    if (INVALIDATE_RING_SIZE <= 0) {
+        INVALIDATE_RING_SIZE = FDIR_DEFAULT_INVALIDATE_RING_SIZE;
+    }
+    SNAPSHOT_INTERVAL = iniGetIntValue(NULL, "snapshot_interval",
+            &ini_context, 0);
+    if (SNAPSHOT_INTERVAL < 0) {
+        SNAPSHOT_INTERVAL = 0;
+    }
+    BINLOG_COMPACT_INTERVAL = iniGetIntValue(NULL,
+            "binlog_compact_interval", &ini_context, 0);
+    if (BINLOG_COMPACT_INTERVAL < 0) {
+        BINLOG_COMPACT_INTERVAL = 0;
+    }
+    BINLOG_COMPACT_KEEP_FILES = iniGetIntValue(NULL,
+            "binlog_compact_keep_files", &ini_context,
+            FDIR_DEFAULT_BINLOG_COMPACT_KEEP_FILES);
+    if (BINLOG_COMPACT_KEEP_FILES < 1) {
+        BINLOG_COMPACT_KEEP_FILES = 1;
+    }
 
     if ((result=load_binlog_buffer_size(&ini_ctx)) != 0) {
         return result;
@@ -490,6 +613,12 @@ int server_load_config(const char *filename)
         SLAVE_BINLOG_CHECK_LAST_ROWS = FDIR_MAX_SLAVE_BINLOG_CHECK_LAST_ROWS;
     }
 
+    if ((result=load_binlog_format(&ini_ctx)) != 0) {
+        return result;
+    }
+    load_binlog_group_commit(&ini_ctx);
+    load_replica_sync_config(&ini_ctx);
+
     g_server_global_vars.reload_interval_ms = iniGetIntValue(NULL,
             "reload_interval_ms", &ini_context,
             FDIR_SERVER_DEFAULT_RELOAD_INTERVAL);
@@ -513,6 +642,11 @@ int server_load_config(const char *filename)
         g_server_global_vars.namespace_hashtable_capacity =
             FDIR_NAMESPACE_HASHTABLE_DEFAULT_CAPACITY;
     }
+    NS_USAGE_NOTIFY_INTERVAL_MS = iniGetIntCorrectValue(&ini_ctx,
+            "ns_usage_notify_interval_ms",
+            FDIR_DEFAULT_NS_USAGE_NOTIFY_INTERVAL_MS, 10, 10000);
+    LATENCY_STAT_ENABLED = iniGetBoolValue(NULL,
+            "latency_stat_enabled", &ini_context, true);
 
     INODE_HASHTABLE_CAPACITY = iniGetIntValue(NULL,
             "inode_hashtable_capacity", &ini_context,
@@ -527,6 +661,8 @@ int server_load_config(const char *filename)
     if (INODE_SHARED_LOCKS_COUNT <= 0) {
         INODE_SHARED_LOCKS_COUNT = FDIR_INODE_SHARED_LOCKS_DEFAULT_COUNT;
     }
+    INODE_HASHTABLE_AUTO_RESIZE = iniGetBoolValue(NULL,
+            "inode_hashtable_auto_resize", &ini_context, true);
 
     load_local_host_ip_addrs();
     if ((result=load_cluster_config(&ini_ctx,
@@ -552,6 +688,36 @@ int server_load_config(const char *filename)
         return result;
     }
 
+    if (DATA_SHARD_ENABLED) {
+        if (STORAGE_ENABLED) {
+            logError("file: "__FILE__", line: %d, "
+                    "config file: %s, data_shard_by_subtree can't be "
+                    "enabled with the storage engine", __LINE__, filename);
+            return EINVAL;
+        }
+
+        if (DATA_THREAD_COUNT == 1) {
+            logWarning("file: "__FILE__", line: %d, "
+                    "config file: %s, data_threads is 1, "
+                    "set data_shard_by_subtree to false",
+                    __LINE__, filename);
+            DATA_SHARD_ENABLED = false;
+        }
+    }
+
+    if (LOCKFREE_QUERY_ENABLED && STORAGE_ENABLED) {
+        LOCKFREE_QUERY_ENABLED = false;  //the dentry maybe not loaded
+    }
+    if (PATH_CACHE_CAPACITY > 0 && STORAGE_ENABLED) {
+        PATH_CACHE_CAPACITY = 0;  //the cached dentry maybe evicted
+    }
+    if (PATH_CACHE_CAPACITY > 0 && DATA_SHARD_ENABLED) {
+        PATH_CACHE_CAPACITY = 0;  //the path is walked by the owner shards
+    }
+    if (SNAPSHOT_INTERVAL > 0 && STORAGE_ENABLED) {
+        SNAPSHOT_INTERVAL = 0;  //the storage engine persists the dentries
+    }
+
     data_cfg.path = STORAGE_PATH;
     data_cfg.binlog_buffer_size = BINLOG_BUFFER_SIZE;
     data_cfg.binlog_subdirs = INODE_BINLOG_SUBDIRS;
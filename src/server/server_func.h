@@ -17,6 +17,8 @@
 #ifndef _FDIR_SERVER_FUNC_H
 #define _FDIR_SERVER_FUNC_H
 
+#include <sys/time.h>
+#include <pthread.h>
 #include "server_types.h"
 
 #ifdef __cplusplus
@@ -25,6 +27,21 @@ extern "C" {
 
 int server_load_config(const char *filename);
 
+//the caller MUST hold the lock
+static inline int server_cond_timedwait_ms(pthread_cond_t *cond,
+        pthread_mutex_t *lock, const int milliseconds)
+{
+    struct timeval tv;
+    struct timespec ts;
+    int64_t nsec;
+
+    gettimeofday(&tv, NULL);
+    nsec = ((int64_t)tv.tv_usec + (int64_t)milliseconds * 1000) * 1000;
+    ts.tv_sec = tv.tv_sec + nsec / (1000 * 1000 * 1000);
+    ts.tv_nsec = nsec % (1000 * 1000 * 1000);
+    return pthread_cond_timedwait(cond, lock, &ts);
+}
+
 #ifdef __cplusplus
 }
 #endif
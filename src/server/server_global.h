@@ -30,6 +30,9 @@
 typedef struct server_global_vars {
 
     int namespace_hashtable_capacity;
+    int ns_usage_notify_interval_ms;  //coalesce the usage notifications
+
+    bool latency_stat_enabled;  //the latency histograms of the requests
 
     int dentry_max_data_size;
 
@@ -67,6 +70,7 @@ typedef struct server_global_vars {
         struct {
             int shared_locks_count;
             int64_t hashtable_capacity;
+            bool auto_resize;
         } entries;
     } inode;
 
@@ -75,7 +79,24 @@ typedef struct server_global_vars {
         string_t path;   //data path
         int binlog_buffer_size;
         int slave_binlog_check_last_rows;
+        int binlog_format;  //FDIR_BINLOG_FORMAT_TEXT or BINARY for writing
+        struct {
+            int max_bytes;  //0 for disabled
+            int wait_ms;
+        } group_commit;
+        struct {
+            int read_ahead;   //the read buffers for sync from disk
+            int window_size;  //the unacked packets for sync from disk
+            int replay_batch_size;  //the record batch of the slave
+        } replica_sync;
         int thread_count;
+        bool shard_by_subtree;  //partition namespace across data threads
+        bool lockfree_query;    //query by inode in the network threads
+        int path_cache_capacity;  //per data thread, 0 for disabled
+        int invalidate_ring_size; //event count for the client caches
+        int snapshot_interval;    //in seconds, 0 for disabled
+        int binlog_compact_interval;   //in seconds, 0 for disabled
+        int binlog_compact_keep_files; //the latest files not compacted
         bool load_done;
     } data;  //for binlog
 
@@ -119,6 +140,11 @@ typedef struct server_global_vars {
         &CLUSTER_MASTER_PTR, 0))
 
 
+#define NS_USAGE_NOTIFY_INTERVAL_MS \
+    g_server_global_vars.ns_usage_notify_interval_ms
+
+#define LATENCY_STAT_ENABLED    g_server_global_vars.latency_stat_enabled
+
 #define CLUSTER_SERVER_ARRAY    g_server_global_vars.cluster.server_array
 
 #define CLUSTER_ID              g_server_global_vars.cluster.id
@@ -130,13 +156,35 @@ typedef struct server_global_vars {
 #define BINLOG_BUFFER_SIZE      g_server_global_vars.data.binlog_buffer_size
 #define SLAVE_BINLOG_CHECK_LAST_ROWS  g_server_global_vars.data. \
     slave_binlog_check_last_rows
+#define BINLOG_FORMAT           g_server_global_vars.data.binlog_format
+#define BINLOG_FORMAT_BINARY    (BINLOG_FORMAT == FDIR_BINLOG_FORMAT_BINARY)
+#define BINLOG_GROUP_COMMIT_BYTES   g_server_global_vars.data. \
+    group_commit.max_bytes
+#define BINLOG_GROUP_COMMIT_WAIT_MS g_server_global_vars.data. \
+    group_commit.wait_ms
+#define REPLICA_SYNC_READ_AHEAD     g_server_global_vars.data. \
+    replica_sync.read_ahead
+#define REPLICA_SYNC_WINDOW_SIZE    g_server_global_vars.data. \
+    replica_sync.window_size
+#define REPLICA_REPLAY_BATCH_SIZE   g_server_global_vars.data. \
+    replica_sync.replay_batch_size
 
 #define CURRENT_INODE_SN        g_server_global_vars.inode.generator.sn
 #define INODE_CLUSTER_PART      g_server_global_vars.inode.generator.cluster
 #define INODE_SHARED_LOCKS_COUNT g_server_global_vars.inode.entries.shared_locks_count
 #define INODE_HASHTABLE_CAPACITY g_server_global_vars.inode.entries.hashtable_capacity
+#define INODE_HASHTABLE_AUTO_RESIZE g_server_global_vars.inode.entries.auto_resize
 #define DATA_CURRENT_VERSION    g_server_global_vars.data.current_version
 #define DATA_THREAD_COUNT       g_server_global_vars.data.thread_count
+#define DATA_SHARD_ENABLED      g_server_global_vars.data.shard_by_subtree
+#define LOCKFREE_QUERY_ENABLED  g_server_global_vars.data.lockfree_query
+#define PATH_CACHE_CAPACITY     g_server_global_vars.data.path_cache_capacity
+#define INVALIDATE_RING_SIZE    g_server_global_vars.data.invalidate_ring_size
+#define SNAPSHOT_INTERVAL       g_server_global_vars.data.snapshot_interval
+#define BINLOG_COMPACT_INTERVAL \
+    g_server_global_vars.data.binlog_compact_interval
+#define BINLOG_COMPACT_KEEP_FILES \
+    g_server_global_vars.data.binlog_compact_keep_files
 #define DATA_LOAD_DONE          g_server_global_vars.data.load_done
 #define DATA_PATH               g_server_global_vars.data.path
 #define DATA_PATH_STR           DATA_PATH.str
@@ -163,6 +211,7 @@ typedef struct server_global_vars {
 #define STORAGE_ENGINE_STORE_API     g_server_global_vars.storage.api.store
 #define STORAGE_ENGINE_REDO_API      g_server_global_vars.storage.api.redo
 #define STORAGE_ENGINE_FETCH_API     g_server_global_vars.storage.api.fetch
+#define STORAGE_ENGINE_FETCH_CHILD_API g_server_global_vars.storage.api.fetch_child
 
 #define SLOW_LOG                g_server_global_vars.slow_log
 #define SLOW_LOG_CFG            SLOW_LOG.cfg
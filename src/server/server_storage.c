@@ -28,6 +28,10 @@ int server_storage_init()
         return result;
     }
 
+    if ((result=dentry_lru_init()) != 0) {
+        return result;
+    }
+
     if ((result=change_notify_init()) != 0) {
         return result;
     }
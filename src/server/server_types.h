@@ -17,12 +17,12 @@
 #define _FDIR_SERVER_TYPES_H
 
 #include <time.h>
+#include <limits.h>
 #include <pthread.h>
 #include "fastcommon/common_define.h"
 #include "fastcommon/fast_task_queue.h"
 #include "fastcommon/fast_mblock.h"
 #include "fastcommon/fast_allocator.h"
-#include "fastcommon/uniq_skiplist.h"
 #include "fastcommon/server_id_func.h"
 #include "fastcommon/fc_list.h"
 #include "fastcommon/fc_queue.h"
@@ -34,8 +34,10 @@
 #include "diskallocator/binlog/common/binlog_types.h"
 #include "common/fdir_types.h"
 #include "common/fdir_server_types.h"
+#include "child_index.h"
 
 #define FDIR_MAX_NS_SUBSCRIBERS                8
+#define FDIR_MAX_INVALIDATE_SUBSCRIBERS     4096
 
 #define FDIR_NS_SUBSCRIBE_QUEUE_INDEX_HOLDING  0
 #define FDIR_NS_SUBSCRIBE_QUEUE_INDEX_SENDING  1
@@ -46,16 +48,31 @@
 #define FDIR_SERVER_DEFAULT_RELOAD_INTERVAL       500
 #define FDIR_SERVER_DEFAULT_CHECK_ALIVE_INTERVAL  300
 #define FDIR_NAMESPACE_HASHTABLE_DEFAULT_CAPACITY 1361
+#define FDIR_DEFAULT_NS_USAGE_NOTIFY_INTERVAL_MS   100
 #define FDIR_INODE_HASHTABLE_DEFAULT_CAPACITY     11229331
 #define FDIR_INODE_SHARED_LOCKS_DEFAULT_COUNT     163
 #define FDIR_DEFAULT_DATA_THREAD_COUNT              1
+#define FDIR_DEFAULT_PATH_CACHE_CAPACITY        65536
+#define FDIR_DEFAULT_INVALIDATE_RING_SIZE       65536
+#define FDIR_DEFAULT_BINLOG_COMPACT_KEEP_FILES      2
+#define FDIR_MAX_WAIT_DATA_VERSION_TIMEOUT_MS   10000
 #define FDIR_MAX_SLAVE_BINLOG_CHECK_LAST_ROWS      64
 #define FDIR_DEFAULT_SLAVE_BINLOG_CHECK_LAST_ROWS   3
+#define FDIR_DEFAULT_REPLICA_SYNC_READ_AHEAD        4
+#define FDIR_MAX_REPLICA_SYNC_READ_AHEAD           32
+#define FDIR_DEFAULT_REPLICA_SYNC_WINDOW_SIZE       4
+#define FDIR_MAX_REPLICA_SYNC_WINDOW_SIZE          32
+#define FDIR_DEFAULT_REPLICA_REPLAY_BATCH_SIZE    256
+#define FDIR_MAX_REPLICA_REPLAY_BATCH_SIZE       4096
+
+#define FDIR_BINLOG_FORMAT_TEXT       't'
+#define FDIR_BINLOG_FORMAT_BINARY     'b'
 
 #define FDIR_SERVER_TASK_TYPE_RELATIONSHIP       1   //slave  -> master
 #define FDIR_SERVER_TASK_TYPE_REPLICA_MASTER     2   //[Master] -> slave
 #define FDIR_SERVER_TASK_TYPE_REPLICA_SLAVE      3   //master -> [Slave]
 #define FDIR_SERVER_TASK_TYPE_NSS_SUBSCRIBE      4   //auth server -> master
+#define FDIR_SERVER_TASK_TYPE_INVALIDATE_SUBSCRIBE 5 //cache client -> master
 
 #define FDIR_REPLICATION_STAGE_NONE               0
 #define FDIR_REPLICATION_STAGE_CONNECTING         1
@@ -84,15 +101,18 @@
 #define FTASK_HEAD_PTR    &TASK_CTX.service.ftasks
 #define SYS_LOCK_TASK     TASK_CTX.service.sys_lock_task
 #define WAITING_RPC_COUNT TASK_CTX.service.waiting_rpc_count
-#define DENTRY_LIST_CACHE TASK_CTX.service.dentry_list_cache
+#define DENTRY_LIST_CURSOR TASK_CTX.service.dentry_list_cursor
+#define REQUEST_LATENCY   TASK_CTX.latency
 
 #define SERVER_TASK_TYPE     TASK_CTX.task_type
+#define CLIENT_JOIN_FLAGS    TASK_CTX.client_join_flags
 #define CLUSTER_PEER         TASK_CTX.shared.cluster.peer
 #define CLUSTER_REPLICA      TASK_CTX.shared.cluster.replica
 #define CLUSTER_CONSUMER_CTX TASK_CTX.shared.cluster.consumer_ctx
 #define IDEMPOTENCY_CHANNEL  TASK_CTX.shared.service.idempotency_channel
 #define IDEMPOTENCY_REQUEST  TASK_CTX.service.idempotency_request
 #define NS_SUBSCRIBER        TASK_CTX.subscriber
+#define INVALIDATE_SUBSCRIBER TASK_CTX.invalidate_subscriber
 
 #define SERVER_CTX        ((FDIRServerContext *)task->thread_data->arg)
 
@@ -110,43 +130,78 @@ struct fdir_dentry_context;
 struct fdir_server_dentry;
 struct flock_entry;
 
-#define DENTRY_SKIPLIST_INIT_LEVEL_COUNT   2
 #define FDIR_DENTRY_LOADED_FLAGS_BASIC    (1 << 0)
 #define FDIR_DENTRY_LOADED_FLAGS_CHILDREN (1 << 1)
 #define FDIR_DENTRY_LOADED_FLAGS_XATTR    (1 << 2)
 #define FDIR_DENTRY_LOADED_FLAGS_CLIST    (1 << 3) /* child list for serialization */
+#define FDIR_DENTRY_LOADED_FLAGS_PARTIAL  (1 << 4) /* some children loaded by name */
+#define FDIR_DENTRY_LOADED_FLAGS_EVICTED  (1 << 5) /* children evicted by LRU */
 #define FDIR_DENTRY_LOADED_FLAGS_ALL      (FDIR_DENTRY_LOADED_FLAGS_BASIC | \
         FDIR_DENTRY_LOADED_FLAGS_CHILDREN | FDIR_DENTRY_LOADED_FLAGS_XATTR |\
         FDIR_DENTRY_LOADED_FLAGS_CLIST)
 
+/* the children of a directory are persisted as chunks, each chunk holds
+ * a range of the child inodes and is stored under a standalone key */
+typedef struct fdir_children_chunk {
+    int64_t key;       //the storage key, 0 for not persisted yet
+    int64_t first_id;  //the lower bound of the child inodes, 0 for the first
+    IdNameArray *array;  //sorted by the child inode, NULL for not built
+    bool dirty;
+} FDIRChildrenChunk;
+
+typedef struct fdir_children_chunk_array {
+    FDIRChildrenChunk *chunks;
+    int alloc;
+    int count;
+    int64_t total;     //the children count
+    bool index_dirty;  //the chunk keys or ranges changed
+} FDIRChildrenChunkArray;
+
 typedef struct fdir_server_dentry_db_args {
-    IdNameArray *children;  //children inodes for update event dealer
+    FDIRChildrenChunkArray *children;  //children inodes for update event dealer
+    struct {
+        struct fdir_server_dentry *prev;
+        struct fdir_server_dentry *next;
+    } lru;  //for the directory which children loaded
 } FDIRServerDentryDBArgs;
 
+typedef struct fdir_server_dentry_extra {
+    union {
+        string_t link;    //for symlink
+        struct fdir_server_dentry *src_dentry;  //for hard link
+    };
+
+    SFKeyValueArray *kv_array;   //for x-attributes
+    struct flock_entry *flock_entry;
+} FDIRServerDentryExtra;
+
 typedef struct fdir_server_dentry {
     int64_t inode;
     string_t name;
-    short loaded_flags;
+    unsigned char loaded_flags;
     bool add_to_clist;  //if add to child list for serialization (just a temp variable)
+    unsigned short thread_index;  //the data thread which the dentry belongs to
     volatile int reffer_count;
 
     FDIRDEntryStat stat;
 
-    union {
-        string_t link;    //for symlink
-        struct fdir_server_dentry *src_dentry;  //for hard link
-    };
-
-    SFKeyValueArray *kv_array;   //for x-attributes
-    struct fdir_dentry_context *context;
-    UniqSkiplist *children;
+    FDIRServerDentryExtra *extra;  //the rarely used fields, alloc on demand
+    FDIRChildIndex *children;
     struct fdir_server_dentry *parent;
     struct fdir_namespace_entry *ns_entry;
-    struct flock_entry *flock_entry;
     struct fdir_server_dentry *ht_next;  //for inode hash table
     FDIRServerDentryDBArgs db_args[0];  //for data persistency, since V3.0
 } FDIRServerDentry;
 
+/* symlink and hard link always have the extra fields */
+#define FDIR_DENTRY_LINK(dentry)   (dentry)->extra->link
+#define FDIR_DENTRY_SRC(dentry)    (dentry)->extra->src_dentry
+
+#define FDIR_DENTRY_KV_ARRAY(dentry) \
+    ((dentry)->extra != NULL ? (dentry)->extra->kv_array : NULL)
+#define FDIR_DENTRY_FLOCK_ENTRY(dentry) \
+    ((dentry)->extra != NULL ? (dentry)->extra->flock_entry : NULL)
+
 typedef struct fdir_server_dentry_array {
     int alloc;
     int count;
@@ -201,6 +256,13 @@ typedef struct fdir_binlog_push_result_context {
     time_t last_check_timeout_time;
 } FDIRBinlogPushResultContext;
 
+//the last data versions of the unacked packets
+typedef struct fdir_replication_window {
+    int64_t versions[FDIR_MAX_REPLICA_SYNC_WINDOW_SIZE];
+    int head;
+    int count;
+} FDIRReplicationWindow;
+
 struct binlog_read_thread_context;
 typedef struct fdir_replication_context {
     FDIRRecordBufferQueue queue;  //push to the slave
@@ -209,11 +271,12 @@ typedef struct fdir_replication_context {
     struct {
         int64_t by_queue;
         struct {
-            int64_t previous;
             int64_t current;
+            FDIRReplicationWindow window;
         } by_disk;
         int64_t by_resp;  //for flow control
     } last_data_versions;
+    int credits;  //the push packets granted by the slave
 
     struct {
         int64_t start_time_ms;
@@ -227,6 +290,10 @@ typedef struct fdir_slave_replication {
     FDIRClusterServerInfo *slave;
     int stage;
     int index;  //for next links
+    struct {
+        int flags;      //FDIR_REPLICA_JOIN_FLAGS_xxx sent by the last join
+        bool rejected;  //the join flags rejected by the old slave
+    } join;
     struct {
         int start_time;
         int next_connect_time;
@@ -249,6 +316,7 @@ typedef struct fdir_slave_replication_ptr_array {
 } FDIRSlaveReplicationPtrArray;
 
 struct fdir_binlog_record;
+struct fdir_latency_stat_table;
 struct flock_task;
 struct sys_lock_task;
 
@@ -259,10 +327,29 @@ typedef struct fdir_ns_subscriber {
     struct fdir_ns_subscriber *next;  //for freelist
 } FDIRNSSubscriber;
 
+typedef struct fdir_invalidate_subscriber {
+    int64_t next_sn;  //the sn of the next event to fetch
+    struct fdir_invalidate_subscriber *next;  //for freelist
+} FDIRInvalidateSubscriber;
+
+/* the timestamps of the request stages in microseconds,
+ * 0 for the stage not passed */
+typedef struct fdir_request_latency {
+    int64_t recv_time;      //the request header received
+    int64_t deal_time;      //the request body received
+    int64_t enqueue_time;   //pushed to the data thread queue
+    int64_t dequeue_time;   //popped by the data thread
+    int64_t done_time;      //dealt by the data thread
+    int64_t produce_time;   //start to produce the binlog
+    int64_t dispatch_time;  //pushed to the replication queues
+} FDIRRequestLatency;
+
 typedef struct server_task_arg {
     struct {
         SFCommonTaskContext common;
         int task_type;
+        int client_join_flags;       //FDIR_CLIENT_JOIN_FLAGS_xxx
+        FDIRRequestLatency latency;  //for service task only
 
         union {
             struct {
@@ -279,11 +366,12 @@ typedef struct server_task_arg {
         union {
             struct {
                 struct {
-                    FDIRServerDentryArray array;
-                    int64_t token;
-                    int offset;
-                    time_t expires;  //expire time
-                } dentry_list_cache; //for dentry_list
+                    int64_t token;  //the inode of the listing directory
+                    unsigned int hash_code;  //of the namespace
+                    int offset;     //the listed count, for check
+                    unsigned char name_len;
+                    char name_str[NAME_MAX];  //list after this name
+                } dentry_list_cursor; //for dentry_list
 
                 struct fc_list_head ftasks;  //for flock
                 struct sys_lock_task *sys_lock_task; //for append and ftruncate
@@ -295,6 +383,7 @@ typedef struct server_task_arg {
             } service;
 
             FDIRNSSubscriber *subscriber;
+            FDIRInvalidateSubscriber *invalidate_subscriber;
         };
 
     } context;
@@ -308,6 +397,7 @@ typedef struct fdir_server_context {
             struct fast_mblock_man record_allocator;
             struct fast_mblock_man record_parray_allocator;
             struct fast_mblock_man request_allocator; //for idempotency_request
+            struct fdir_latency_stat_table *latency_table;
         } service;
 
         struct {
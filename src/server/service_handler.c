@@ -48,12 +48,17 @@
 #include "server_global.h"
 #include "server_func.h"
 #include "dentry.h"
+#include "inode_index.h"
+#include "data_loader.h"
+#include "db/dentry_lru.h"
 #include "cluster_relationship.h"
 #include "common_handler.h"
 #include "ns_manager.h"
+#include "invalidate_subscribe.h"
+#include "version_waiter.h"
+#include "latency_stat.h"
 #include "service_handler.h"
 
-static volatile int64_t next_token = 0;   //next token for dentry list
 static int64_t dstat_mflags_mask = 0;
 
 typedef int (*deal_task_func)(struct fast_task_info *task);
@@ -72,8 +77,6 @@ int service_handler_init()
     mask.size = 1;
     dstat_mflags_mask = mask.flags;
 
-    next_token = ((int64_t)g_current_time) << 32;
-
     return idempotency_channel_init(SF_IDEMPOTENCY_MAX_CHANNEL_ID,
             SF_IDEMPOTENCY_DEFAULT_REQUEST_HINT_CAPACITY,
             SF_IDEMPOTENCY_DEFAULT_CHANNEL_RESERVE_INTERVAL,
@@ -121,6 +124,18 @@ void service_task_finish_cleanup(struct fast_task_info *task)
             }
             SERVER_TASK_TYPE = SF_SERVER_TASK_TYPE_NONE;
             break;
+        case FDIR_SERVER_TASK_TYPE_INVALIDATE_SUBSCRIBE:
+            if (INVALIDATE_SUBSCRIBER != NULL) {
+                invalidate_subscribe_unregister(INVALIDATE_SUBSCRIBER);
+                INVALIDATE_SUBSCRIBER = NULL;
+            } else {
+                logError("file: "__FILE__", line: %d, "
+                        "mistake happen! task: %p, SERVER_TASK_TYPE: %d, "
+                        "INVALIDATE_SUBSCRIBER is NULL", __LINE__, task,
+                        SERVER_TASK_TYPE);
+            }
+            SERVER_TASK_TYPE = SF_SERVER_TASK_TYPE_NONE;
+            break;
         default:
             break;
     }
@@ -132,6 +147,8 @@ void service_task_finish_cleanup(struct fast_task_info *task)
                 SERVER_TASK_TYPE, IDEMPOTENCY_CHANNEL);
         IDEMPOTENCY_CHANNEL = NULL;
     }
+    CLIENT_JOIN_FLAGS = 0;
+    DENTRY_LIST_CURSOR.token = 0;
 
     if (!fc_list_empty(FTASK_HEAD_PTR)) {
         FLockTask *flck;
@@ -146,7 +163,6 @@ void service_task_finish_cleanup(struct fast_task_info *task)
         SYS_LOCK_TASK = NULL;
     }
 
-    dentry_array_free(&DENTRY_LIST_CACHE.array);
     sf_task_finish_clean_up(task);
 }
 
@@ -220,6 +236,7 @@ static int service_deal_client_join(struct fast_task_info *task)
 
         SERVER_TASK_TYPE = SF_SERVER_TASK_TYPE_CHANNEL_USER;
     }
+    CLIENT_JOIN_FLAGS = flags;
 
     join_resp = (FDIRProtoClientJoinResp *)SF_PROTO_RESP_BODY(task);
     int2buff(g_sf_global_vars.min_buff_size - 128,
@@ -274,6 +291,119 @@ static int service_deal_service_stat(struct fast_task_info *task)
     return 0;
 }
 
+static int service_deal_service_detail_stat(struct fast_task_info *task)
+{
+    int result;
+    FDIRProtoServiceDetailStatResp *stat_resp;
+    FDIRInodeHashtableStat ht_stat;
+    FDIRDataLoadStat load_stat;
+    FDIRDentryMemoryStat mem_stat;
+    int64_t evict_count;
+    int64_t reload_count;
+    int i;
+
+    if ((result=server_expect_body_length(0)) != 0) {
+        return result;
+    }
+
+    stat_resp = (FDIRProtoServiceDetailStatResp *)SF_PROTO_RESP_BODY(task);
+    if (STORAGE_ENABLED) {
+        dentry_lru_sum_counters(&evict_count, &reload_count);
+    } else {
+        evict_count = reload_count = 0;
+    }
+    long2buff(evict_count, stat_resp->dentry_lru.evict_count);
+    long2buff(reload_count, stat_resp->dentry_lru.reload_count);
+
+    inode_index_get_stat(&ht_stat);
+    long2buff(ht_stat.capacity, stat_resp->inode_hashtable.capacity);
+    long2buff(ht_stat.count, stat_resp->inode_hashtable.count);
+    long2buff(ht_stat.rehash_capacity,
+            stat_resp->inode_hashtable.rehash_capacity);
+    int2buff(ht_stat.resize_count, stat_resp->inode_hashtable.resize_count);
+    int2buff(ht_stat.max_chain_length,
+            stat_resp->inode_hashtable.max_chain_length);
+    for (i=0; i<FDIR_INODE_HT_CHAIN_HISTOGRAM_SIZE; i++) {
+        long2buff(ht_stat.chain_histogram[i],
+                stat_resp->inode_hashtable.chain_histogram[i]);
+    }
+
+    server_get_data_load_stat(&load_stat);
+    long2buff(load_stat.record_count, stat_resp->data_load.record_count);
+    long2buff(load_stat.skip_count, stat_resp->data_load.skip_count);
+    long2buff(load_stat.barrier_count, stat_resp->data_load.barrier_count);
+    long2buff(load_stat.time_used_ms, stat_resp->data_load.time_used_ms);
+    stat_resp->data_load.parallel = (load_stat.parallel ? 1 : 0);
+
+    dentry_get_memory_stat(&mem_stat);
+    int2buff(mem_stat.dentry_size, stat_resp->dentry_memory.dentry_size);
+    long2buff(mem_stat.count, stat_resp->dentry_memory.count);
+    long2buff(mem_stat.extra_count, stat_resp->dentry_memory.extra_count);
+    long2buff(mem_stat.name_bytes, stat_resp->dentry_memory.name_bytes);
+    long2buff(mem_stat.total_bytes, stat_resp->dentry_memory.total_bytes);
+
+    RESPONSE.header.body_len = sizeof(FDIRProtoServiceDetailStatResp);
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_SERVICE_DETAIL_STAT_RESP;
+    TASK_CTX.common.response_done = true;
+    return 0;
+}
+
+static void latency_stat_pack_stage(FDIRProtoLatencyStatStage *proto,
+        const FDIRHistogram *histogram)
+{
+    long2buff(histogram->count, proto->count);
+    long2buff(histogram->count > 0 ? histogram->sum / histogram->count : 0,
+            proto->avg);
+    long2buff(fdir_histogram_percentile(histogram, 50.00), proto->p50);
+    long2buff(fdir_histogram_percentile(histogram, 90.00), proto->p90);
+    long2buff(fdir_histogram_percentile(histogram, 99.00), proto->p99);
+    long2buff(fdir_histogram_percentile(histogram, 99.90), proto->p999);
+    long2buff(histogram->max, proto->max);
+}
+
+static int service_deal_latency_stat(struct fast_task_info *task)
+{
+    int result;
+    int cmd;
+    int count;
+    int i;
+    FDIRCmdLatencyStat stat;
+    FDIRProtoLatencyStatRespBodyHeader *body_header;
+    FDIRProtoLatencyStatRespBodyPart *body_part;
+    FDIRProtoLatencyStatRespBodyPart *body_end;
+
+    if ((result=server_expect_body_length(0)) != 0) {
+        return result;
+    }
+
+    body_header = (FDIRProtoLatencyStatRespBodyHeader *)
+        SF_PROTO_RESP_BODY(task);
+    body_part = (FDIRProtoLatencyStatRespBodyPart *)(body_header + 1);
+    body_end = (FDIRProtoLatencyStatRespBodyPart *)
+        (task->data + task->size) - 1;
+    count = 0;
+    for (cmd=0; cmd<FDIR_LATENCY_STAT_MAX_CMD_COUNT &&
+            body_part<=body_end; cmd++)
+    {
+        if (!latency_stat_sum(cmd, &stat)) {
+            continue;
+        }
+
+        body_part->cmd = cmd;
+        for (i=0; i<FDIR_LATENCY_STAGE_COUNT; i++) {
+            latency_stat_pack_stage(body_part->stages + i, stat.stages + i);
+        }
+        body_part++;
+        count++;
+    }
+
+    int2buff(count, body_header->count);
+    RESPONSE.header.body_len = (char *)body_part - SF_PROTO_RESP_BODY(task);
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_LATENCY_STAT_RESP;
+    TASK_CTX.common.response_done = true;
+    return 0;
+}
+
 static int service_deal_cluster_stat(struct fast_task_info *task)
 {
     int result;
@@ -395,17 +525,25 @@ static int service_deal_nss_subscribe(struct fast_task_info *task)
     return 0;
 }
 
+//the max entries of one fetch with the used inodes section
+#define NSS_FETCH_MAX_INODES_COUNT  256
+
 static int service_deal_nss_fetch(struct fast_task_info *task)
 {
     int result;
     struct fc_queue_info qinfo;
     FDIRProtoNSSFetchRespBodyHeader *body_header;
     FDIRProtoNSSFetchRespBodyPart *body_part;
+    FDIRProtoNSSFetchRespInodesPart *inodes_part;
     FDIRNSSubscribeEntry *entry;
     FDIRNSSubscribeEntry *current;
+    int64_t used_inodes[NSS_FETCH_MAX_INODES_COUNT];
     char *p;
     char *end;
+    int inodes_bytes;
+    int max_count;
     int count;
+    int i;
 
     if ((result=service_check_master(task)) != 0) {
         return result;
@@ -433,6 +571,15 @@ static int service_deal_nss_fetch(struct fast_task_info *task)
         ns_subscribe_holding_to_sending_queue(NS_SUBSCRIBER);
     }
 
+    //the old clients can't parse the used inodes section
+    if ((CLIENT_JOIN_FLAGS & FDIR_CLIENT_JOIN_FLAGS_NSS_INODES)) {
+        inodes_bytes = sizeof(FDIRProtoNSSFetchRespInodesPart);
+        max_count = NSS_FETCH_MAX_INODES_COUNT;
+    } else {
+        inodes_bytes = 0;
+        max_count = INT32_MAX;
+    }
+
     body_header = (FDIRProtoNSSFetchRespBodyHeader *)SF_PROTO_RESP_BODY(task);
     p = (char *)(body_header + 1);
     end = task->data + task->size;
@@ -441,12 +588,12 @@ static int service_deal_nss_fetch(struct fast_task_info *task)
     fc_queue_try_pop_to_queue(NS_SUBSCRIBER->queues +
             FDIR_NS_SUBSCRIBE_QUEUE_INDEX_SENDING, &qinfo);
     entry = (FDIRNSSubscribeEntry *)qinfo.head;
-    while (entry != NULL) {
+    while (entry != NULL && count < max_count) {
         current = entry;
 
         body_part = (FDIRProtoNSSFetchRespBodyPart *)p;
         p += sizeof(FDIRProtoNSSFetchRespBodyPart) + current->ns->name.len;
-        if (p > end) {
+        if (p + inodes_bytes * (count + 1) > end) {
             p -= sizeof(FDIRProtoNSSFetchRespBodyPart) +
                 current->ns->name.len;
             break;
@@ -454,6 +601,11 @@ static int service_deal_nss_fetch(struct fast_task_info *task)
 
         long2buff(__sync_add_and_fetch(&current->ns->current.used_bytes, 0),
                 body_part->used_bytes);
+        if (inodes_bytes > 0) {
+            used_inodes[count] = FC_ATOMIC_GET(current->ns->
+                    current.counts.dir) + FC_ATOMIC_GET(
+                        current->ns->current.counts.file);
+        }
         body_part->ns_name.len = current->ns->name.len;
         memcpy(body_part->ns_name.str, current->ns->name.str,
                 current->ns->name.len);
@@ -465,6 +617,14 @@ static int service_deal_nss_fetch(struct fast_task_info *task)
         ++count;
     }
 
+    if (inodes_bytes > 0) {
+        inodes_part = (FDIRProtoNSSFetchRespInodesPart *)p;
+        for (i=0; i<count; i++) {
+            long2buff(used_inodes[i], inodes_part[i].used_inodes);
+        }
+        p += inodes_bytes * count;
+    }
+
     if (entry == NULL) {
         body_header->is_last = 1;
     } else {
@@ -481,6 +641,163 @@ static int service_deal_nss_fetch(struct fast_task_info *task)
     return 0;
 }
 
+static int service_deal_invalidate_subscribe(struct fast_task_info *task)
+{
+    int result;
+
+    if ((result=service_check_master(task)) != 0) {
+        return result;
+    }
+
+    if ((result=server_expect_body_length(0)) != 0) {
+        return result;
+    }
+
+    if (SERVER_TASK_TYPE != SF_SERVER_TASK_TYPE_NONE) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "unexpect server type: %d != expect: %d",
+                SERVER_TASK_TYPE, SF_SERVER_TASK_TYPE_NONE);
+        return EINVAL;
+    }
+
+    if ((INVALIDATE_SUBSCRIBER=invalidate_subscribe_register()) == NULL) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "invalidate subscribe fail, exceed max subscribers: %d",
+                FDIR_MAX_INVALIDATE_SUBSCRIBERS);
+        return EOVERFLOW;
+    }
+
+    SERVER_TASK_TYPE = FDIR_SERVER_TASK_TYPE_INVALIDATE_SUBSCRIBE;
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_INVALIDATE_SUBSCRIBE_RESP;
+    return 0;
+}
+
+static int service_deal_invalidate_fetch(struct fast_task_info *task)
+{
+    int result;
+    int size;
+    int count;
+    bool overflow;
+    bool is_last;
+    FDIRProtoInvalidateFetchRespBodyHeader *body_header;
+    FDIRProtoInvalidateEvent *events;
+
+    if ((result=service_check_master(task)) != 0) {
+        return result;
+    }
+
+    if ((result=server_expect_body_length(0)) != 0) {
+        return result;
+    }
+
+    if (SERVER_TASK_TYPE != FDIR_SERVER_TASK_TYPE_INVALIDATE_SUBSCRIBE) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "unexpect server type: %d != expect: %d", SERVER_TASK_TYPE,
+                FDIR_SERVER_TASK_TYPE_INVALIDATE_SUBSCRIBE);
+        return EPERM;
+    }
+    if (INVALIDATE_SUBSCRIBER == NULL) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "internal error: subscriber ptr is NULL");
+        return EBUSY;
+    }
+
+    body_header = (FDIRProtoInvalidateFetchRespBodyHeader *)
+        SF_PROTO_RESP_BODY(task);
+    events = (FDIRProtoInvalidateEvent *)(body_header + 1);
+    size = ((task->data + task->size) - (char *)events) /
+        sizeof(FDIRProtoInvalidateEvent);
+    count = invalidate_subscribe_fetch(INVALIDATE_SUBSCRIBER,
+            events, size, &overflow, &is_last);
+
+    int2buff(count, body_header->count);
+    body_header->is_last = is_last;
+    body_header->overflow = overflow;
+    RESPONSE.header.body_len = sizeof(*body_header) +
+        sizeof(FDIRProtoInvalidateEvent) * count;
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_INVALIDATE_FETCH_RESP;
+    TASK_CTX.common.response_done = true;
+    return 0;
+}
+
+//the data versions of the slave are continuous up to the applied version
+static inline int64_t get_applied_data_version()
+{
+    return MYSELF_IS_MASTER ? __sync_add_and_fetch(&DATA_CURRENT_VERSION,
+            0) : version_waiter_applied_version();
+}
+
+static void wait_data_version_output(struct fast_task_info *task)
+{
+    FDIRProtoWaitDataVersionResp *resp;
+
+    resp = (FDIRProtoWaitDataVersionResp *)SF_PROTO_RESP_BODY(task);
+    long2buff(get_applied_data_version(), resp->data_version);
+    RESPONSE.header.body_len = sizeof(FDIRProtoWaitDataVersionResp);
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_WAIT_DATA_VERSION_RESP;
+    TASK_CTX.common.response_done = true;
+}
+
+static int handle_wait_data_version_done(struct fast_task_info *task)
+{
+    int result;
+
+    task->continue_callback = NULL;
+    result = RESPONSE_STATUS;
+    if (result == 0) {
+        wait_data_version_output(task);
+    } else {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "wait data version timeout, applied version: %"PRId64,
+                get_applied_data_version());
+    }
+
+    sf_release_task(task);
+    return result;
+}
+
+static int service_deal_wait_data_version(struct fast_task_info *task)
+{
+    int result;
+    int timeout_ms;
+    int64_t data_version;
+    FDIRProtoWaitDataVersionReq *req;
+
+    if ((result=server_expect_body_length(sizeof(
+                        FDIRProtoWaitDataVersionReq))) != 0)
+    {
+        return result;
+    }
+
+    req = (FDIRProtoWaitDataVersionReq *)REQUEST.body;
+    data_version = buff2long(req->data_version);
+    timeout_ms = buff2int(req->timeout_ms);
+    if (get_applied_data_version() >= data_version) {
+        wait_data_version_output(task);
+        return 0;
+    }
+
+    if (timeout_ms <= 0) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "data version %"PRId64" not applied, applied: %"PRId64,
+                data_version, get_applied_data_version());
+        return EAGAIN;
+    }
+    if (timeout_ms > FDIR_MAX_WAIT_DATA_VERSION_TIMEOUT_MS) {
+        timeout_ms = FDIR_MAX_WAIT_DATA_VERSION_TIMEOUT_MS;
+    }
+
+    sf_hold_task(task);
+    task->continue_callback = handle_wait_data_version_done;
+    if ((result=version_waiter_add(task, data_version, timeout_ms)) != 0) {
+        task->continue_callback = NULL;
+        sf_release_task(task);
+        return result;
+    }
+
+    return TASK_STATUS_CONTINUE;
+}
+
 static int service_deal_get_master(struct fast_task_info *task)
 {
     int result;
@@ -775,6 +1092,9 @@ static int server_check_and_parse_dentry(
     }
     RECORD->inode = 0;
     RECORD->dentry_type = fdir_dentry_type_fullname;
+    RECORD->path_walk.stage = fdir_path_walk_none;
+    RECORD->path_walk.depth = 0;
+    RECORD->path_walk.inode = 0;
     RECORD->ns = RECORD->me.fullname.ns;
     RECORD->hash_code = simple_hash(RECORD->ns.str, RECORD->ns.len);
     return 0;
@@ -881,6 +1201,23 @@ static inline void service_idempotency_request_finish(
     }
 }
 
+/* append the committed data version to the update response for
+ * the client joined with FDIR_CLIENT_JOIN_FLAGS_DATA_VERSION */
+static inline void update_version_output(struct fast_task_info *task,
+        const int64_t data_version)
+{
+    FDIRProtoUpdateRespTrailer *trailer;
+
+    if (!TASK_CTX.common.response_done) {
+        RESPONSE.header.body_len = 0;
+        TASK_CTX.common.response_done = true;
+    }
+    trailer = (FDIRProtoUpdateRespTrailer *)(SF_PROTO_RESP_BODY(task) +
+            RESPONSE.header.body_len);
+    long2buff(data_version, trailer->data_version);
+    RESPONSE.header.body_len += sizeof(FDIRProtoUpdateRespTrailer);
+}
+
 static int handle_replica_done(struct fast_task_info *task)
 {
     int result;
@@ -889,6 +1226,9 @@ static int handle_replica_done(struct fast_task_info *task)
     service_idempotency_request_finish(task, 0);
 
     if (RBUFFER != NULL) {
+        if ((CLIENT_JOIN_FLAGS & FDIR_CLIENT_JOIN_FLAGS_DATA_VERSION)) {
+            update_version_output(task, RBUFFER->data_version.last);
+        }
         result = push_to_binlog_write_queue(RBUFFER);
         server_binlog_release_rbuffer(RBUFFER);
         RBUFFER = NULL;
@@ -922,6 +1262,7 @@ static int server_binlog_produce(struct fast_task_info *task)
     ServerBinlogRecordBuffer *rbuffer;
     int result;
 
+    REQUEST_LATENCY.produce_time = latency_stat_now();
     if ((rbuffer=server_binlog_alloc_hold_rbuffer()) == NULL) {
         free_record_object(task);
         service_idempotency_request_finish(task, ENOMEM);
@@ -961,11 +1302,33 @@ static inline void dentry_stat_output(struct fast_task_info *task,
         FDIRServerDentry **dentry)
 {
     if (FDIR_IS_DENTRY_HARD_LINK((*dentry)->stat.mode)) {
-        *dentry = (*dentry)->src_dentry;
+        *dentry = FDIR_DENTRY_SRC(*dentry);
     }
     dstat_output(task, (*dentry)->inode, &(*dentry)->stat);
 }
 
+#define LOCKFREE_STAT_READ_TIMES  3
+
+/* called by the network thread in the read section, return EAGAIN
+ * when the stat keeps changing by the data thread */
+static inline int lockfree_dentry_stat_output(struct fast_task_info *task,
+        FDIRServerDentry *dentry)
+{
+    FDIRDEntryStat stat;
+    int i;
+
+    if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
+        dentry = FDIR_DENTRY_SRC(dentry);
+    }
+    for (i=0; i<LOCKFREE_STAT_READ_TIMES; i++) {
+        if (dentry_stat_read(dentry, &stat)) {
+            dstat_output(task, dentry->inode, &stat);
+            return 0;
+        }
+    }
+    return EAGAIN;
+}
+
 static inline void set_update_result_and_output(
         struct fast_task_info *task, FDIRServerDentry *dentry)
 {
@@ -990,8 +1353,9 @@ static inline int readlink_output(struct fast_task_info *task,
         return ENOLINK;
     }
 
-    RESPONSE.header.body_len = dentry->link.len;
-    memcpy(SF_PROTO_RESP_BODY(task), dentry->link.str, dentry->link.len);
+    RESPONSE.header.body_len = FDIR_DENTRY_LINK(dentry).len;
+    memcpy(SF_PROTO_RESP_BODY(task), FDIR_DENTRY_LINK(dentry).str,
+            FDIR_DENTRY_LINK(dentry).len);
     TASK_CTX.common.response_done = true;
     return 0;
 }
@@ -1007,59 +1371,83 @@ static inline void lookup_inode_output(struct fast_task_info *task,
     TASK_CTX.common.response_done = true;
 }
 
-static void server_list_dentry_output(struct fast_task_info *task)
+static inline bool server_list_dentry_pack(FDIRServerDentry *dentry,
+        char **p, const char *buf_end)
 {
-    FDIRProtoListDEntryRespBodyHeader *body_header;
     FDIRServerDentry *src_dentry;
-    FDIRServerDentry **dentry;
-    FDIRServerDentry **start;
-    FDIRServerDentry **end;
     FDIRProtoListDEntryRespBodyPart *body_part;
+
+    if (buf_end - *p < sizeof(FDIRProtoListDEntryRespBodyPart) +
+            dentry->name.len)
+    {
+        return false;
+    }
+
+    src_dentry = FDIR_GET_REAL_DENTRY(dentry);
+    body_part = (FDIRProtoListDEntryRespBodyPart *)*p;
+    long2buff(src_dentry->inode, body_part->inode);
+    fdir_proto_pack_dentry_stat_ex(&src_dentry->stat,
+            &body_part->stat, true);
+    body_part->name_len = dentry->name.len;
+    memcpy(body_part->name_str, dentry->name.str, dentry->name.len);
+    *p += sizeof(FDIRProtoListDEntryRespBodyPart) + dentry->name.len;
+    return true;
+}
+
+/* called by the data thread, iterate the children after the last listed
+ * name of the task's cursor instead of taking a snapshot of the children */
+static void server_list_dentry_output(struct fast_task_info *task)
+{
+    FDIRProtoListDEntryRespBodyHeader *body_header;
+    FDIRServerDentry *dentry;
+    FDIRServerDentry *current;
+    FDIRServerDentry *last;
+    FDIRChildIndexIterator iterator;
     char *p;
     char *buf_end;
-    int remain_count;
     int count;
-
-    remain_count = DENTRY_LIST_CACHE.array.count -
-        DENTRY_LIST_CACHE.offset;
+    bool is_last;
 
     buf_end = task->data + task->size;
     p = SF_PROTO_RESP_BODY(task) + sizeof(FDIRProtoListDEntryRespBodyHeader);
-    start = DENTRY_LIST_CACHE.array.entries +
-        DENTRY_LIST_CACHE.offset;
-    end = start + remain_count;
-    for (dentry=start; dentry<end; dentry++) {
-        src_dentry = FDIR_GET_REAL_DENTRY(*dentry);
-        if (buf_end - p < sizeof(FDIRProtoListDEntryRespBodyPart) +
-                (*dentry)->name.len)
-        {
-            break;
+    dentry = RECORD->me.dentry;
+    last = NULL;
+    count = 0;
+    is_last = true;
+    if (S_ISDIR(dentry->stat.mode)) {
+        //the last name may be in the cursor, so position firstly
+        dentry_list_iterator(dentry, &RECORD->last_name, &iterator);
+        while ((current=child_index_next(&iterator)) != NULL) {
+            if (!server_list_dentry_pack(current, &p, buf_end)) {
+                is_last = false;
+                break;
+            }
+            last = current;
+            count++;
         }
-        body_part = (FDIRProtoListDEntryRespBodyPart *)p;
-        long2buff(src_dentry->inode, body_part->inode);
-
-        fdir_proto_pack_dentry_stat_ex(&src_dentry->stat,
-                &body_part->stat, true);
-        body_part->name_len = (*dentry)->name.len;
-        memcpy(body_part->name_str, (*dentry)->name.str, (*dentry)->name.len);
-        p += sizeof(FDIRProtoListDEntryRespBodyPart) + (*dentry)->name.len;
+    } else if (RECORD->last_name.len == 0) {
+        server_list_dentry_pack(dentry, &p, buf_end);
+        count = 1;
     }
-    count = dentry - start;
+
     RESPONSE.header.body_len = p - SF_PROTO_RESP_BODY(task);
     RESPONSE.header.cmd = FDIR_SERVICE_PROTO_LIST_DENTRY_RESP;
 
     body_header = (FDIRProtoListDEntryRespBodyHeader *)SF_PROTO_RESP_BODY(task);
     int2buff(count, body_header->count);
-    if (count < remain_count) {
-        DENTRY_LIST_CACHE.offset += count;
-        DENTRY_LIST_CACHE.expires = g_current_time + 60;
-        DENTRY_LIST_CACHE.token = __sync_add_and_fetch(&next_token, 1);
-
-        body_header->is_last = 0;
-        long2buff(DENTRY_LIST_CACHE.token, body_header->token);
-    } else {
+    if (is_last || last == NULL) {
+        DENTRY_LIST_CURSOR.token = 0;
         body_header->is_last = 1;
         long2buff(0, body_header->token);
+    } else {
+        DENTRY_LIST_CURSOR.token = dentry->inode;
+        DENTRY_LIST_CURSOR.hash_code = RECORD->hash_code;
+        DENTRY_LIST_CURSOR.offset += count;
+        DENTRY_LIST_CURSOR.name_len = last->name.len;
+        memcpy(DENTRY_LIST_CURSOR.name_str, last->name.str, last->name.len);
+
+        body_header->is_last = 0;
+        long2buff(DENTRY_LIST_CURSOR.token, body_header->token);
     }
 
     TASK_CTX.common.response_done = true;
@@ -1076,21 +1464,22 @@ static inline void service_getxattr_output(struct fast_task_info *task,
 static void service_do_listxattr(struct fast_task_info *task,
         FDIRServerDentry *dentry)
 {
+    const SFKeyValueArray *kv_array;
     const key_value_pair_t *kv;
     const key_value_pair_t *kv_end;
     char *p;
 
     p = SF_PROTO_RESP_BODY(task);
-    if (dentry->kv_array != NULL) {
+    if ((kv_array=FDIR_DENTRY_KV_ARRAY(dentry)) != NULL) {
         char *buff_end;
 
         buff_end = task->data + task->size;
-        kv_end = dentry->kv_array->elts + dentry->kv_array->count;
-        for (kv=dentry->kv_array->elts; kv<kv_end; kv++) {
+        kv_end = kv_array->elts + kv_array->count;
+        for (kv=kv_array->elts; kv<kv_end; kv++) {
             if (buff_end - p <= kv->key.len) {
                 logWarning("file: "__FILE__", line: %d, "
                         "too many xattribues, xattr count: %d!",
-                        __LINE__, dentry->kv_array->count);
+                        __LINE__, kv_array->count);
                 break;
             }
             memcpy(p, kv->key.str, kv->key.len);
@@ -1171,12 +1560,23 @@ void service_record_deal_error_log_ex1(FDIRBinlogRecord *record,
             STRERROR(result), ns_buff, extra_buff, xattr_name_buff);
 }
 
+//called by the data thread
+static inline void service_latency_set_done(struct fast_task_info *task,
+        const FDIRBinlogRecord *record)
+{
+    if (record->dequeue_time > 0) {
+        REQUEST_LATENCY.dequeue_time = record->dequeue_time;
+        REQUEST_LATENCY.done_time = get_current_time_us();
+    }
+}
+
 static void record_deal_done_notify(FDIRBinlogRecord *record,
         const int result, const bool is_error)
 {
     struct fast_task_info *task;
 
     task = (struct fast_task_info *)record->notify.args;
+    service_latency_set_done(task, record);
     if (result != 0) {
         service_record_deal_error_log_ex(record, result, is_error, task);
     } else {
@@ -1202,7 +1602,6 @@ static void record_deal_done_notify(FDIRBinlogRecord *record,
                 lookup_inode_output(task, record->me.dentry);
                 break;
             case SERVICE_OP_LIST_DENTRY_INT:
-                DENTRY_LIST_CACHE.offset = 0;
                 server_list_dentry_output(task);
                 break;
             case SERVICE_OP_GET_XATTR_INT:
@@ -1265,6 +1664,7 @@ static int batch_set_dsize_binlog_produce(FDIRBinlogRecord *record,
     FDIRBinlogRecord **recend;
     int result;
 
+    REQUEST_LATENCY.produce_time = latency_stat_now();
     if ((rbuffer=server_binlog_alloc_hold_rbuffer()) == NULL) {
         free_record_and_parray(task);
         *need_release = true;
@@ -1342,6 +1742,7 @@ static void batch_set_dsize_done_notify(FDIRBinlogRecord *record,
     struct fast_task_info *task;
 
     task = (struct fast_task_info *)record->notify.args;
+    service_latency_set_done(task, record);
     if (result != 0) {
         logWarning("file: "__FILE__", line: %d, "
                 "batch set %d dentries' size fail",
@@ -1352,6 +1753,121 @@ static void batch_set_dsize_done_notify(FDIRBinlogRecord *record,
     sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
 }
 
+static void free_record_and_batch_records(struct fast_task_info *task)
+{
+    FDIRBinlogRecord **pp;
+    FDIRBinlogRecord **recend;
+
+    recend = RECORD->parray->records + RECORD->parray->counts.total;
+    for (pp=RECORD->parray->records; pp<recend; pp++) {
+        fast_mblock_free_object(&SERVER_CTX->service.
+                record_allocator, *pp);
+    }
+    free_record_and_parray(task);
+}
+
+static int batch_update_binlog_pack(FDIRBinlogRecord *record,
+        ServerBinlogRecordBuffer **rbuffer)
+{
+    FDIRBinlogRecord **pp;
+    FDIRBinlogRecord **recend;
+    int result;
+
+    if ((*rbuffer=server_binlog_alloc_hold_rbuffer()) == NULL) {
+        return ENOMEM;
+    }
+
+    (*rbuffer)->data_version.first = record->data_version -
+        record->parray->counts.updated + 1;
+    (*rbuffer)->data_version.last = record->data_version;
+    recend = record->parray->records + record->parray->counts.total;
+    for (pp=record->parray->records; pp<recend; pp++) {
+        if ((*pp)->data_version == 0) {
+            continue;
+        }
+
+        (*pp)->timestamp = g_current_time;
+        if ((result=binlog_pack_record(*pp, &(*rbuffer)->buffer)) != 0) {
+            server_binlog_free_rbuffer(*rbuffer);
+            *rbuffer = NULL;
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static void batch_update_output(struct fast_task_info *task)
+{
+    FDIRProtoBatchRespHeader *rheader;
+    FDIRProtoBatchRespBodyPart *rbody;
+    FDIRBinlogRecord **pp;
+    FDIRBinlogRecord **recend;
+    short *result;
+
+    rheader = (FDIRProtoBatchRespHeader *)SF_PROTO_RESP_BODY(task);
+    int2buff(RECORD->parray->counts.total, rheader->count);
+    int2buff(RECORD->parray->counts.success, rheader->success);
+
+    rbody = (FDIRProtoBatchRespBodyPart *)(rheader + 1);
+    recend = RECORD->parray->records + RECORD->parray->counts.total;
+    for (pp=RECORD->parray->records, result=RECORD->parray->results;
+            pp<recend; pp++, result++, rbody++)
+    {
+        long2buff((*result == 0 ? (*pp)->inode : 0), rbody->inode);
+        short2buff(*result, rbody->status);
+    }
+
+    RESPONSE.header.body_len = (char *)rbody - SF_PROTO_RESP_BODY(task);
+    TASK_CTX.common.response_done = true;
+}
+
+/* the strings of the sub records point to the request body,
+ * so MUST pack the binlog before the response output */
+static int handle_batch_update_done(struct fast_task_info *task)
+{
+    ServerBinlogRecordBuffer *rbuffer;
+    int result;
+
+    rbuffer = NULL;
+    result = RESPONSE_STATUS;
+    if (result == 0 && RECORD->parray->counts.updated > 0) {
+        REQUEST_LATENCY.produce_time = latency_stat_now();
+        result = batch_update_binlog_pack(RECORD, &rbuffer);
+    }
+    if (result == 0) {
+        batch_update_output(task);
+    }
+    free_record_and_batch_records(task);
+
+    if (rbuffer != NULL) {
+        return do_binlog_produce(task, rbuffer);
+    }
+
+    task->continue_callback = NULL;
+    service_idempotency_request_finish(task, result);
+    sf_release_task(task);
+    return result;
+}
+
+static void batch_update_done_notify(FDIRBinlogRecord *record,
+        const int result, const bool is_error)
+{
+    struct fast_task_info *task;
+
+    task = (struct fast_task_info *)record->notify.args;
+    service_latency_set_done(task, record);
+    if (result != 0) {
+        logWarning("file: "__FILE__", line: %d, "
+                "batch update %d records fail, errno: %d, error info: %s",
+                __LINE__, record->parray->counts.total,
+                result, STRERROR(result));
+    }
+
+    RESPONSE_STATUS = result;
+    sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+}
+
 static void sys_lock_dentry_output(struct fast_task_info *task,
         const FDIRServerDentry *dentry)
 {
@@ -1372,6 +1888,7 @@ static void flock_done_notify(FDIRBinlogRecord *record,
 
     newr = result;
     task = (struct fast_task_info *)record->notify.args;
+    service_latency_set_done(task, record);
     if (record->ftask == NULL) {
         logWarning("file: "__FILE__", line: %d, "
                 "inode: %"PRId64", %s fail, errno: %d, error info: %s",
@@ -1408,6 +1925,7 @@ static inline int push_record_to_data_thread_queue(struct fast_task_info *task,
     RECORD->notify.func = notify_func;  //call by data thread
     RECORD->notify.args = task;
     task->continue_callback = continue_callback;
+    REQUEST_LATENCY.enqueue_time = latency_stat_now();
     push_to_data_thread_queue(RECORD);
     return TASK_STATUS_CONTINUE;
 }
@@ -1420,6 +1938,10 @@ static inline int push_record_to_data_thread_queue(struct fast_task_info *task,
     push_record_to_data_thread_queue(task, true, batch_set_dsize_done_notify, \
             handle_batch_set_dsize_done)
 
+#define push_batch_update_to_data_thread_queue(task) \
+    push_record_to_data_thread_queue(task, true, batch_update_done_notify, \
+            handle_batch_update_done)
+
 #define push_query_to_data_thread_queue(task) \
     push_record_to_data_thread_queue(task, false, record_deal_done_notify, \
             handle_record_query_done)
@@ -1434,6 +1956,10 @@ int service_set_record_pname_info(FDIRBinlogRecord *record,
     char *p;
 
     record->options.path_info.flags = BINLOG_OPTIONS_PATH_ENABLED;
+    if (task == NULL) {  //sub record of batch update, keep in request body
+        return 0;
+    }
+
     if (REQUEST.header.body_len > sizeof(FDIRProtoStatDEntryResp)) {
         if ((REQUEST.header.body_len + record->ns.len +
                     record->me.pname.name.len) < task->size)
@@ -1466,28 +1992,36 @@ int service_set_record_pname_info(FDIRBinlogRecord *record,
 #define init_record_for_create(task, mode) \
     init_record_for_create_ex(task, mode, false)
 
+static void init_record_for_create_by_front(FDIRBinlogRecord *record,
+        const FDIRProtoCreateDEntryFront *front, const int mode)
+{
+    record->operation = BINLOG_OP_CREATE_DENTRY_INT;
+    record->stat.mode = mode;
+    record->stat.uid = buff2int(front->uid);
+    record->stat.gid = buff2int(front->gid);
+    record->stat.size = 0;
+    record->stat.atime = record->stat.btime = record->stat.ctime =
+        record->stat.mtime = g_current_time;
+    record->options.atime = record->options.btime = record->options.ctime =
+        record->options.mtime = 1;
+    record->options.mode = 1;
+    record->options.uid = 1;
+    record->options.gid = 1;
+}
+
 static void init_record_for_create_ex(struct fast_task_info *task,
         const int mode, const bool is_hdlink)
 {
+    int new_mode;
+
     if (is_hdlink) {
-        RECORD->stat.mode = FDIR_SET_DENTRY_HARD_LINK((mode & (~S_IFMT)));
+        new_mode = FDIR_SET_DENTRY_HARD_LINK((mode & (~S_IFMT)));
     } else {
-        RECORD->stat.mode = FDIR_UNSET_DENTRY_HARD_LINK(mode);
+        new_mode = FDIR_UNSET_DENTRY_HARD_LINK(mode);
     }
 
-    RECORD->operation = BINLOG_OP_CREATE_DENTRY_INT;
-    RECORD->stat.uid = buff2int(((FDIRProtoCreateDEntryFront *)
-                REQUEST.body)->uid);
-    RECORD->stat.gid = buff2int(((FDIRProtoCreateDEntryFront *)
-                REQUEST.body)->gid);
-    RECORD->stat.size = 0;
-    RECORD->stat.atime = RECORD->stat.btime = RECORD->stat.ctime =
-        RECORD->stat.mtime = g_current_time;
-    RECORD->options.atime = RECORD->options.btime = RECORD->options.ctime =
-        RECORD->options.mtime = 1;
-    RECORD->options.mode = 1;
-    RECORD->options.uid = 1;
-    RECORD->options.gid = 1;
+    init_record_for_create_by_front(RECORD, (FDIRProtoCreateDEntryFront *)
+            REQUEST.body, new_mode);
 }
 
 static int server_parse_dentry_for_update(struct fast_task_info *task,
@@ -1748,6 +2282,10 @@ int service_set_record_link(FDIRBinlogRecord *record,
 {
     char *link_str;
 
+    if (task == NULL) {  //sub record of batch update, keep in request body
+        return 0;
+    }
+
     link_str = record->me.pname.name.str + record->me.pname.name.len;
     if (link_str + record->link.len > task->data + task->size) {
         RESPONSE.error.length = sprintf(RESPONSE.error.message,
@@ -2057,13 +2595,9 @@ static int service_deal_rename_by_pname(struct fast_task_info *task)
     return push_update_to_data_thread_queue(task);
 }
 
-static int parse_xattr_fields(struct fast_task_info *task,
-        FDIRProtoSetXAttrFields *fields, key_value_pair_t *xattr)
+static int check_xattr_fields(struct fast_task_info *task,
+        const key_value_pair_t *xattr)
 {
-    xattr->key.len = fields->name_len;
-    xattr->key.str = fields->name_str;
-    xattr->value.len = buff2short(fields->value_len);
-    xattr->value.str = fields->name_str + xattr->key.len;
     if (xattr->key.len <= 0) {
         RESPONSE.error.length = sprintf(RESPONSE.error.message,
                 "invalid xattr name, length: %d <= 0",
@@ -2097,6 +2631,16 @@ static int parse_xattr_fields(struct fast_task_info *task,
     return 0;
 }
 
+static inline int parse_xattr_fields(struct fast_task_info *task,
+        FDIRProtoSetXAttrFields *fields, key_value_pair_t *xattr)
+{
+    xattr->key.len = fields->name_len;
+    xattr->key.str = fields->name_str;
+    xattr->value.len = buff2short(fields->value_len);
+    xattr->value.str = fields->name_str + xattr->key.len;
+    return check_xattr_fields(task, xattr);
+}
+
 static inline int service_do_setxattr(struct fast_task_info *task,
         const key_value_pair_t *xattr, const int flags,
         const int resp_cmd)
@@ -2370,16 +2914,63 @@ static inline int server_check_and_parse_inode(struct fast_task_info *task)
     return 0;
 }
 
+/* query in the network thread without the data thread queue,
+ * return EAGAIN for the data thread to deal */
+static int service_lockfree_query_by_inode(struct fast_task_info *task,
+        const int operation)
+{
+    FDIRProtoInodeInfo *req;
+    FDIRServerDentry *dentry;
+    int slot_index;
+    int result;
+
+    if (STORAGE_ENABLED) {
+        return EAGAIN;
+    }
+
+    req = (FDIRProtoInodeInfo *)REQUEST.body;
+    if ((result=server_expect_body_length(sizeof(*req) + req->ns_len)) != 0) {
+        return result;
+    }
+
+    if ((slot_index=data_thread_read_enter()) < 0) {
+        return EAGAIN;
+    }
+
+    if ((dentry=inode_index_find_dentry(buff2long(req->inode))) == NULL) {
+        result = ENOENT;
+    } else if (!fc_string_equal2(&dentry->ns_entry->name,
+                req->ns_str, req->ns_len))
+    {
+        result = EAGAIN;  //the queued path deals the namespace mismatch
+    } else if (operation == SERVICE_OP_STAT_DENTRY_INT) {
+        result = lockfree_dentry_stat_output(task, dentry);
+    } else {
+        result = readlink_output(task, dentry);
+    }
+
+    data_thread_read_leave(slot_index);
+    return result;
+}
+
 static int service_deal_readlink_by_inode(struct fast_task_info *task)
 {
     int result;
 
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_READLINK_BY_INODE_RESP;
+    if (LOCKFREE_QUERY_ENABLED) {
+        if ((result=service_lockfree_query_by_inode(task,
+                        SERVICE_OP_READ_LINK_INT)) != EAGAIN)
+        {
+            return result;
+        }
+    }
+
     if ((result=server_check_and_parse_inode(task)) != 0) {
         return result;
     }
 
     RECORD->operation = SERVICE_OP_READ_LINK_INT;
-    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_READLINK_BY_INODE_RESP;
     return push_query_to_data_thread_queue(task);
 }
 
@@ -2400,12 +2991,20 @@ static int service_deal_stat_dentry_by_inode(struct fast_task_info *task)
 {
     int result;
 
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_STAT_BY_INODE_RESP;
+    if (LOCKFREE_QUERY_ENABLED) {
+        if ((result=service_lockfree_query_by_inode(task,
+                        SERVICE_OP_STAT_DENTRY_INT)) != EAGAIN)
+        {
+            return result;
+        }
+    }
+
     if ((result=server_check_and_parse_inode(task)) != 0) {
         return result;
     }
 
     RECORD->operation = SERVICE_OP_STAT_DENTRY_INT;
-    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_STAT_BY_INODE_RESP;
     return push_query_to_data_thread_queue(task);
 }
 
@@ -2584,6 +3183,220 @@ static int service_deal_batch_set_dentry_size(struct fast_task_info *task)
     return push_batch_set_dsize_to_data_thread_queue(task);
 }
 
+static int parse_batch_op_path(struct fast_task_info *task,
+        const string_t *path)
+{
+    if (path->len <= 0 || path->len > PATH_MAX) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "invalid path length: %d, which <= 0 or > %d",
+                path->len, PATH_MAX);
+        return EINVAL;
+    }
+
+    if (path->str[0] != '/') {
+        RESPONSE.error.length = snprintf(RESPONSE.error.message,
+                sizeof(RESPONSE.error.message),
+                "invalid path: %.*s", path->len, path->str);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+static int parse_batch_op(struct fast_task_info *task,
+        FDIRProtoBatchOpHeader *oph, const char *body_end,
+        FDIRBinlogRecord *record, int *op_bytes)
+{
+    key_value_pair_t kv;
+    int mode;
+    int result;
+
+    if ((char *)(oph + 1) > body_end) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "request body length: %d is too small",
+                REQUEST.header.body_len);
+        return EINVAL;
+    }
+
+    record->me.fullname.path.len = buff2short(oph->path_len);
+    record->me.fullname.path.str = oph->path_str;
+    kv.key.len = oph->name_len;
+    kv.key.str = oph->path_str + record->me.fullname.path.len;
+    kv.value.len = buff2short(oph->value_len);
+    kv.value.str = kv.key.str + kv.key.len;
+    *op_bytes = sizeof(FDIRProtoBatchOpHeader) + record->me.
+        fullname.path.len + kv.key.len + kv.value.len;
+    if ((char *)oph + *op_bytes > body_end) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "request body length: %d is too small",
+                REQUEST.header.body_len);
+        return EINVAL;
+    }
+
+    if ((result=parse_batch_op_path(task, &record->me.
+                    fullname.path)) != 0)
+    {
+        return result;
+    }
+
+    record->options.flags = 0;
+    switch (oph->op) {
+        case FDIR_BATCH_OP_CREATE_DENTRY:
+            mode = buff2int(oph->front.mode);
+            if ((mode & S_IFMT) == 0 || S_ISLNK(mode)) {
+                RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                        "mode: %d is invalid", mode);
+                return EINVAL;
+            }
+            init_record_for_create_by_front(record, &oph->front,
+                    FDIR_UNSET_DENTRY_HARD_LINK(mode));
+            break;
+        case FDIR_BATCH_OP_SYMLINK_DENTRY:
+            if (kv.value.len <= 0 || kv.value.len >= PATH_MAX) {
+                RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                        "link length: %d is invalid", kv.value.len);
+                return EINVAL;
+            }
+            mode = buff2int(oph->front.mode);
+            mode = (mode & (~S_IFMT)) | S_IFLNK;
+            init_record_for_create_by_front(record, &oph->front,
+                    FDIR_UNSET_DENTRY_HARD_LINK(mode));
+            record->link = kv.value;
+            record->options.link = 1;
+            break;
+        case FDIR_BATCH_OP_REMOVE_DENTRY:
+            record->operation = BINLOG_OP_REMOVE_DENTRY_INT;
+            break;
+        case FDIR_BATCH_OP_SET_XATTR:
+            if ((result=check_xattr_fields(task, &kv)) != 0) {
+                return result;
+            }
+            record->flags = buff2short(oph->flags);
+            record->xattr = kv;
+            record->operation = BINLOG_OP_SET_XATTR_INT;
+            break;
+        case FDIR_BATCH_OP_REMOVE_XATTR:
+            if ((result=check_name_length(task, kv.key.len,
+                            "xattr name")) != 0)
+            {
+                return result;
+            }
+            record->xattr.key = kv.key;
+            record->operation = BINLOG_OP_REMOVE_XATTR_INT;
+            break;
+        default:
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "unknown batch operation: %d", oph->op);
+            return EINVAL;
+    }
+
+    record->inode = record->data_version = 0;
+    record->dentry_type = fdir_dentry_type_fullname;
+    record->path_walk.stage = fdir_path_walk_none;
+    record->path_walk.depth = 0;
+    record->path_walk.inode = 0;
+    record->me.pname.parent_inode = 0;
+
+    //executed and released along with the batch record
+    record->notify.func = NULL;
+    record->notify.args = NULL;
+    return 0;
+}
+
+static int service_deal_batch(struct fast_task_info *task)
+{
+    FDIRProtoBatchReqHeader *rheader;
+    FDIRProtoBatchOpHeader *oph;
+    FDIRBinlogRecord **record;
+    string_t ns;
+    char *body_end;
+    uint32_t hash_code;
+    int result;
+    int count;
+    int op_bytes;
+
+    if ((result=server_check_body_length(sizeof(FDIRProtoBatchReqHeader) +
+                    1 + sizeof(FDIRProtoBatchOpHeader) + 1,
+                    FDIR_BATCH_UPDATE_MAX_BODY_SIZE)) != 0)
+    {
+        return result;
+    }
+
+    rheader = (FDIRProtoBatchReqHeader *)REQUEST.body;
+    if ((result=check_name_length(task, rheader->ns_len,
+                    "namespace")) != 0)
+    {
+        return result;
+    }
+    count = buff2int(rheader->count);
+    if (count <= 0 || count > FDIR_BATCH_UPDATE_MAX_OP_COUNT) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "count: %d is invalid which <= 0 or > %d",
+                count, FDIR_BATCH_UPDATE_MAX_OP_COUNT);
+        return EINVAL;
+    }
+
+    if ((result=alloc_record_object(task)) != 0) {
+        return result;
+    }
+
+    RECORD->parray = (FDIRRecordPtrArray *)fast_mblock_alloc_object(
+            &SERVER_CTX->service.record_parray_allocator);
+    if (RECORD->parray == NULL) {
+        free_record_object(task);
+        RESPONSE.error.length = sprintf(
+                RESPONSE.error.message,
+                "system busy, please try later");
+        return EBUSY;
+    }
+
+    FC_SET_STRING_EX(ns, rheader->ns_str, rheader->ns_len);
+    hash_code = simple_hash(ns.str, ns.len);
+    body_end = REQUEST.body + REQUEST.header.body_len;
+    oph = (FDIRProtoBatchOpHeader *)(rheader->ns_str + ns.len);
+    RECORD->parray->counts.total = 0;
+    for (record=RECORD->parray->records; RECORD->parray->
+            counts.total < count; record++)
+    {
+        *record = (FDIRBinlogRecord *)fast_mblock_alloc_object(
+                &SERVER_CTX->service.record_allocator);
+        if (*record == NULL) {
+            free_record_and_batch_records(task);
+            RESPONSE.error.length = sprintf(
+                    RESPONSE.error.message,
+                    "system busy, please try later");
+            return EBUSY;
+        }
+        RECORD->parray->counts.total++;
+
+        if ((result=parse_batch_op(task, oph, body_end,
+                        *record, &op_bytes)) != 0)
+        {
+            free_record_and_batch_records(task);
+            return result;
+        }
+        (*record)->ns = (*record)->me.fullname.ns = ns;
+        (*record)->hash_code = hash_code;
+        oph = (FDIRProtoBatchOpHeader *)((char *)oph + op_bytes);
+    }
+
+    if ((char *)oph != body_end) {
+        free_record_and_batch_records(task);
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "body length: %d != expected: %d", REQUEST.header.body_len,
+                (int)((char *)oph - REQUEST.body));
+        return EINVAL;
+    }
+
+    RECORD->ns = ns;
+    RECORD->inode = RECORD->data_version = 0;
+    RECORD->dentry_type = fdir_dentry_type_fullname;
+    RECORD->hash_code = hash_code;
+    RECORD->operation = SERVICE_OP_BATCH_UPDATE_INT;
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_BATCH_RESP;
+    return push_batch_update_to_data_thread_queue(task);
+}
+
 static int service_deal_modify_dentry_stat(struct fast_task_info *task)
 {
     FDIRProtoModifyDentryStatReq *req;
@@ -3012,6 +3825,8 @@ static int service_deal_list_dentry_by_path(struct fast_task_info *task)
         return result;
     }
 
+    FC_SET_STRING_NULL(RECORD->last_name);
+    DENTRY_LIST_CURSOR.offset = 0;
     RECORD->operation = SERVICE_OP_LIST_DENTRY_INT;
     return push_query_to_data_thread_queue(task);
 }
@@ -3024,6 +3839,8 @@ static int service_deal_list_dentry_by_inode(struct fast_task_info *task)
         return result;
     }
 
+    FC_SET_STRING_NULL(RECORD->last_name);
+    DENTRY_LIST_CURSOR.offset = 0;
     RECORD->operation = SERVICE_OP_LIST_DENTRY_INT;
     return push_query_to_data_thread_queue(task);
 }
@@ -3041,31 +3858,36 @@ static int service_deal_list_dentry_next(struct fast_task_info *task)
         return result;
     }
 
-    if (DENTRY_LIST_CACHE.expires < g_current_time) {
-        RESPONSE.error.length = sprintf(
-                RESPONSE.error.message,
-                "dentry list cache expires, please try again");
-        return ETIMEDOUT;
-    }
-
     next_body = (FDIRProtoListDEntryNextBody *)REQUEST.body;
     token = buff2long(next_body->token);
     offset = buff2int(next_body->offset);
-    if (token != DENTRY_LIST_CACHE.token) {
+    if (token == 0 || token != DENTRY_LIST_CURSOR.token) {
         RESPONSE.error.length = sprintf(
                 RESPONSE.error.message,
                 "invalid token for next list");
         return EINVAL;
     }
-    if (offset != DENTRY_LIST_CACHE.offset) {
+    if (offset != DENTRY_LIST_CURSOR.offset) {
         RESPONSE.error.length = sprintf(
                 RESPONSE.error.message,
                 "next list offset: %d != expected: %d",
-                offset, DENTRY_LIST_CACHE.offset);
+                offset, DENTRY_LIST_CURSOR.offset);
         return EINVAL;
     }
-    server_list_dentry_output(task);
-    return 0;
+
+    if ((result=alloc_record_object(task)) != 0) {
+        return result;
+    }
+
+    FC_SET_STRING_NULL(RECORD->ns);
+    RECORD->hash_code = DENTRY_LIST_CURSOR.hash_code;
+    RECORD->dentry_type = fdir_dentry_type_inode;
+    RECORD->inode = token;
+    FC_SET_STRING_NULL(RECORD->me.pname.name);
+    FC_SET_STRING_EX(RECORD->last_name, DENTRY_LIST_CURSOR.name_str,
+            DENTRY_LIST_CURSOR.name_len);
+    RECORD->operation = SERVICE_OP_LIST_DENTRY_INT;
+    return push_query_to_data_thread_queue(task);
 }
 
 static int service_get_xattr_by_path(struct fast_task_info *task)
@@ -3172,6 +3994,7 @@ static int service_check_priv(struct fast_task_info *task)
         case SF_SERVICE_PROTO_REPORT_REQ_RECEIPT_REQ:
         case SF_SERVICE_PROTO_REBIND_CHANNEL_REQ:
         case FDIR_SERVICE_PROTO_NSS_FETCH_REQ:
+        case FDIR_SERVICE_PROTO_INVALIDATE_FETCH_REQ:
             return 0;
 
         case FDIR_SERVICE_PROTO_CREATE_DENTRY_REQ:
@@ -3186,6 +4009,7 @@ static int service_check_priv(struct fast_task_info *task)
         case FDIR_SERVICE_PROTO_RENAME_BY_PNAME_REQ:
         case FDIR_SERVICE_PROTO_SET_DENTRY_SIZE_REQ:
         case FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_REQ:
+        case FDIR_SERVICE_PROTO_BATCH_REQ:
         case FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_REQ:
         case FDIR_SERVICE_PROTO_SET_XATTR_BY_PATH_REQ:
         case FDIR_SERVICE_PROTO_SET_XATTR_BY_INODE_REQ:
@@ -3215,11 +4039,15 @@ static int service_check_priv(struct fast_task_info *task)
         case FDIR_SERVICE_PROTO_LIST_XATTR_BY_PATH_REQ:
         case FDIR_SERVICE_PROTO_LIST_XATTR_BY_INODE_REQ:
         case FDIR_SERVICE_PROTO_NAMESPACE_STAT_REQ:
+        case FDIR_SERVICE_PROTO_INVALIDATE_SUBSCRIBE_REQ:
+        case FDIR_SERVICE_PROTO_WAIT_DATA_VERSION_REQ:
             priv_type = fcfs_auth_validate_priv_type_pool_fdir;
             the_priv = FCFS_AUTH_POOL_ACCESS_READ;
             break;
 
         case FDIR_SERVICE_PROTO_SERVICE_STAT_REQ:
+        case FDIR_SERVICE_PROTO_SERVICE_DETAIL_STAT_REQ:
+        case FDIR_SERVICE_PROTO_LATENCY_STAT_REQ:
         case FDIR_SERVICE_PROTO_CLUSTER_STAT_REQ:
             priv_type = fcfs_auth_validate_priv_type_user;
             the_priv = FCFS_AUTH_USER_PRIV_MONITOR_CLUSTER;
@@ -3296,6 +4124,9 @@ static int service_process(struct fast_task_info *task)
             return service_process_update(task,
                     service_deal_batch_set_dentry_size,
                     FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_RESP);
+        case FDIR_SERVICE_PROTO_BATCH_REQ:
+            return service_process_update(task, service_deal_batch,
+                    FDIR_SERVICE_PROTO_BATCH_RESP);
         case FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_REQ:
             return service_process_update(task,
                     service_deal_modify_dentry_stat,
@@ -3413,6 +4244,10 @@ static int service_process(struct fast_task_info *task)
             return result;
         case FDIR_SERVICE_PROTO_SERVICE_STAT_REQ:
             return service_deal_service_stat(task);
+        case FDIR_SERVICE_PROTO_SERVICE_DETAIL_STAT_REQ:
+            return service_deal_service_detail_stat(task);
+        case FDIR_SERVICE_PROTO_LATENCY_STAT_REQ:
+            return service_deal_latency_stat(task);
         case FDIR_SERVICE_PROTO_CLUSTER_STAT_REQ:
             return service_deal_cluster_stat(task);
         case FDIR_SERVICE_PROTO_NAMESPACE_STAT_REQ:
@@ -3437,6 +4272,12 @@ static int service_process(struct fast_task_info *task)
             return service_deal_nss_subscribe(task);
         case FDIR_SERVICE_PROTO_NSS_FETCH_REQ:
             return service_deal_nss_fetch(task);
+        case FDIR_SERVICE_PROTO_INVALIDATE_SUBSCRIBE_REQ:
+            return service_deal_invalidate_subscribe(task);
+        case FDIR_SERVICE_PROTO_INVALIDATE_FETCH_REQ:
+            return service_deal_invalidate_fetch(task);
+        case FDIR_SERVICE_PROTO_WAIT_DATA_VERSION_REQ:
+            return service_deal_wait_data_version(task);
         case SF_SERVICE_PROTO_SETUP_CHANNEL_REQ:
             if ((result=sf_server_deal_setup_channel(task,
                             &SERVER_TASK_TYPE, &IDEMPOTENCY_CHANNEL,
@@ -3488,6 +4329,7 @@ int service_deal_task(struct fast_task_info *task, const int stage)
         }
     } else {
         sf_proto_init_task_context(task, &TASK_CTX.common);
+        latency_stat_request_start(&REQUEST_LATENCY);
         if (AUTH_ENABLED) {
             if ((result=service_check_priv(task)) == 0) {
                 result = service_process(task);
@@ -3500,17 +4342,29 @@ int service_deal_task(struct fast_task_info *task, const int stage)
     if (result == TASK_STATUS_CONTINUE) {
         return 0;
     } else {
+        if (SERVER_CTX->service.latency_table != NULL) {
+            latency_stat_add(SERVER_CTX->service.latency_table,
+                    REQUEST.header.cmd, &REQUEST_LATENCY,
+                    latency_stat_now());
+        }
         RESPONSE_STATUS = result;
         return sf_proto_deal_task_done(task, &TASK_CTX.common);
     }
 }
 
+int service_set_body_length(struct fast_task_info *task)
+{
+    REQUEST_LATENCY.recv_time = latency_stat_now();
+    return sf_proto_set_body_length(task);
+}
+
 int record_parray_alloc_init(void *element, void *args)
 {
     FDIRRecordPtrArray *parray;
     parray = (FDIRRecordPtrArray *)element;
     parray->records = (FDIRBinlogRecord **)(parray + 1);
     parray->alloc = FDIR_BATCH_SET_MAX_DENTRY_COUNT;
+    parray->results = (short *)(parray->records + parray->alloc);
     return 0;
 }
 
@@ -3533,8 +4387,8 @@ void *service_alloc_thread_extra_data(const int thread_index)
         return NULL;
     }
 
-    element_size = sizeof(FDIRRecordPtrArray) + sizeof(FDIRBinlogRecord *) *
-        FDIR_BATCH_SET_MAX_DENTRY_COUNT;
+    element_size = sizeof(FDIRRecordPtrArray) + (sizeof(FDIRBinlogRecord *)
+            + sizeof(short)) * FDIR_BATCH_SET_MAX_DENTRY_COUNT;
     if (fast_mblock_init_ex1(&server_context->service.record_parray_allocator,
                 "record_parray", element_size, 512, 0, record_parray_alloc_init,
                 NULL, false) != 0)
@@ -3553,5 +4407,13 @@ void *service_alloc_thread_extra_data(const int thread_index)
         return NULL;
     }
 
+    if (LATENCY_STAT_ENABLED) {
+        server_context->service.latency_table = latency_stat_alloc_table();
+        if (server_context->service.latency_table == NULL) {
+            free(server_context);
+            return NULL;
+        }
+    }
+
     return server_context;
 }
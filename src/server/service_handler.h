@@ -33,6 +33,9 @@ extern "C" {
 int service_handler_init();
 int service_handler_destroy();
 int service_deal_task(struct fast_task_info *task, const int stage);
+
+//record the receive time of the request header for the latency stat
+int service_set_body_length(struct fast_task_info *task);
 void service_task_finish_cleanup(struct fast_task_info *task);
 void *service_alloc_thread_extra_data(const int thread_index);
 //int service_thread_loop(struct nio_thread_data *thread_data);
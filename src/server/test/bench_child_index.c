@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//bench_child_index.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/uniq_skiplist.h"
+#include "server/server_types.h"
+#include "server/child_index.h"
+
+#define LOOKUP_COUNT  (2 * 1000 * 1000)
+#define SKIPLIST_INIT_LEVEL_COUNT  2  //the init level of the directory before
+
+/* compare the find child cost of the UniqSkiplist, which kept the
+ * children of a directory before, with the child index */
+
+static UniqSkiplistFactory factory;
+
+static int dentry_compare(const void *p1, const void *p2)
+{
+    return fc_string_compare(&((FDIRServerDentry *)p1)->name,
+            &((FDIRServerDentry *)p2)->name);
+}
+
+//the dentries are shared and freed by the child index
+static void skiplist_free_func(void *ptr, const int delay_seconds)
+{
+}
+
+static void child_free_func(void *ptr, const int delay_seconds)
+{
+    FDIRServerDentry *dentry;
+
+    dentry = (FDIRServerDentry *)ptr;
+    free(dentry->name.str);
+    free(dentry);
+}
+
+static inline int64_t get_current_time_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+static FDIRServerDentry *alloc_dentry(const int index)
+{
+    FDIRServerDentry *dentry;
+    char buff[64];
+    int len;
+
+    dentry = (FDIRServerDentry *)fc_malloc(sizeof(FDIRServerDentry));
+    if (dentry == NULL) {
+        return NULL;
+    }
+    memset(dentry, 0, sizeof(FDIRServerDentry));
+
+    len = snprintf(buff, sizeof(buff), "file-%06d-%08x", index, rand());
+    if ((dentry->name.str=(char *)fc_malloc(len + 1)) == NULL) {
+        free(dentry);
+        return NULL;
+    }
+    memcpy(dentry->name.str, buff, len + 1);
+    dentry->name.len = len;
+    return dentry;
+}
+
+static int bench(const int count)
+{
+    UniqSkiplist *skiplist;
+    FDIRChildIndex *index;
+    FDIRServerDentry **dentries;
+    FDIRServerDentry **lookups;
+    FDIRServerDentry target;
+    int64_t start_time;
+    int64_t skiplist_time;
+    int64_t index_time;
+    int64_t found;
+    int i;
+    int result;
+
+    dentries = (FDIRServerDentry **)fc_malloc(
+            sizeof(FDIRServerDentry *) * count);
+    lookups = (FDIRServerDentry **)fc_malloc(
+            sizeof(FDIRServerDentry *) * LOOKUP_COUNT);
+    if (dentries == NULL || lookups == NULL) {
+        return ENOMEM;
+    }
+
+    skiplist = uniq_skiplist_new(&factory, SKIPLIST_INIT_LEVEL_COUNT);
+    index = child_index_new();
+    if (skiplist == NULL || index == NULL) {
+        return ENOMEM;
+    }
+
+    for (i=0; i<count; i++) {
+        if ((dentries[i]=alloc_dentry(i)) == NULL) {
+            return ENOMEM;
+        }
+    }
+    //insert in random order as the creates of a directory
+    for (i=0; i<count; i++) {
+        int k;
+        FDIRServerDentry *tmp;
+
+        k = i + rand() % (count - i);
+        tmp = dentries[i];
+        dentries[i] = dentries[k];
+        dentries[k] = tmp;
+        if ((result=uniq_skiplist_insert(skiplist, dentries[i])) != 0 ||
+                (result=child_index_insert(index, dentries[i])) != 0)
+        {
+            return result;
+        }
+    }
+    for (i=0; i<LOOKUP_COUNT; i++) {
+        lookups[i] = dentries[rand() % count];
+    }
+
+    found = 0;
+    start_time = get_current_time_ns();
+    for (i=0; i<LOOKUP_COUNT; i++) {
+        target.name = lookups[i]->name;
+        if (uniq_skiplist_find(skiplist, &target) != NULL) {
+            found++;
+        }
+    }
+    skiplist_time = get_current_time_ns() - start_time;
+
+    start_time = get_current_time_ns();
+    for (i=0; i<LOOKUP_COUNT; i++) {
+        if (child_index_find(index, &lookups[i]->name) != NULL) {
+            found++;
+        }
+    }
+    index_time = get_current_time_ns() - start_time;
+
+    if (found != 2 * LOOKUP_COUNT) {
+        fprintf(stderr, "children: %d, found count: %"PRId64" != %d\n",
+                count, found, 2 * LOOKUP_COUNT);
+        return ENOENT;
+    }
+
+    printf("%10d %16.1f %16.1f\n", count,
+            (double)skiplist_time / LOOKUP_COUNT,
+            (double)index_time / LOOKUP_COUNT);
+
+    uniq_skiplist_free(skiplist);
+    child_index_free(index);
+    free(dentries);
+    free(lookups);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const int sizes[] = {4, 16, 64, 256, 1000, 10000, 100000};
+    int i;
+    int result;
+
+    srand(time(NULL));
+    log_init();
+
+    //the same settings as the directory children before
+    if ((result=uniq_skiplist_init_ex2(&factory, 20, dentry_compare,
+                    skiplist_free_func, 16 * 1024,
+                    SKIPLIST_DEFAULT_MIN_ALLOC_ELEMENTS_ONCE,
+                    0, false, false)) != 0)
+    {
+        return result;
+    }
+    child_index_global_init(child_free_func, 0);
+
+    printf("find child, %d random lookups per size\n", LOOKUP_COUNT);
+    printf("%10s %16s %16s\n", "children", "skiplist ns/op",
+            "child index ns/op");
+    for (i=0; i<sizeof(sizes) / sizeof(sizes[0]); i++) {
+        if ((result=bench(sizes[i])) != 0) {
+            return result;
+        }
+    }
+
+    uniq_skiplist_destroy(&factory);
+    return 0;
+}
@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//bench_dentry_memory.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fast_mblock.h"
+#include "fastcommon/fast_allocator.h"
+#include "server/server_types.h"
+#include "server/child_index.h"
+
+#define DEFAULT_FILES_PER_DIR  100
+#define DEFAULT_EXTRA_PERCENT    2
+
+/* load a namespace of directories and files with the allocators of the
+ * server, and compare the bytes per inode of the dentry layout before,
+ * which kept the link, xattr, flock and context fields in the dentry,
+ * with the compact dentry and the on-demand extra struct. the bytes of
+ * the names, the child indexes and the inode hash table are the same
+ * for both layouts, they are counted in the totals */
+
+typedef struct wide_server_dentry {
+    int64_t inode;
+    string_t name;
+    short loaded_flags;
+    bool add_to_clist;
+    volatile int reffer_count;
+
+    FDIRDEntryStat stat;
+
+    union {
+        string_t link;    //for symlink
+        struct wide_server_dentry *src_dentry;  //for hard link
+    };
+
+    SFKeyValueArray *kv_array;   //for x-attributes
+    struct fdir_dentry_context *context;
+    FDIRChildIndex *children;
+    struct wide_server_dentry *parent;
+    struct fdir_namespace_entry *ns_entry;
+    struct flock_entry *flock_entry;
+    struct wide_server_dentry *ht_next;  //for inode hash table
+    FDIRServerDentryDBArgs db_args[0];
+} WideServerDentry;
+
+typedef struct {
+    struct fast_mblock_man wide_allocator;
+    struct fast_mblock_man dentry_allocator;
+    struct fast_mblock_man extra_allocator;
+    struct fast_allocator_context name_acontext;
+    FDIRServerDentry **dirs;
+    int dir_count;
+} BenchNamespace;
+
+typedef struct {
+    int64_t wide_bytes;
+    int64_t dentry_bytes;
+    int64_t extra_bytes;
+    int64_t name_bytes;
+    int64_t index_bytes;
+    int64_t ht_bytes;
+} BenchMemoryStat;
+
+//the dentries are freed with the allocators
+static void child_free_func(void *ptr, const int delay_seconds)
+{
+}
+
+//the same regions as the names of the server by default
+static int init_name_allocator(struct fast_allocator_context *acontext)
+{
+    struct fast_region_info regions[2];
+
+    FAST_ALLOCATOR_INIT_REGION(regions[0], 0, 64, 8, 8 * 1024);
+    FAST_ALLOCATOR_INIT_REGION(regions[1], 64, NAME_MAX + 1, 8, 4 * 1024);
+    return fast_allocator_init_ex(acontext, "name",
+            regions, 2, 0, 0.00, 0, false);
+}
+
+static int namespace_init(BenchNamespace *ns, const int dentry_size,
+        const int wide_size, const int max_dirs)
+{
+    int result;
+
+    memset(ns, 0, sizeof(*ns));
+    if ((result=fast_mblock_init_ex1(&ns->wide_allocator, "wide-dentry",
+                    wide_size, 8 * 1024, 0, NULL, NULL, false)) != 0)
+    {
+        return result;
+    }
+    if ((result=fast_mblock_init_ex1(&ns->dentry_allocator, "dentry",
+                    dentry_size, 8 * 1024, 0, NULL, NULL, false)) != 0)
+    {
+        return result;
+    }
+    if ((result=fast_mblock_init_ex1(&ns->extra_allocator, "dentry-extra",
+                    sizeof(FDIRServerDentryExtra), 4 * 1024, 0,
+                    NULL, NULL, false)) != 0)
+    {
+        return result;
+    }
+    if ((result=init_name_allocator(&ns->name_acontext)) != 0) {
+        return result;
+    }
+
+    ns->dirs = (FDIRServerDentry **)fc_malloc(
+            sizeof(FDIRServerDentry *) * max_dirs);
+    return (ns->dirs != NULL ? 0 : ENOMEM);
+}
+
+static void namespace_destroy(BenchNamespace *ns)
+{
+    int i;
+
+    for (i=0; i<ns->dir_count; i++) {
+        child_index_free(ns->dirs[i]->children);
+    }
+    free(ns->dirs);
+    fast_allocator_destroy(&ns->name_acontext);
+    fast_mblock_destroy(&ns->extra_allocator);
+    fast_mblock_destroy(&ns->dentry_allocator);
+    fast_mblock_destroy(&ns->wide_allocator);
+}
+
+/* alloc the dentry of both layouts, the wide one is only for the
+ * allocator bytes, the compact one is linked into the namespace */
+static FDIRServerDentry *alloc_dentry(BenchNamespace *ns,
+        FDIRServerDentry *parent, const int64_t inode, const char *prefix,
+        const bool is_dir, const bool with_extra)
+{
+    FDIRServerDentry *dentry;
+    WideServerDentry *wide;
+    string_t name;
+    char buff[64];
+
+    if ((wide=fast_mblock_alloc_object(&ns->wide_allocator)) == NULL) {
+        return NULL;
+    }
+    memset(wide, 0, ns->wide_allocator.info.element_size);
+
+    if ((dentry=fast_mblock_alloc_object(&ns->dentry_allocator)) == NULL) {
+        return NULL;
+    }
+    memset(dentry, 0, ns->dentry_allocator.info.element_size);
+    dentry->inode = wide->inode = inode;
+    dentry->parent = parent;
+
+    //the name of the root is empty
+    if (parent != NULL) {
+        name.str = buff;
+        name.len = snprintf(buff, sizeof(buff), "%s-%"PRId64,
+                prefix, inode);
+        if (fast_allocator_alloc_string(&ns->name_acontext,
+                    &dentry->name, &name) != 0)
+        {
+            return NULL;
+        }
+        wide->name = dentry->name;
+    }
+
+    if (with_extra) {
+        if ((dentry->extra=fast_mblock_alloc_object(
+                        &ns->extra_allocator)) == NULL)
+        {
+            return NULL;
+        }
+        memset(dentry->extra, 0, sizeof(FDIRServerDentryExtra));
+    }
+
+    if (is_dir) {
+        if ((dentry->children=child_index_new()) == NULL) {
+            return NULL;
+        }
+        ns->dirs[ns->dir_count++] = dentry;
+    }
+    if (parent != NULL && child_index_insert(parent->children, dentry) != 0) {
+        return NULL;
+    }
+
+    return dentry;
+}
+
+/* the root with the directories under it, and the files under each
+ * directory, the extra struct for extra_percent of the files */
+static int namespace_load(BenchNamespace *ns, const int count,
+        const int files_per_dir, const int extra_percent)
+{
+    FDIRServerDentry *root;
+    FDIRServerDentry *dir;
+    int64_t inode;
+    int i;
+
+    inode = 1;
+    if ((root=alloc_dentry(ns, NULL, inode++, "", true, false)) == NULL) {
+        return ENOMEM;
+    }
+
+    dir = NULL;
+    for (i=1; i<count; i++) {
+        if (dir == NULL || child_index_count(dir->children) >=
+                files_per_dir)
+        {
+            if ((dir=alloc_dentry(ns, root, inode++,
+                            "dir", true, false)) == NULL)
+            {
+                return ENOMEM;
+            }
+            continue;
+        }
+
+        if (alloc_dentry(ns, dir, inode++, "file-0000", false,
+                    i % 100 < extra_percent) == NULL)
+        {
+            return ENOMEM;
+        }
+    }
+
+    return 0;
+}
+
+static inline int64_t get_mblock_bytes(struct fast_mblock_man *mblock)
+{
+    return mblock->info.trunk_total_count * mblock->info.trunk_size;
+}
+
+static int64_t get_child_index_bytes(FDIRChildIndex *index)
+{
+    int64_t bytes;
+    int i;
+
+    bytes = sizeof(FDIRChildIndex);
+    if (index->blocks != index->fixed_blocks) {
+        bytes += sizeof(FDIRChildBlock *) * index->block_alloc;
+    }
+    for (i=0; i<index->block_count; i++) {
+        bytes += sizeof(FDIRChildBlock) + sizeof(FDIRServerDentry *) *
+            index->blocks[i]->alloc;
+    }
+    if (index->htable.buckets != NULL) {
+        bytes += sizeof(FDIRChildHashEntry) * (index->htable.mask + 1);
+    }
+
+    return bytes;
+}
+
+static void namespace_stat(BenchNamespace *ns, const int count,
+        BenchMemoryStat *stat)
+{
+    int64_t capacity;
+    int i;
+
+    stat->wide_bytes = get_mblock_bytes(&ns->wide_allocator);
+    stat->dentry_bytes = get_mblock_bytes(&ns->dentry_allocator);
+    stat->extra_bytes = get_mblock_bytes(&ns->extra_allocator);
+    stat->name_bytes = ns->name_acontext.alloc_bytes;
+
+    stat->index_bytes = 0;
+    for (i=0; i<ns->dir_count; i++) {
+        stat->index_bytes += get_child_index_bytes(ns->dirs[i]->children);
+    }
+
+    //the buckets of the inode hash table after the auto resize
+    capacity = 1;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    stat->ht_bytes = sizeof(FDIRServerDentry *) * capacity;
+}
+
+static int bench(const int count, const int files_per_dir,
+        const int extra_percent, const bool storage_enabled)
+{
+    BenchNamespace ns;
+    BenchMemoryStat stat;
+    int db_args_size;
+    int64_t shared_bytes;
+    double wide_bytes;
+    double compact_bytes;
+    int result;
+
+    db_args_size = (storage_enabled ? sizeof(FDIRServerDentryDBArgs) : 0);
+    if ((result=namespace_init(&ns, sizeof(FDIRServerDentry) + db_args_size,
+                    sizeof(WideServerDentry) + db_args_size, count)) != 0 ||
+            (result=namespace_load(&ns, count, files_per_dir,
+                                   extra_percent)) != 0)
+    {
+        fprintf(stderr, "load %d dentries fail, errno: %d\n",
+                count, result);
+        return result;
+    }
+
+    namespace_stat(&ns, count, &stat);
+    namespace_destroy(&ns);
+
+    shared_bytes = stat.name_bytes + stat.index_bytes + stat.ht_bytes;
+    wide_bytes = (double)(stat.wide_bytes + shared_bytes) / count;
+    compact_bytes = (double)(stat.dentry_bytes + stat.extra_bytes +
+            shared_bytes) / count;
+    printf("%10d %8s %8.1f %8.1f %8.1f %12.1f %12.1f %9.1f%%\n", count,
+            (storage_enabled ? "yes" : "no"),
+            (double)stat.name_bytes / count,
+            (double)stat.index_bytes / count,
+            (double)stat.ht_bytes / count, wide_bytes, compact_bytes,
+            100.00 * (wide_bytes - compact_bytes) / wide_bytes);
+    return 0;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [files_per_dir] [extra_percent]\n"
+            "\tfiles_per_dir: the files of each directory, default: %d\n"
+            "\textra_percent: the percent of the files with symlink, "
+            "hard link, xattr or flock, default: %d\n", program,
+            DEFAULT_FILES_PER_DIR, DEFAULT_EXTRA_PERCENT);
+}
+
+int main(int argc, char *argv[])
+{
+    const int counts[] = {10000, 100000, 1000000, 10000000};
+    int files_per_dir;
+    int extra_percent;
+    int i;
+    int result;
+
+    files_per_dir = (argc > 1 ? strtol(argv[1], NULL, 10) :
+            DEFAULT_FILES_PER_DIR);
+    extra_percent = (argc > 2 ? strtol(argv[2], NULL, 10) :
+            DEFAULT_EXTRA_PERCENT);
+    if (files_per_dir <= 0 || extra_percent < 0 || extra_percent > 100) {
+        usage(argv[0]);
+        return EINVAL;
+    }
+
+    log_init();
+    child_index_global_init(child_free_func, 0);
+
+    printf("dentry size: %d => %d, extra size: %d, db args size: %d, "
+            "%d files per dir, %d%% files with extra\n",
+            (int)sizeof(WideServerDentry), (int)sizeof(FDIRServerDentry),
+            (int)sizeof(FDIRServerDentryExtra),
+            (int)sizeof(FDIRServerDentryDBArgs),
+            files_per_dir, extra_percent);
+    printf("bytes per inode, the names, child indexes and inode hash "
+            "table are in both totals\n");
+    printf("%10s %8s %8s %8s %8s %12s %12s %10s\n", "inodes", "storage",
+            "name", "index", "inode_ht", "wide total", "compact total",
+            "saved");
+    for (i=0; i<sizeof(counts) / sizeof(counts[0]); i++) {
+        if ((result=bench(counts[i], files_per_dir,
+                        extra_percent, false)) != 0 ||
+                (result=bench(counts[i], files_per_dir,
+                              extra_percent, true)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
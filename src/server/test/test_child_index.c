@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//test_child_index.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "server/server_types.h"
+#include "server/child_index.h"
+
+#define NAME_POOL_SIZE  8192
+#define OP_COUNT        (2 * 1000 * 1000)
+#define CHECK_INTERVAL  1000
+
+/* the reference: the names sorted by fc_string_compare,
+ * check the child index against it after the random operations */
+typedef struct {
+    string_t *names;
+    int count;
+} ReferenceArray;
+
+static string_t name_pool[NAME_POOL_SIZE];
+static ReferenceArray reference;
+static int64_t live_dentry_count = 0;
+
+static void free_dentry_func(void *ptr, const int delay_seconds)
+{
+    free(ptr);
+    live_dentry_count--;
+}
+
+static FDIRServerDentry *alloc_dentry(const string_t *name)
+{
+    FDIRServerDentry *dentry;
+
+    dentry = (FDIRServerDentry *)fc_malloc(sizeof(FDIRServerDentry));
+    if (dentry == NULL) {
+        return NULL;
+    }
+    memset(dentry, 0, sizeof(FDIRServerDentry));
+    dentry->name = *name;
+    live_dentry_count++;
+    return dentry;
+}
+
+static int init_name_pool()
+{
+    char buff[64];
+    int len;
+    int i;
+
+    for (i=0; i<NAME_POOL_SIZE; i++) {
+        //the variable length names with the common prefixes
+        len = snprintf(buff, sizeof(buff), "%.*s%x",
+                rand() % 12, "file-000000-", rand());
+        name_pool[i].str = (char *)fc_malloc(len + 1);
+        if (name_pool[i].str == NULL) {
+            return ENOMEM;
+        }
+        memcpy(name_pool[i].str, buff, len + 1);
+        name_pool[i].len = len;
+    }
+
+    reference.names = (string_t *)fc_malloc(
+            sizeof(string_t) * NAME_POOL_SIZE);
+    return (reference.names != NULL ? 0 : ENOMEM);
+}
+
+//return the first position which name >= the name
+static int reference_find(const string_t *name, bool *found)
+{
+    int low;
+    int high;
+    int mid;
+    int r;
+
+    low = 0;
+    high = reference.count - 1;
+    while (low <= high) {
+        mid = (low + high) / 2;
+        r = fc_string_compare(reference.names + mid, name);
+        if (r < 0) {
+            low = mid + 1;
+        } else if (r > 0) {
+            high = mid - 1;
+        } else {
+            *found = true;
+            return mid;
+        }
+    }
+
+    *found = false;
+    return low;
+}
+
+static int check_insert(FDIRChildIndex *index, const string_t *name)
+{
+    FDIRServerDentry *dentry;
+    bool found;
+    int pos;
+    int result;
+
+    if ((dentry=alloc_dentry(name)) == NULL) {
+        return ENOMEM;
+    }
+
+    pos = reference_find(name, &found);
+    result = child_index_insert(index, dentry);
+    if (found) {
+        free_dentry_func(dentry, 0);
+        if (result != EEXIST) {
+            fprintf(stderr, "insert exist name: %.*s, result: %d != "
+                    "EEXIST\n", name->len, name->str, result);
+            return EINVAL;
+        }
+        return 0;
+    }
+
+    if (result != 0) {
+        fprintf(stderr, "insert name: %.*s fail, result: %d\n",
+                name->len, name->str, result);
+        return result;
+    }
+
+    memmove(reference.names + pos + 1, reference.names + pos,
+            sizeof(string_t) * (reference.count - pos));
+    reference.names[pos] = *name;
+    reference.count++;
+    return 0;
+}
+
+static int check_delete(FDIRChildIndex *index, const string_t *name)
+{
+    FDIRServerDentry target;
+    bool found;
+    int pos;
+    int result;
+
+    target.name = *name;
+    pos = reference_find(name, &found);
+    result = child_index_delete(index, &target);
+    if (!found) {
+        if (result != ENOENT) {
+            fprintf(stderr, "delete not exist name: %.*s, result: %d != "
+                    "ENOENT\n", name->len, name->str, result);
+            return EINVAL;
+        }
+        return 0;
+    }
+
+    if (result != 0) {
+        fprintf(stderr, "delete name: %.*s fail, result: %d\n",
+                name->len, name->str, result);
+        return result;
+    }
+
+    reference.count--;
+    memmove(reference.names + pos, reference.names + pos + 1,
+            sizeof(string_t) * (reference.count - pos));
+    return 0;
+}
+
+static int check_replace(FDIRChildIndex *index, const string_t *name)
+{
+    FDIRServerDentry *dentry;
+    bool found;
+    int result;
+
+    if ((dentry=alloc_dentry(name)) == NULL) {
+        return ENOMEM;
+    }
+
+    reference_find(name, &found);
+    result = child_index_replace(index, dentry);
+    if (result != (found ? 0 : ENOENT)) {
+        fprintf(stderr, "replace name: %.*s, exist: %d, result: %d\n",
+                name->len, name->str, found, result);
+        return EINVAL;
+    }
+    if (!found) {
+        free_dentry_func(dentry, 0);
+    } else if (child_index_find(index, name) != dentry) {
+        fprintf(stderr, "replace name: %.*s, find the old one\n",
+                name->len, name->str);
+        return EINVAL;
+    }
+    return 0;
+}
+
+static int check_find(FDIRChildIndex *index, const string_t *name)
+{
+    FDIRServerDentry *dentry;
+    bool found;
+
+    reference_find(name, &found);
+    dentry = child_index_find(index, name);
+    if ((dentry != NULL) != found || (dentry != NULL &&
+                !fc_string_equal(&dentry->name, name)))
+    {
+        fprintf(stderr, "find name: %.*s, expect found: %d, "
+                "but dentry: %p\n", name->len, name->str, found, dentry);
+        return EINVAL;
+    }
+    return 0;
+}
+
+//the full iteration and the iteration after a random name
+static int check_iterate(FDIRChildIndex *index)
+{
+    FDIRChildIndexIterator it;
+    FDIRServerDentry *dentry;
+    const string_t *last_name;
+    bool found;
+    int pos;
+    int i;
+
+    if (child_index_count(index) != reference.count) {
+        fprintf(stderr, "child count: %d != reference count: %d\n",
+                child_index_count(index), reference.count);
+        return EINVAL;
+    }
+
+    i = 0;
+    child_index_iterator(index, &it);
+    while ((dentry=child_index_next(&it)) != NULL) {
+        if (i >= reference.count || !fc_string_equal(
+                    &dentry->name, reference.names + i))
+        {
+            fprintf(stderr, "iterate the child #%d: %.*s, "
+                    "out of order\n", i, dentry->name.len,
+                    dentry->name.str);
+            return EINVAL;
+        }
+        i++;
+    }
+    if (i != reference.count) {
+        fprintf(stderr, "iterate count: %d != reference count: %d\n",
+                i, reference.count);
+        return EINVAL;
+    }
+
+    last_name = name_pool + rand() % NAME_POOL_SIZE;
+    pos = reference_find(last_name, &found);
+    if (found) {
+        pos++;
+    }
+    child_index_iterator_after(index, last_name, &it);
+    for (; pos<reference.count; pos++) {
+        dentry = child_index_next(&it);
+        if (dentry == NULL || !fc_string_equal(&dentry->name,
+                    reference.names + pos))
+        {
+            fprintf(stderr, "iterate after name: %.*s, expect: %.*s\n",
+                    last_name->len, last_name->str,
+                    reference.names[pos].len, reference.names[pos].str);
+            return EINVAL;
+        }
+    }
+    if (child_index_next(&it) != NULL) {
+        fprintf(stderr, "iterate after name: %.*s, expect the end\n",
+                last_name->len, last_name->str);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    FDIRChildIndex *index;
+    const string_t *name;
+    unsigned int seed;
+    int target_count;
+    int op;
+    int i;
+    int result;
+
+    seed = (argc > 1 ? strtoul(argv[1], NULL, 10) : (unsigned int)time(NULL));
+    srand(seed);
+    log_init();
+    printf("random seed: %u\n", seed);
+
+    child_index_global_init(free_dentry_func, 0);
+    if ((result=init_name_pool()) != 0) {
+        return result;
+    }
+    if ((index=child_index_new()) == NULL) {
+        return ENOMEM;
+    }
+
+    /* the target count walks randomly across the inline block,
+     * the hash table threshold and the block split */
+    target_count = 0;
+    result = 0;
+    for (i=0; i<OP_COUNT && result == 0; i++) {
+        if (i % 5000 == 0) {
+            target_count = rand() % (4 * FDIR_CHILD_BLOCK_MAX_SIZE + 1);
+            if (rand() % 4 == 0) {
+                target_count = rand() % NAME_POOL_SIZE;
+            }
+        }
+
+        name = name_pool + rand() % NAME_POOL_SIZE;
+        op = rand() % 8;
+        if (op < 3) {
+            if (reference.count < target_count) {
+                result = check_insert(index, name);
+            } else {
+                result = check_delete(index, name);
+            }
+        } else if (op < 5) {
+            //delete an existing one
+            if (reference.count > target_count) {
+                result = check_delete(index, reference.names +
+                        rand() % reference.count);
+            } else {
+                result = check_insert(index, name);
+            }
+        } else if (op == 5) {
+            result = check_replace(index, name);
+        } else {
+            result = check_find(index, name);
+        }
+
+        if (result == 0 && i % CHECK_INTERVAL == 0) {
+            result = check_iterate(index);
+        }
+    }
+
+    if (result == 0) {
+        result = check_iterate(index);
+    }
+    if (result != 0) {
+        fprintf(stderr, "fail at operation #%d, random seed: %u\n",
+                i, seed);
+        return result;
+    }
+
+    child_index_free(index);
+    if (live_dentry_count != 0) {
+        fprintf(stderr, "the dentries not freed: %"PRId64"\n",
+                live_dentry_count);
+        return EINVAL;
+    }
+
+    printf("%d operations passed\n", OP_COUNT);
+    return 0;
+}
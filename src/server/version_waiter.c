@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/fast_mblock.h"
+#include "fastcommon/logger.h"
+#include "sf/sf_global.h"
+#include "sf/sf_nio.h"
+#include "server_global.h"
+#include "server_func.h"
+#include "version_waiter.h"
+
+typedef struct fdir_version_waiter {
+    struct fast_task_info *task;
+    int64_t data_version;
+    int64_t expires_ms;
+    int status;
+    struct fdir_version_waiter *next;
+} FDIRVersionWaiter;
+
+typedef struct fdir_version_waiter_context {
+    struct fast_mblock_man allocator;
+    FDIRVersionWaiter *head;
+    volatile int64_t applied_version;
+    pthread_lock_cond_pair_t lcp;
+} FDIRVersionWaiterContext;
+
+static FDIRVersionWaiterContext waiter_ctx;
+
+int version_waiter_add(struct fast_task_info *task,
+        const int64_t data_version, const int timeout_ms)
+{
+    FDIRVersionWaiter *waiter;
+
+    if ((waiter=(FDIRVersionWaiter *)fast_mblock_alloc_object(
+                    &waiter_ctx.allocator)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    waiter->task = task;
+    waiter->data_version = data_version;
+    waiter->expires_ms = get_current_time_ms() + timeout_ms;
+
+    //wake up the thread for the expire time of the new waiter
+    PTHREAD_MUTEX_LOCK(&waiter_ctx.lcp.lock);
+    waiter->next = waiter_ctx.head;
+    waiter_ctx.head = waiter;
+    pthread_cond_signal(&waiter_ctx.lcp.cond);
+    PTHREAD_MUTEX_UNLOCK(&waiter_ctx.lcp.lock);
+    return 0;
+}
+
+int64_t version_waiter_applied_version()
+{
+    return __sync_add_and_fetch(&waiter_ctx.applied_version, 0);
+}
+
+void version_waiter_set_applied(const int64_t data_version)
+{
+    int64_t old_version;
+
+    while (1) {
+        old_version = __sync_add_and_fetch(&waiter_ctx.applied_version, 0);
+        if (data_version <= old_version) {
+            return;
+        }
+        if (__sync_bool_compare_and_swap(&waiter_ctx.applied_version,
+                    old_version, data_version))
+        {
+            break;
+        }
+    }
+
+    PTHREAD_MUTEX_LOCK(&waiter_ctx.lcp.lock);
+    if (waiter_ctx.head != NULL) {
+        pthread_cond_signal(&waiter_ctx.lcp.cond);
+    }
+    PTHREAD_MUTEX_UNLOCK(&waiter_ctx.lcp.lock);
+}
+
+/* detach the satisfied or expired waiters, the caller MUST hold the lock
+ * next_expires_ms: return the min expire time of the remain waiters */
+static FDIRVersionWaiter *detach_done_waiters(int64_t *next_expires_ms)
+{
+    FDIRVersionWaiter *waiter;
+    FDIRVersionWaiter *previous;
+    FDIRVersionWaiter *done;
+    int64_t applied_version;
+    int64_t current_ms;
+
+    //the waiters are satisfied by the master after the role changed
+    applied_version = (MYSELF_IS_MASTER ? INT64_MAX :
+            version_waiter_applied_version());
+    current_ms = get_current_time_ms();
+    *next_expires_ms = INT64_MAX;
+    done = NULL;
+    previous = NULL;
+    waiter = waiter_ctx.head;
+    while (waiter != NULL) {
+        if (applied_version >= waiter->data_version) {
+            waiter->status = 0;
+        } else if (current_ms >= waiter->expires_ms) {
+            waiter->status = EAGAIN;
+        } else {
+            if (waiter->expires_ms < *next_expires_ms) {
+                *next_expires_ms = waiter->expires_ms;
+            }
+            previous = waiter;
+            waiter = waiter->next;
+            continue;
+        }
+
+        if (previous == NULL) {
+            waiter_ctx.head = waiter->next;
+        } else {
+            previous->next = waiter->next;
+        }
+        waiter->next = done;
+        done = waiter;
+        waiter = (previous == NULL ? waiter_ctx.head : previous->next);
+    }
+
+    return done;
+}
+
+static void notify_waiters(FDIRVersionWaiter *head)
+{
+    FDIRVersionWaiter *waiter;
+    struct fast_task_info *task;
+
+    while (head != NULL) {
+        waiter = head;
+        head = head->next;
+
+        task = waiter->task;
+        RESPONSE_STATUS = waiter->status;
+        fast_mblock_free_object(&waiter_ctx.allocator, waiter);
+        sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+    }
+}
+
+static void *version_waiter_thread_func(void *arg)
+{
+    FDIRVersionWaiter *done;
+    int64_t next_expires_ms;
+    int64_t wait_ms;
+
+#ifdef OS_LINUX
+    prctl(PR_SET_NAME, "version-waiter");
+#endif
+
+    /* woken up by the new waiter and the applied version change,
+     * or the min expire time of the waiters */
+    PTHREAD_MUTEX_LOCK(&waiter_ctx.lcp.lock);
+    while (SF_G_CONTINUE_FLAG) {
+        if ((done=detach_done_waiters(&next_expires_ms)) != NULL) {
+            PTHREAD_MUTEX_UNLOCK(&waiter_ctx.lcp.lock);
+            notify_waiters(done);
+            PTHREAD_MUTEX_LOCK(&waiter_ctx.lcp.lock);
+            continue;
+        }
+
+        if (waiter_ctx.head == NULL) {
+            pthread_cond_wait(&waiter_ctx.lcp.cond,
+                    &waiter_ctx.lcp.lock);
+        } else {
+            wait_ms = next_expires_ms - get_current_time_ms();
+            if (wait_ms > 0) {
+                server_cond_timedwait_ms(&waiter_ctx.lcp.cond,
+                        &waiter_ctx.lcp.lock, wait_ms);
+            }
+        }
+    }
+    PTHREAD_MUTEX_UNLOCK(&waiter_ctx.lcp.lock);
+
+    return NULL;
+}
+
+int version_waiter_init()
+{
+    int result;
+    pthread_t tid;
+
+    if ((result=fast_mblock_init_ex1(&waiter_ctx.allocator,
+                    "version-waiter", sizeof(FDIRVersionWaiter),
+                    1024, 0, NULL, NULL, true)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=init_pthread_lock_cond_pair(&waiter_ctx.lcp)) != 0) {
+        return result;
+    }
+
+    return fc_create_thread(&tid, version_waiter_thread_func,
+            NULL, SF_G_THREAD_STACK_SIZE);
+}
+
+void version_waiter_destroy()
+{
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//version_waiter.h
+
+#ifndef _VERSION_WAITER_H_
+#define _VERSION_WAITER_H_
+
+#include "server_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int version_waiter_init();
+void version_waiter_destroy();
+
+/* wait until the applied version >= data_version or timeout,
+ * the task is notified with RESPONSE_STATUS 0 or EAGAIN (timeout)
+ */
+int version_waiter_add(struct fast_task_info *task,
+        const int64_t data_version, const int timeout_ms);
+
+/* the data versions <= the applied version are all applied by the slave,
+ * DATA_CURRENT_VERSION can't be used because the records of a replay
+ * batch are applied by the data threads in parallel */
+int64_t version_waiter_applied_version();
+
+/* called when the replay batch done, the data versions <= data_version
+ * are all applied, the satisfied waiters are woken up */
+void version_waiter_set_applied(const int64_t data_version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif